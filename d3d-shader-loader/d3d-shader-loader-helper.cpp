@@ -442,34 +442,39 @@ namespace LoaderPriv {
 		return result;
 	}
 
-	static bool LoadShaderByteCode(std::filesystem::path fullPath, COMPUTE_PIPELINE_STATE_DESC& desc, CompilerFlags flags)
+	/*
+	* @param bRequired: Whether a missing variant is worth a message and a
+	* failure, an optional stage without one is just left empty
+	*/
+	static bool LoadByteCode(nlohmann::json& json, CompilerFlags flags, bool bRequired, ShaderByteCode& outCode)
 	{
-		std::ifstream file(fullPath.native());
-
-		if (!file.is_open())
+		// Only the targets the compiler was asked for are written, the D3D12 loader only cares about DXIL
+		if (!json.contains("DXIL") || !json["DXIL"].contains(CompilerFlagsToStr(flags)))
 		{
-			Error("Failed to open shader file %s for reading", fullPath.c_str());
+			if (!bRequired)
+			{
+				return true;
+			}
+
+			Message("No DXIL %s variant, the shaders were compiled without that target.", CompilerFlagsToStr(flags).c_str());
 			return false;
 		}
 
-		nlohmann::json fileData = nlohmann::json::parse(file);
-
-		std::string encodedData = fileData[CompilerFlagsToStr(flags)];
+		std::string encoded = json["DXIL"][CompilerFlagsToStr(flags)];
 
-		std::vector<uint8_t> res = FromBase64(encodedData);
+		std::vector<uint8_t> res = FromBase64(encoded);
 
 		if (res.size() == 0)
 		{
-			Error("Failed to decode data in %s", fullPath.c_str());
 			return false;
 		}
 
-		std::swap(res, desc.CS);
+		outCode.Assign(std::move(res));
 
 		return true;
 	}
 
-	static bool LoadShaderByteCode(std::filesystem::path fullPath, RAYTRACING_PIPELINE_STATE_DESC& desc, CompilerFlags flags)
+	static bool LoadShaderByteCode(std::filesystem::path fullPath, COMPUTE_PIPELINE_STATE_DESC& desc, CompilerFlags flags)
 	{
 		std::ifstream file(fullPath.native());
 
@@ -481,33 +486,32 @@ namespace LoaderPriv {
 
 		nlohmann::json fileData = nlohmann::json::parse(file);
 
-		std::string encodedData = fileData[CompilerFlagsToStr(flags)];
-
-		std::vector<uint8_t> res = FromBase64(encodedData);
-
-		if (res.size() == 0)
+		if (!LoadByteCode(fileData, flags, true, desc.CS))
 		{
 			Error("Failed to decode data in %s", fullPath.c_str());
 			return false;
 		}
 
-		std::swap(res, desc.Library);
-
 		return true;
 	}
 
-	static bool LoadByteCode(nlohmann::json& json, CompilerFlags flags, ShaderByteCode& outCode)
+	static bool LoadShaderByteCode(std::filesystem::path fullPath, RAYTRACING_PIPELINE_STATE_DESC& desc, CompilerFlags flags)
 	{
-		std::string encoded = json[CompilerFlagsToStr(flags)];
-
-		std::vector<uint8_t> res = FromBase64(encoded);
+		std::ifstream file(fullPath.native());
 
-		if (res.size() == 0)
+		if (!file.is_open())
 		{
+			Error("Failed to open shader file %s for reading", fullPath.c_str());
 			return false;
 		}
 
-		std::swap(res, outCode);
+		nlohmann::json fileData = nlohmann::json::parse(file);
+
+		if (!LoadByteCode(fileData, flags, true, desc.Library))
+		{
+			Error("Failed to decode data in %s", fullPath.c_str());
+			return false;
+		}
 
 		return true;
 	}
@@ -526,7 +530,7 @@ namespace LoaderPriv {
 
 		if (fileData.contains("VertexShader"))
 		{
-			if (!LoadByteCode(fileData["VertexShader"], flags, desc.VS))
+			if (!LoadByteCode(fileData["VertexShader"], flags, true, desc.VS))
 			{
 				Error("Failed to decode data in %s", fullPath.c_str());
 				return false;
@@ -540,7 +544,7 @@ namespace LoaderPriv {
 
 		if (fileData.contains("PixelShader"))
 		{
-			if (!LoadByteCode(fileData["PixelShader"], flags, desc.VS))
+			if (!LoadByteCode(fileData["PixelShader"], flags, true, desc.PS))
 			{
 				Error("Failed to decode data in %s", fullPath.c_str());
 				return false;
@@ -554,7 +558,7 @@ namespace LoaderPriv {
 
 		if (fileData.contains("GeometryShader"))
 		{
-			if (!LoadByteCode(fileData["GeometryShader"], flags, desc.VS))
+			if (!LoadByteCode(fileData["GeometryShader"], flags, false, desc.GS))
 			{
 				Error("Failed to decode data in %s", fullPath.c_str());
 				return false;
@@ -563,7 +567,7 @@ namespace LoaderPriv {
 
 		if (fileData.contains("HullShader"))
 		{
-			if (!LoadByteCode(fileData["HullShader"], flags, desc.VS))
+			if (!LoadByteCode(fileData["HullShader"], flags, false, desc.HS))
 			{
 				Error("Failed to decode data in %s", fullPath.c_str());
 				return false;
@@ -572,12 +576,14 @@ namespace LoaderPriv {
 
 		if (fileData.contains("DomainShader"))
 		{
-			if (!LoadByteCode(fileData["DomainShader"], flags, desc.VS))
+			if (!LoadByteCode(fileData["DomainShader"], flags, false, desc.DS))
 			{
 				Error("Failed to decode data in %s", fullPath.c_str());
 				return false;
 			}
 		}
+
+		return true;
 	}
 
 	bool LoadCmptDescFromJson(const nlohmann::json& json, COMPUTE_PIPELINE_STATE_DESC& desc, std::filesystem::path startPath, CompilerFlags flags)
@@ -740,5 +746,151 @@ namespace LoaderPriv {
 		return true;
 	}
 
+	static void LoadCountsFromPack(const SHADER_PACK_PIPELINE& pipeline, PIPELINE_STATE_RESOURCE_COUNTS& counts)
+	{
+		counts.NumConstantBuffers = pipeline.NumConstantBuffers;
+		counts.NumSamplers = pipeline.NumSamplers;
+		counts.NumShaderResourceViews = pipeline.NumShaderResourceViews;
+		counts.NumUnorderedAccessViews = pipeline.NumUnorderedAccessViews;
+	}
+
+	/*
+	* @param bRequired: See LoadByteCode, most pipelines have no hull, domain or geometry shader
+	*/
+	static bool LoadByteCodeFromPack(const ShaderPackView& pack, const SHADER_PACK_PIPELINE& pipeline, ESHADER_PACK_STAGE stage, CompilerFlags flags, bool bRequired, ShaderByteCode& outCode)
+	{
+		// LoadDirectory opened the DXIL pack for these flags, it has nothing else
+		const SHADER_PACK_BLOB* blob = pack.FindBlob(pipeline, stage, SHADER_PACK_API_DXIL, (uint32_t)flags);
+		if (blob == nullptr || blob->Size == 0)
+		{
+			if (!bRequired)
+			{
+				return true;
+			}
+
+			Message("No DXIL %s variant, the pack was built without that target.", CompilerFlagsToStr(flags).c_str());
+			return false;
+		}
+
+		// No copy, this points into the mapped pack
+		outCode.Reference(pack.GetBlobData(*blob), (size_t)blob->Size);
+		return true;
+	}
+
+	static void LoadDepthStencilOpFromPack(const SHADER_PACK_DEPTH_STENCIL_OP& op, GFX_DEPTH_STENCIL_OP_DESC& desc)
+	{
+		desc.StencilFailOp = (ESTENCIL_OP)op.StencilFailOp;
+		desc.StencilDepthFailOp = (ESTENCIL_OP)op.StencilDepthFailOp;
+		desc.StencilPassOp = (ESTENCIL_OP)op.StencilPassOp;
+		desc.ComparisonFunction = (ECOMPARISON_FUNCTION)op.ComparisonFunction;
+	}
+
+	bool LoadCmptDescFromPack(const ShaderPackView& pack, const SHADER_PACK_PIPELINE& pipeline, COMPUTE_PIPELINE_STATE_DESC& desc, CompilerFlags flags)
+	{
+		if (pipeline.Type != SHADER_PACK_PIPELINE_TYPE_COMPUTE)
+		{
+			Message("Pipeline isn't compute");
+			return false;
+		}
+
+		LoadCountsFromPack(pipeline, desc.Counts);
+
+		return LoadByteCodeFromPack(pack, pipeline, SHADER_PACK_STAGE_COMPUTE, flags, true, desc.CS);
+	}
+
+	bool LoadRTDescFromPack(const ShaderPackView& pack, const SHADER_PACK_PIPELINE& pipeline, RAYTRACING_PIPELINE_STATE_DESC& desc, CompilerFlags flags)
+	{
+		if (pipeline.Type != SHADER_PACK_PIPELINE_TYPE_RAYTRACING)
+		{
+			Message("Pipeline isn't raytracing");
+			return false;
+		}
+
+		LoadCountsFromPack(pipeline, desc.Counts);
+
+		for (uint32_t i = 0; i < pipeline.Raytracing.NumHitGroups; i++)
+		{
+			const SHADER_PACK_HIT_GROUP& hitGroup = pack.GetHitGroup(pipeline.Raytracing.FirstHitGroup + i);
+			desc.bHasClosestHit |= hitGroup.ClosestHit.Length > 0;
+			desc.bHasAnyHit |= hitGroup.AnyHit.Length > 0;
+		}
+
+		return LoadByteCodeFromPack(pack, pipeline, SHADER_PACK_STAGE_LIBRARY, flags, true, desc.Library);
+	}
+
+	bool LoadGfxDescFromPack(const ShaderPackView& pack, const SHADER_PACK_PIPELINE& pipeline, GFX_PIPELINE_STATE_DESC& desc, CompilerFlags flags)
+	{
+		if (pipeline.Type != SHADER_PACK_PIPELINE_TYPE_GRAPHICS)
+		{
+			Message("Pipeline isn't graphics.");
+			return false;
+		}
+
+		LoadCountsFromPack(pipeline, desc.Counts);
+
+		// Already range checked by ShaderPackView::Open
+		const SHADER_PACK_GRAPHICS_STATE& state = pipeline.Graphics;
+		desc.NumRenderTargets = state.NumRenderTargets;
+		desc.PolygonType = (EPOLYGON_TYPE)state.PolygonType;
+		desc.bEnableAlphaToCoverage = state.bEnableAlphaToCoverage;
+		desc.bIndependentBlendEnable = state.bIndependentBlendEnable;
+
+		desc.RasterDesc.bFillSolid = state.bFillSolid;
+		desc.RasterDesc.bCull = state.bCull;
+		desc.RasterDesc.bIsCounterClockwiseForward = state.bIsCounterClockwiseForward;
+		desc.RasterDesc.bDepthClipEnable = state.bDepthClipEnable;
+		desc.RasterDesc.bAntialiasedLineEnabled = state.bAntialiasedLineEnabled;
+		desc.RasterDesc.bMultisampleEnable = state.bMultisampleEnable;
+		desc.RasterDesc.DepthBiasClamp = state.DepthBiasClamp;
+		desc.RasterDesc.SlopeScaledDepthBias = state.SlopeScaledDepthBias;
+		desc.RasterDesc.MultisampleLevel = (EMULTISAMPLE_LEVEL)state.MultisampleLevel;
+
+		for (uint32_t i = 0; i < desc.NumRenderTargets; i++)
+		{
+			const SHADER_PACK_RENDER_TARGET& packRtv = state.RenderTargets[i];
+			GFX_RENDER_TARGET_DESC& rtv = desc.RtvDescs[i];
+			rtv.bBlendEnable = packRtv.bBlendEnable;
+			rtv.bLogicOpEnable = packRtv.bLogicOpEnable;
+			rtv.SrcBlend = (EBLEND_STYLE)packRtv.SrcBlend;
+			rtv.DstBlend = (EBLEND_STYLE)packRtv.DstBlend;
+			rtv.BlendOp = (EBLEND_OP)packRtv.BlendOp;
+			rtv.SrcBlendAlpha = (EBLEND_STYLE)packRtv.SrcBlendAlpha;
+			rtv.DstBlendAlpha = (EBLEND_STYLE)packRtv.DstBlendAlpha;
+			rtv.AlphaBlendOp = (EBLEND_OP)packRtv.AlphaBlendOp;
+			rtv.LogicOp = (ELOGIC_OP)packRtv.LogicOp;
+			rtv.Format = (EFORMAT)packRtv.Format;
+		}
+
+		desc.InputLayout.InputItems.resize(state.NumInputItems);
+		for (uint32_t i = 0; i < state.NumInputItems; i++)
+		{
+			const SHADER_PACK_INPUT_ITEM& item = pack.GetInputItem(state.FirstInputItem + i);
+			desc.InputLayout.InputItems[i].Name = std::string(pack.GetString(item.Name));
+			desc.InputLayout.InputItems[i].ItemFormat = (EINPUT_ITEM_FORMAT)item.Format;
+		}
+
+		desc.DepthStencilState.Format = (EFORMAT)state.DepthStencilFormat;
+		desc.DepthStencilState.bDepthEnable = state.bDepthEnable;
+		desc.DepthStencilState.DepthWriteMask = state.DepthWriteMask;
+		desc.DepthStencilState.DepthFunction = (ECOMPARISON_FUNCTION)state.DepthFunction;
+		desc.DepthStencilState.bStencilEnable = state.bStencilEnable;
+		LoadDepthStencilOpFromPack(state.FrontFace, desc.DepthStencilState.FrontFace);
+		LoadDepthStencilOpFromPack(state.BackFace, desc.DepthStencilState.BackFace);
+
+		// Vertex and pixel are required, the rest are only there if they were compiled
+		if (!LoadByteCodeFromPack(pack, pipeline, SHADER_PACK_STAGE_VERTEX, flags, true, desc.VS) ||
+			!LoadByteCodeFromPack(pack, pipeline, SHADER_PACK_STAGE_PIXEL, flags, true, desc.PS))
+		{
+			Error("Failed to find bytecode for %.*s", (int)pipeline.Name.Length, pack.GetString(pipeline.Name).data());
+			return false;
+		}
+
+		LoadByteCodeFromPack(pack, pipeline, SHADER_PACK_STAGE_HULL, flags, false, desc.HS);
+		LoadByteCodeFromPack(pack, pipeline, SHADER_PACK_STAGE_DOMAIN, flags, false, desc.DS);
+		LoadByteCodeFromPack(pack, pipeline, SHADER_PACK_STAGE_GEOMETRY, flags, false, desc.GS);
+
+		return true;
+	}
+
 }
 
@@ -4,6 +4,7 @@
 #include <nlohmann.hpp>
 #include <filesystem>
 #include "d3d-shader-loader-types.h"
+#include "d3d-shader-loader-pack-format.h"
 
 
 /*
@@ -55,5 +56,11 @@ namespace LoaderPriv {
 	bool LoadGfxRTDescFromJson(const nlohmann::json& json, GFX_RENDER_TARGET_DESC* outDesc, uint32_t numRenderTargets);
 
 	bool LoadGfxDepthStencilDescFromJson(const nlohmann::json& json, GFX_DEPTH_STENCIL_DESC& desc);
+
+	bool LoadCmptDescFromPack(const ShaderPackView& pack, const SHADER_PACK_PIPELINE& pipeline, COMPUTE_PIPELINE_STATE_DESC& desc, CompilerFlags flags);
+
+	bool LoadRTDescFromPack(const ShaderPackView& pack, const SHADER_PACK_PIPELINE& pipeline, RAYTRACING_PIPELINE_STATE_DESC& desc, CompilerFlags flags);
+
+	bool LoadGfxDescFromPack(const ShaderPackView& pack, const SHADER_PACK_PIPELINE& pipeline, GFX_PIPELINE_STATE_DESC& desc, CompilerFlags flags);
 }
 
@@ -0,0 +1,146 @@
+#include "d3d-shader-loader-mapped-file.h"
+
+#ifndef WINDOWS_BUILD
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+namespace LoaderPriv {
+
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+#ifdef WINDOWS_BUILD
+
+	bool MappedFile::Open(const std::filesystem::path& path)
+	{
+		Close();
+
+		m_File = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (m_File == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER size = { };
+		if (!GetFileSizeEx(m_File, &size) || size.QuadPart == 0)
+		{
+			Close();
+			return false;
+		}
+
+		m_Mapping = CreateFileMappingW(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_Mapping == nullptr)
+		{
+			Close();
+			return false;
+		}
+
+		m_Data = (const uint8_t*)MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0);
+		if (m_Data == nullptr)
+		{
+			Close();
+			return false;
+		}
+
+		m_Size = (uint64_t)size.QuadPart;
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_Data != nullptr)
+		{
+			UnmapViewOfFile(m_Data);
+		}
+		if (m_Mapping != nullptr)
+		{
+			CloseHandle(m_Mapping);
+		}
+		if (m_File != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(m_File);
+		}
+
+		m_Data = nullptr;
+		m_Size = 0;
+		m_Mapping = nullptr;
+		m_File = INVALID_HANDLE_VALUE;
+	}
+
+	void MappedFile::WillNeed()
+	{
+		if (m_Data == nullptr)
+		{
+			return;
+		}
+
+		// Windows 8+, just a hint so failing is fine
+		WIN32_MEMORY_RANGE_ENTRY range = { };
+		range.VirtualAddress = (PVOID)m_Data;
+		range.NumberOfBytes = (SIZE_T)m_Size;
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+	}
+
+#else
+
+	bool MappedFile::Open(const std::filesystem::path& path)
+	{
+		Close();
+
+		int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+		{
+			return false;
+		}
+
+		struct stat st = { };
+		if (fstat(fd, &st) != 0 || st.st_size <= 0)
+		{
+			close(fd);
+			return false;
+		}
+
+		// The mapping keeps the file alive, no need to hold on to fd
+		void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (data == MAP_FAILED)
+		{
+			return false;
+		}
+
+		m_Data = (const uint8_t*)data;
+		m_Size = (uint64_t)st.st_size;
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_Data != nullptr)
+		{
+			munmap((void*)m_Data, (size_t)m_Size);
+		}
+
+		m_Data = nullptr;
+		m_Size = 0;
+	}
+
+	void MappedFile::WillNeed()
+	{
+		if (m_Data == nullptr)
+		{
+			return;
+		}
+
+		madvise((void*)m_Data, (size_t)m_Size, MADV_SEQUENTIAL);
+		madvise((void*)m_Data, (size_t)m_Size, MADV_WILLNEED);
+	}
+
+#endif
+
+}
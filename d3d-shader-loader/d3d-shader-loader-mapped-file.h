@@ -0,0 +1,61 @@
+#pragma once
+#include <stdint.h>
+#include <filesystem>
+
+#ifdef WINDOWS_BUILD
+#include <windows.h>
+#endif
+
+
+namespace LoaderPriv {
+
+	/*
+	* Read only memory mapping of a whole file.
+	* MapViewOfFile on WINDOWS_BUILD, mmap everywhere else.
+	*/
+	class MappedFile
+	{
+	public:
+
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool Open(const std::filesystem::path& path);
+
+		/*
+		* @brief: Unmaps the file, the OS can drop its pages straight away.
+		* Anything pointing into GetData() is invalid afterwards.
+		*/
+		void Close();
+
+		/*
+		* @brief: Hints that the whole file is about to be read front to back
+		* so the OS can start reading it in ahead of us.
+		*/
+		void WillNeed();
+
+		const uint8_t* GetData() const
+		{
+			return m_Data;
+		}
+
+		uint64_t GetSize() const
+		{
+			return m_Size;
+		}
+
+	private:
+
+		const uint8_t* m_Data = nullptr;
+		uint64_t m_Size = 0;
+
+#ifdef WINDOWS_BUILD
+		HANDLE m_File = INVALID_HANDLE_VALUE;
+		HANDLE m_Mapping = nullptr;
+#endif
+	};
+
+}
@@ -0,0 +1,371 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <string_view>
+
+
+/*
+* Binary layout of the ShaderPipelines.<api>.<flags>.pack files
+*
+* ANY CHANGES HERE NEED TO BE REFLECTED IN shader-compiler/ShaderPackFormat.h
+* Kept as a copy so everything in d3d-shader-loader can still be dragged and
+* dropped into any project. Any change to the layout must bump SHADER_PACK_VERSION.
+*
+* Layout, every section starts SHADER_PACK_ALIGNMENT aligned:
+*	SHADER_PACK_HEADER
+*	SHADER_PACK_PIPELINE[NumPipelines]
+*	SHADER_PACK_BLOB[NumBlobs]
+*	SHADER_PACK_INPUT_ITEM[NumInputItems]
+*	SHADER_PACK_HIT_GROUP[NumHitGroups]
+*	char Strings[StringsSize]
+*	Bytecode, every blob SHADER_PACK_ALIGNMENT aligned
+*
+* Everything is plain old data, offsets are from the start of the file
+* and all values are little endian.
+*/
+
+static constexpr uint32_t SHADER_PACK_MAGIC = 0x4b415053; // "SPAK"
+static constexpr uint32_t SHADER_PACK_VERSION = 1;
+static constexpr uint64_t SHADER_PACK_ALIGNMENT = 16;
+
+typedef enum ESHADER_PACK_PIPELINE_TYPE {
+	SHADER_PACK_PIPELINE_TYPE_GRAPHICS,
+	SHADER_PACK_PIPELINE_TYPE_COMPUTE,
+	SHADER_PACK_PIPELINE_TYPE_RAYTRACING
+} ESHADER_PACK_PIPELINE_TYPE;
+
+typedef enum ESHADER_PACK_STAGE {
+	SHADER_PACK_STAGE_VERTEX,
+	SHADER_PACK_STAGE_HULL,
+	SHADER_PACK_STAGE_DOMAIN,
+	SHADER_PACK_STAGE_GEOMETRY,
+	SHADER_PACK_STAGE_PIXEL,
+	SHADER_PACK_STAGE_COMPUTE,
+	SHADER_PACK_STAGE_LIBRARY
+} ESHADER_PACK_STAGE;
+
+typedef enum ESHADER_PACK_API {
+	SHADER_PACK_API_DXIL,
+	SHADER_PACK_API_SPIRV
+} ESHADER_PACK_API;
+
+/*
+* Each api and CompilerFlags pair is written to a pack of its own so a
+* client only maps the one variant it runs, e.g. ShaderPipelines.dxil.release.pack
+*/
+inline std::string ShaderPackFileName(ESHADER_PACK_API api, uint32_t flags)
+{
+	std::string name = "ShaderPipelines.";
+	name += api == SHADER_PACK_API_DXIL ? "dxil" : "spirv";
+	name += flags == 0 ? ".debug" : ".release";
+	return name + ".pack";
+}
+
+typedef struct SHADER_PACK_HEADER {
+	uint32_t Magic;
+	uint32_t Version;
+	uint64_t FileSize;
+	uint32_t NumPipelines;
+	uint32_t NumBlobs;
+	uint32_t NumInputItems;
+	uint32_t NumHitGroups;
+	uint64_t PipelinesOffset;
+	uint64_t BlobsOffset;
+	uint64_t InputItemsOffset;
+	uint64_t HitGroupsOffset;
+	uint64_t StringsOffset;
+	uint64_t StringsSize;
+} SHADER_PACK_HEADER;
+
+// Offset is relative to the start of the string section, not null terminated
+typedef struct SHADER_PACK_STRING {
+	uint32_t Offset;
+	uint32_t Length;
+} SHADER_PACK_STRING;
+
+/*
+* One compiled variant of one stage. Only the variants that were
+* actually compiled are written, so look them up with FindBlob.
+*/
+typedef struct SHADER_PACK_BLOB {
+	uint64_t Offset;
+	uint64_t Size;
+	uint8_t Stage;	// ESHADER_PACK_STAGE
+	uint8_t Api;	// ESHADER_PACK_API
+	uint8_t Flags;	// CompilerFlags
+	uint8_t Padding[5];
+} SHADER_PACK_BLOB;
+
+typedef struct SHADER_PACK_INPUT_ITEM {
+	SHADER_PACK_STRING Name;
+	uint32_t Format; // EINPUT_ITEM_FORMAT
+	uint32_t Padding;
+} SHADER_PACK_INPUT_ITEM;
+
+typedef struct SHADER_PACK_HIT_GROUP {
+	SHADER_PACK_STRING ClosestHit;
+	SHADER_PACK_STRING AnyHit;
+	SHADER_PACK_STRING ExportName;
+} SHADER_PACK_HIT_GROUP;
+
+typedef struct SHADER_PACK_DEPTH_STENCIL_OP {
+	uint8_t StencilFailOp;		// ESTENCIL_OP
+	uint8_t StencilDepthFailOp;	// ESTENCIL_OP
+	uint8_t StencilPassOp;		// ESTENCIL_OP
+	uint8_t ComparisonFunction;	// ECOMPARISON_FUNCTION
+} SHADER_PACK_DEPTH_STENCIL_OP;
+
+typedef struct SHADER_PACK_RENDER_TARGET {
+	uint8_t bBlendEnable;
+	uint8_t bLogicOpEnable;
+	uint8_t SrcBlend;		// EBLEND_STYLE
+	uint8_t DstBlend;		// EBLEND_STYLE
+	uint8_t BlendOp;		// EBLEND_OP
+	uint8_t SrcBlendAlpha;	// EBLEND_STYLE
+	uint8_t DstBlendAlpha;	// EBLEND_STYLE
+	uint8_t AlphaBlendOp;	// EBLEND_OP
+	uint8_t LogicOp;		// ELOGIC_OP
+	uint8_t Padding[3];
+	uint32_t Format;		// EFORMAT
+} SHADER_PACK_RENDER_TARGET;
+
+typedef struct SHADER_PACK_GRAPHICS_STATE {
+	uint32_t PolygonType;	// EPOLYGON_TYPE
+	uint32_t NumRenderTargets;
+	uint32_t FirstInputItem;
+	uint32_t NumInputItems;
+
+	uint8_t bFillSolid;
+	uint8_t bCull;
+	uint8_t bIsCounterClockwiseForward;
+	uint8_t bDepthClipEnable;
+	uint8_t bAntialiasedLineEnabled;
+	uint8_t bMultisampleEnable;
+	uint8_t bEnableAlphaToCoverage;
+	uint8_t bIndependentBlendEnable;
+	float DepthBiasClamp;
+	float SlopeScaledDepthBias;
+	uint32_t MultisampleLevel; // EMULTISAMPLE_LEVEL
+
+	uint32_t DepthStencilFormat; // EFORMAT
+	uint32_t DepthWriteMask;
+	uint8_t bDepthEnable;
+	uint8_t bStencilEnable;
+	uint8_t DepthFunction; // ECOMPARISON_FUNCTION
+	uint8_t Padding;
+	SHADER_PACK_DEPTH_STENCIL_OP FrontFace;
+	SHADER_PACK_DEPTH_STENCIL_OP BackFace;
+
+	SHADER_PACK_RENDER_TARGET RenderTargets[8];
+} SHADER_PACK_GRAPHICS_STATE;
+
+typedef struct SHADER_PACK_RAYTRACING_STATE {
+	uint32_t PayloadSizeInBytes;
+	uint32_t MaxRaytraceRecurseDepth;
+	uint32_t FirstHitGroup;
+	uint32_t NumHitGroups;
+} SHADER_PACK_RAYTRACING_STATE;
+
+/*
+* Fixed size so the table can be indexed directly,
+* only the state matching Type is filled in.
+*/
+typedef struct SHADER_PACK_PIPELINE {
+	SHADER_PACK_STRING Name;
+	uint32_t Type; // ESHADER_PACK_PIPELINE_TYPE
+	uint8_t NumConstantBuffers;
+	uint8_t NumShaderResourceViews;
+	uint8_t NumUnorderedAccessViews;
+	uint8_t NumSamplers;
+	uint32_t FirstBlob;
+	uint32_t NumBlobs;
+	SHADER_PACK_GRAPHICS_STATE Graphics;
+	SHADER_PACK_RAYTRACING_STATE Raytracing;
+} SHADER_PACK_PIPELINE;
+
+static_assert(sizeof(SHADER_PACK_HEADER) == 80, "Shader pack layout changed, bump SHADER_PACK_VERSION");
+static_assert(sizeof(SHADER_PACK_BLOB) == 24, "Shader pack layout changed, bump SHADER_PACK_VERSION");
+static_assert(sizeof(SHADER_PACK_INPUT_ITEM) == 16, "Shader pack layout changed, bump SHADER_PACK_VERSION");
+static_assert(sizeof(SHADER_PACK_HIT_GROUP) == 24, "Shader pack layout changed, bump SHADER_PACK_VERSION");
+static_assert(sizeof(SHADER_PACK_RENDER_TARGET) == 16, "Shader pack layout changed, bump SHADER_PACK_VERSION");
+static_assert(sizeof(SHADER_PACK_GRAPHICS_STATE) == 184, "Shader pack layout changed, bump SHADER_PACK_VERSION");
+static_assert(sizeof(SHADER_PACK_PIPELINE) == 224, "Shader pack layout changed, bump SHADER_PACK_VERSION");
+
+
+/*
+* Read only view over a pack that's already in memory, doesn't own the data.
+* Open validates every offset, count and range in the file so none
+* of the accessors have to.
+*/
+class ShaderPackView
+{
+public:
+
+	inline bool Open(const uint8_t* data, uint64_t size)
+	{
+		m_Data = nullptr;
+		m_Size = 0;
+		m_Header = nullptr;
+
+		if (data == nullptr || size < sizeof(SHADER_PACK_HEADER))
+		{
+			return false;
+		}
+
+		const SHADER_PACK_HEADER* header = (const SHADER_PACK_HEADER*)data;
+		if (header->Magic != SHADER_PACK_MAGIC ||
+			header->Version != SHADER_PACK_VERSION ||
+			header->FileSize != size)
+		{
+			return false;
+		}
+
+		if (!IsRangeValid(header->PipelinesOffset, (uint64_t)header->NumPipelines * sizeof(SHADER_PACK_PIPELINE), size) ||
+			!IsRangeValid(header->BlobsOffset, (uint64_t)header->NumBlobs * sizeof(SHADER_PACK_BLOB), size) ||
+			!IsRangeValid(header->InputItemsOffset, (uint64_t)header->NumInputItems * sizeof(SHADER_PACK_INPUT_ITEM), size) ||
+			!IsRangeValid(header->HitGroupsOffset, (uint64_t)header->NumHitGroups * sizeof(SHADER_PACK_HIT_GROUP), size) ||
+			!IsRangeValid(header->StringsOffset, header->StringsSize, size))
+		{
+			return false;
+		}
+
+		m_Data = data;
+		m_Size = size;
+		m_Header = header;
+
+		for (uint32_t i = 0; i < header->NumBlobs; i++)
+		{
+			const SHADER_PACK_BLOB& blob = GetBlob(i);
+			if (!IsRangeValid(blob.Offset, blob.Size, size))
+			{
+				return Fail();
+			}
+		}
+
+		for (uint32_t i = 0; i < header->NumInputItems; i++)
+		{
+			if (!IsStringValid(GetInputItem(i).Name))
+			{
+				return Fail();
+			}
+		}
+
+		for (uint32_t i = 0; i < header->NumHitGroups; i++)
+		{
+			const SHADER_PACK_HIT_GROUP& hitGroup = GetHitGroup(i);
+			if (!IsStringValid(hitGroup.ClosestHit) || !IsStringValid(hitGroup.AnyHit) || !IsStringValid(hitGroup.ExportName))
+			{
+				return Fail();
+			}
+		}
+
+		for (uint32_t i = 0; i < header->NumPipelines; i++)
+		{
+			const SHADER_PACK_PIPELINE& pipeline = GetPipeline(i);
+			if (!IsStringValid(pipeline.Name) ||
+				(uint64_t)pipeline.FirstBlob + pipeline.NumBlobs > header->NumBlobs ||
+				(uint64_t)pipeline.Graphics.FirstInputItem + pipeline.Graphics.NumInputItems > header->NumInputItems ||
+				(uint64_t)pipeline.Raytracing.FirstHitGroup + pipeline.Raytracing.NumHitGroups > header->NumHitGroups ||
+				pipeline.Graphics.NumRenderTargets > 8)
+			{
+				return Fail();
+			}
+		}
+
+		return true;
+	}
+
+	inline bool IsOpen() const
+	{
+		return m_Header != nullptr;
+	}
+
+	inline uint32_t GetNumPipelines() const
+	{
+		return m_Header ? m_Header->NumPipelines : 0;
+	}
+
+	inline const SHADER_PACK_PIPELINE& GetPipeline(uint32_t idx) const
+	{
+		return ((const SHADER_PACK_PIPELINE*)(m_Data + m_Header->PipelinesOffset))[idx];
+	}
+
+	inline const SHADER_PACK_BLOB& GetBlob(uint32_t idx) const
+	{
+		return ((const SHADER_PACK_BLOB*)(m_Data + m_Header->BlobsOffset))[idx];
+	}
+
+	inline const SHADER_PACK_INPUT_ITEM& GetInputItem(uint32_t idx) const
+	{
+		return ((const SHADER_PACK_INPUT_ITEM*)(m_Data + m_Header->InputItemsOffset))[idx];
+	}
+
+	inline const SHADER_PACK_HIT_GROUP& GetHitGroup(uint32_t idx) const
+	{
+		return ((const SHADER_PACK_HIT_GROUP*)(m_Data + m_Header->HitGroupsOffset))[idx];
+	}
+
+	inline std::string_view GetString(const SHADER_PACK_STRING& str) const
+	{
+		return std::string_view((const char*)(m_Data + m_Header->StringsOffset + str.Offset), str.Length);
+	}
+
+	inline const uint8_t* GetBlobData(const SHADER_PACK_BLOB& blob) const
+	{
+		return m_Data + blob.Offset;
+	}
+
+	inline bool FindPipeline(std::string_view name, uint32_t& outIdx) const
+	{
+		for (uint32_t i = 0; i < GetNumPipelines(); i++)
+		{
+			if (GetString(GetPipeline(i).Name) == name)
+			{
+				outIdx = i;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/*
+	* @returns: nullptr if the pipeline has no such variant
+	*/
+	inline const SHADER_PACK_BLOB* FindBlob(const SHADER_PACK_PIPELINE& pipeline, ESHADER_PACK_STAGE stage, ESHADER_PACK_API api, uint32_t flags) const
+	{
+		for (uint32_t i = pipeline.FirstBlob; i < pipeline.FirstBlob + pipeline.NumBlobs; i++)
+		{
+			const SHADER_PACK_BLOB& blob = GetBlob(i);
+			if (blob.Stage == stage && blob.Api == api && blob.Flags == flags)
+			{
+				return &blob;
+			}
+		}
+		return nullptr;
+	}
+
+private:
+
+	static inline bool IsRangeValid(uint64_t offset, uint64_t size, uint64_t fileSize)
+	{
+		return offset <= fileSize && size <= fileSize - offset && (offset % 8) == 0;
+	}
+
+	inline bool IsStringValid(const SHADER_PACK_STRING& str) const
+	{
+		return (uint64_t)str.Offset + str.Length <= m_Header->StringsSize;
+	}
+
+	inline bool Fail()
+	{
+		m_Data = nullptr;
+		m_Size = 0;
+		m_Header = nullptr;
+		return false;
+	}
+
+	const uint8_t* m_Data = nullptr;
+	uint64_t m_Size = 0;
+	const SHADER_PACK_HEADER* m_Header = nullptr;
+};
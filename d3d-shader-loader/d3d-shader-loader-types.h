@@ -2,6 +2,7 @@
 #include <stdint.h>
 #include <vector>
 #include <string>
+#include <utility>
 #include "d3d-shader-loader-format.h"
 
 
@@ -24,7 +25,45 @@ inline std::string CompilerFlagsToStr(CompilerFlags flags)
 	return "";
 }
 
-typedef std::vector<uint8_t> ShaderByteCode;
+/*
+* Bytecode for one stage. Loaded from a pack it points straight into the
+* mapped file, which stays mapped until every pipeline has been created.
+* Loaded from json it owns the decoded bytes.
+*/
+class ShaderByteCode
+{
+public:
+
+	void Assign(std::vector<uint8_t>&& bytes)
+	{
+		m_Storage = std::move(bytes);
+		m_View = nullptr;
+		m_ViewSize = 0;
+	}
+
+	void Reference(const uint8_t* data, size_t size)
+	{
+		m_Storage.clear();
+		m_View = data;
+		m_ViewSize = size;
+	}
+
+	const uint8_t* data() const
+	{
+		return m_Storage.empty() ? m_View : m_Storage.data();
+	}
+
+	size_t size() const
+	{
+		return m_Storage.empty() ? m_ViewSize : m_Storage.size();
+	}
+
+private:
+
+	const uint8_t* m_View = nullptr;
+	size_t m_ViewSize = 0;
+	std::vector<uint8_t> m_Storage;
+};
 
 typedef enum ESHADER_PARAMETER_TYPE {
 	SHADER_PARAMETER_TYPE_CBV,
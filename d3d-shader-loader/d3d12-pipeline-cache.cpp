@@ -71,59 +71,128 @@ bool D3D12PipelineCache::LoadDirectory(const std::filesystem::path& dirPath, Com
 		return false;
 	}
 
+	// The compiler writes a pack per target, only the DXIL one for these flags
+	// is read. ShaderPipelines.json is only there if it was run with --json for debugging
+	std::filesystem::path packFile = dirPath / ShaderPackFileName(SHADER_PACK_API_DXIL, (uint32_t)flags);
+	if (std::filesystem::is_regular_file(packFile))
+	{
+		return LoadPack(packFile, flags);
+	}
+
 	std::filesystem::path shaderFile = dirPath / "ShaderPipelines.json";
 
 	if (!std::filesystem::is_regular_file(shaderFile))
 	{
-		m_print->Error("%s does not exist, unable to load pipelines", shaderFile.c_str());
+		m_print->Error("Neither %s nor %s exist, unable to load pipelines. Was the compiler run with that target?", packFile.string().c_str(), shaderFile.string().c_str());
 		return false;
 	}
 
-	std::ifstream metadataFile(shaderFile);
-	nlohmann::json json = nlohmann::json::parse(metadataFile);
+	return LoadJson(dirPath, flags);
+}
 
-	for (auto entry = json.begin(); entry != json.end(); entry++)
+bool D3D12PipelineCache::LoadPack(const std::filesystem::path& packFile, CompilerFlags flags)
+{
+	// The bytecode in every desc points straight into the mapping,
+	// it has to stay mapped until the last pipeline is created
+	LoaderPriv::MappedFile file;
+	if (!file.Open(packFile))
 	{
-		auto data = entry.value();
-		std::string type = data["Type"].get<std::string>();
+		m_print->Error("Failed to map %s", packFile.string().c_str());
+		return false;
+	}
 
-		m_print->Message("Attempting to load pipeline %s", entry.key().c_str());
+	// Pipelines and their blobs are laid out in the order we walk them
+	file.WillNeed();
 
-		if (type == "Graphics")
+	ShaderPackView pack;
+	if (!pack.Open(file.GetData(), file.GetSize()))
+	{
+		m_print->Error("%s is corrupt or was written by a different version of the compiler", packFile.string().c_str());
+		return false;
+	}
+
+	for (uint32_t i = 0; i < pack.GetNumPipelines(); i++)
+	{
+		const SHADER_PACK_PIPELINE& pipeline = pack.GetPipeline(i);
+		std::string name(pack.GetString(pipeline.Name));
+
+		m_print->Message("Attempting to load pipeline %s", name.c_str());
+
+		if (pipeline.Type == SHADER_PACK_PIPELINE_TYPE_GRAPHICS)
 		{
-			GFX_PIPELINE_STATE_DESC desc = { };
-			if (!LoaderPriv::LoadGfxDescFromJson(data, desc, dirPath, flags))
+			GFX_PIPELINE_STATE_DESC desc(INIT_DEFAULT);
+			if (!LoaderPriv::LoadGfxDescFromPack(pack, pipeline, desc, flags))
 			{
 				m_print->Error("Failed to load pipeline");
 				return false;
 			}
 
-			D3D12_GRAPHICS_PIPELINE_STATE_DESC d3dDesc = LoaderPriv::D3D12_TranslateGfxDesc(desc);
-			ID3D12RootSignature* rootSig = m_rootSigLib.FindBest(
-				desc.Counts.NumConstantBuffers,
-				desc.Counts.NumShaderResourceViews,
-				desc.Counts.NumSamplers,
-				desc.Counts.NumUnorderedAccessViews
-			);
+			if (!CreateGfxPipeline(name, desc))
+			{
+				return false;
+			}
+		}
+		else if (pipeline.Type == SHADER_PACK_PIPELINE_TYPE_COMPUTE)
+		{
+			COMPUTE_PIPELINE_STATE_DESC desc = { };
+			if (!LoaderPriv::LoadCmptDescFromPack(pack, pipeline, desc, flags))
+			{
+				m_print->Error("Failed to load pipeline");
+				return false;
+			}
 
-			if (rootSig == nullptr)
+			if (!CreateCmptPipeline(name, desc))
 			{
-				m_print->Error("Failed to assign a root signature to pipeline");
 				return false;
 			}
+		}
+		else if (pipeline.Type == SHADER_PACK_PIPELINE_TYPE_RAYTRACING)
+		{
+			if (!m_hasRaytracingSupport)
+			{
+				m_print->Message("Skipping raytracing pipeline");
+				continue;
+			}
 
-			d3dDesc.pRootSignature = rootSig;
+			RAYTRACING_PIPELINE_STATE_DESC desc = { };
+			if (!LoaderPriv::LoadRTDescFromPack(pack, pipeline, desc, flags))
+			{
+				m_print->Error("Failed to load pipeline");
+				return false;
+			}
+		}
+	}
+
+	// Nothing references the pack anymore, let the OS have the pages back
+	file.Close();
+	return true;
+}
 
-			D3DPipeline newEntry = { };
-			newEntry.RootSignature = rootSig;
+bool D3D12PipelineCache::LoadJson(const std::filesystem::path& dirPath, CompilerFlags flags)
+{
+	std::ifstream metadataFile(dirPath / "ShaderPipelines.json");
+	nlohmann::json json = nlohmann::json::parse(metadataFile);
 
-			if (FAILED(m_device->CreateGraphicsPipelineState(&d3dDesc, IID_PPV_ARGS(&newEntry.PipelineState)))) 
+	for (auto entry = json.begin(); entry != json.end(); entry++)
+	{
+		auto data = entry.value();
+		std::string type = data["Type"].get<std::string>();
+
+		m_print->Message("Attempting to load pipeline %s", entry.key().c_str());
+
+		if (type == "Graphics")
+		{
+			GFX_PIPELINE_STATE_DESC desc = { };
+			if (!LoaderPriv::LoadGfxDescFromJson(data, desc, dirPath, flags))
 			{
-				m_print->Error("Failed to create ID3D12PipelineState object");
+				m_print->Error("Failed to load pipeline");
 				return false;
 			}
 
-			m_library[entry.key()] = newEntry;
+			if (!CreateGfxPipeline(entry.key(), desc))
+			{
+				return false;
+			}
 		}
 		else if (type == "Compute")
 		{
@@ -134,32 +203,10 @@ bool D3D12PipelineCache::LoadDirectory(const std::filesystem::path& dirPath, Com
 				return false;
 			}
 
-			D3D12_COMPUTE_PIPELINE_STATE_DESC d3dDesc = LoaderPriv::D3D12_TranslateCmptDesc(desc);
-			ID3D12RootSignature* rootSig = m_rootSigLib.FindBest(
-				desc.Counts.NumConstantBuffers,
-				desc.Counts.NumShaderResourceViews,
-				desc.Counts.NumSamplers,
-				desc.Counts.NumUnorderedAccessViews
-			);
-
-			if (rootSig == nullptr)
-			{
-				m_print->Error("Failed to assign a root signature to pipeline");
-				return false;
-			}
-
-			d3dDesc.pRootSignature = rootSig;
-
-			D3DPipeline newEntry = { };
-			newEntry.RootSignature = rootSig;
-
-			if (FAILED(m_device->CreateComputePipelineState(&d3dDesc, IID_PPV_ARGS(&newEntry.PipelineState))))
+			if (!CreateCmptPipeline(entry.key(), desc))
 			{
-				m_print->Error("Failed to create ID3D12PipelineState object");
 				return false;
 			}
-
-			m_library[entry.key()] = newEntry;
 		}
 		else if (type == "Raytracing")
 		{
@@ -178,6 +225,74 @@ bool D3D12PipelineCache::LoadDirectory(const std::filesystem::path& dirPath, Com
 
 		}
 	}
+
+	return true;
+}
+
+bool D3D12PipelineCache::CreateGfxPipeline(const std::string& name, const GFX_PIPELINE_STATE_DESC& desc)
+{
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC d3dDesc = LoaderPriv::D3D12_TranslateGfxDesc(desc);
+	ID3D12RootSignature* rootSig = m_rootSigLib.FindBest(
+		desc.Counts.NumConstantBuffers,
+		desc.Counts.NumShaderResourceViews,
+		desc.Counts.NumSamplers,
+		desc.Counts.NumUnorderedAccessViews
+	);
+
+	if (rootSig == nullptr)
+	{
+		m_print->Error("Failed to assign a root signature to pipeline");
+		LoaderPriv::FreeD3D12GraphicsPipelineDesc(d3dDesc);
+		return false;
+	}
+
+	d3dDesc.pRootSignature = rootSig;
+
+	D3DPipeline newEntry = { };
+	newEntry.RootSignature = rootSig;
+
+	HRESULT hr = m_device->CreateGraphicsPipelineState(&d3dDesc, IID_PPV_ARGS(&newEntry.PipelineState));
+	LoaderPriv::FreeD3D12GraphicsPipelineDesc(d3dDesc);
+
+	if (FAILED(hr))
+	{
+		m_print->Error("Failed to create ID3D12PipelineState object");
+		return false;
+	}
+
+	m_library[name] = newEntry;
+	return true;
+}
+
+bool D3D12PipelineCache::CreateCmptPipeline(const std::string& name, const COMPUTE_PIPELINE_STATE_DESC& desc)
+{
+	D3D12_COMPUTE_PIPELINE_STATE_DESC d3dDesc = LoaderPriv::D3D12_TranslateCmptDesc(desc);
+	ID3D12RootSignature* rootSig = m_rootSigLib.FindBest(
+		desc.Counts.NumConstantBuffers,
+		desc.Counts.NumShaderResourceViews,
+		desc.Counts.NumSamplers,
+		desc.Counts.NumUnorderedAccessViews
+	);
+
+	if (rootSig == nullptr)
+	{
+		m_print->Error("Failed to assign a root signature to pipeline");
+		return false;
+	}
+
+	d3dDesc.pRootSignature = rootSig;
+
+	D3DPipeline newEntry = { };
+	newEntry.RootSignature = rootSig;
+
+	if (FAILED(m_device->CreateComputePipelineState(&d3dDesc, IID_PPV_ARGS(&newEntry.PipelineState))))
+	{
+		m_print->Error("Failed to create ID3D12PipelineState object");
+		return false;
+	}
+
+	m_library[name] = newEntry;
+	return true;
 }
 
 bool D3D12PipelineCache::FindPipeline(const std::string& name, D3DPipeline* outPipeline)
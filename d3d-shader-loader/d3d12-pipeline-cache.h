@@ -3,6 +3,7 @@
 #include <map>
 #include "d3d-shader-loader-types.h"
 #include "d3d-shader-loader-helper.h"
+#include "d3d-shader-loader-mapped-file.h"
 #include "d3d12-shader-loader-rootsig-library.h"
 #include <filesystem>
 
@@ -44,12 +45,15 @@ public:
 	/*
 	* @brief: Given a directory of compiled shaders, load them and turn them into their
 	* associated "ID3D12PipelineState*", "ID3D12RootSignature*", "ID3D12StateObject*" objects.
+	* Reads only the pack for DXIL with flags, e.g. ShaderPipelines.dxil.release.pack,
+	* falling back to the json dump if there's no pack.
 	* 
 	* @param dirPath: A std::filesystem::path pointing to the directory you wish to load.
 	* 
 	* @param flags: Load the shaders compiled with the associated flags.
 	*	WithDebugInfo_NoOptimization is compiled with "-Zi" unless overidden by the compiler
 	*	WithoutDebugInfo_Optimize is compiled with "-O3" unless overridden by the compiler
+	*	The compiler has to have been run with the DXIL target for these flags, see its --targets
 	* 
 	* @returns: false if unable to load, true if able to load
 	*/
@@ -68,6 +72,14 @@ public:
 
 private:
 
+	bool LoadPack(const std::filesystem::path& packFile, CompilerFlags flags);
+
+	bool LoadJson(const std::filesystem::path& dirPath, CompilerFlags flags);
+
+	bool CreateGfxPipeline(const std::string& name, const GFX_PIPELINE_STATE_DESC& desc);
+
+	bool CreateCmptPipeline(const std::string& name, const COMPUTE_PIPELINE_STATE_DESC& desc);
+
 	void CheckRaytracingSupport();
 
 	void BuildDxrStateDesc(const RAYTRACING_PIPELINE_STATE_DESC& desc, const std::string& shaderName, D3D12_STATE_OBJECT_DESC& outDesc);
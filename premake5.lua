@@ -9,7 +9,7 @@ workspace "shader-compiler"
 	
 	filter "system:Windows"
 	  defines { "WINDOWS_BUILD" }
-	filter "system:Unix"
+	filter "system:linux"
 	  defines { "LINUX_BUILD" }
 	filter {}
    
@@ -73,4 +73,11 @@ project "d3d-shader-loader"
 		"d3d12"
 	}
 
-	files { "d3d-shader-loader/**.h", "d3d-shader-loader/**.cpp" }
\ No newline at end of file
+	files { "d3d-shader-loader/**.h", "d3d-shader-loader/**.cpp" }
+
+-- Decode throughput of d3d-shader-loader-base64.cpp, run the Release build
+project "base64-bench"
+	kind "ConsoleApp"
+	defines { "BASE64_BENCH" }
+
+	files { "d3d-shader-loader/d3d-shader-loader-base64.h", "d3d-shader-loader/d3d-shader-loader-base64.cpp" }
\ No newline at end of file
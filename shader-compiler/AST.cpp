@@ -1,120 +1,70 @@
 #include "AST.h"
-#include <fstream>
-#include <sstream>
+#include "HLSLKeywords.h"
+#include "HeaderCache.h"
 #include <iostream>
-#include <regex>
+#include <string.h>
 
 
 
 
 static DefaultPrintHandler g_DefaultPrint;
 
-std::vector<TOKEN> ExtractTokens(const std::string& fileData)
+bool ASTBase::LoadFile(const std::filesystem::path& path)
 {
-	std::vector<TOKEN> Result;
-	std::istringstream Str(fileData);
-
-	uint32_t i = 0;
-	std::string Buff;
-	while (std::getline(Str, Buff, '\n'))
+	// The only read of this file, the compile stage reuses the same buffer
+	std::shared_ptr<const std::string> source = std::make_shared<const std::string>(ReadEntireFile(path.string()));
+	if (source->size() == 0)
 	{
-		i++;
-
-		std::string currentTok;
-
-		for (char ch : Buff)
-		{
-			if (IsWhiteSpace(ch))
-			{
-				if (currentTok != "")
-				{
-					TOKEN tk;
-					tk.Line = i;
-					tk.Data = currentTok;
-					Result.push_back(tk);
-
-					currentTok = "";
-				}
-			}
-			else
-			{
-				currentTok.append(1, ch);
-			}
-		}
-
-		if (currentTok != "")
-		{
-			TOKEN tk;
-			tk.Line = i;
-			tk.Data = currentTok;
-			Result.push_back(tk);
-		}
+		return false;
 	}
 
-	return Result;
+	return LoadSource(std::move(source));
 }
 
-bool ASTBase::LoadFile(const std::filesystem::path& path)
+bool ASTBase::LoadSource(std::shared_ptr<const std::string> source)
 {
 	if (m_Print == nullptr)
 	{
 		SetPrintHandler(&g_DefaultPrint);
 	}
 
-	std::string fileData = ReadEntireFile(path.string());
-	if (fileData.size() == 0)
-	{
-		return false;
-	}
-
-	std::string hlslNoComments = RemoveHLSLComments(fileData);
+	m_Arena.Reset();
+	m_PipelineNode = AST_INVALID_NODE;
+	m_Structs.Clear();
+	m_Funcs.Clear();
+	m_Symbols.Clear();
+	m_Imports.clear();
 
-	std::vector<TOKEN> lines = ExtractTokens(hlslNoComments);
-	ASTUnparsedTokens toks(lines);
-	Parse(toks);
+	m_Source = std::move(source);
+	m_Lexer.Lex(*m_Source);
+	Parse(m_Lexer);
 	return true;
 }
 
-bool ASTBase::Parse(ASTUnparsedTokens& tokens)
+ASTToken ASTParsedTokens::Get(size_t index) const
 {
-	m_Tokens.clear();
-	while (tokens.Advance())
-	{
-		const TOKEN& current = tokens.Current();
+	ASTToken token;
+	token.Data = m_Lexer->GetText(index);
+	token.Type = m_Lexer->GetKind(index);
+	token.Index = (uint32_t)index;
+	token.Source = m_Lexer;
 
-		std::vector<ASTToken> expandedToks = BreakUpStringWithSyntaxSugar(current.Data, current.Line);
+	if (token.Type == AST_TOKEN_TYPE_UNKNOWN)
+	{
+		token.Type = ClassifyHLSLWord(token.Data);
+		m_Lexer->SetKind(index, token.Type);
+	}
+	return token;
+}
 
-		for (uint32_t i = 0; i < expandedToks.size(); i++)
-		{
-			ASTToken& et = expandedToks[i];
-			if (et.Type == AST_TOKEN_TYPE_UNKNOWN)
-			{
-				if (et.Data.Data == "struct")
-				{
-					et.Type = AST_TOKEN_TYPE_STRUCT_KEYWORD;
-				}
-				else if (IsSystemType(et.Data.Data))
-				{
-					et.Type = AST_TOKEN_TYPE_BUILTIN_DATATYPE;
-				}
-				else if (IsValidParamModifier(et.Data.Data))
-				{
-					et.Type = AST_TOKEN_TYPE_PARAM_MODIFIER;
-				}
-				else if (IsHLSLReservedWord(et.Data.Data))
-				{
-					et.Type = AST_TOKEN_TYPE_HLSL_KEYWORD;
-				}
-				else
-				{
-					et.Type = AST_TOKEN_TYPE_GENERAL_IDENTIFIER;
-				}
-			}
-			m_Tokens.push_back(et);
-		}
+bool ASTBase::Parse(Lexer& lexer)
+{
+	if (lexer.Count() == 0)
+	{
+		return true;
 	}
 
-	ASTParsedTokens newTokens(m_Tokens);
+	ASTParsedTokens newTokens(lexer);
 
 	return SecondPassParse(newTokens);
 }
@@ -140,6 +90,14 @@ bool ASTBase::SecondPassParse(ASTParsedTokens& tokens)
 			{
 				break;
 			}
+			if (t.GetData() == "#include")
+			{
+				if (!ParseIncludeStatement(tokens) && m_UnrecoverableError)
+				{
+					return false;
+				}
+				break;
+			}
 			if (IsPipelineStatement(tokens))
 			{
 				if (!ParsePipelineStatement(tokens))
@@ -205,7 +163,7 @@ bool ASTBase::SecondPassParse(ASTParsedTokens& tokens)
 			{
 				break;
 			}
-			std::string keyword = t.GetData();
+			std::string_view keyword = t.GetData();
 			if (keyword == "groupshared" ||
 				keyword == "uniform" ||
 				keyword == "const")
@@ -228,7 +186,17 @@ bool ASTBase::SecondPassParse(ASTParsedTokens& tokens)
 		} break;
 		case AST_TOKEN_TYPE_LEFT_CURLY:
 		{
-			scopeCt++;
+			// Nothing inside a scope matters here, hop straight to
+			// its '}' instead of walking every token of the body
+			uint32_t match = tokens.GetMatch();
+			if (match != LEXER_NO_MATCH)
+			{
+				tokens.JumpTo(match);
+			}
+			else
+			{
+				scopeCt++;
+			}
 		} break;
 		case AST_TOKEN_TYPE_RIGHT_CURLY:
 		{
@@ -242,87 +210,29 @@ bool ASTBase::SecondPassParse(ASTParsedTokens& tokens)
 	return true;
 }
 
-bool ASTBase::IsValidType(const std::string& type) const
+bool ASTBase::IsValidType(std::string_view type) const
 {
 	if (IsSystemType(type))
 	{
 		return true;
 	}
 
-	for (auto& regType : m_Structs)
-	{
-		if (regType == type)
-		{
-			return true;
-		}
-	}
-
-	return false;
+	return IsStructDefined(type);
 }
 
-bool ASTBase::HasParsedFunction(const std::string& name) const
+bool ASTBase::HasParsedFunction(std::string_view name) const
 {
-	for (const std::string& n : m_Funcs)
-	{
-		if (name == n)
-		{
-			return true;
-		}
-	}
-
-	return false;
+	return GetFuncDecl(name) != nullptr;
 }
 
-bool ASTBase::IsSystemType(const std::string& type) const
+bool ASTBase::IsSystemType(std::string_view type) const
 {
-	if (type == "void" || type == "bool" || type == "matrix")
-	{
-		return true;
-	}
-
-	static std::regex r("^(int|uint|dword|half|double|float)([1-4](x[1-4])?)?$", std::regex_constants::ECMAScript);
-	if (std::regex_search(type, r))
-	{
-		return true;
-	}
-
-	return false;
+	return ClassifyHLSLWord(type) == AST_TOKEN_TYPE_BUILTIN_DATATYPE;
 }
 
-bool ASTBase::IsHLSLReservedWord(const std::string& word) const
+bool ASTBase::IsHLSLReservedWord(std::string_view word) const
 {
-	static std::string keywords[] = { 
-		"AppendStructuredBuffer", "asm", "asm_fragmentBlendState", "bool", "break", 
-		"Buffer", "ByteAddressBuffercase", "cbuffer", "centroid", "class", "column_major", 
-		"compile", "compile_fragment", "CompileShader", "const", "continue", "ComputeShader", 
-		"ConsumeStructuredBufferdefault", "DepthStencilState", "DepthStencilView", 
-		"discard", "do", "double", "DomainShader", "dwordelse", "export", "externfalse", 
-		"float", "for", "fxgroupGeometryShader", "groupsharedhalf", "Hullshaderif", 
-		"in", "inline", "inout", "InputPatch", "int", "interfaceline", "lineadj", 
-		"linear", "LineStreammatrix", "min16float", "min10float", "min16int", "min12int", 
-		"min16uintnamespace", "nointerpolation", "noperspective", "NULLout", 
-		"OutputPatchpackoffset", "pass", "pixelfragment", "PixelShader", "point", 
-		"PointStream", "preciseRasterizerState", "RenderTargetView", "return", 
-		"register", "row_major", "RWBuffer", "RWByteAddressBuffer", "RWStructuredBuffer", 
-		"RWTexture1D", "RWTexture1DArray", "RWTexture2D", "RWTexture2DArray", 
-		"RWTexture3Dsample", "sampler", "SamplerState", "SamplerComparisonState", 
-		"shared", "snorm", "stateblock", "stateblock_state", "static", "string", "struct", 
-		"switch", "StructuredBuffertbuffer", "technique", "technique10", "technique11", 
-		"texture", "Texture1D", "Texture1DArray", "Texture2D", "Texture2DArray", 
-		"Texture2DMS", "Texture2DMSArray", "Texture3D", "TextureCube", "TextureCubeArray", 
-		"true", "typedef", "triangle", "triangleadj", "TriangleStreamuint", "uniform", 
-		"unorm", "unsignedvector", "vertexfragment", "VertexShader", "void", "volatilewhile" 
-	};
-
-	for (uint32_t i = 0; i < (sizeof(keywords) / sizeof(std::string)); i++)
-	{
-		if (word == keywords[i])
-		{
-			return true;
-		}
-	}
-
-	return false;
+	return IsHLSLKeyword(word);
 }
 
 bool ASTBase::AdvanceToEndOfScope(ASTParsedTokens& tokens, uint32_t scopeCt)
@@ -337,7 +247,23 @@ bool ASTBase::AdvanceToEndOfScope(ASTParsedTokens& tokens, uint32_t scopeCt)
 	{
 		if (tokens.Current().Type == AST_TOKEN_TYPE_LEFT_CURLY)
 		{
-			scopeCt++;
+			// Skip nested scopes whole, only the '}' that closes
+			// the scope we're in can bring scopeCt back down
+			uint32_t match = tokens.GetMatch();
+			if (match == LEXER_NO_MATCH)
+			{
+				scopeCt++;
+			}
+			else
+			{
+				tokens.JumpTo(match);
+				if (scopeCt == 0)
+				{
+					result = true;
+					break;
+				}
+				continue;
+			}
 		}
 		else if (tokens.Current().Type == AST_TOKEN_TYPE_RIGHT_CURLY)
 		{
@@ -354,7 +280,7 @@ bool ASTBase::AdvanceToEndOfScope(ASTParsedTokens& tokens, uint32_t scopeCt)
 		// Can this realistically happen?
 		if (scopeCt > SCOPE_UNDERFLOW_CHECK)
 		{
-			m_Print->Error("Error parsing scope starting at token \"%s\" on line %d", current.GetData().c_str(), current.Data.Line);
+			m_Print->Error("Error parsing scope starting at token \"%.*s\" on line %d", AST_TOKEN_ARG(current), current.GetLine());
 			result = false;
 			break;
 		}
@@ -371,7 +297,7 @@ bool ASTBase::AdvanceToEndOfScope(ASTParsedTokens& tokens, uint32_t scopeCt)
 	// Did we successfully get to the end of the scope
 	if (scopeCt != 0)
 	{
-		m_Print->Error("Unmatched scope starting at token \"%s\" on line %d", current.GetDataPtr(), current.GetLine());
+		m_Print->Error("Unmatched scope starting at token \"%.*s\" on line %d", AST_TOKEN_ARG(current), current.GetLine());
 		return false;
 	}
 
@@ -379,233 +305,25 @@ bool ASTBase::AdvanceToEndOfScope(ASTParsedTokens& tokens, uint32_t scopeCt)
 }
 
 void ASTBase::AdvanceToEndOfStatement(ASTParsedTokens& tokens)
-{	
-	while (tokens.Advance())
-	{
-		if (tokens.Current().Type == AST_TOKEN_TYPE_SEMICOLON)
-		{
-			tokens.Advance();
-			break;
-		}
-	}
-}
-
-std::vector<ASTToken> ASTBase::BreakUpStringWithSyntaxSugar(const std::string& statement, uint32_t lineNumber) const
 {
-	size_t i = 0;
-	std::string token;
-
-	std::vector<ASTToken> result;
-	ASTToken n;
-
-#define ADD_TOKEN_AND_CLEAR do { \
-	if (token.size() == 0) { break; } \
-	ASTToken tmpNode; \
-	tmpNode.Data.Data = token; \
-	tmpNode.Data.Line = lineNumber; \
-	tmpNode.Type = AST_TOKEN_TYPE_UNKNOWN; \
-	result.push_back(tmpNode); \
-	token = ""; \
-	} while(0);
-
-	for (i = 0; i < statement.size(); i++)
-	{
-		char ch = statement[i];
-		switch (ch)
-		{
-		case '(':
-			ADD_TOKEN_AND_CLEAR;
-			n.Data.Data = "(";
-			n.Data.Line = lineNumber;
-			n.Type = AST_TOKEN_TYPE_LEFT_PARENTHESIS;
-			result.push_back(n);
-			break;
-		case ')':
-			ADD_TOKEN_AND_CLEAR;
-			n.Data.Data = ")";
-			n.Data.Line = lineNumber;
-			n.Type = AST_TOKEN_TYPE_RIGHT_PARENTHESIS;
-			result.push_back(n);
-			break;
-		case '{':
-			ADD_TOKEN_AND_CLEAR;
-			n.Data.Data = "{";
-			n.Data.Line = lineNumber;
-			n.Type = AST_TOKEN_TYPE_LEFT_CURLY;
-			result.push_back(n);
-			break;
-		case '}':
-			ADD_TOKEN_AND_CLEAR;
-			n.Data.Data = "}";
-			n.Data.Line = lineNumber;
-			n.Type = AST_TOKEN_TYPE_RIGHT_CURLY;
-			result.push_back(n);
-			break;
-		case '<':
-			ADD_TOKEN_AND_CLEAR;
-			n.Data.Data = "<";
-			n.Data.Line = lineNumber;
-			n.Type = AST_TOKEN_TYPE_LEFT_GATOR;
-			result.push_back(n);
-			break;
-		case '>':
-			ADD_TOKEN_AND_CLEAR;
-			n.Data.Data = ">";
-			n.Data.Line = lineNumber;
-			n.Type = AST_TOKEN_TYPE_RIGHT_GATOR;
-			result.push_back(n);
-			break;
-		case '[':
-			ADD_TOKEN_AND_CLEAR;
-			// This is kinda funky code reuse
-			if (i + 1 > statement.size() - 1)
-			{
-				n.Data.Data = "[";
-				n.Data.Line = lineNumber;
-				n.Type = AST_TOKEN_TYPE_LEFT_SQUARE;
-				result.push_back(n);
-			}
-			else
-			{
-				if (statement[i + 1] != '[')
-				{
-					n.Data.Data = "[";
-					n.Data.Line = lineNumber;
-					n.Type = AST_TOKEN_TYPE_LEFT_SQUARE;
-					result.push_back(n);
-				}
-				else
-				{
-					n.Data.Data = "[[";
-					n.Data.Line = lineNumber;
-					n.Type = AST_TOKEN_TYPE_DOUBLE_LEFT_SQUARE;
-					result.push_back(n);
-					i += 1;
-				}
-			}
-			break;
-		case ']':
-			ADD_TOKEN_AND_CLEAR;
-			// This is kinda funky code reuse
-			if (i + 1 > statement.size() - 1)
-			{
-				n.Data.Data = "]";
-				n.Data.Line = lineNumber;
-				n.Type = AST_TOKEN_TYPE_RIGHT_SQUARE;
-				result.push_back(n);
-			}
-			else
-			{
-				if (statement[i + 1] != ']')
-				{
-					n.Data.Data = "]";
-					n.Data.Line = lineNumber;
-					n.Type = AST_TOKEN_TYPE_RIGHT_SQUARE;
-					result.push_back(n);
-				}
-				else
-				{
-					n.Data.Data = "]]";
-					n.Data.Line = lineNumber;
-					n.Type = AST_TOKEN_TYPE_DOUBLE_RIGHT_SQUARE;
-					result.push_back(n);
-					i += 1;
-				}
-			}
-			break;
-		case '"':
-			ADD_TOKEN_AND_CLEAR;
-			n.Data.Data = "\"";
-			n.Data.Line = lineNumber;
-			n.Type = AST_TOKEN_TYPE_DOUBLE_QUOTE;
-			result.push_back(n);
-			break;
-		case '\'':
-			ADD_TOKEN_AND_CLEAR;
-			n.Data.Data = "'";
-			n.Data.Line = lineNumber;
-			n.Type = AST_TOKEN_TYPE_SINGLE_QUOTE;
-			result.push_back(n);
-			break;
-		case ':':
-			ADD_TOKEN_AND_CLEAR;
-			// This is kinda funky code reuse
-			if (i + 1 > statement.size() - 1)
-			{
-				n.Data.Data = ":";
-				n.Data.Line = lineNumber;
-				n.Type = AST_TOKEN_TYPE_COLON;
-				result.push_back(n);
-			}
-			else
-			{
-				if (statement[i + 1] != '[')
-				{
-					n.Data.Data = ":";
-					n.Data.Line = lineNumber;
-					n.Type = AST_TOKEN_TYPE_COLON;
-					result.push_back(n);
-				}
-				else
-				{
-					n.Data.Data = "::";
-					n.Data.Line = lineNumber;
-					n.Type = AST_TOKEN_TYPE_DOUBLE_COLON;
-					result.push_back(n);
-					i += 1;
-				}
-			}
-			break;		
-		case ';':
-			ADD_TOKEN_AND_CLEAR;
-			n.Data.Data = ";";
-			n.Data.Line = lineNumber;
-			n.Type = AST_TOKEN_TYPE_SEMICOLON;
-			result.push_back(n);
-			break;
-		case ',':
-			ADD_TOKEN_AND_CLEAR;
-			n.Data.Data = ",";
-			n.Data.Line = lineNumber;
-			n.Type = AST_TOKEN_TYPE_COMMA;
-			result.push_back(n);
-			break;
-		case '*':
-		case '+':
-		case '-':
-		case '/':
-		case '%':
-		case '&':
-		case '!':
-			ADD_TOKEN_AND_CLEAR;
-			n.Data.Data = "";
-			n.Data.Data += ch;
-			n.Data.Line = lineNumber;
-			n.Type = AST_TOKEN_TYPE_MATH_OPERATION;
-			result.push_back(n);
-			break;
-		default:
-			token.append(1, ch);
-			break;
-		};
+	if (!tokens.CanPeekNext())
+	{
+		return;
 	}
 
-	if (token.size() != 0)
+	uint32_t semicolon = tokens.GetNextSemicolon();
+	if (!tokens.JumpTo(semicolon))
 	{
-		n.Data.Data = token;
-		n.Data.Line = lineNumber;
-		n.Type = AST_TOKEN_TYPE_GENERAL_IDENTIFIER;
-		result.push_back(n);
+		// No ';' left, same as walking off the end
+		tokens.JumpTo(tokens.Count() - 1);
+		return;
 	}
-
-	return result;
-
-#undef ADD_TOKEN_AND_CLEAR
+	tokens.Advance();
 }
 
-bool ASTBase::IsValidParamModifier(const std::string& modifier) const
+bool ASTBase::IsValidParamModifier(std::string_view modifier) const
 {
-	return modifier == "in" || modifier == "inout" || modifier == "out";
+	return ClassifyHLSLWord(modifier) == AST_TOKEN_TYPE_PARAM_MODIFIER;
 }
 
 void ASTBase::SetPrintHandler(IPrintHandler* handler)
@@ -654,8 +372,8 @@ bool ASTBase::ParseResourcesBlock(ASTParsedTokens& tokens)
 
 	if (tokens.Current().Type != AST_TOKEN_TYPE_LEFT_CURLY)
 	{
-		m_Print->Error("Resources block must be assigned like \"Resources = {\", got \"Resources = %s\" on line %d",
-			tokens.Current().GetDataPtr(),
+		m_Print->Error("Resources block must be assigned like \"Resources = {\", got \"Resources = %.*s\" on line %d",
+			AST_TOKEN_ARG(tokens.Current()),
 			tokens.Current().GetLine()
 		);
 		AdvanceToEndOfScope(tokens);
@@ -686,7 +404,7 @@ bool ASTBase::ParseResourcesBlock(ASTParsedTokens& tokens)
 			{
 				if (!tokens.Advance())
 				{
-					m_Print->Error("Unexpected end of statement at \"%s\" on line %d", cur.GetDataPtr(), cur.GetLine());
+					m_Print->Error("Unexpected end of statement at \"%.*s\" on line %d", AST_TOKEN_ARG(cur), cur.GetLine());
 					AdvanceToEndOfScope(tokens, 1);
 					return false;
 				}
@@ -704,16 +422,16 @@ bool ASTBase::ParseResourcesBlock(ASTParsedTokens& tokens)
 
 				if (!tokens.Advance())
 				{
-					m_Print->Error("Unexpected end of statement at \"%s\" on line %d", 
-						tokens.Current().GetDataPtr(), tokens.Current().GetLine());
+					m_Print->Error("Unexpected end of statement at \"%.*s\" on line %d", 
+						AST_TOKEN_ARG(tokens.Current()), tokens.Current().GetLine());
 					AdvanceToEndOfScope(tokens, 1);
 					return false;
 				}
 
 				if (tokens.Current().Type != AST_TOKEN_TYPE_GENERAL_IDENTIFIER)
 				{
-					m_Print->Error("Unexpected syntax -> \"%s\" on line %d",
-						tokens.Current().GetDataPtr(), tokens.Current().GetLine());
+					m_Print->Error("Unexpected syntax -> \"%.*s\" on line %d",
+						AST_TOKEN_ARG(tokens.Current()), tokens.Current().GetLine());
 					AdvanceToEndOfScope(tokens, 1);
 					return false;
 				}
@@ -722,29 +440,29 @@ bool ASTBase::ParseResourcesBlock(ASTParsedTokens& tokens)
 
 				if (!tokens.Advance())
 				{
-					m_Print->Error("Unexpected end of statement at \"%s\" on line %d",
-						tokens.Current().GetDataPtr(), tokens.Current().GetLine());
+					m_Print->Error("Unexpected end of statement at \"%.*s\" on line %d",
+						AST_TOKEN_ARG(tokens.Current()), tokens.Current().GetLine());
 					AdvanceToEndOfScope(tokens, 1);
 					return false;
 				}
 
 				if (tokens.Current().Type != AST_TOKEN_TYPE_RIGHT_PARENTHESIS)
 				{
-					m_Print->Error("Unexpected token \"%s\" at end of register statement on line %d",
-						tokens.Current().GetDataPtr(), tokens.Current().GetLine());
+					m_Print->Error("Unexpected token \"%.*s\" at end of register statement on line %d",
+						AST_TOKEN_ARG(tokens.Current()), tokens.Current().GetLine());
 					AdvanceToEndOfScope(tokens, 1);
 					return false;
 				}
 
 				if (regSlotToken.GetData().size() != 2 || regSlotToken.GetData().size() != 3)
 				{
-					m_Print->Error("Invalid register slot type \"%s\" on line %d",
-						regSlotToken.GetDataPtr(), regSlotToken.GetLine());
+					m_Print->Error("Invalid register slot type \"%.*s\" on line %d",
+						AST_TOKEN_ARG(regSlotToken), regSlotToken.GetLine());
 					AdvanceToEndOfScope(tokens, 1);
 					return false;
 				}
 
-				std::string regSlot = regSlotToken.GetData();
+				std::string regSlot(regSlotToken.GetData());
 				char regType = regSlot[0];
 				std::string regNumStr = regSlot.substr(1);
 				bool doContinue = false;
@@ -754,8 +472,8 @@ bool ASTBase::ParseResourcesBlock(ASTParsedTokens& tokens)
 					if (ch < '0' || ch > '9')
 					{
 						// From here we leave it up to the compiler to fail
-						m_Print->Error("register slot must be one of {u, t, s, b} followed by a number. Got %s on line %d",
-							regSlotToken.GetDataPtr(), regSlotToken.GetLine());
+						m_Print->Error("register slot must be one of {u, t, s, b} followed by a number. Got %.*s on line %d",
+							AST_TOKEN_ARG(regSlotToken), regSlotToken.GetLine());
 						AdvanceToEndOfStatement(tokens);
 						doContinue = true;
 						break;
@@ -838,7 +556,7 @@ bool ASTBase::ParseResourcesBlock(ASTParsedTokens& tokens)
 		}
 		if (scopeCt > SCOPE_UNDERFLOW_CHECK)
 		{
-			m_Print->Error("Scope number integer underflow at token %s on line %d", cur.GetDataPtr(), cur.GetLine());
+			m_Print->Error("Scope number integer underflow at token %.*s on line %d", AST_TOKEN_ARG(cur), cur.GetLine());
 			m_UnrecoverableError = true;
 			return false;
 		}
@@ -878,8 +596,8 @@ bool ASTBase::IsPipelineStatement(ASTParsedTokens& tokens)
 
 		if (toks.Current().Type != AST_TOKEN_TYPE_EQUALS)
 		{
-			m_Print->Error("Expected assignment to \"Pipeline\" variable, got \"%s\" on line %d",
-				toks.Current().GetDataPtr(),
+			m_Print->Error("Expected assignment to \"Pipeline\" variable, got \"%.*s\" on line %d",
+				AST_TOKEN_ARG(toks.Current()),
 				toks.Current().GetLine()
 			);
 			return false;
@@ -894,8 +612,8 @@ bool ASTBase::IsPipelineStatement(ASTParsedTokens& tokens)
 
 		if (toks.Current().Type != AST_TOKEN_TYPE_LEFT_CURLY)
 		{
-			m_Print->Error("Unexpected syntax. \"Pipeline = %s\", expected \"Pipeline = {\" on line %d",
-				toks.Current().GetDataPtr(),
+			m_Print->Error("Unexpected syntax. \"Pipeline = %.*s\", expected \"Pipeline = {\" on line %d",
+				AST_TOKEN_ARG(toks.Current()),
 				toks.Current().GetLine()
 			);
 		}
@@ -912,36 +630,36 @@ bool ASTBase::ParsePipelineStatement(ASTParsedTokens& tokens)
 	}
 
 	m_PipelineBlockStart = tokens.Current().GetLine();
+	const uint32_t blockBegin = GetTokenOffset(tokens.Current());
 
 	// Because toks was able to get here, we can assume 
 	// these will succeed
 	tokens.Advance(); // tokens.Current() = '='
 	tokens.Advance(); // tokens.Current() = '{'
 
-	m_PipelineNode = std::make_shared<ASTInitializerList>();
-	NameList emptyName;
+	m_PipelineNode = m_Arena.NewNode(AST_NODE_TYPE_INITIALIZER_LIST, tokens.Current().GetLine());
 
-	if (!ParseInitializerScope(tokens, emptyName, m_PipelineNode))
+	// Leaves tokens.Current() on the ';' after the closing '}'
+	if (!ParseInitializerScope(tokens, m_PipelineNode))
 	{
 		m_Print->Error("Failed to parse Pipeline block");
 		return false;
 	}
 
-	if (!tokens.Advance())
-	{
-		m_Print->Error("Unexpected end of file on line %d", tokens.Current().GetLine());
-		m_UnrecoverableError = true;
-		return false;
-	}
-
 	if (tokens.Current().Type != AST_TOKEN_TYPE_SEMICOLON)
 	{
-		m_Print->Error("Syntax error. Expected ';' on line %d. Got '%s'",
+		m_Print->Error("Syntax error. Expected ';' on line %d. Got '%.*s'",
 			tokens.Current().GetLine(),
-			tokens.Current().GetDataPtr());
+			AST_TOKEN_ARG(tokens.Current()));
 	}
 
 	m_PipelineBlockEnd = tokens.Current().GetLine();
+	m_PipelineBlockBeginOffset = blockBegin;
+	m_PipelineBlockEndOffset = GetTokenOffset(tokens.Current());
+	if (tokens.Current().Type == AST_TOKEN_TYPE_SEMICOLON)
+	{
+		m_PipelineBlockEndOffset++;
+	}
 
 	if (!tokens.Advance())
 	{
@@ -969,8 +687,8 @@ bool ASTBase::ParseStructDefinition(ASTParsedTokens& tokens)
 
 	if (tokens.Current().Type != AST_TOKEN_TYPE_GENERAL_IDENTIFIER)
 	{
-		m_Print->Error("Struct name is not a valid name %s on line %d",
-			tokens.Current().GetDataPtr(),
+		m_Print->Error("Struct name is not a valid name %.*s on line %d",
+			AST_TOKEN_ARG(tokens.Current()),
 			tokens.Current().GetLine());
 		return false;
 	}
@@ -978,7 +696,8 @@ bool ASTBase::ParseStructDefinition(ASTParsedTokens& tokens)
 	uint32_t scopeCt = 0;
 	ASTStructDecl structDecl;
 
-	structDecl.Name = tokens.Current().GetData();
+	const AST_SYMBOL structSymbol = m_Symbols.Intern(tokens.Current().GetData());
+	structDecl.Name = m_Symbols.GetString(structSymbol);
 
 	if (!tokens.Advance())
 	{
@@ -1003,7 +722,7 @@ bool ASTBase::ParseStructDefinition(ASTParsedTokens& tokens)
 	{
 		ASTStructDecl::Member member;
 
-		if (tokens.Current().Type == AST_TOKEN_TYPE_SEMICOLON)
+		if (tokens.Current().Type == AST_TOKEN_TYPE_RIGHT_CURLY)
 		{
 			break;
 		}
@@ -1015,7 +734,7 @@ bool ASTBase::ParseStructDefinition(ASTParsedTokens& tokens)
 		// TODO: Check that this is a valid modifier
 		if (tokens.Current().Type == AST_TOKEN_TYPE_HLSL_KEYWORD)
 		{
-			member.Modifier = tokens.Current().GetData();
+			member.Modifier = InternToken(tokens.Current());
 
 			if (!tokens.Advance())
 			{
@@ -1029,8 +748,8 @@ bool ASTBase::ParseStructDefinition(ASTParsedTokens& tokens)
 		{
 			if (tokens.Current().Type != AST_TOKEN_TYPE_GENERAL_IDENTIFIER)
 			{
-				m_Print->Error("Invalid struct member type \"%s\" on line %d",
-					tokens.Current().GetDataPtr(),
+				m_Print->Error("Invalid struct member type \"%.*s\" on line %d",
+					AST_TOKEN_ARG(tokens.Current()),
 					tokens.Current().GetLine());
 				m_UnrecoverableError = true;
 				return false;
@@ -1039,14 +758,14 @@ bool ASTBase::ParseStructDefinition(ASTParsedTokens& tokens)
 
 		if (!IsValidType(tokens.Current().GetData()))
 		{
-			m_Print->Error("Invalid data type on line %d. Got \"%s\"",
+			m_Print->Error("Invalid data type on line %d. Got \"%.*s\"",
 				tokens.Current().GetLine(),
-				tokens.Current().GetDataPtr());
+				AST_TOKEN_ARG(tokens.Current()));
 			m_UnrecoverableError = true;
 			return false;
 		}
 
-		member.Type = tokens.Current().GetData();
+		member.Type = InternToken(tokens.Current());
 
 		if (!tokens.Advance())
 		{
@@ -1057,25 +776,25 @@ bool ASTBase::ParseStructDefinition(ASTParsedTokens& tokens)
 
 		if (tokens.Current().Type != AST_TOKEN_TYPE_GENERAL_IDENTIFIER)
 		{
-			m_Print->Error("Struct member \"%s\" is not a valid member name on line %d",
-				tokens.Current().GetDataPtr(),
+			m_Print->Error("Struct member \"%.*s\" is not a valid member name on line %d",
+				AST_TOKEN_ARG(tokens.Current()),
 				tokens.Current().GetLine());
 			m_UnrecoverableError = true;
 			return false;
 		}
 
-		std::string memberName = tokens.Current().GetData();
+		std::string_view memberName = tokens.Current().GetData();
 
-		if (structDecl.Members.find(memberName) != structDecl.Members.end())
+		if (structDecl.FindMember(memberName) != nullptr)
 		{
-			m_Print->Error("Struct member redefinition \"%s\" on line %d",
-				tokens.Current().GetDataPtr(),
+			m_Print->Error("Struct member redefinition \"%.*s\" on line %d",
+				AST_TOKEN_ARG(tokens.Current()),
 				tokens.Current().GetLine());
 			m_UnrecoverableError = true;
 			return false;
 		}
 
-		member.Name = memberName;
+		member.Name = m_Symbols.GetString(m_Symbols.Intern(memberName));
 
 		if (!tokens.Advance())
 		{
@@ -1095,13 +814,13 @@ bool ASTBase::ParseStructDefinition(ASTParsedTokens& tokens)
 
 			if (tokens.Current().Type != AST_TOKEN_TYPE_GENERAL_IDENTIFIER)
 			{
-				m_Print->Error("Invalid semantic name \"%s\" on line %d",
-					tokens.Current().GetDataPtr(),
+				m_Print->Error("Invalid semantic name \"%.*s\" on line %d",
+					AST_TOKEN_ARG(tokens.Current()),
 					tokens.Current().GetLine());
 				return false;
 			}
 
-			member.Semantic = tokens.Current().GetData();
+			member.Semantic = InternToken(tokens.Current());
 
 			if (!tokens.Advance())
 			{
@@ -1139,7 +858,7 @@ bool ASTBase::ParseStructDefinition(ASTParsedTokens& tokens)
 			return false;
 		}
 
-		structDecl.Members.insert(std::pair<std::string, ASTStructDecl::Member>(member.Name, member));
+		structDecl.Members.push_back(member);
 	}
 
 	if (!tokens.Advance())
@@ -1155,13 +874,18 @@ bool ASTBase::ParseStructDefinition(ASTParsedTokens& tokens)
 		return false;
 	}
 
-	m_Structs.push_back(structDecl.Name);
-	m_StructsParsed.insert(std::pair<std::string, ASTStructDecl>(structDecl.Name, structDecl));
+	// The first definition wins
+	if (!m_Structs.Insert(structSymbol, std::move(structDecl)))
+	{
+		m_Print->Warn("Struct redefinition \"%.*s\" on line %d",
+			AST_STRING_ARG(structDecl.Name),
+			tokens.Current().GetLine());
+	}
 
 	return true;
 }
 
-bool ASTBase::ParseInitializerScope(ASTParsedTokens& tokens, const NameList& name, std::shared_ptr<ASTInitializerList> outList)
+bool ASTBase::ParseInitializerScope(ASTParsedTokens& tokens, AST_NODE_INDEX outList)
 {
 	if (tokens.Current().Type != AST_TOKEN_TYPE_LEFT_CURLY)
 	{
@@ -1177,13 +901,15 @@ bool ASTBase::ParseInitializerScope(ASTParsedTokens& tokens, const NameList& nam
 
 	for (;;)
 	{
-		// Grab inital identifier
+		// Grab inital identifier. Some state names, DepthStencilState
+		// and friends, are effect framework keywords to the lexer
 		const ASTToken& identifier = tokens.Current();
-		if (tokens.Current().Type != AST_TOKEN_TYPE_GENERAL_IDENTIFIER)
+		if (tokens.Current().Type != AST_TOKEN_TYPE_GENERAL_IDENTIFIER &&
+			tokens.Current().Type != AST_TOKEN_TYPE_HLSL_KEYWORD)
 		{
-			m_Print->Error("Syntax error: Expected identifier on line %d, got: \"%s\"",
+			m_Print->Error("Syntax error: Expected identifier on line %d, got: \"%.*s\"",
 				tokens.Current().GetLine(),
-				tokens.Current().GetDataPtr());
+				AST_TOKEN_ARG(tokens.Current()));
 			return false;
 		}
 
@@ -1194,19 +920,14 @@ bool ASTBase::ParseInitializerScope(ASTParsedTokens& tokens, const NameList& nam
 			return false;
 		}
 
-		NameList names;
+		// Names of one assignment sit back to back in the arena
+		const uint32_t firstName = m_Arena.AddName(identifier.GetData());
+		uint32_t numNames = 1;
 
-		// If we have assignment
-		if (tokens.Current().Type == AST_TOKEN_TYPE_EQUALS)
-		{
-			names.push_back(identifier.GetData());
-		}
 		// Build the "names" list. We support multiple
 		// variables per assignment statement
-		else if (tokens.Current().Type == AST_TOKEN_TYPE_COMMA)
+		if (tokens.Current().Type == AST_TOKEN_TYPE_COMMA)
 		{
-			names.push_back(identifier.GetData());
-
 			for (;;)
 			{
 				if (!tokens.Advance())
@@ -1217,15 +938,17 @@ bool ASTBase::ParseInitializerScope(ASTParsedTokens& tokens, const NameList& nam
 				}
 				const ASTToken& id = tokens.Current();
 
-				if (id.Type != AST_TOKEN_TYPE_GENERAL_IDENTIFIER)
+				if (id.Type != AST_TOKEN_TYPE_GENERAL_IDENTIFIER &&
+					id.Type != AST_TOKEN_TYPE_HLSL_KEYWORD)
 				{
-					m_Print->Error("Syntax error on line %d. Got '%s' expected 'identifier'",
+					m_Print->Error("Syntax error on line %d. Got '%.*s' expected 'identifier'",
 						id.GetLine(),
-						id.GetDataPtr());
+						AST_TOKEN_ARG(id));
 					return false;
 				}
 
-				names.push_back(id.GetData());
+				m_Arena.AddName(id.GetData());
+				numNames++;
 
 				if (!tokens.Advance())
 				{
@@ -1244,17 +967,17 @@ bool ASTBase::ParseInitializerScope(ASTParsedTokens& tokens, const NameList& nam
 				}
 				else
 				{
-					m_Print->Error("Syntax error. Expected '=' or ',' got '%s' on line %d",
-						tokens.Current().GetDataPtr(),
+					m_Print->Error("Syntax error. Expected '=' or ',' got '%.*s' on line %d",
+						AST_TOKEN_ARG(tokens.Current()),
 						tokens.Current().GetLine());
 					return false;
 				}
 			}
 		}
-		else
+		else if (tokens.Current().Type != AST_TOKEN_TYPE_EQUALS)
 		{
-			m_Print->Error("Syntax error, expected '=' or ',' got \"%s\" on line %d",
-				tokens.Current().GetDataPtr(),
+			m_Print->Error("Syntax error, expected '=' or ',' got \"%.*s\" on line %d",
+				AST_TOKEN_ARG(tokens.Current()),
 				tokens.Current().GetLine());
 			return false;
 		}
@@ -1270,34 +993,80 @@ bool ASTBase::ParseInitializerScope(ASTParsedTokens& tokens, const NameList& nam
 		// Parse the value
 		if (tokens.Current().Type == AST_TOKEN_TYPE_LEFT_CURLY)
 		{
-			std::shared_ptr<ASTAssignment> assignment = std::make_shared<ASTAssignment>();
-			std::shared_ptr<ASTInitializerList> list = std::make_shared<ASTInitializerList>();
+			AST_NODE_INDEX assignment = m_Arena.NewNode(AST_NODE_TYPE_ASSIGNMENT, identifier.GetLine());
+			AST_NODE_INDEX list = m_Arena.NewNode(AST_NODE_TYPE_INITIALIZER_LIST, tokens.Current().GetLine());
 
-			if (!ParseInitializerScope(tokens, names, list))
+			if (!ParseInitializerScope(tokens, list))
 			{
 				return false;
 			}
 
 			if (tokens.Current().Type != AST_TOKEN_TYPE_SEMICOLON)
 			{
-				m_Print->Error("Syntax error. Expected ';' got \"%s\" on line %d",
-					tokens.Current().GetDataPtr(),
+				m_Print->Error("Syntax error. Expected ';' got \"%.*s\" on line %d",
+					AST_TOKEN_ARG(tokens.Current()),
 					tokens.Current().GetLine()
 				);
 				return false;
 			}
 
-			assignment->Names = names;
-			assignment->Value = list;
-			outList->Assignments.push_back(assignment);
+			AST_NODE& node = m_Arena.GetNode(assignment);
+			node.FirstName = firstName;
+			node.NumNames = numNames;
+			node.Value = list;
+			m_Arena.AppendChild(outList, assignment);
+		}
+		else if (tokens.Current().Type == AST_TOKEN_TYPE_MATH_OPERATION && tokens.Current().GetData() == "-")
+		{
+			// The lexer splits the sign off negative numbers, the value
+			// keeps both so it reads exactly as it was written
+			const std::string_view sign = tokens.Current().GetData();
+			if (!tokens.Advance())
+			{
+				m_Print->Error("Unexpected end of file on line %d", tokens.Current().GetLine());
+				m_UnrecoverableError = true;
+				return false;
+			}
+
+			if (tokens.Current().Type != AST_TOKEN_TYPE_GENERAL_IDENTIFIER)
+			{
+				m_Print->Error("Syntax error. Expected a number after '-' got \"%.*s\" on line %d",
+					AST_TOKEN_ARG(tokens.Current()),
+					tokens.Current().GetLine());
+				return false;
+			}
+
+			const std::string_view number = tokens.Current().GetData();
+			const std::string_view text(sign.data(), (size_t)(number.data() + number.size() - sign.data()));
+
+			AST_NODE_INDEX assignment = m_Arena.NewNode(AST_NODE_TYPE_ASSIGNMENT, identifier.GetLine());
+			AST_NODE_INDEX value = m_Arena.NewValue(text, tokens.Current().GetLine());
+
+			AST_NODE& node = m_Arena.GetNode(assignment);
+			node.FirstName = firstName;
+			node.NumNames = numNames;
+			node.Value = value;
+			m_Arena.AppendChild(outList, assignment);
+
+			if (!tokens.Advance())
+			{
+				m_Print->Error("Unexpected end of file on line %d", tokens.Current().GetLine());
+				m_UnrecoverableError = true;
+				return false;
+			}
 		}
 		else if (tokens.Current().Type == AST_TOKEN_TYPE_GENERAL_IDENTIFIER ||
-			tokens.Current().Type == AST_TOKEN_TYPE_BUILTIN_DATATYPE) // Cover the "true", "false" case. If this is an error we can catch later
+			tokens.Current().Type == AST_TOKEN_TYPE_BUILTIN_DATATYPE ||
+			tokens.Current().Type == AST_TOKEN_TYPE_HLSL_KEYWORD) // Cover the "true", "false" case. If this is an error we can catch later
 		{
-			std::shared_ptr<ASTAssignment> assignment = std::make_shared<ASTAssignment>();
-			assignment->Names = names;
-			assignment->Value = std::make_shared<ASTAssignmentValue>(tokens.Current().GetData());
-			outList->Assignments.push_back(assignment);
+			AST_NODE_INDEX assignment = m_Arena.NewNode(AST_NODE_TYPE_ASSIGNMENT, identifier.GetLine());
+			AST_NODE_INDEX value = m_Arena.NewValue(tokens.Current().GetData(), tokens.Current().GetLine());
+
+			AST_NODE& node = m_Arena.GetNode(assignment);
+			node.FirstName = firstName;
+			node.NumNames = numNames;
+			node.Value = value;
+			m_Arena.AppendChild(outList, assignment);
 
 			if (!tokens.Advance())
 			{
@@ -1309,9 +1078,9 @@ bool ASTBase::ParseInitializerScope(ASTParsedTokens& tokens, const NameList& nam
 
 		if (tokens.Current().Type != AST_TOKEN_TYPE_SEMICOLON)
 		{
-			m_Print->Error("Syntax error. Expected ';' on line %d. Got '%s'",
+			m_Print->Error("Syntax error. Expected ';' on line %d. Got '%.*s'",
 				tokens.Current().GetLine(),
-				tokens.Current().GetDataPtr());
+				AST_TOKEN_ARG(tokens.Current()));
 		}
 
 		if (!tokens.Advance())
@@ -1340,12 +1109,142 @@ bool ASTBase::ParseInitializerScope(ASTParsedTokens& tokens, const NameList& nam
 	return true;
 }
 
+bool ASTBase::InterpretPipelineBlock(const SCHEMA_STRUCT& schema, void* desc)
+{
+	// No block, everything stays at its default
+	if (m_PipelineNode == AST_INVALID_NODE)
+	{
+		return true;
+	}
+
+	return InterpretInitializerList(schema, m_PipelineNode, (uint8_t*)desc);
+}
+
+const SCHEMA_FIELD* ASTBase::ResolveSchemaField(const SCHEMA_STRUCT& schema, std::string_view name, uint32_t line, uint32_t& outElement)
+{
+	outElement = 0;
+
+	const SCHEMA_FIELD* field = FindSchemaField(schema, name);
+	if (field)
+	{
+		if (field->ArraySize != 0)
+		{
+			m_Print->Error("\"%.*s\" on line %d needs an index, %.*s0 through %.*s%u",
+				AST_STRING_ARG(name), line, AST_STRING_ARG(name), AST_STRING_ARG(name), field->ArraySize - 1);
+			return nullptr;
+		}
+		return field;
+	}
+
+	// Array elements are Name0 or Name_0, split the index off and look up the rest
+	size_t indexStart = name.size();
+	while (indexStart > 0 && name[indexStart - 1] >= '0' && name[indexStart - 1] <= '9')
+	{
+		indexStart--;
+	}
+
+	std::string_view base = name.substr(0, indexStart);
+	const std::string_view index = name.substr(indexStart);
+	if (!base.empty() && base.back() == '_')
+	{
+		base.remove_suffix(1);
+	}
+
+	field = index.empty() ? nullptr : FindSchemaField(schema, base);
+	if (!field || field->ArraySize == 0)
+	{
+		m_Print->Error("Unknown pipeline state \"%.*s\" on line %d", AST_STRING_ARG(name), line);
+		return nullptr;
+	}
+
+	uint32_t element = 0;
+	for (char digit : index)
+	{
+		element = element * 10 + (uint32_t)(digit - '0');
+		if (element >= field->ArraySize)
+		{
+			m_Print->Error("\"%.*s\" on line %d is out of range, there are only %u",
+				AST_STRING_ARG(name), line, field->ArraySize);
+			return nullptr;
+		}
+	}
+
+	outElement = element;
+	return field;
+}
+
+bool ASTBase::InterpretInitializerList(const SCHEMA_STRUCT& schema, AST_NODE_INDEX list, uint8_t* obj)
+{
+	bool result = true;
+
+	for (AST_NODE_INDEX child = m_Arena.GetNode(list).FirstChild; child != AST_INVALID_NODE; child = m_Arena.GetNode(child).NextSibling)
+	{
+		const AST_NODE& assignment = m_Arena.GetNode(child);
+		const AST_NODE& value = m_Arena.GetNode(assignment.Value);
+
+		// "Src, Dst = x;" sets both
+		for (uint32_t i = 0; i < assignment.NumNames; i++)
+		{
+			const std::string_view name = m_Arena.GetName(assignment, i);
+
+			uint32_t element = 0;
+			const SCHEMA_FIELD* field = ResolveSchemaField(schema, name, assignment.Line, element);
+			if (!field)
+			{
+				result = false;
+				continue;
+			}
+
+			const bool isBlock = field->Type == SCHEMA_FIELD_TYPE_STRUCT || field->Type == SCHEMA_FIELD_TYPE_LIST;
+			if (isBlock != (value.Type == AST_NODE_TYPE_INITIALIZER_LIST))
+			{
+				m_Print->Error(isBlock ?
+					"\"%.*s\" on line %d is set with a block, %.*s = { ... };" :
+					"\"%.*s\" on line %d is set with a value, %.*s = value;",
+					AST_STRING_ARG(name), assignment.Line, AST_STRING_ARG(name));
+				result = false;
+				continue;
+			}
+
+			uint8_t* dst = obj + field->Offset + element * field->Stride;
+			if (field->Type == SCHEMA_FIELD_TYPE_LIST)
+			{
+				result &= InterpretInitializerList(*field->Struct, assignment.Value, (uint8_t*)field->List->Append(dst));
+			}
+			else if (field->Type == SCHEMA_FIELD_TYPE_STRUCT)
+			{
+				result &= InterpretInitializerList(*field->Struct, assignment.Value, dst);
+			}
+			else if (!SchemaParseValue(*field, value.Text, dst))
+			{
+				m_Print->Error("\"%.*s\" isn't a valid value for \"%.*s\" on line %d",
+					AST_STRING_ARG(value.Text), AST_STRING_ARG(name), value.Line);
+				result = false;
+			}
+
+			// Whatever element gets set is counted
+			if (field->CountOffset != SCHEMA_NO_OFFSET)
+			{
+				uint32_t count = 0;
+				memcpy(&count, obj + field->CountOffset, sizeof(count));
+				if (count < element + 1)
+				{
+					count = element + 1;
+					memcpy(obj + field->CountOffset, &count, sizeof(count));
+				}
+			}
+		}
+	}
+
+	return result;
+}
+
 bool ASTBase::ParseRegisterStatement(ASTParsedTokens& tokens)
 {
 	if (!tokens.Advance())
 	{
-		m_Print->Error("Unexpected end of statement at \"%s\" on line %d",
-			tokens.Current().GetDataPtr(), tokens.Current().GetLine());
+		m_Print->Error("Unexpected end of statement at \"%.*s\" on line %d",
+			AST_TOKEN_ARG(tokens.Current()), tokens.Current().GetLine());
 		AdvanceToEndOfStatement(tokens);
 		return false;
 	}
@@ -1359,16 +1258,16 @@ bool ASTBase::ParseRegisterStatement(ASTParsedTokens& tokens)
 
 	if (!tokens.Advance())
 	{
-		m_Print->Error("Unexpected end of statement at \"%s\" on line %d",
-			tokens.Current().GetDataPtr(), tokens.Current().GetLine());
+		m_Print->Error("Unexpected end of statement at \"%.*s\" on line %d",
+			AST_TOKEN_ARG(tokens.Current()), tokens.Current().GetLine());
 		AdvanceToEndOfStatement(tokens);
 		return false;
 	}
 
 	if (tokens.Current().Type != AST_TOKEN_TYPE_GENERAL_IDENTIFIER)
 	{
-		m_Print->Error("Unexpected syntax -> \"%s\" on line %d",
-			tokens.Current().GetDataPtr(), tokens.Current().GetLine());
+		m_Print->Error("Unexpected syntax -> \"%.*s\" on line %d",
+			AST_TOKEN_ARG(tokens.Current()), tokens.Current().GetLine());
 		AdvanceToEndOfStatement(tokens);
 		return false;
 	}
@@ -1377,8 +1276,8 @@ bool ASTBase::ParseRegisterStatement(ASTParsedTokens& tokens)
 
 	if (!tokens.Advance())
 	{
-		m_Print->Error("Unexpected end of statement at \"%s\" on line %d",
-			tokens.Current().GetDataPtr(), tokens.Current().GetLine());
+		m_Print->Error("Unexpected end of statement at \"%.*s\" on line %d",
+			AST_TOKEN_ARG(tokens.Current()), tokens.Current().GetLine());
 		m_UnrecoverableError = true;
 		return false;
 	}
@@ -1395,9 +1294,9 @@ bool ASTBase::ParseRegisterStatement(ASTParsedTokens& tokens)
 			}
 			if (tokens.Current().Type != AST_TOKEN_TYPE_GENERAL_IDENTIFIER)
 			{
-				m_Print->Error("Syntax error on line %d. Expected \"space<number>\" got %s",
+				m_Print->Error("Syntax error on line %d. Expected \"space<number>\" got %.*s",
 					tokens.Current().GetLine(),
-					tokens.Current().GetDataPtr());
+					AST_TOKEN_ARG(tokens.Current()));
 				return false;
 			}
 			if (!tokens.Advance())
@@ -1408,16 +1307,16 @@ bool ASTBase::ParseRegisterStatement(ASTParsedTokens& tokens)
 			}
 			if (tokens.Current().Type != AST_TOKEN_TYPE_RIGHT_PARENTHESIS)
 			{
-				m_Print->Error("Unexpected syntax on line %d. Expected ')' got '%s'",
+				m_Print->Error("Unexpected syntax on line %d. Expected ')' got '%.*s'",
 					tokens.Current().GetLine(),
-					tokens.Current().GetDataPtr());
+					AST_TOKEN_ARG(tokens.Current()));
 				return false;
 			}
 		}
 		else
 		{
-			m_Print->Error("Unexpected token \"%s\" at end of register statement on line %d",
-				tokens.Current().GetDataPtr(), tokens.Current().GetLine());
+			m_Print->Error("Unexpected token \"%.*s\" at end of register statement on line %d",
+				AST_TOKEN_ARG(tokens.Current()), tokens.Current().GetLine());
 			AdvanceToEndOfStatement(tokens);
 			return false;
 		}
@@ -1425,13 +1324,13 @@ bool ASTBase::ParseRegisterStatement(ASTParsedTokens& tokens)
 
 	if (regSlotToken.GetData().size() != 2 && regSlotToken.GetData().size() != 3)
 	{
-		m_Print->Error("Invalid register slot type \"%s\" on line %d",
-			regSlotToken.GetDataPtr(), regSlotToken.GetLine());
+		m_Print->Error("Invalid register slot type \"%.*s\" on line %d",
+			AST_TOKEN_ARG(regSlotToken), regSlotToken.GetLine());
 		AdvanceToEndOfStatement(tokens);
 		return false;
 	}
 
-	std::string regSlot = regSlotToken.GetData();
+	std::string regSlot(regSlotToken.GetData());
 	char regType = regSlot[0];
 	std::string regNumStr = regSlot.substr(1);
 	bool doContinue = true;
@@ -1441,8 +1340,8 @@ bool ASTBase::ParseRegisterStatement(ASTParsedTokens& tokens)
 		if (ch < '0' || ch > '9')
 		{
 			// From here we leave it up to the compiler to fail
-			m_Print->Error("register slot must be one of {u, t, s, b} followed by a number. Got %s on line %d",
-				regSlotToken.GetDataPtr(), regSlotToken.GetLine());
+			m_Print->Error("register slot must be one of {u, t, s, b} followed by a number. Got %.*s on line %d",
+				AST_TOKEN_ARG(regSlotToken), regSlotToken.GetLine());
 			AdvanceToEndOfStatement(tokens);
 			doContinue = false;
 			break;
@@ -1493,7 +1392,7 @@ bool ASTBase::ParseFunctionDefinition(ASTParsedTokens& tokens)
 {
 	ASTFunctionDecl funcDecl;
 
-	funcDecl.ReturnType = tokens.Current().GetData();
+	funcDecl.ReturnType = InternToken(tokens.Current());
 
 	if (!tokens.Advance())
 	{
@@ -1504,18 +1403,19 @@ bool ASTBase::ParseFunctionDefinition(ASTParsedTokens& tokens)
 
 	if (tokens.Current().Type != AST_TOKEN_TYPE_GENERAL_IDENTIFIER)
 	{
-		m_Print->Error("Invalid function name on line %d. Got \"%s\"",
+		m_Print->Error("Invalid function name on line %d. Got \"%.*s\"",
 			tokens.Current().GetLine(),
-			tokens.Current().GetDataPtr());
+			AST_TOKEN_ARG(tokens.Current()));
 		return false;
 	}
 
-	funcDecl.Name = tokens.Current().GetData();
+	const AST_SYMBOL funcSymbol = m_Symbols.Intern(tokens.Current().GetData());
+	funcDecl.Name = m_Symbols.GetString(funcSymbol);
 
 	if (HasParsedFunction(funcDecl.Name))
 	{
-		m_Print->Error("Function redefinition \"%s\" on line %d",
-			funcDecl.Name,
+		m_Print->Error("Function redefinition \"%.*s\" on line %d",
+			AST_STRING_ARG(funcDecl.Name),
 			tokens.Current().GetLine());
 		return false;
 	}
@@ -1564,7 +1464,7 @@ bool ASTBase::ParseFunctionDefinition(ASTParsedTokens& tokens)
 
 		if (tokens.Current().Type == AST_TOKEN_TYPE_PARAM_MODIFIER)
 		{
-			param.Modifier = tokens.Current().GetData();
+			param.Modifier = InternToken(tokens.Current());
 
 			if (!tokens.Advance())
 			{
@@ -1579,20 +1479,20 @@ bool ASTBase::ParseFunctionDefinition(ASTParsedTokens& tokens)
 		{
 			if (!IsValidType(tokens.Current().GetData()))
 			{
-				m_Print->Error("Invalid data type in function parameter for function %s. Type: %s on line %d",
-					funcDecl.Name.c_str(),
-					tokens.Current().GetDataPtr(),
+				m_Print->Error("Invalid data type in function parameter for function %.*s. Type: %.*s on line %d",
+					AST_STRING_ARG(funcDecl.Name),
+					AST_TOKEN_ARG(tokens.Current()),
 					tokens.Current().GetLine());
 				return false;
 			}
 
-			param.Type = tokens.Current().GetData();
+			param.Type = InternToken(tokens.Current());
 		}
 		else
 		{
-			m_Print->Error("Invalid function parameter type %s for function %s on line %d",
-				tokens.Current().GetDataPtr(),
-				funcDecl.Name.c_str(),
+			m_Print->Error("Invalid function parameter type %.*s for function %.*s on line %d",
+				AST_TOKEN_ARG(tokens.Current()),
+				AST_STRING_ARG(funcDecl.Name),
 				tokens.Current().GetLine());
 			return false;
 		}
@@ -1606,14 +1506,14 @@ bool ASTBase::ParseFunctionDefinition(ASTParsedTokens& tokens)
 
 		if (tokens.Current().Type != AST_TOKEN_TYPE_GENERAL_IDENTIFIER)
 		{
-			m_Print->Error("Invalid parameter name %s for function %s on line %d",
-				tokens.Current().GetDataPtr(),
-				funcDecl.Name.c_str(),
+			m_Print->Error("Invalid parameter name %.*s for function %.*s on line %d",
+				AST_TOKEN_ARG(tokens.Current()),
+				AST_STRING_ARG(funcDecl.Name),
 				tokens.Current().GetLine());
 			return false;
 		}
 
-		param.Name = tokens.Current().GetData();
+		param.Name = InternToken(tokens.Current());
 
 		if (!tokens.Advance())
 		{
@@ -1633,14 +1533,14 @@ bool ASTBase::ParseFunctionDefinition(ASTParsedTokens& tokens)
 
 			if (tokens.Current().Type != AST_TOKEN_TYPE_GENERAL_IDENTIFIER)
 			{
-				m_Print->Error("Invalid semantic name %s for function %s on line %d",
-					tokens.Current().GetDataPtr(),
-					funcDecl.Name.c_str(),
+				m_Print->Error("Invalid semantic name %.*s for function %.*s on line %d",
+					AST_TOKEN_ARG(tokens.Current()),
+					AST_STRING_ARG(funcDecl.Name),
 					tokens.Current().GetLine());
 				return false;
 			}
 
-			param.Semantic = tokens.Current().GetData();
+			param.Semantic = InternToken(tokens.Current());
 
 			if (!tokens.Advance())
 			{
@@ -1648,6 +1548,15 @@ bool ASTBase::ParseFunctionDefinition(ASTParsedTokens& tokens)
 				m_Print->Error("Unexpected end of file on line %d", tokens.Current().GetLine());
 				return false;
 			}
+
+			// Step over the comma too, otherwise every parameter after
+			// the first one with a semantic gets dropped
+			if (tokens.Current().Type == AST_TOKEN_TYPE_COMMA && !tokens.Advance())
+			{
+				m_UnrecoverableError = true;
+				m_Print->Error("Unexpected end of file on line %d", tokens.Current().GetLine());
+				return false;
+			}
 		}
 		else if (tokens.Current().Type == AST_TOKEN_TYPE_COMMA)
 		{
@@ -1740,25 +1649,31 @@ bool ASTBase::ParseFunctionDefinition(ASTParsedTokens& tokens)
 
 		if (tokens.Current().Type != AST_TOKEN_TYPE_GENERAL_IDENTIFIER)
 		{
-			m_Print->Error("Invalid return semantic for function %s. Got %s on line %d",
-				funcDecl.Name.c_str(),
-				tokens.Current().GetDataPtr(),
+			m_Print->Error("Invalid return semantic for function %.*s. Got %.*s on line %d",
+				AST_STRING_ARG(funcDecl.Name),
+				AST_TOKEN_ARG(tokens.Current()),
 				tokens.Current().GetLine());
 			return false;
 		}
 
-		funcDecl.ReturnSemantic = tokens.Current().GetData();
+		funcDecl.ReturnSemantic = InternToken(tokens.Current());
+
+		if (!tokens.Advance())
+		{
+			m_UnrecoverableError = true;
+			m_Print->Error("Unexpected end of file on line %d", tokens.Current().GetLine());
+			return false;
+		}
 	}
 
-	if (!tokens.Advance())
+	// Leave the caller on the body's '}', walking into the body
+	// would close one scope too many and end the whole parse
+	if (tokens.Current().Type == AST_TOKEN_TYPE_LEFT_CURLY && tokens.GetMatch() != LEXER_NO_MATCH)
 	{
-		m_UnrecoverableError = true;
-		m_Print->Error("Unexpected end of file on line %d", tokens.Current().GetLine());
-		return false;
+		tokens.JumpTo(tokens.GetMatch());
 	}
 
-	m_Funcs.push_back(funcDecl.Name);
-	m_FuncsParsed.insert(std::pair<std::string, ASTFunctionDecl>(funcDecl.Name, funcDecl));
+	m_Funcs.Insert(funcSymbol, std::move(funcDecl));
 
 	return true;
 
@@ -1767,6 +1682,104 @@ Failure:
 	return false;
 }
 
+bool ASTBase::ParseIncludeStatement(ASTParsedTokens& tokens)
+{
+	// The path is read straight from the source line, the lexer
+	// splits it up on every '/' and '.' otherwise
+	const Lexer& lexer = tokens.GetLexer();
+	const uint32_t line = tokens.Current().GetLine();
+	const uint32_t lineEnd = lexer.GetLineStart(line + 1);
+	const uint32_t start = lexer.GetOffset(tokens.Ptr) + (uint32_t)tokens.Current().GetData().size();
+	std::string_view rest = lexer.GetSource().substr(start, lineEnd - start);
+
+	// Step over the rest of the line whatever it holds
+	while (tokens.CanPeekNext() && lexer.GetOffset(tokens.Ptr + 1) < lineEnd)
+	{
+		tokens.Advance();
+	}
+
+	const size_t open = rest.find_first_of("\"<");
+	const size_t close = open == std::string_view::npos ? open : rest.find_first_of("\">", open + 1);
+	if (close == std::string_view::npos)
+	{
+		m_Print->Error("Malformed #include on line %d", line);
+		return false;
+	}
+
+	if (m_Headers == nullptr)
+	{
+		return true;
+	}
+
+	std::filesystem::path path = m_Headers->GetIncludeDir() / std::filesystem::path(rest.substr(open + 1, close - open - 1));
+	std::shared_ptr<const ASTBase> header = m_Headers->Get(path, m_Print);
+	if (header == nullptr)
+	{
+		// Leave it to DXC to report missing headers, it knows better
+		return true;
+	}
+
+	ImportHeader(path, header);
+	return true;
+}
+
+void ASTBase::ImportHeader(const std::filesystem::path& path, const std::shared_ptr<const ASTBase>& header)
+{
+	auto addImport = [&](const AST_IMPORT& import) {
+		for (const AST_IMPORT& existing : m_Imports)
+		{
+			if (existing.Header == import.Header)
+			{
+				return;
+			}
+		}
+		m_Imports.push_back(import);
+	};
+
+	// Flattened so a lookup visits every header once, however tangled the includes are
+	for (const AST_IMPORT& nested : header->GetImports())
+	{
+		addImport(nested);
+	}
+	addImport({ path, header });
+}
+
+const ASTFunctionDecl* ASTBase::GetFuncDecl(std::string_view funcName) const
+{
+	if (const ASTFunctionDecl* decl = m_Funcs.Find(m_Symbols.Find(funcName)))
+	{
+		return decl;
+	}
+
+	for (const AST_IMPORT& import : m_Imports)
+	{
+		if (const ASTFunctionDecl* decl = import.Header->m_Funcs.Find(import.Header->m_Symbols.Find(funcName)))
+		{
+			return decl;
+		}
+	}
+
+	return nullptr;
+}
+
+const ASTStructDecl* ASTBase::GetStructDecl(std::string_view structName) const
+{
+	if (const ASTStructDecl* decl = m_Structs.Find(m_Symbols.Find(structName)))
+	{
+		return decl;
+	}
+
+	for (const AST_IMPORT& import : m_Imports)
+	{
+		if (const ASTStructDecl* decl = import.Header->m_Structs.Find(import.Header->m_Symbols.Find(structName)))
+		{
+			return decl;
+		}
+	}
+
+	return nullptr;
+}
+
 bool ASTBase::IsFunctionDeclaration(ASTParsedTokens tokens)
 {
 	// Assume we're at a general identifier
@@ -1789,15 +1802,84 @@ bool ASTBase::IsFunctionDeclaration(ASTParsedTokens tokens)
 	return false;
 }
 
-bool ASTBase::IsStructDefined(const std::string& name)
+bool ASTBase::IsStructDefined(std::string_view name) const
 {
-	for (size_t i = 0; i < m_Structs.size(); i++)
+	return GetStructDecl(name) != nullptr;
+}
+
+static EINPUT_ITEM_FORMAT TypeToItemFormat(std::string_view type)
+{
+	static constexpr struct {
+		std::string_view Type;
+		EINPUT_ITEM_FORMAT Format;
+	} s_Formats[] = {
+		{ "float", INPUT_ITEM_FORMAT_FLOAT },
+		{ "float2", INPUT_ITEM_FORMAT_FLOAT2 },
+		{ "float3", INPUT_ITEM_FORMAT_FLOAT3 },
+		{ "float4", INPUT_ITEM_FORMAT_FLOAT4 },
+		{ "int", INPUT_ITEM_FORMAT_INT },
+		{ "int2", INPUT_ITEM_FORMAT_INT2 },
+		{ "int3", INPUT_ITEM_FORMAT_INT3 },
+		{ "int4", INPUT_ITEM_FORMAT_INT4 }
+	};
+
+	for (const auto& format : s_Formats)
 	{
-		if (name == m_Structs[i])
+		if (format.Type == type)
 		{
-			return true;
+			return format.Format;
 		}
 	}
+	return INPUT_ITEM_FORMAT_INVALID;
+}
 
-	return false;
+static inline bool IsVertexInputSemantic(std::string_view semantic)
+{
+	return !semantic.empty() && semantic.substr(0, 3) != "SV_";
+}
+
+bool ASTBase::GetVertexInputLayout(std::string_view entry, GFX_INPUT_LAYOUT_DESC& outLayout) const
+{
+	const ASTFunctionDecl* func = GetFuncDecl(entry);
+	if (func == nullptr)
+	{
+		return false;
+	}
+
+	outLayout.InputItems.clear();
+
+	auto addItem = [&](std::string_view type, std::string_view semantic) {
+		EINPUT_ITEM_FORMAT format = TypeToItemFormat(type);
+		if (format == INPUT_ITEM_FORMAT_INVALID)
+		{
+			m_Print->Warn("Vertex input \"%.*s\" has type \"%.*s\" which can't be used in an input layout",
+				AST_STRING_ARG(semantic),
+				AST_STRING_ARG(type));
+			return;
+		}
+		outLayout.InputItems.push_back({ std::string(semantic), format });
+	};
+
+	for (const ASTFunctionDecl::Param& param : func->Params)
+	{
+		const ASTStructDecl* inputStruct = GetStructDecl(param.Type);
+		if (inputStruct == nullptr)
+		{
+			if (IsVertexInputSemantic(param.Semantic))
+			{
+				addItem(param.Type, param.Semantic);
+			}
+			continue;
+		}
+
+		for (const ASTStructDecl::Member& member : inputStruct->Members)
+		{
+			if (IsVertexInputSemantic(member.Semantic))
+			{
+				addItem(member.Type, member.Semantic);
+			}
+		}
+	}
+
+	return true;
 }
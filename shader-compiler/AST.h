@@ -4,96 +4,72 @@
 #include <memory>
 #include "Pipeline.h"
 #include "ASTTypes.h"
+#include "Lexer.h"
+#include "SymbolTable.h"
+#include "PipelineSchema.h"
+#include <string_view>
 
 
 
 
 
-typedef enum EAST_TOKEN_TYPE {
-	AST_TOKEN_TYPE_NONE = 0,
-
-	// General syntax stuff
-	AST_TOKEN_TYPE_LEFT_CURLY,
-	AST_TOKEN_TYPE_RIGHT_CURLY,
-	AST_TOKEN_TYPE_LEFT_PARENTHESIS,
-	AST_TOKEN_TYPE_RIGHT_PARENTHESIS,
-	AST_TOKEN_TYPE_LEFT_GATOR,
-	AST_TOKEN_TYPE_RIGHT_GATOR,
-	AST_TOKEN_TYPE_COMMA,
-	AST_TOKEN_TYPE_COLON,
-	AST_TOKEN_TYPE_DOUBLE_COLON,
-	AST_TOKEN_TYPE_EQUALS,
-	AST_TOKEN_TYPE_SEMICOLON,
-	AST_TOKEN_TYPE_LEFT_SQUARE,
-	AST_TOKEN_TYPE_RIGHT_SQUARE,
-	AST_TOKEN_TYPE_DOUBLE_LEFT_SQUARE,
-	AST_TOKEN_TYPE_DOUBLE_RIGHT_SQUARE,
-	AST_TOKEN_TYPE_SINGLE_QUOTE,
-	AST_TOKEN_TYPE_DOUBLE_QUOTE,
-
-	// Catch all for math stuff, we don't care about this
-	AST_TOKEN_TYPE_MATH_OPERATION,
-
-	// Different keyword types
-	AST_TOKEN_TYPE_PARAM_MODIFIER,
-	AST_TOKEN_TYPE_BUILTIN_DATATYPE,
-	AST_TOKEN_TYPE_STRUCT_KEYWORD,
-	AST_TOKEN_TYPE_HLSL_KEYWORD,
-
-	// Catch all for when we think we're looking at an identifier
-	AST_TOKEN_TYPE_GENERAL_IDENTIFIER,
+#define SCOPE_UNDERFLOW_CHECK 4096
 
-	// Special marker that this node needs a second pass
-	AST_TOKEN_TYPE_UNKNOWN
-} EAST_TOKEN_TYPE;
+class HeaderCache;
+class ASTBase;
 
-#define SCOPE_UNDERFLOW_CHECK 4096
+/*
+* A header some AST imported declarations from.
+* Holding on to it keeps the decl strings that point into it alive.
+*/
+typedef struct AST_IMPORT {
+	std::filesystem::path Path;
+	std::shared_ptr<const ASTBase> Header;
+} AST_IMPORT;
 
-typedef struct TOKEN {
-	std::string Data;
-	uint32_t Line;
-} TOKEN;
+// Token text isn't null terminated, print it with "%.*s" and AST_TOKEN_ARG(token)
+#define AST_TOKEN_ARG(token) (int)(token).GetData().size(), (token).GetData().data()
+#define AST_STRING_ARG(str) (int)(str).size(), (str).data()
 
 class ASTToken
 {
 public:
-	TOKEN Data;
+	std::string_view Data;
 	EAST_TOKEN_TYPE Type;
 
-	inline const std::string& GetData() const
-	{
-		return Data.Data;
-	}
+	// Where the token lives in the lexer, the line is only looked up when asked for
+	uint32_t Index;
+	const Lexer* Source;
 
-	inline const char* GetDataPtr() const
+	inline std::string_view GetData() const
 	{
-		return Data.Data.c_str();
+		return Data;
 	}
 
 	inline uint32_t GetLine() const
 	{
-		return Data.Line;
+		return Source->GetLine(Index);
 	}
 };
 
-template<typename T>
-class ASTItemsList
+/*
+* Cursor over the tokens of a Lexer. Tokens are handed out by value and
+* words only get classified the first time the parser looks at them, the
+* result is written back into the lexer. Whatever the parser jumps over
+* with JumpTo, like function bodies, is never classified at all.
+*/
+class ASTParsedTokens
 {
 public:
 
-	ASTItemsList() = delete;
+	ASTParsedTokens() = delete;
 
-	ASTItemsList(std::vector<T>& inItems) :
-		Items(inItems),
-		Ptr(0)
+	ASTParsedTokens(Lexer& lexer) :
+		Ptr(0),
+		m_Lexer(&lexer)
 	{
 	}
 
-	ASTItemsList(const ASTItemsList<T>& other) :
-		Items(other.Items),
-		Ptr(other.Ptr)
-	{ }
-
 	inline bool Advance()
 	{
 		if (!CanPeekNext())
@@ -105,46 +81,79 @@ public:
 		return true;
 	}
 
-	inline bool CanPeekNext() const
+	/*
+	* @brief: Moves straight to token ptr, false if it's past the end
+	*/
+	inline bool JumpTo(size_t ptr)
 	{
-		if (Ptr + 1 > Items.size() - 1)
+		if (ptr >= Count())
 		{
 			return false;
 		}
+
+		Ptr = ptr;
 		return true;
 	}
 
-	inline const T& PeekNext() const
+	inline bool CanPeekNext() const
 	{
-		return Items[Ptr + 1];
+		return Ptr + 1 < Count();
+	}
+
+	inline ASTToken PeekNext() const
+	{
+		return Get(Ptr + 1);
 	}
 
 	inline size_t Count() const
 	{
-		return Items.size();
+		return m_Lexer->Count();
 	}
 
-	inline const T& Current() const
+	inline const Lexer& GetLexer() const
 	{
-		return Items[Ptr];
+		return *m_Lexer;
 	}
 
-	inline const T& Last() const
+	inline ASTToken Current() const
+	{
+		return Get(Ptr);
+	}
+
+	inline ASTToken Last() const
 	{
 		if (Ptr == 0)
 		{
 			return Current();
 		}
 
-		return Items[Ptr - 1];
+		return Get(Ptr - 1);
+	}
+
+	/*
+	* @returns: Index of the delimiter matching the current token, see Lexer::GetMatch
+	*/
+	inline uint32_t GetMatch() const
+	{
+		return m_Lexer->GetMatch(Ptr);
+	}
+
+	/*
+	* @returns: Index of the first ';' after the current token, Count() if there isn't one
+	*/
+	inline uint32_t GetNextSemicolon() const
+	{
+		return CanPeekNext() ? m_Lexer->GetNextSemicolon(Ptr + 1) : (uint32_t)Count();
 	}
 
 	size_t Ptr;
-	const std::vector<T>& Items;
-};
 
-typedef ASTItemsList<TOKEN> ASTUnparsedTokens;
-typedef ASTItemsList<ASTToken> ASTParsedTokens;
+private:
+
+	ASTToken Get(size_t index) const;
+
+	Lexer* m_Lexer;
+};
 
 class ASTBase
 {
@@ -154,7 +163,12 @@ public:
 
 	bool LoadFile(const std::filesystem::path& path);
 
-	bool Parse(ASTUnparsedTokens& tokens);
+	/*
+	* @brief: Same as LoadFile for a file that's already been read
+	*/
+	bool LoadSource(std::shared_ptr<const std::string> source);
+
+	bool Parse(Lexer& lexer);
 
 	bool SecondPassParse(ASTParsedTokens& tokens);
 
@@ -162,6 +176,24 @@ public:
 
 	void SetPrintHandler(IPrintHandler* handler);
 
+	/*
+	* @brief: #include "..." statements pull the structs and functions of the
+	* header in from cache, parsing it there if nobody has yet.
+	* Without a cache includes are skipped.
+	*/
+	inline void SetHeaderCache(HeaderCache* cache)
+	{
+		m_Headers = cache;
+	}
+
+	/*
+	* @returns: Every header this file included, directly or not, each one once
+	*/
+	inline const std::vector<AST_IMPORT>& GetImports() const
+	{
+		return m_Imports;
+	}
+
 	inline const std::string& GetReconstructedResourcesBlock() const
 	{
 		return m_ResourcesBlockStr;
@@ -172,40 +204,84 @@ public:
 		return m_Counts;
 	}
 
-	inline void GetPipelineBlockLines(uint32_t& outStart, uint32_t& outEnd)
+	inline const ASTArena& GetArena() const
+	{
+		return m_Arena;
+	}
+
+	inline AST_NODE_INDEX GetPipelineNode() const
+	{
+		return m_PipelineNode;
+	}
+
+	inline void GetPipelineBlockLines(uint32_t& outStart, uint32_t& outEnd) const
 	{
 		outStart = m_PipelineBlockStart;
 		outEnd = m_PipelineBlockEnd;
 	}
 
-	inline bool GetFuncDecl(const std::string& funcName, ASTFunctionDecl& outFunc)
+	/*
+	* @brief: Byte range of the Pipeline block in GetSource(), from the start of
+	* "Pipeline" to just past its closing ';'. Both are 0 if there's no block.
+	*/
+	inline void GetPipelineBlockRange(uint32_t& outBegin, uint32_t& outEnd) const
 	{
-		auto findRes = m_FuncsParsed.find(funcName);
-		if (findRes == m_FuncsParsed.end())
-		{
-			return false;
-		}
+		outBegin = m_PipelineBlockBeginOffset;
+		outEnd = m_PipelineBlockEndOffset;
+	}
 
-		outFunc = findRes->second;
-		return true;
+	/*
+	* @brief: The file exactly as read by LoadFile. Shared so the compile
+	* stage can keep using it after the AST is gone.
+	*/
+	inline const std::shared_ptr<const std::string>& GetSource() const
+	{
+		return m_Source;
 	}
 
-	inline bool GetStructDecl(const std::string& structName, ASTStructDecl& outStruct)
+	inline const Lexer& GetLexer() const
 	{
-		auto findRes = m_StructsParsed.find(structName);
-		if (findRes == m_StructsParsed.end())
-		{
-			return false;
-		}
+		return m_Lexer;
+	}
 
-		outStruct = findRes->second;
-		return true;
+	/*
+	* @returns: The parsed function, from this file or anything it included,
+	* or nullptr. Valid until the next LoadFile
+	*/
+	const ASTFunctionDecl* GetFuncDecl(std::string_view funcName) const;
+
+	/*
+	* @returns: The parsed struct, from this file or anything it included,
+	* or nullptr. Valid until the next LoadFile
+	*/
+	const ASTStructDecl* GetStructDecl(std::string_view structName) const;
+
+	/*
+	* @returns: Every struct declared in this file in declaration order, included ones aren't in here
+	*/
+	inline const std::vector<ASTStructDecl>& GetStructDecls() const
+	{
+		return m_Structs.GetItems();
+	}
+
+	/*
+	* @returns: Every function declared in this file in declaration order, included ones aren't in here
+	*/
+	inline const std::vector<ASTFunctionDecl>& GetFuncDecls() const
+	{
+		return m_Funcs.GetItems();
 	}
 
+	/*
+	* @brief: Builds the input layout of a vertex shader entry point from its
+	* parameters, flattening struct parameters member by member in declaration order.
+	* Parameters and members without a semantic, or with an SV_ one, are skipped.
+	* @returns: false if the entry point wasn't parsed
+	*/
+	bool GetVertexInputLayout(std::string_view entry, GFX_INPUT_LAYOUT_DESC& outLayout) const;
 
-protected:
 
-	typedef std::vector<std::string> NameList;
+protected:
 
 	bool ParseResourcesBlock(ASTParsedTokens& tokens);
 
@@ -215,27 +291,32 @@ protected:
 
 	bool ParseStructDefinition(ASTParsedTokens& tokens);
 
-	bool ParseInitializerScope(
-		ASTParsedTokens& tokens,
-		const NameList& name,
-		std::shared_ptr<ASTInitializerList> outList
-	);
+	bool ParseInitializerScope(ASTParsedTokens& tokens, AST_NODE_INDEX outList);
 
 	bool ParseRegisterStatement(ASTParsedTokens& tokens);
 
+	bool ParseIncludeStatement(ASTParsedTokens& tokens);
+
+	/*
+	* @brief: Makes header's structs and functions, and those of everything it
+	* included, visible to lookups. Nothing is copied, lookups that miss this
+	* file's own tables go through each import's tables in include order.
+	*/
+	void ImportHeader(const std::filesystem::path& path, const std::shared_ptr<const ASTBase>& header);
+
 	bool ParseFunctionDefinition(ASTParsedTokens& tokens);
 
 	bool IsFunctionDeclaration(ASTParsedTokens tokens);
 
-	bool IsStructDefined(const std::string& name);
+	bool IsStructDefined(std::string_view name) const;
 
-	bool IsValidType(const std::string& type) const;
+	bool IsValidType(std::string_view type) const;
 
-	bool HasParsedFunction(const std::string& name) const;
+	bool HasParsedFunction(std::string_view name) const;
 
-	bool IsSystemType(const std::string& type) const;
+	bool IsSystemType(std::string_view type) const;
 
-	bool IsHLSLReservedWord(const std::string& word) const;
+	bool IsHLSLReservedWord(std::string_view word) const;
 
 	/*
 	* @summary: Given the current scope, try to advance to the end of the given scope
@@ -252,15 +333,40 @@ protected:
 
 	void AdvanceToEndOfStatement(ASTParsedTokens& tokens);
 
-	std::vector<ASTToken> BreakUpStringWithSyntaxSugar(const std::string& statement, uint32_t lineNumber) const;
+	inline uint32_t GetTokenOffset(const ASTToken& token) const
+	{
+		return (uint32_t)(token.GetData().data() - m_Source->data());
+	}
+
+	bool IsValidParamModifier(std::string_view modifier) const;
 
-	bool IsValidParamModifier(const std::string& modifier) const;
+	/*
+	* @brief: Fills desc from the Pipeline block in one walk over the arena.
+	* Every assignment goes straight to its field through the schema, anything
+	* the block doesn't set keeps what desc already had.
+	* @returns: false if anything in the block isn't valid state, after reporting all of it
+	*/
+	bool InterpretPipelineBlock(const SCHEMA_STRUCT& schema, void* desc);
 
-	std::vector<std::string> m_Structs;
-	std::map<std::string, ASTStructDecl> m_StructsParsed;
+	bool InterpretInitializerList(const SCHEMA_STRUCT& schema, AST_NODE_INDEX list, uint8_t* obj);
 
-	std::vector<std::string> m_Funcs;
-	std::map<std::string, ASTFunctionDecl> m_FuncsParsed;
+	/*
+	* @returns: The field name refers to and for fixed arrays which element, or nullptr
+	*/
+	const SCHEMA_FIELD* ResolveSchemaField(const SCHEMA_STRUCT& schema, std::string_view name, uint32_t line, uint32_t& outElement);
+
+	/*
+	* @returns: The token's text interned in m_Symbols, safe to keep after the file is gone
+	*/
+	inline std::string_view InternToken(const ASTToken& token)
+	{
+		return m_Symbols.GetString(m_Symbols.Intern(token.GetData()));
+	}
+
+	// Names, types and semantics of every decl, the decls hold views into it
+	SymbolTable m_Symbols;
+	SymbolMap<ASTStructDecl> m_Structs;
+	SymbolMap<ASTFunctionDecl> m_Funcs;
 
 	bool m_UnrecoverableError = false;
 
@@ -269,14 +375,24 @@ protected:
 
 	uint32_t m_PipelineBlockStart = 0;
 	uint32_t m_PipelineBlockEnd = 0;
+	uint32_t m_PipelineBlockBeginOffset = 0;
+	uint32_t m_PipelineBlockEndOffset = 0;
+
+	// Tokens point into m_Source, it has to stay alive as long as they do
+	std::shared_ptr<const std::string> m_Source;
+	Lexer m_Lexer;
 
-	std::vector<ASTToken> m_Tokens;
 	IPrintHandler* m_Print;
 
+	HeaderCache* m_Headers = nullptr;
+	std::vector<AST_IMPORT> m_Imports;
+
 	bool m_ResourcesBlockParsed = false;
 
 	bool m_PipelineParsed = false;
-	std::shared_ptr<ASTInitializerList> m_PipelineNode;
+	// Owns every node of the Pipeline block, m_PipelineNode is its root list
+	ASTArena m_Arena;
+	AST_NODE_INDEX m_PipelineNode = AST_INVALID_NODE;
 };
 
 
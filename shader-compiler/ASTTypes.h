@@ -3,6 +3,8 @@
 #include <vector>
 #include <memory>
 #include <unordered_map>
+#include <string_view>
+#include <type_traits>
 #include "Pipeline.h"
 
 
@@ -16,9 +18,6 @@ typedef enum EAST_NODE_TYPE {
 } EAST_NODE_TYPE;
 
 
-class ASTAssignment;
-class ASTInitializerList;
-
 class IASTNode
 {
 public:
@@ -27,79 +26,144 @@ public:
 
 };
 
-class ASTInitializerList : public IASTNode
+typedef uint32_t AST_NODE_INDEX;
+
+#define AST_INVALID_NODE ((AST_NODE_INDEX)0xffffffff)
+
+/*
+* One node of the Pipeline block. Which fields mean something depends on Type:
+*   AST_NODE_TYPE_INITIALIZER_LIST: FirstChild/LastChild, the assignments inside the braces
+*   AST_NODE_TYPE_ASSIGNMENT: FirstName/NumNames and Value, the node being assigned
+*   AST_NODE_TYPE_VALUE: Text, the value as written
+* Siblings are chained through NextSibling.
+* Nothing in here owns memory, strings are views into the file the
+* ASTBase loaded and children are indices into the same ASTArena.
+*/
+typedef struct AST_NODE {
+	EAST_NODE_TYPE Type;
+	uint32_t Line;
+	AST_NODE_INDEX NextSibling;
+
+	AST_NODE_INDEX FirstChild;
+	AST_NODE_INDEX LastChild;
+
+	uint32_t FirstName;
+	uint32_t NumNames;
+	AST_NODE_INDEX Value;
+
+	std::string_view Text;
+} AST_NODE;
+
+static_assert(std::is_trivially_destructible_v<AST_NODE>, "AST_NODE has to be freeable without running destructors");
+
+/*
+* Flat storage for every Pipeline block node in one file.
+* Nodes and names are appended to two arrays and refer to each other by
+* index, so building the tree is a couple of bumps into memory that's
+* already reserved, and Reset() throws it all away in O(1) while keeping
+* the capacity for the next file.
+*/
+class ASTArena
 {
 public:
 
-	EAST_NODE_TYPE Type() const override
+	inline void Reset()
 	{
-		return AST_NODE_TYPE_INITIALIZER_LIST;
+		m_Nodes.clear();
+		m_Names.clear();
 	}
 
-	std::vector<
-		std::shared_ptr<
-		IASTNode
-		>
-	> Assignments;
-};
-
-class ASTDefineValue : public IASTNode
-{
-
-};
+	inline AST_NODE_INDEX NewNode(EAST_NODE_TYPE type, uint32_t line)
+	{
+		AST_NODE node = { };
+		node.Type = type;
+		node.Line = line;
+		node.NextSibling = AST_INVALID_NODE;
+		node.FirstChild = AST_INVALID_NODE;
+		node.LastChild = AST_INVALID_NODE;
+		node.Value = AST_INVALID_NODE;
+		m_Nodes.push_back(node);
+		return (AST_NODE_INDEX)(m_Nodes.size() - 1);
+	}
 
-class ASTAssignmentValue : public IASTNode
-{
-public:
+	inline AST_NODE_INDEX NewValue(std::string_view text, uint32_t line)
+	{
+		AST_NODE_INDEX index = NewNode(AST_NODE_TYPE_VALUE, line);
+		m_Nodes[index].Text = text;
+		return index;
+	}
 
-	ASTAssignmentValue() = default;
-	ASTAssignmentValue(const std::string& value) :
-		Value(value)
+	/*
+	* @brief: Names for one assignment have to be pushed back to back,
+	* the assignment keeps the index of the first and a count
+	*/
+	inline uint32_t AddName(std::string_view name)
 	{
+		m_Names.push_back(name);
+		return (uint32_t)(m_Names.size() - 1);
 	}
 
-	EAST_NODE_TYPE Type() const override
+	inline void AppendChild(AST_NODE_INDEX list, AST_NODE_INDEX child)
 	{
-		return AST_NODE_TYPE_VALUE;
+		AST_NODE& parent = m_Nodes[list];
+		if (parent.LastChild == AST_INVALID_NODE)
+		{
+			parent.FirstChild = child;
+		}
+		else
+		{
+			m_Nodes[parent.LastChild].NextSibling = child;
+		}
+		parent.LastChild = child;
 	}
 
-	std::string Value;
-};
+	inline AST_NODE& GetNode(AST_NODE_INDEX index)
+	{
+		return m_Nodes[index];
+	}
 
-class ASTAssignment : public IASTNode
-{
-public:
+	inline const AST_NODE& GetNode(AST_NODE_INDEX index) const
+	{
+		return m_Nodes[index];
+	}
 
-	EAST_NODE_TYPE Type() const override
+	inline std::string_view GetName(const AST_NODE& assignment, uint32_t i) const
 	{
-		return AST_NODE_TYPE_ASSIGNMENT;
+		return m_Names[assignment.FirstName + i];
 	}
 
-	uint32_t NumNames() const
+	inline size_t NodeCount() const
 	{
-		return (uint32_t)Names.size();
+		return m_Nodes.size();
 	}
 
-	std::string GetName() const
+	inline void Reserve(size_t numNodes)
 	{
-		return Names[0];
+		m_Nodes.reserve(numNodes);
+		m_Names.reserve(numNodes);
 	}
 
-	// Support for multiple name assignment
-	std::vector<std::string> Names;
-	std::shared_ptr<IASTNode> Value;
+private:
+
+	std::vector<AST_NODE> m_Nodes;
+	std::vector<std::string_view> m_Names;
 };
 
+/*
+* Strings in the decls are views into the SymbolTable of the ASTBase that
+* parsed them, copying a decl never allocates for its strings and
+* they stay valid for as long as that ASTBase does.
+*/
 class ASTStructDecl : public IASTNode
 {
 public:
 
 	struct Member
 	{
-		std::string Modifier;
-		std::string Type;
-		std::string Name;
-		std::string Semantic;
+		std::string_view Modifier;
+		std::string_view Type;
+		std::string_view Name;
+		std::string_view Semantic;
 	};
 	
 	ASTStructDecl() {}
@@ -110,8 +174,22 @@ public:
 		return AST_NODE_TYPE_STRUCT_DECL;
 	}
 
-	std::string Name;
-	std::map<std::string, Member> Members;
+	inline const Member* FindMember(std::string_view name) const
+	{
+		for (const Member& member : Members)
+		{
+			if (member.Name == name)
+			{
+				return &member;
+			}
+		}
+		return nullptr;
+	}
+
+	std::string_view Name;
+
+	// In declaration order, the order matters for input layouts
+	std::vector<Member> Members;
 };
 
 class ASTFunctionDecl : public IASTNode
@@ -120,10 +198,10 @@ public:
 
 	struct Param
 	{
-		std::string Modifier;
-		std::string Type;
-		std::string Name;
-		std::string Semantic;
+		std::string_view Modifier;
+		std::string_view Type;
+		std::string_view Name;
+		std::string_view Semantic;
 	};
 
 	ASTFunctionDecl() {}
@@ -134,9 +212,9 @@ public:
 		return AST_NODE_TYPE_FUNCTION_DECL;
 	}
 
-	std::string Name;
-	std::string ReturnType;
-	std::string ReturnSemantic;
+	std::string_view Name;
+	std::string_view ReturnType;
+	std::string_view ReturnSemantic;
 	std::vector<Param> Params;
 };
 
@@ -0,0 +1,193 @@
+#include "Base64Encoder.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define BASE64_X64 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC lets any function use any intrinsic, gcc/clang need to be told per function
+#if defined(BASE64_X64) && !defined(_MSC_VER)
+#define BASE64_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define BASE64_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define BASE64_TARGET_SSSE3
+#define BASE64_TARGET_AVX2
+#endif
+
+
+static const char s_EncodingTable[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static void EncodeScalar(const uint8_t* data, size_t size, char* out)
+{
+	size_t i = 0;
+	for (; i + 3 <= size; i += 3)
+	{
+		uint32_t triple = ((uint32_t)data[i] << 16) | ((uint32_t)data[i + 1] << 8) | (uint32_t)data[i + 2];
+		*out++ = s_EncodingTable[(triple >> 18) & 0x3f];
+		*out++ = s_EncodingTable[(triple >> 12) & 0x3f];
+		*out++ = s_EncodingTable[(triple >> 6) & 0x3f];
+		*out++ = s_EncodingTable[triple & 0x3f];
+	}
+
+	size_t remaining = size - i;
+	if (remaining == 0)
+	{
+		return;
+	}
+
+	uint32_t triple = (uint32_t)data[i] << 16;
+	if (remaining == 2)
+	{
+		triple |= (uint32_t)data[i + 1] << 8;
+	}
+
+	*out++ = s_EncodingTable[(triple >> 18) & 0x3f];
+	*out++ = s_EncodingTable[(triple >> 12) & 0x3f];
+	*out++ = remaining == 2 ? s_EncodingTable[(triple >> 6) & 0x3f] : '=';
+	*out++ = '=';
+}
+
+#ifdef BASE64_X64
+
+/*
+* Vector encode from Wojciech Mula's "Base64 encoding with SIMD instructions".
+* Every 12 input bytes are spread over the 4 dwords of a register, split
+* into 6 bit indices with two multiplies, and turned into ascii with one
+* pshufb offset lookup.
+*
+* Loads are a full register but only 12 bytes of it are used, so the loops
+* stop while the load still fits in data.
+*
+* @returns: how many bytes were consumed, always a multiple of 12
+*/
+BASE64_TARGET_SSSE3
+static size_t EncodeSSSE3(const uint8_t* data, size_t size, char* out)
+{
+	const __m128i spread = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+	const __m128i lut = _mm_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+
+	size_t i = 0;
+	for (; i + 16 <= size; i += 12)
+	{
+		__m128i in = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + i)), spread);
+
+		const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+		const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+		const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+		const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+		const __m128i indices = _mm_or_si128(t1, t3);
+
+		// 0-25 -> 'A', 26-51 -> 'a', 52-61 -> '0', 62 -> '+', 63 -> '/'
+		__m128i offsets = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+		offsets = _mm_sub_epi8(offsets, _mm_cmpgt_epi8(indices, _mm_set1_epi8(25)));
+		const __m128i ascii = _mm_add_epi8(indices, _mm_shuffle_epi8(lut, offsets));
+
+		_mm_storeu_si128((__m128i*)out, ascii);
+		out += 16;
+	}
+	return i;
+}
+
+BASE64_TARGET_AVX2
+static size_t EncodeAVX2(const uint8_t* data, size_t size, char* out)
+{
+	const __m256i spread = _mm256_setr_epi8(
+		1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+		1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+	const __m256i lut = _mm256_setr_epi8(
+		65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+		65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+
+	// 12 bytes into each 128 bit lane
+	size_t i = 0;
+	for (; i + 28 <= size; i += 24)
+	{
+		__m256i in = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(data + i))),
+			_mm_loadu_si128((const __m128i*)(data + i + 12)), 1);
+		in = _mm256_shuffle_epi8(in, spread);
+
+		const __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+		const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+		const __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+		const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+		const __m256i indices = _mm256_or_si256(t1, t3);
+
+		__m256i offsets = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+		offsets = _mm256_sub_epi8(offsets, _mm256_cmpgt_epi8(indices, _mm256_set1_epi8(25)));
+		const __m256i ascii = _mm256_add_epi8(indices, _mm256_shuffle_epi8(lut, offsets));
+
+		_mm256_storeu_si256((__m256i*)out, ascii);
+		out += 32;
+	}
+
+	return i + EncodeSSSE3(data + i, size - i, out);
+}
+
+typedef enum EBASE64_ISA {
+	BASE64_ISA_SCALAR,
+	BASE64_ISA_SSSE3,
+	BASE64_ISA_AVX2
+} EBASE64_ISA;
+
+static EBASE64_ISA DetectIsa()
+{
+#ifdef _MSC_VER
+	int info[4] = { };
+	__cpuid(info, 1);
+	bool ssse3 = (info[2] & (1 << 9)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+
+	__cpuidex(info, 7, 0);
+	bool avx2 = (info[1] & (1 << 5)) != 0;
+
+	// The OS has to save the ymm registers too
+	if (avx2 && avx && osxsave && (_xgetbv(0) & 6) == 6)
+	{
+		return BASE64_ISA_AVX2;
+	}
+	return ssse3 ? BASE64_ISA_SSSE3 : BASE64_ISA_SCALAR;
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		return BASE64_ISA_AVX2;
+	}
+	return __builtin_cpu_supports("ssse3") ? BASE64_ISA_SSSE3 : BASE64_ISA_SCALAR;
+#endif
+}
+
+static const EBASE64_ISA g_Base64Isa = DetectIsa();
+
+#endif
+
+void Base64Encode(const uint8_t* data, size_t size, char* out)
+{
+	size_t consumed = 0;
+#ifdef BASE64_X64
+	switch (g_Base64Isa)
+	{
+	case BASE64_ISA_AVX2:
+		consumed = EncodeAVX2(data, size, out);
+		break;
+	case BASE64_ISA_SSSE3:
+		consumed = EncodeSSSE3(data, size, out);
+		break;
+	default:
+		break;
+	}
+#endif
+
+	EncodeScalar(data + consumed, size - consumed, out + consumed / 3 * 4);
+}
+
+void AppendBase64(std::string& out, const uint8_t* data, size_t size)
+{
+	size_t offset = out.size();
+	out.resize(offset + Base64EncodedLength(size));
+	Base64Encode(data, size, &out[offset]);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+
+/*
+* @returns: Length of the padded base64 encoding of size bytes
+*/
+inline size_t Base64EncodedLength(size_t size)
+{
+	return (size + 2) / 3 * 4;
+}
+
+/*
+* @brief: Encodes data into out, which must have room for Base64EncodedLength(size) chars.
+* Uses AVX2 or SSSE3 when the cpu has them, picked once at startup.
+*/
+void Base64Encode(const uint8_t* data, size_t size, char* out);
+
+/*
+* @brief: Encodes straight onto the end of out, no temporary string
+*/
+void AppendBase64(std::string& out, const uint8_t* data, size_t size);
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+
+
+/*
+* Fixed capacity queue between two stages of the build.
+* Push blocks while it's full, so a fast stage can only get
+* Capacity items ahead of a slow one and memory stays bounded.
+* Pop blocks until there's an item or the queue is closed and drained.
+*/
+template<typename T>
+class BoundedQueue
+{
+public:
+
+	BoundedQueue(size_t capacity) :
+		m_Capacity(capacity > 0 ? capacity : 1)
+	{
+	}
+
+	BoundedQueue(const BoundedQueue&) = delete;
+	BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+	/*
+	* @returns: false if the queue was closed, item is dropped
+	*/
+	bool Push(T item)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_Lock);
+			m_NotFullCv.wait(lock, [this]() { return m_Closed || m_Items.size() < m_Capacity; });
+			if (m_Closed)
+			{
+				return false;
+			}
+			m_Items.push_back(std::move(item));
+		}
+		m_NotEmptyCv.notify_one();
+		return true;
+	}
+
+	/*
+	* @returns: false once the queue is closed and nothing is left in it
+	*/
+	bool Pop(T& outItem)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_Lock);
+			m_NotEmptyCv.wait(lock, [this]() { return m_Closed || !m_Items.empty(); });
+			if (m_Items.empty())
+			{
+				return false;
+			}
+			outItem = std::move(m_Items.front());
+			m_Items.pop_front();
+		}
+		m_NotFullCv.notify_one();
+		return true;
+	}
+
+	/*
+	* @brief: No more pushes, consumers drain what's left then Pop returns false
+	*/
+	void Close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Lock);
+			m_Closed = true;
+		}
+		m_NotEmptyCv.notify_all();
+		m_NotFullCv.notify_all();
+	}
+
+private:
+
+	const size_t m_Capacity;
+
+	std::mutex m_Lock;
+	std::condition_variable m_NotEmptyCv;
+	std::condition_variable m_NotFullCv;
+	std::deque<T> m_Items;
+	bool m_Closed = false;
+};
+
+/*
+* The worker threads of one stage. Every worker runs the same
+* function, which is expected to loop on its input queue's Pop.
+*/
+class BuildStage
+{
+public:
+
+	BuildStage() = default;
+
+	BuildStage(const BuildStage&) = delete;
+	BuildStage& operator=(const BuildStage&) = delete;
+
+	~BuildStage()
+	{
+		Join();
+	}
+
+	template<typename FUNC>
+	void Start(uint32_t numWorkers, FUNC func)
+	{
+		for (uint32_t i = 0; i < (numWorkers > 0 ? numWorkers : 1); i++)
+		{
+			m_Threads.emplace_back(func);
+		}
+	}
+
+	/*
+	* @brief: Waits for every worker to return
+	*/
+	void Join()
+	{
+		for (std::thread& thread : m_Threads)
+		{
+			thread.join();
+		}
+		m_Threads.clear();
+	}
+
+private:
+
+	std::vector<std::thread> m_Threads;
+};
@@ -12,7 +12,7 @@ public:
 
 	ComPtr() : Ptr(nullptr) {};
 	ComPtr(T* p) : Ptr(p) {}
-	ComPtr(ComPtr<T>& rhs) : Ptr(rhs.Ptr)
+	ComPtr(const ComPtr<T>& rhs) : Ptr(rhs.Ptr)
 	{
 		if (Ptr)
 		{
@@ -0,0 +1,154 @@
+#include "CompileHistory.h"
+#include "Utils.h"
+#include "nlohmann.hpp"
+#include <fstream>
+#include <iostream>
+
+
+static constexpr uint32_t CompileHistoryVersion = 2;
+
+// Weight of the newest measurement
+static constexpr double CompileHistoryBlend = 0.5;
+
+// Start of every key of the pipeline's units. Any character can be in a filename,
+// the length is what keeps "a|0" from being read as pipeline "a", stage 0
+static std::string PipelinePrefix(const std::string& pipeline)
+{
+	return std::to_string(pipeline.size()) + ":" + pipeline + "|";
+}
+
+
+void CompileHistory::Load(const std::filesystem::path& file)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	m_Entries.clear();
+	m_TotalMs = 0.0;
+
+	std::ifstream stream(file);
+	if (!stream.is_open())
+	{
+		return;
+	}
+
+	// Exceptions are off, so don't let a corrupt file take us down
+	nlohmann::json json = nlohmann::json::parse(stream, nullptr, false);
+	if (json.is_discarded() || !json.is_object() || json.value("Version", 0u) != CompileHistoryVersion)
+	{
+		return;
+	}
+
+	const nlohmann::json& units = json["Units"];
+	if (!units.is_object())
+	{
+		return;
+	}
+
+	for (auto unit = units.begin(); unit != units.end(); unit++)
+	{
+		if (unit.value().is_number() && unit.value().get<double>() >= 0.0)
+		{
+			m_Entries[unit.key()] = unit.value().get<double>();
+			m_TotalMs += unit.value().get<double>();
+		}
+	}
+}
+
+bool CompileHistory::Save(const std::filesystem::path& file)
+{
+	nlohmann::json json;
+	json["Version"] = CompileHistoryVersion;
+
+	nlohmann::json& units = json["Units"];
+	units = nlohmann::json::object();
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		for (const auto& entry : m_Entries)
+		{
+			units[entry.first] = entry.second;
+		}
+	}
+
+	if (!WriteFileAtomic(file, json.dump(1, '\t')))
+	{
+		std::cout << "[ERROR] Failed to write " << file.string() << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+void CompileHistory::RetainPipelines(const std::set<std::string>& pipelines)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	std::map<std::string, double> kept;
+	double totalMs = 0.0;
+	for (const std::string& pipeline : pipelines)
+	{
+		const std::string prefix = PipelinePrefix(pipeline);
+		for (auto it = m_Entries.lower_bound(prefix); it != m_Entries.end() && it->first.compare(0, prefix.size(), prefix) == 0; it++)
+		{
+			kept.insert(*it);
+			totalMs += it->second;
+		}
+	}
+
+	m_Entries.swap(kept);
+	m_TotalMs = totalMs;
+}
+
+std::string CompileHistory::MakeKey(const std::string& pipeline, uint32_t stage, uint32_t type, uint32_t flags)
+{
+	// A pipeline's units sort next to each other, see PredictPipeline
+	return PipelinePrefix(pipeline) + std::to_string(stage) + "|" + std::to_string(type) + "|" + std::to_string(flags);
+}
+
+bool CompileHistory::Lookup(const std::string& key, double& outMs) const
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	auto findRes = m_Entries.find(key);
+	if (findRes == m_Entries.end())
+	{
+		return false;
+	}
+
+	outMs = findRes->second;
+	return true;
+}
+
+void CompileHistory::Record(const std::string& key, double ms)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	auto insertRes = m_Entries.insert({ key, ms });
+	if (insertRes.second)
+	{
+		m_TotalMs += ms;
+		return;
+	}
+
+	double& estimate = insertRes.first->second;
+	const double blended = estimate + (ms - estimate) * CompileHistoryBlend;
+	m_TotalMs += blended - estimate;
+	estimate = blended;
+}
+
+double CompileHistory::GetMeanMs() const
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	return m_Entries.empty() ? 0.0 : m_TotalMs / (double)m_Entries.size();
+}
+
+bool CompileHistory::PredictPipeline(const std::string& pipeline, double& outMs) const
+{
+	const std::string prefix = PipelinePrefix(pipeline);
+
+	std::lock_guard<std::mutex> lock(m_Lock);
+	outMs = 0.0;
+	bool found = false;
+	for (auto it = m_Entries.lower_bound(prefix); it != m_Entries.end() && it->first.compare(0, prefix.size(), prefix) == 0; it++)
+	{
+		outMs += it->second;
+		found = true;
+	}
+	return found;
+}
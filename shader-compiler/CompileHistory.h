@@ -0,0 +1,69 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <mutex>
+#include <string>
+#include <filesystem>
+#include <stdint.h>
+
+
+/*
+* How long DXC took for every compile unit the last times it ran.
+* Keyed by pipeline file, stage, target and flags, see MakeKey.
+* Stored as json next to the dependency database, the compiler uses
+* it to start the longest units first and to hold back the heaviest
+* ones so only a few of them run at once.
+* Safe to use from any thread.
+*/
+class CompileHistory
+{
+public:
+
+	CompileHistory() = default;
+
+	CompileHistory(const CompileHistory&) = delete;
+	CompileHistory& operator=(const CompileHistory&) = delete;
+
+	/*
+	* @brief: A missing or unreadable file isn't an error, there's just no history
+	*/
+	void Load(const std::filesystem::path& file);
+
+	bool Save(const std::filesystem::path& file);
+
+	/*
+	* @brief: Drops every unit of a pipeline not in pipelines, so
+	* deleted sources don't linger and skew GetMeanMs
+	*/
+	void RetainPipelines(const std::set<std::string>& pipelines);
+
+	static std::string MakeKey(const std::string& pipeline, uint32_t stage, uint32_t type, uint32_t flags);
+
+	/*
+	* @returns: false if the unit has never been through DXC
+	*/
+	bool Lookup(const std::string& key, double& outMs) const;
+
+	/*
+	* @brief: Blends a new measurement into the unit's estimate,
+	* so one slow run on a busy machine doesn't stick
+	*/
+	void Record(const std::string& key, double ms);
+
+	/*
+	* @returns: Average of every unit, 0 with no history
+	*/
+	double GetMeanMs() const;
+
+	/*
+	* @returns: Sum over every unit of the pipeline, false if it has none
+	*/
+	bool PredictPipeline(const std::string& pipeline, double& outMs) const;
+
+private:
+
+	mutable std::mutex m_Lock;
+	std::map<std::string, double> m_Entries;
+	double m_TotalMs = 0.0;
+};
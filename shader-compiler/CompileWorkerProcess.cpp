@@ -0,0 +1,879 @@
+#include "CompileWorkerProcess.h"
+#include "ShaderCompiler.h"
+#include <iostream>
+#include <algorithm>
+#include <thread>
+#include <string.h>
+
+#if defined(LINUX_BUILD)
+#include <poll.h>
+#include <errno.h>
+#include <spawn.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+extern char** environ;
+#elif defined(WINDOWS_BUILD)
+#include <io.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <atomic>
+#endif
+
+#define failed(x) ((x) < 0)
+
+
+/*
+* Both ends are the same executable, so everything is sent as is, no byte
+* order or wchar_t size to agree on. Every message is a run of these:
+*
+* Request: u32 buildGeneration, u32 numArgs, numArgs x (u32 length, wchar_t[length]), u32 length, source
+* Response: i32 status, u32 length, errors, u32 length, object,
+* u32 length, preprocessed, u32 numIncludes,
+* numIncludes x (u32 length, wchar_t[length], u64 size, i64 writeTime, u8[32] hash)
+*/
+
+static void AppendU32(std::string& out, uint32_t value)
+{
+	out.append((const char*)&value, sizeof(value));
+}
+
+static void AppendBytes(std::string& out, const void* data, size_t size)
+{
+	AppendU32(out, (uint32_t)size);
+	out.append((const char*)data, size);
+}
+
+static void AppendWide(std::string& out, const wchar_t* str, size_t length)
+{
+	AppendU32(out, (uint32_t)length);
+	out.append((const char*)str, length * sizeof(wchar_t));
+}
+
+void CompileWithDxc(
+	IDxcCompiler3* compiler,
+	ShaderCompilerIncludeHandler* includeHandler,
+	const LPCWSTR* args,
+	uint32_t numArgs,
+	const std::string& source,
+	DXC_OUTPUT& outOutput
+) {
+	outOutput.Errors.clear();
+	outOutput.Object = nullptr;
+	outOutput.Preprocessed.clear();
+	outOutput.Includes.clear();
+
+	DxcBuffer Buf = { };
+	Buf.Encoding = DXC_CP_UTF8;
+	Buf.Ptr = source.c_str();
+	Buf.Size = source.length();
+
+	ComPtr<IDxcResult> Result = nullptr;
+	includeHandler->BeginRecording();
+	outOutput.Status = compiler->Compile(
+		&Buf,
+		const_cast<LPCWSTR*>(args),
+		numArgs,
+		includeHandler,
+		IID_PPV_ARGS(&Result));
+	includeHandler->EndRecording(outOutput.Includes);
+	if (failed(outOutput.Status))
+	{
+		return;
+	}
+
+	Result->GetStatus(&outOutput.Status);
+
+	ComPtr<IDxcBlob> Errors = nullptr;
+	Result->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&Errors), nullptr);
+	if (Errors != nullptr && Errors->GetBufferSize() != 0)
+	{
+		// Null terminated, the terminator is counted in the size
+		outOutput.Errors.assign((const char*)Errors->GetBufferPointer(), Errors->GetBufferSize());
+		while (!outOutput.Errors.empty() && outOutput.Errors.back() == '\0')
+		{
+			outOutput.Errors.pop_back();
+		}
+	}
+
+	if (Result->HasOutput(DXC_OUT_OBJECT))
+	{
+		// Kept as is, it outlives the result
+		Result->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&outOutput.Object), nullptr);
+	}
+
+	if (Result->HasOutput(DXC_OUT_HLSL))
+	{
+		ComPtr<IDxcBlob> Preprocessed = nullptr;
+		Result->GetOutput(DXC_OUT_HLSL, IID_PPV_ARGS(&Preprocessed), nullptr);
+		if (Preprocessed != nullptr)
+		{
+			outOutput.Preprocessed.assign((const char*)Preprocessed->GetBufferPointer(), Preprocessed->GetBufferSize());
+		}
+	}
+}
+
+
+CompileWorkerProcess::~CompileWorkerProcess()
+{
+	Stop();
+}
+
+bool CompileWorkerProcess::Run(
+	uint32_t buildGeneration,
+	const LPCWSTR* args,
+	uint32_t numArgs,
+	const std::string& source,
+	DXC_OUTPUT& outOutput
+) {
+	m_bTimedOut = false;
+	if (!IsRunning())
+	{
+		return false;
+	}
+
+	// One deadline for the whole request, DXC runs between the write and the first read
+	m_Deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_TimeoutMs);
+
+	std::string request;
+	AppendU32(request, buildGeneration);
+	AppendU32(request, numArgs);
+	for (uint32_t i = 0; i < numArgs; i++)
+	{
+		AppendWide(request, args[i], wcslen(args[i]));
+	}
+	AppendBytes(request, source.data(), source.size());
+
+	// Anything short of a full response means the child is gone,
+	// or in a state nothing more should be sent to it
+	auto readBytes = [this](auto& out) -> bool {
+		uint32_t size = 0;
+		if (!ReadAll(&size, sizeof(size)))
+		{
+			return false;
+		}
+		out.resize(size);
+		return size == 0 || ReadAll(out.data(), size);
+	};
+
+	int32_t status = 0;
+	uint32_t numIncludes = 0;
+	std::vector<uint8_t> object;
+	if (!WriteAll(request.data(), request.size()) ||
+		!ReadAll(&status, sizeof(status)) ||
+		!readBytes(outOutput.Errors) ||
+		!readBytes(object) ||
+		!readBytes(outOutput.Preprocessed) ||
+		!ReadAll(&numIncludes, sizeof(numIncludes)))
+	{
+		Kill();
+		return false;
+	}
+	outOutput.Status = (HRESULT)status;
+
+	outOutput.Object = nullptr;
+	if (!object.empty())
+	{
+		outOutput.Object.UnsafeSet(CreateByteCodeBlob(std::move(object)));
+	}
+
+	outOutput.Includes.clear();
+	for (uint32_t i = 0; i < numIncludes; i++)
+	{
+		uint32_t length = 0;
+		if (!ReadAll(&length, sizeof(length)))
+		{
+			Kill();
+			return false;
+		}
+
+		std::wstring include(length, L'\0');
+		FILE_STAMP stamp = { };
+		if ((length > 0 && !ReadAll(include.data(), length * sizeof(wchar_t))) ||
+			!ReadAll(&stamp.Size, sizeof(stamp.Size)) ||
+			!ReadAll(&stamp.WriteTime, sizeof(stamp.WriteTime)) ||
+			!ReadAll(stamp.Hash.Digest, sizeof(stamp.Hash.Digest)))
+		{
+			Kill();
+			return false;
+		}
+		stamp.Path = std::filesystem::path(include);
+		outOutput.Includes.push_back(std::move(stamp));
+	}
+
+	return true;
+}
+
+int CompileWorkerProcess::RemainingMs() const
+{
+	if (m_TimeoutMs == 0)
+	{
+		return -1;
+	}
+
+	const long long left = std::chrono::duration_cast<std::chrono::milliseconds>(m_Deadline - std::chrono::steady_clock::now()).count();
+	return (int)std::max(left, 0ll);
+}
+
+
+#if defined(LINUX_BUILD)
+
+bool CompileWorkerProcess::Start(const std::filesystem::path& shaderDir)
+{
+	Stop();
+
+	// A socket rather than two pipes so the parent can send with MSG_NOSIGNAL,
+	// a child dying mid write is an error to handle, not a SIGPIPE
+	int fds[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0)
+	{
+		std::cout << "[ERROR] Failed to create a socket for a DXC worker process" << std::endl;
+		return false;
+	}
+
+	char exe[4096];
+	ssize_t exeLen = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+	if (exeLen <= 0)
+	{
+		std::cout << "[ERROR] Failed to find the shader-compiler executable to start a DXC worker process" << std::endl;
+		close(fds[0]);
+		close(fds[1]);
+		return false;
+	}
+	exe[exeLen] = '\0';
+
+	std::string dir = shaderDir.string();
+	char workerArg[] = "--compile-worker";
+	char* argv[] = { exe, workerArg, dir.data(), nullptr };
+
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_adddup2(&actions, fds[1], STDIN_FILENO);
+	posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+
+	pid_t pid = -1;
+	int res = posix_spawn(&pid, exe, &actions, nullptr, argv, environ);
+	posix_spawn_file_actions_destroy(&actions);
+	close(fds[1]);
+
+	if (res != 0)
+	{
+		std::cout << "[ERROR] Failed to start a DXC worker process: " << strerror(res) << std::endl;
+		close(fds[0]);
+		return false;
+	}
+
+	m_Pid = pid;
+	m_Fd = fds[0];
+	return true;
+}
+
+void CompileWorkerProcess::Stop()
+{
+	if (m_Fd >= 0)
+	{
+		// The child exits once it reads the end of its input
+		close(m_Fd);
+		m_Fd = -1;
+	}
+
+	if (m_Pid > 0)
+	{
+		// A child hung inside dxc never reads the end of its input, give it
+		// a moment to exit on its own before killing it
+		int status = 0;
+		bool exited = false;
+		for (int i = 0; i < 50 && !exited; i++)
+		{
+			const pid_t res = waitpid(m_Pid, &status, WNOHANG);
+			if (res == 0 || (res < 0 && errno == EINTR))
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+				continue;
+			}
+			exited = true;
+		}
+
+		if (!exited)
+		{
+			kill(m_Pid, SIGKILL);
+			while (waitpid(m_Pid, &status, 0) < 0 && errno == EINTR)
+			{
+			}
+		}
+		m_Pid = -1;
+	}
+}
+
+void CompileWorkerProcess::Kill()
+{
+	if (m_Pid > 0)
+	{
+		kill(m_Pid, SIGKILL);
+	}
+	Stop();
+}
+
+bool CompileWorkerProcess::IsRunning() const
+{
+	return m_Pid > 0;
+}
+
+bool CompileWorkerProcess::WaitFd(short events)
+{
+	for (;;)
+	{
+		pollfd fd = { };
+		fd.fd = m_Fd;
+		fd.events = events;
+
+		const int res = poll(&fd, 1, RemainingMs());
+		if (res < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (res == 0)
+		{
+			m_bTimedOut = true;
+		}
+		// Hangup and errors are ready too, the send or recv reports them
+		return res > 0;
+	}
+}
+
+bool CompileWorkerProcess::WriteAll(const void* data, size_t size)
+{
+	const char* ptr = (const char*)data;
+	while (size > 0)
+	{
+		if (!WaitFd(POLLOUT))
+		{
+			return false;
+		}
+
+		ssize_t written = send(m_Fd, ptr, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (written < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			continue;
+		}
+		if (written <= 0)
+		{
+			return false;
+		}
+		ptr += written;
+		size -= (size_t)written;
+	}
+	return true;
+}
+
+bool CompileWorkerProcess::ReadAll(void* data, size_t size)
+{
+	char* ptr = (char*)data;
+	while (size > 0)
+	{
+		if (!WaitFd(POLLIN))
+		{
+			return false;
+		}
+
+		ssize_t got = recv(m_Fd, ptr, size, MSG_DONTWAIT);
+		if (got < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			continue;
+		}
+		if (got <= 0)
+		{
+			return false;
+		}
+		ptr += got;
+		size -= (size_t)got;
+	}
+	return true;
+}
+
+#elif defined(WINDOWS_BUILD)
+
+/*
+* CreatePipe's anonymous pipes can't do overlapped io, so a read on one
+* can't be given up on. The parent's ends are a named pipe instead, the
+* child gets a plain inheritable handle to the other end.
+*/
+static bool CreateWorkerPipe(bool bParentReads, SECURITY_ATTRIBUTES* childSa, HANDLE& outParent, HANDLE& outChild)
+{
+	static std::atomic<uint32_t> counter = 0;
+
+	wchar_t name[128];
+	swprintf(name, sizeof(name) / sizeof(name[0]), L"\\\\.\\pipe\\shader-compiler-worker-%lu-%u", GetCurrentProcessId(), counter++);
+
+	outParent = CreateNamedPipeW(
+		name,
+		(bParentReads ? PIPE_ACCESS_INBOUND : PIPE_ACCESS_OUTBOUND) | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+		PIPE_TYPE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+		1,
+		1 << 16,
+		1 << 16,
+		0,
+		nullptr);
+	if (outParent == INVALID_HANDLE_VALUE)
+	{
+		outParent = nullptr;
+		return false;
+	}
+
+	outChild = CreateFileW(name, bParentReads ? GENERIC_WRITE : GENERIC_READ, 0, childSa, OPEN_EXISTING, 0, nullptr);
+	if (outChild == INVALID_HANDLE_VALUE)
+	{
+		outChild = nullptr;
+		return false;
+	}
+	return true;
+}
+
+bool CompileWorkerProcess::Start(const std::filesystem::path& shaderDir)
+{
+	Stop();
+
+	SECURITY_ATTRIBUTES sa = { };
+	sa.nLength = sizeof(sa);
+	sa.bInheritHandle = TRUE;
+
+	HANDLE childIn = nullptr;
+	HANDLE childOut = nullptr;
+	HANDLE childErr = nullptr;
+	HANDLE parentWrite = nullptr;
+	HANDLE parentRead = nullptr;
+
+	auto closeAll = [&]() {
+		HANDLE handles[] = { childIn, childOut, childErr, parentWrite, parentRead };
+		for (HANDLE handle : handles)
+		{
+			if (handle)
+			{
+				CloseHandle(handle);
+			}
+		}
+	};
+
+	if (!CreateWorkerPipe(false, &sa, parentWrite, childIn) ||
+		!CreateWorkerPipe(true, &sa, parentRead, childOut) ||
+		!DuplicateHandle(GetCurrentProcess(), GetStdHandle(STD_ERROR_HANDLE), GetCurrentProcess(), &childErr, 0, TRUE, DUPLICATE_SAME_ACCESS))
+	{
+		std::cout << "[ERROR] Failed to create pipes for a DXC worker process" << std::endl;
+		closeAll();
+		return false;
+	}
+
+	HANDLE ioEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+	if (!ioEvent)
+	{
+		std::cout << "[ERROR] Failed to create an event for a DXC worker process" << std::endl;
+		closeAll();
+		return false;
+	}
+
+	// Every compile thread starts its own child, without the list a child
+	// could inherit another's pipe and keep it open after that one dies
+	HANDLE inherit[] = { childIn, childOut, childErr };
+	SIZE_T listSize = 0;
+	InitializeProcThreadAttributeList(nullptr, 1, 0, &listSize);
+	std::vector<char> listData(listSize);
+	LPPROC_THREAD_ATTRIBUTE_LIST list = (LPPROC_THREAD_ATTRIBUTE_LIST)listData.data();
+	if (!InitializeProcThreadAttributeList(list, 1, 0, &listSize))
+	{
+		CloseHandle(ioEvent);
+		closeAll();
+		return false;
+	}
+	UpdateProcThreadAttribute(list, 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST, inherit, sizeof(inherit), nullptr, nullptr);
+
+	wchar_t exe[4096];
+	DWORD exeLen = GetModuleFileNameW(nullptr, exe, sizeof(exe) / sizeof(exe[0]));
+	if (exeLen == 0 || exeLen == sizeof(exe) / sizeof(exe[0]))
+	{
+		std::cout << "[ERROR] Failed to find the shader-compiler executable to start a DXC worker process" << std::endl;
+		DeleteProcThreadAttributeList(list);
+		CloseHandle(ioEvent);
+		closeAll();
+		return false;
+	}
+
+	// A trailing backslash would escape the closing quote
+	std::wstring dir = shaderDir.wstring();
+	if (!dir.empty() && dir.back() == L'\\')
+	{
+		dir += L'\\';
+	}
+	std::wstring cmd = L"\"" + std::wstring(exe) + L"\" --compile-worker \"" + dir + L"\"";
+
+	STARTUPINFOEXW si = { };
+	si.StartupInfo.cb = sizeof(si);
+	si.StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+	si.StartupInfo.hStdInput = childIn;
+	si.StartupInfo.hStdOutput = childOut;
+	si.StartupInfo.hStdError = childErr;
+	si.lpAttributeList = list;
+
+	PROCESS_INFORMATION pi = { };
+	BOOL created = CreateProcessW(exe, cmd.data(), nullptr, nullptr, TRUE, EXTENDED_STARTUPINFO_PRESENT, nullptr, nullptr, &si.StartupInfo, &pi);
+	DeleteProcThreadAttributeList(list);
+
+	CloseHandle(childIn);
+	CloseHandle(childOut);
+	CloseHandle(childErr);
+	childIn = childOut = childErr = nullptr;
+
+	if (!created)
+	{
+		std::cout << "[ERROR] Failed to start a DXC worker process, error " << GetLastError() << std::endl;
+		CloseHandle(ioEvent);
+		closeAll();
+		return false;
+	}
+	CloseHandle(pi.hThread);
+
+	m_Process = pi.hProcess;
+	m_Write = parentWrite;
+	m_Read = parentRead;
+	m_IoEvent = ioEvent;
+	return true;
+}
+
+void CompileWorkerProcess::Stop()
+{
+	if (m_Write)
+	{
+		// The child exits once it reads the end of its input
+		CloseHandle(m_Write);
+		m_Write = nullptr;
+	}
+
+	if (m_Process)
+	{
+		// A child hung inside dxc never reads the end of its input, give it
+		// a moment to exit on its own before killing it
+		if (WaitForSingleObject(m_Process, 500) != WAIT_OBJECT_0)
+		{
+			TerminateProcess(m_Process, 1);
+			// Bounded too, if terminating failed the handle is all that's left to drop
+			WaitForSingleObject(m_Process, 500);
+		}
+		CloseHandle(m_Process);
+		m_Process = nullptr;
+	}
+
+	if (m_Read)
+	{
+		CloseHandle(m_Read);
+		m_Read = nullptr;
+	}
+
+	if (m_IoEvent)
+	{
+		CloseHandle(m_IoEvent);
+		m_IoEvent = nullptr;
+	}
+}
+
+void CompileWorkerProcess::Kill()
+{
+	if (m_Process)
+	{
+		TerminateProcess(m_Process, 1);
+	}
+	Stop();
+}
+
+bool CompileWorkerProcess::IsRunning() const
+{
+	return m_Process != nullptr;
+}
+
+bool CompileWorkerProcess::FinishIo(BOOL started, HANDLE pipe, OVERLAPPED& overlapped, DWORD& outBytes)
+{
+	outBytes = 0;
+	if (!started && GetLastError() != ERROR_IO_PENDING)
+	{
+		return false;
+	}
+
+	const int remaining = RemainingMs();
+	if (WaitForSingleObject(m_IoEvent, remaining < 0 ? INFINITE : (DWORD)remaining) != WAIT_OBJECT_0)
+	{
+		// The buffer has to stay alive until the cancel went through
+		CancelIoEx(pipe, &overlapped);
+		GetOverlappedResult(pipe, &overlapped, &outBytes, TRUE);
+		m_bTimedOut = true;
+		return false;
+	}
+
+	return GetOverlappedResult(pipe, &overlapped, &outBytes, FALSE) && outBytes > 0;
+}
+
+bool CompileWorkerProcess::WriteAll(const void* data, size_t size)
+{
+	const char* ptr = (const char*)data;
+	while (size > 0)
+	{
+		OVERLAPPED overlapped = { };
+		overlapped.hEvent = m_IoEvent;
+
+		DWORD written = 0;
+		const BOOL started = WriteFile(m_Write, ptr, (DWORD)std::min(size, (size_t)1 << 20), nullptr, &overlapped);
+		if (!FinishIo(started, m_Write, overlapped, written))
+		{
+			return false;
+		}
+		ptr += written;
+		size -= written;
+	}
+	return true;
+}
+
+bool CompileWorkerProcess::ReadAll(void* data, size_t size)
+{
+	char* ptr = (char*)data;
+	while (size > 0)
+	{
+		OVERLAPPED overlapped = { };
+		overlapped.hEvent = m_IoEvent;
+
+		DWORD got = 0;
+		const BOOL started = ReadFile(m_Read, ptr, (DWORD)std::min(size, (size_t)1 << 20), nullptr, &overlapped);
+		if (!FinishIo(started, m_Read, overlapped, got))
+		{
+			return false;
+		}
+		ptr += got;
+		size -= got;
+	}
+	return true;
+}
+
+#else
+
+bool CompileWorkerProcess::Start(const std::filesystem::path& shaderDir)
+{
+	(void)shaderDir;
+	std::cout << "[ERROR] DXC worker processes aren't supported on this platform" << std::endl;
+	return false;
+}
+
+void CompileWorkerProcess::Stop()
+{
+}
+
+void CompileWorkerProcess::Kill()
+{
+}
+
+bool CompileWorkerProcess::IsRunning() const
+{
+	return false;
+}
+
+bool CompileWorkerProcess::WriteAll(const void* data, size_t size)
+{
+	(void)data;
+	(void)size;
+	return false;
+}
+
+bool CompileWorkerProcess::ReadAll(void* data, size_t size)
+{
+	(void)data;
+	(void)size;
+	return false;
+}
+
+#endif
+
+
+#if defined(LINUX_BUILD) || defined(WINDOWS_BUILD)
+
+// The child's side of the pipe, plain file descriptors on every platform
+static bool ReadFd(int fd, void* data, size_t size)
+{
+	char* ptr = (char*)data;
+	while (size > 0)
+	{
+#ifdef WINDOWS_BUILD
+		int got = _read(fd, ptr, (unsigned int)std::min(size, (size_t)1 << 20));
+#else
+		ssize_t got = read(fd, ptr, size);
+		if (got < 0 && errno == EINTR)
+		{
+			continue;
+		}
+#endif
+		if (got <= 0)
+		{
+			return false;
+		}
+		ptr += got;
+		size -= (size_t)got;
+	}
+	return true;
+}
+
+static bool WriteFd(int fd, const void* data, size_t size)
+{
+	const char* ptr = (const char*)data;
+	while (size > 0)
+	{
+#ifdef WINDOWS_BUILD
+		int written = _write(fd, ptr, (unsigned int)std::min(size, (size_t)1 << 20));
+#else
+		ssize_t written = write(fd, ptr, size);
+		if (written < 0 && errno == EINTR)
+		{
+			continue;
+		}
+#endif
+		if (written <= 0)
+		{
+			return false;
+		}
+		ptr += written;
+		size -= (size_t)written;
+	}
+	return true;
+}
+
+#endif
+
+int RunCompileWorker(const std::filesystem::path& shaderDir)
+{
+#if defined(LINUX_BUILD) || defined(WINDOWS_BUILD)
+#ifdef WINDOWS_BUILD
+	// Crash instead of sitting on an error report dialog, the parent is waiting
+	SetErrorMode(SEM_FAILCRITICALERRORS | SEM_NOGPFAULTERRORBOX);
+
+	const int in = _fileno(stdin);
+	const int out = _dup(_fileno(stdout));
+	_setmode(in, _O_BINARY);
+	_setmode(out, _O_BINARY);
+	// Anything printed by accident goes to the parent's console, not into a response
+	_dup2(_fileno(stderr), _fileno(stdout));
+#else
+	const int in = STDIN_FILENO;
+	const int out = dup(STDOUT_FILENO);
+	dup2(STDERR_FILENO, STDOUT_FILENO);
+#endif
+
+	ComPtr<IDxcUtils> utils;
+	ComPtr<IDxcCompiler3> compiler;
+	if (failed(DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&utils))) ||
+		failed(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler))))
+	{
+		std::cout << "[ERROR] DXC worker process failed to initialize dxc" << std::endl;
+		return 1;
+	}
+
+	ComPtr<IDxcIncludeHandler> defaultHandler;
+	utils->CreateDefaultIncludeHandler(&defaultHandler);
+
+	ComPtr<ShaderCompilerIncludeHandler> includeHandler;
+	includeHandler.UnsafeSet(new ShaderCompilerIncludeHandler(shaderDir));
+	includeHandler->SetDefaultHandler(defaultHandler);
+
+	// Lives as long as the child does, across every build the parent runs
+	IncludeCache includes;
+	if (!includes.Initialize())
+	{
+		std::cout << "[ERROR] DXC worker process failed to initialize dxc" << std::endl;
+		return 1;
+	}
+	includeHandler->SetIncludeCache(&includes);
+	uint32_t generation = 0;
+
+	std::vector<std::wstring> args;
+	std::vector<LPCWSTR> argPtrs;
+	std::string source;
+	std::string response;
+	DXC_OUTPUT output = { };
+
+	for (;;)
+	{
+		uint32_t buildGeneration = 0;
+		if (!ReadFd(in, &buildGeneration, sizeof(buildGeneration)))
+		{
+			// Parent closed the pipe, it's done with us
+			return 0;
+		}
+
+		if (buildGeneration != generation)
+		{
+			includes.BeginBuild();
+			generation = buildGeneration;
+		}
+
+		uint32_t numArgs = 0;
+		if (!ReadFd(in, &numArgs, sizeof(numArgs)))
+		{
+			return 1;
+		}
+
+		args.resize(numArgs);
+		argPtrs.resize(numArgs);
+		for (uint32_t i = 0; i < numArgs; i++)
+		{
+			uint32_t length = 0;
+			if (!ReadFd(in, &length, sizeof(length)))
+			{
+				return 1;
+			}
+			args[i].assign(length, L'\0');
+			if (length > 0 && !ReadFd(in, args[i].data(), length * sizeof(wchar_t)))
+			{
+				return 1;
+			}
+			argPtrs[i] = args[i].c_str();
+		}
+
+		uint32_t sourceLength = 0;
+		if (!ReadFd(in, &sourceLength, sizeof(sourceLength)))
+		{
+			return 1;
+		}
+		source.resize(sourceLength);
+		if (sourceLength > 0 && !ReadFd(in, source.data(), sourceLength))
+		{
+			return 1;
+		}
+
+		CompileWithDxc(compiler.Ptr, includeHandler.Ptr, argPtrs.data(), numArgs, source, output);
+
+		response.clear();
+		AppendU32(response, (uint32_t)(int32_t)output.Status);
+		AppendBytes(response, output.Errors.data(), output.Errors.size());
+		if (output.Object != nullptr)
+		{
+			AppendBytes(response, output.Object->GetBufferPointer(), output.Object->GetBufferSize());
+		}
+		else
+		{
+			AppendU32(response, 0);
+		}
+		AppendBytes(response, output.Preprocessed.data(), output.Preprocessed.size());
+		AppendU32(response, (uint32_t)output.Includes.size());
+		for (const FILE_STAMP& include : output.Includes)
+		{
+			const std::wstring wide = include.Path.wstring();
+			AppendWide(response, wide.c_str(), wide.size());
+			response.append((const char*)&include.Size, sizeof(include.Size));
+			response.append((const char*)&include.WriteTime, sizeof(include.WriteTime));
+			response.append((const char*)include.Hash.Digest, sizeof(include.Hash.Digest));
+		}
+
+		if (!WriteFd(out, response.data(), response.size()))
+		{
+			return 1;
+		}
+	}
+#else
+	(void)shaderDir;
+	std::cout << "[ERROR] DXC worker processes aren't supported on this platform" << std::endl;
+	return 1;
+#endif
+}
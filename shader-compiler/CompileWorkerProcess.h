@@ -0,0 +1,146 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <stdint.h>
+#include "ComPtr.h"
+#include "FileCache.h"
+#include <d3dcommon.h>
+#include <dxc/dxcapi.h>
+
+#ifdef WINDOWS_BUILD
+#include <windows.h>
+#endif
+
+class ShaderCompilerIncludeHandler;
+
+
+/*
+* What comes back from one call into DXC, wherever it ran
+*/
+typedef struct DXC_OUTPUT {
+	// Failure to call into DXC at all shows up here too
+	HRESULT Status;
+	std::string Errors;
+	// DXC's own blob when it ran in this process, null if nothing was compiled
+	ComPtr<IDxcBlob> Object;
+	// Only with -P
+	std::string Preprocessed;
+	// Every file the include handler resolved, as it was handed to DXC
+	std::vector<FILE_STAMP> Includes;
+} DXC_OUTPUT;
+
+/*
+* @brief: One DXC compile, in this process
+*/
+void CompileWithDxc(
+	IDxcCompiler3* compiler,
+	ShaderCompilerIncludeHandler* includeHandler,
+	const LPCWSTR* args,
+	uint32_t numArgs,
+	const std::string& source,
+	DXC_OUTPUT& outOutput
+);
+
+/*
+* A child shader-compiler started with --compile-worker, running
+* DXC on whatever it's sent. DXC crashing takes down the child
+* instead of the build, Run reports it and Start brings up a new one.
+* So does a child that hangs, it's killed once the timeout passes.
+* One request at a time, each compile thread owns one of these.
+*/
+class CompileWorkerProcess
+{
+public:
+
+	CompileWorkerProcess() = default;
+	~CompileWorkerProcess();
+
+	CompileWorkerProcess(const CompileWorkerProcess&) = delete;
+	CompileWorkerProcess& operator=(const CompileWorkerProcess&) = delete;
+
+	/*
+	* @brief: Starts the child, includes are resolved relative to shaderDir
+	*/
+	bool Start(const std::filesystem::path& shaderDir);
+
+	/*
+	* @brief: Closes the child's input and waits for it to exit
+	*/
+	void Stop();
+
+	bool IsRunning() const;
+
+	/*
+	* @brief: How long Run waits on the child before killing it, 0 waits forever
+	*/
+	inline void SetTimeout(uint32_t timeoutMs)
+	{
+		m_TimeoutMs = timeoutMs;
+	}
+
+	/*
+	* @brief: Whether the last Run failed because the child took longer than the timeout
+	*/
+	inline bool TimedOut() const
+	{
+		return m_bTimedOut;
+	}
+
+	/*
+	* @param buildGeneration: The child rereads includes changed on disk once this changes
+	* @returns: false if the child died or didn't answer within the timeout.
+	* It's killed then, the caller decides whether to Start a new one and try again.
+	* A shader that fails to compile is still true, see outOutput.Status.
+	*/
+	bool Run(
+		uint32_t buildGeneration,
+		const LPCWSTR* args,
+		uint32_t numArgs,
+		const std::string& source,
+		DXC_OUTPUT& outOutput
+	);
+
+private:
+
+	bool WriteAll(const void* data, size_t size);
+
+	bool ReadAll(void* data, size_t size);
+
+	// Kills the child without waiting for it to finish what it's doing
+	void Kill();
+
+	// Milliseconds left until the current Run's deadline, -1 without one
+	int RemainingMs() const;
+
+	uint32_t m_TimeoutMs = 0;
+	std::chrono::steady_clock::time_point m_Deadline;
+	bool m_bTimedOut = false;
+
+#if defined(LINUX_BUILD)
+	int m_Pid = -1;
+	// Socket the child has as both stdin and stdout
+	int m_Fd = -1;
+
+	// Blocks until m_Fd is ready for events or the deadline passes
+	bool WaitFd(short events);
+#elif defined(WINDOWS_BUILD)
+	HANDLE m_Process = nullptr;
+	// Child's stdin and stdout, both opened for overlapped io so a wait can time out
+	HANDLE m_Write = nullptr;
+	HANDLE m_Read = nullptr;
+	// Signaled when a read or write on either pipe completes
+	HANDLE m_IoEvent = nullptr;
+
+	bool FinishIo(BOOL started, HANDLE pipe, OVERLAPPED& overlapped, DWORD& outBytes);
+#endif
+};
+
+/*
+* @brief: main of a --compile-worker child. Answers requests on stdin
+* until the parent closes it.
+* @returns: The process exit code
+*/
+int RunCompileWorker(const std::filesystem::path& shaderDir);
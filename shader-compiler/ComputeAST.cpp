@@ -13,6 +13,7 @@ ComputeAST::~ComputeAST()
 
 bool ComputeAST::Interpret()
 {
-	// Nothing to do.
+	// No Pipeline block state for compute, only the counts
+	m_Desc.Counts = GetCounts();
 	return true;
 }
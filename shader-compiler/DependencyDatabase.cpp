@@ -0,0 +1,272 @@
+#include "DependencyDatabase.h"
+#include "ShaderCache.h"
+#include "Utils.h"
+#include "nlohmann.hpp"
+#include <fstream>
+#include <iostream>
+
+
+static constexpr uint32_t DependencyDatabaseVersion = 1;
+
+// json::value and get throw on a mistyped field, and exceptions are off
+static bool ParseInput(const nlohmann::json& json, DEPENDENCY_INPUT& outInput)
+{
+	if (!json.is_object())
+	{
+		return false;
+	}
+
+	auto size = json.find("Size");
+	auto writeTime = json.find("WriteTime");
+	auto hash = json.find("Hash");
+	if (size == json.end() || !size->is_number_unsigned() ||
+		writeTime == json.end() || !writeTime->is_number_integer() ||
+		hash == json.end() || !hash->is_string())
+	{
+		return false;
+	}
+
+	outInput.Size = size->get<uint64_t>();
+	outInput.WriteTime = writeTime->get<int64_t>();
+	outInput.Hash = hash->get<std::string>();
+	return true;
+}
+
+
+void DependencyDatabase::Load(const std::filesystem::path& dbFile)
+{
+	m_ArgsHash.clear();
+	m_Pipelines.clear();
+
+	std::ifstream file(dbFile);
+	if (!file.is_open())
+	{
+		return;
+	}
+
+	// Exceptions are off, so don't let a corrupt file take us down
+	nlohmann::json json = nlohmann::json::parse(file, nullptr, false);
+	if (json.is_discarded() || !json.is_object())
+	{
+		std::cout << "[WARN] Dependency database " << dbFile.string() << " is corrupt, rebuilding everything" << std::endl;
+		return;
+	}
+
+	auto version = json.find("Version");
+	if (version == json.end() || !version->is_number_unsigned() || version->get<uint32_t>() != DependencyDatabaseVersion)
+	{
+		return;
+	}
+
+	auto argsHash = json.find("ArgsHash");
+	auto pipelinesRes = json.find("Pipelines");
+	if (argsHash == json.end() || !argsHash->is_string() ||
+		pipelinesRes == json.end() || !pipelinesRes->is_object())
+	{
+		std::cout << "[WARN] Dependency database " << dbFile.string() << " is corrupt, rebuilding everything" << std::endl;
+		return;
+	}
+
+	m_ArgsHash = argsHash->get<std::string>();
+	const nlohmann::json& pipelines = *pipelinesRes;
+
+	for (auto pipeline = pipelines.begin(); pipeline != pipelines.end(); pipeline++)
+	{
+		if (!pipeline.value().is_object())
+		{
+			std::cout << "[WARN] Dependency database entry for " << pipeline.key() << " is corrupt, rebuilding it" << std::endl;
+			continue;
+		}
+
+		auto inputs = pipeline.value().find("Inputs");
+		if (inputs == pipeline.value().end() || !inputs->is_object())
+		{
+			continue;
+		}
+
+		// A pipeline missing any of its inputs could look up to date, so
+		// one bad input drops the whole entry
+		DEPENDENCY_PIPELINE entry;
+		bool valid = true;
+		for (auto input = inputs->begin(); input != inputs->end() && valid; input++)
+		{
+			DEPENDENCY_INPUT inputEntry = { };
+			valid = ParseInput(input.value(), inputEntry);
+			entry.Inputs[input.key()] = inputEntry;
+		}
+
+		if (!valid)
+		{
+			std::cout << "[WARN] Dependency database entry for " << pipeline.key() << " is corrupt, rebuilding it" << std::endl;
+			continue;
+		}
+		m_Pipelines[pipeline.key()] = std::move(entry);
+	}
+}
+
+bool DependencyDatabase::Save(const std::filesystem::path& dbFile)
+{
+	nlohmann::json json;
+	json["Version"] = DependencyDatabaseVersion;
+	json["ArgsHash"] = m_ArgsHash;
+
+	nlohmann::json& pipelines = json["Pipelines"];
+	pipelines = nlohmann::json::object();
+	for (const auto& pipeline : m_Pipelines)
+	{
+		nlohmann::json& inputs = pipelines[pipeline.first]["Inputs"];
+		inputs = nlohmann::json::object();
+		for (const auto& input : pipeline.second.Inputs)
+		{
+			nlohmann::json& inputJson = inputs[input.first];
+			inputJson["Size"] = input.second.Size;
+			inputJson["WriteTime"] = input.second.WriteTime;
+			inputJson["Hash"] = input.second.Hash;
+		}
+	}
+
+	if (!WriteFileAtomic(dbFile, json.dump(1, '\t')))
+	{
+		std::cout << "[ERROR] Failed to write " << dbFile.string() << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+void DependencyDatabase::SetArgsHash(const std::string& argsHash)
+{
+	if (m_ArgsHash != argsHash)
+	{
+		m_Pipelines.clear();
+		m_ArgsHash = argsHash;
+	}
+}
+
+bool DependencyDatabase::IsUpToDate(const std::string& pipeline)
+{
+	auto findRes = m_Pipelines.find(pipeline);
+	if (findRes == m_Pipelines.end() || findRes->second.Inputs.empty())
+	{
+		return false;
+	}
+
+	for (auto& input : findRes->second.Inputs)
+	{
+		DEPENDENCY_INPUT current = { };
+		if (!ReadInput(input.first, current, false))
+		{
+			return false;
+		}
+
+		if (current.Size == input.second.Size && current.WriteTime == input.second.WriteTime)
+		{
+			continue;
+		}
+
+		// Touched, check if the contents actually changed
+		if (!ReadInput(input.first, current, true) || current.Hash != input.second.Hash)
+		{
+			return false;
+		}
+
+		input.second = current;
+	}
+
+	return true;
+}
+
+void DependencyDatabase::SetPipelineInputs(const std::string& pipeline, const std::vector<FILE_STAMP>& inputs)
+{
+	DEPENDENCY_PIPELINE& entry = m_Pipelines[pipeline];
+	entry.Inputs.clear();
+
+	for (const FILE_STAMP& input : inputs)
+	{
+		DEPENDENCY_INPUT& inputEntry = entry.Inputs[input.Path.lexically_normal().string()];
+		inputEntry.Size = input.Size;
+		inputEntry.WriteTime = input.WriteTime;
+		inputEntry.Hash = input.Hash.ToString();
+	}
+}
+
+void DependencyDatabase::RemovePipeline(const std::string& pipeline)
+{
+	m_Pipelines.erase(pipeline);
+}
+
+void DependencyDatabase::RetainPipelines(const std::set<std::string>& pipelines)
+{
+	for (auto it = m_Pipelines.begin(); it != m_Pipelines.end();)
+	{
+		if (pipelines.find(it->first) == pipelines.end())
+		{
+			it = m_Pipelines.erase(it);
+		}
+		else
+		{
+			it++;
+		}
+	}
+}
+
+bool DependencyDatabase::HasDependents(const std::filesystem::path& input) const
+{
+	std::string key = input.lexically_normal().string();
+	for (const auto& pipeline : m_Pipelines)
+	{
+		if (pipeline.second.Inputs.find(key) != pipeline.second.Inputs.end())
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void DependencyDatabase::GetInputDirectories(std::set<std::filesystem::path>& outDirs) const
+{
+	for (const auto& pipeline : m_Pipelines)
+	{
+		for (const auto& input : pipeline.second.Inputs)
+		{
+			outDirs.insert(std::filesystem::path(input.first).parent_path());
+		}
+	}
+}
+
+bool DependencyDatabase::ReadInput(const std::filesystem::path& input, DEPENDENCY_INPUT& outInput, bool hashContents)
+{
+	std::error_code ec;
+	outInput.Size = std::filesystem::file_size(input, ec);
+	if (ec)
+	{
+		return false;
+	}
+
+	outInput.WriteTime = (int64_t)std::filesystem::last_write_time(input, ec).time_since_epoch().count();
+	if (ec)
+	{
+		return false;
+	}
+
+	if (!hashContents)
+	{
+		return true;
+	}
+
+	std::ifstream file(input, std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	ShaderCacheHasher hasher;
+	char buffer[16384];
+	while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0)
+	{
+		hasher.Update(buffer, (size_t)file.gcount());
+	}
+
+	outInput.Hash = hasher.Finalize().ToString();
+	return true;
+}
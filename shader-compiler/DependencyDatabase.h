@@ -0,0 +1,86 @@
+#pragma once
+
+#include "FileCache.h"
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <stdint.h>
+
+
+/*
+* What a pipeline's input looked like the last time it was built.
+* Size and write time are checked first, the content hash is only
+* compared when those changed so touching a file doesn't force a rebuild.
+*/
+typedef struct DEPENDENCY_INPUT {
+	uint64_t Size;
+	int64_t WriteTime;
+	std::string Hash;
+} DEPENDENCY_INPUT;
+
+typedef struct DEPENDENCY_PIPELINE {
+	std::map<std::string, DEPENDENCY_INPUT> Inputs;
+} DEPENDENCY_PIPELINE;
+
+/*
+* Persistent record of which files every pipeline was built from.
+* Stored as json next to the compiled output, a pipeline is only
+* rebuilt if one of its sources, transitive includes or the compiler
+* arguments changed since it was last recorded.
+*/
+class DependencyDatabase
+{
+public:
+
+	DependencyDatabase() = default;
+
+	/*
+	* @brief: A missing or unreadable database isn't an error,
+	* everything will just be out of date.
+	*/
+	void Load(const std::filesystem::path& dbFile);
+
+	bool Save(const std::filesystem::path& dbFile);
+
+	/*
+	* @brief: If the arguments differ from the ones the database was
+	* built with every pipeline is treated as out of date.
+	*/
+	void SetArgsHash(const std::string& argsHash);
+
+	/*
+	* @returns: true if every recorded input of the pipeline is unchanged
+	*/
+	bool IsUpToDate(const std::string& pipeline);
+
+	/*
+	* @brief: Replaces the recorded inputs of the pipeline. The stamps are taken when
+	* the inputs are read for the compile, not from the disk afterwards, a file saved
+	* while the pipeline was compiling is then still out of date next time.
+	*/
+	void SetPipelineInputs(const std::string& pipeline, const std::vector<FILE_STAMP>& inputs);
+
+	void RemovePipeline(const std::string& pipeline);
+
+	/*
+	* @brief: Drops every pipeline not in pipelines, so deleted sources don't linger
+	*/
+	void RetainPipelines(const std::set<std::string>& pipelines);
+
+	/*
+	* @returns: true if any pipeline was built from input
+	*/
+	bool HasDependents(const std::filesystem::path& input) const;
+
+	void GetInputDirectories(std::set<std::filesystem::path>& outDirs) const;
+
+private:
+
+	static bool ReadInput(const std::filesystem::path& input, DEPENDENCY_INPUT& outInput, bool hashContents);
+
+	std::string m_ArgsHash;
+
+	std::map<std::string, DEPENDENCY_PIPELINE> m_Pipelines;
+};
@@ -0,0 +1,122 @@
+#include "FileCache.h"
+#include <fstream>
+
+
+static bool StatFile(const std::filesystem::path& path, uint64_t& outSize, int64_t& outWriteTime)
+{
+	std::error_code ec;
+	outSize = std::filesystem::file_size(path, ec);
+	if (ec)
+	{
+		return false;
+	}
+
+	outWriteTime = (int64_t)std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+	return !ec;
+}
+
+bool ReadFileSnapshot(const std::filesystem::path& path, FILE_SNAPSHOT& outSnapshot)
+{
+	// Stat first, see FILE_SNAPSHOT
+	if (!StatFile(path, outSnapshot.Size, outSnapshot.WriteTime))
+	{
+		return false;
+	}
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	// Sized from the stat, but read to the end in case it grew since
+	std::string contents((size_t)outSnapshot.Size, '\0');
+	file.read(contents.data(), contents.size());
+	contents.resize((size_t)file.gcount());
+
+	char buffer[16384];
+	while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0)
+	{
+		contents.append(buffer, (size_t)file.gcount());
+	}
+
+	ShaderCacheHasher hasher;
+	hasher.Update(contents.data(), contents.size());
+	outSnapshot.Hash = hasher.Finalize();
+	outSnapshot.Contents = std::make_shared<const std::string>(std::move(contents));
+	return true;
+}
+
+void FileCache::BeginBuild()
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	m_Generation++;
+}
+
+bool FileCache::Get(const std::filesystem::path& path, FILE_SNAPSHOT& outSnapshot, bool& outRead)
+{
+	const std::string key = path.lexically_normal().string();
+	outRead = false;
+
+	bool found = false;
+	uint64_t cachedSize = 0;
+	int64_t cachedWriteTime = 0;
+	uint32_t generation = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		generation = m_Generation;
+
+		auto findRes = m_Entries.find(key);
+		if (findRes != m_Entries.end())
+		{
+			// Already checked during this build, don't touch the disk again
+			if (findRes->second.Generation == generation)
+			{
+				outSnapshot = findRes->second.Snapshot;
+				return true;
+			}
+
+			found = true;
+			cachedSize = findRes->second.Snapshot.Size;
+			cachedWriteTime = findRes->second.Snapshot.WriteTime;
+		}
+	}
+
+	uint64_t size = 0;
+	int64_t writeTime = 0;
+	if (!StatFile(path, size, writeTime))
+	{
+		return false;
+	}
+
+	if (found && size == cachedSize && writeTime == cachedWriteTime)
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		FILE_ENTRY& entry = m_Entries[key];
+		entry.Generation = generation;
+		outSnapshot = entry.Snapshot;
+		return true;
+	}
+
+	// Read without the lock, two threads racing on
+	// the same file both read it and the last one wins
+	FILE_SNAPSHOT snapshot = { };
+	if (!ReadFileSnapshot(path, snapshot))
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(m_Lock);
+	FILE_ENTRY& entry = m_Entries[key];
+	entry.Snapshot = snapshot;
+	entry.Generation = generation;
+	outSnapshot = snapshot;
+	outRead = true;
+	return true;
+}
+
+void FileCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	m_Entries.clear();
+}
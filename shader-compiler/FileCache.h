@@ -0,0 +1,92 @@
+#pragma once
+
+#include "ShaderCache.h"
+#include <mutex>
+#include <memory>
+#include <string>
+#include <filesystem>
+#include <unordered_map>
+#include <stdint.h>
+
+
+/*
+* A file's content along with the size and write time it had right before
+* it was read. If it's saved again after the stat the next stat won't match,
+* so a snapshot is never mistaken for newer than it is.
+*/
+typedef struct FILE_SNAPSHOT {
+	uint64_t Size;
+	int64_t WriteTime;
+	SHADER_CACHE_KEY Hash;
+	std::shared_ptr<const std::string> Contents;
+} FILE_SNAPSHOT;
+
+/*
+* What a build records about a file it read, the snapshot without the content
+*/
+typedef struct FILE_STAMP {
+	std::filesystem::path Path;
+	uint64_t Size;
+	int64_t WriteTime;
+	SHADER_CACHE_KEY Hash;
+} FILE_STAMP;
+
+inline FILE_STAMP MakeFileStamp(const std::filesystem::path& path, const FILE_SNAPSHOT& snapshot)
+{
+	return { path.lexically_normal(), snapshot.Size, snapshot.WriteTime, snapshot.Hash };
+}
+
+/*
+* @returns: false if the file can't be read, an empty file is fine
+*/
+bool ReadFileSnapshot(const std::filesystem::path& path, FILE_SNAPSHOT& outSnapshot);
+
+/*
+* Build wide store of file snapshots, keyed by path.
+* A file is checked against its size and write time the first time it's
+* asked for in a build and only read again if those changed.
+* The HeaderCache and IncludeCache keep what they make of the contents on top of this.
+* Safe to use from any thread.
+*/
+class FileCache
+{
+public:
+
+	FileCache() = default;
+
+	FileCache(const FileCache&) = delete;
+	FileCache& operator=(const FileCache&) = delete;
+
+	/*
+	* @brief: Starts a new build, every file gets checked against
+	* the disk once more the next time it's asked for
+	*/
+	void BeginBuild();
+
+	inline uint32_t GetGeneration() const
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		return m_Generation;
+	}
+
+	/*
+	* @param outRead: Set if the file had to be read, not just checked
+	* @returns: false if it can't be read
+	*/
+	bool Get(const std::filesystem::path& path, FILE_SNAPSHOT& outSnapshot, bool& outRead);
+
+	void Clear();
+
+private:
+
+	typedef struct FILE_ENTRY {
+		FILE_SNAPSHOT Snapshot;
+		// Build the entry was last checked against the disk in
+		uint32_t Generation;
+	} FILE_ENTRY;
+
+	mutable std::mutex m_Lock;
+	std::unordered_map<std::string, FILE_ENTRY> m_Entries;
+
+	uint32_t m_Generation = 1;
+};
@@ -0,0 +1,474 @@
+#include "FileWatcher.h"
+#include <iostream>
+#include <thread>
+#include <chrono>
+
+#ifdef LINUX_BUILD
+#include <poll.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+
+#if defined(LINUX_BUILD) || defined(WINDOWS_BUILD)
+
+// For when the system dropped changes, anything in the directory could have changed
+static void AddAllFiles(const std::filesystem::path& dir, std::set<std::filesystem::path>& outChanged)
+{
+	std::error_code ec;
+	for (auto it = std::filesystem::directory_iterator(dir, ec);
+		!ec && it != std::filesystem::directory_iterator();
+		it.increment(ec))
+	{
+		outChanged.insert(it->path());
+	}
+}
+
+#endif
+
+
+#ifdef LINUX_BUILD
+
+FileWatcher::FileWatcher() :
+	m_Fd(inotify_init1(IN_CLOEXEC))
+{
+	if (m_Fd < 0)
+	{
+		std::cout << "[ERROR] inotify_init1 failed" << std::endl;
+	}
+}
+
+FileWatcher::~FileWatcher()
+{
+	if (m_Fd >= 0)
+	{
+		close(m_Fd);
+	}
+}
+
+bool FileWatcher::AddDirectory(const std::filesystem::path& dir)
+{
+	if (m_Fd < 0)
+	{
+		return false;
+	}
+
+	for (const auto& watch : m_Watches)
+	{
+		if (watch.second == dir)
+		{
+			return true;
+		}
+	}
+
+	// IN_CLOSE_WRITE instead of IN_MODIFY so we don't
+	// rebuild off a file that's halfway through being saved
+	int wd = inotify_add_watch(m_Fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+	if (wd < 0)
+	{
+		std::cout << "[ERROR] Failed to watch " << dir.string() << std::endl;
+		return false;
+	}
+
+	m_Watches[wd] = dir;
+	return true;
+}
+
+bool FileWatcher::ReadEvents(int timeoutMs, std::set<std::filesystem::path>& outChanged, bool& outFailed)
+{
+	outFailed = false;
+
+	pollfd pfd = { };
+	pfd.fd = m_Fd;
+	pfd.events = POLLIN;
+
+	int res = poll(&pfd, 1, timeoutMs);
+	if (res < 0 && errno != EINTR)
+	{
+		std::cout << "[ERROR] Waiting for file changes failed: " << strerror(errno) << std::endl;
+		outFailed = true;
+		return false;
+	}
+	if (res <= 0)
+	{
+		return false;
+	}
+
+	alignas(inotify_event) char buffer[16384];
+	ssize_t len = read(m_Fd, buffer, sizeof(buffer));
+	if (len < 0 && errno != EINTR && errno != EAGAIN)
+	{
+		std::cout << "[ERROR] Reading file changes failed: " << strerror(errno) << std::endl;
+		outFailed = true;
+		return false;
+	}
+	if (len <= 0)
+	{
+		return false;
+	}
+
+	for (char* ptr = buffer; ptr < buffer + len;)
+	{
+		const inotify_event* event = (const inotify_event*)ptr;
+		ptr += sizeof(inotify_event) + event->len;
+
+		if (event->mask & IN_Q_OVERFLOW)
+		{
+			// Not tied to a watch, whatever didn't fit in the queue is lost
+			for (const auto& watch : m_Watches)
+			{
+				AddAllFiles(watch.second, outChanged);
+			}
+			continue;
+		}
+
+		auto watch = m_Watches.find(event->wd);
+		if (watch == m_Watches.end() || event->len == 0 || (event->mask & IN_ISDIR))
+		{
+			continue;
+		}
+
+		outChanged.insert(watch->second / event->name);
+	}
+
+	return true;
+}
+
+bool FileWatcher::WaitForChanges(std::vector<std::filesystem::path>& outChanged, uint32_t debounceMs)
+{
+	if (m_Fd < 0)
+	{
+		return false;
+	}
+
+	std::set<std::filesystem::path> changed;
+	bool failed = false;
+	while (changed.empty())
+	{
+		ReadEvents(-1, changed, failed);
+		if (failed)
+		{
+			return false;
+		}
+	}
+
+	while (ReadEvents((int)debounceMs, changed, failed))
+	{
+	}
+
+	outChanged.assign(changed.begin(), changed.end());
+	return true;
+}
+
+#elif defined(WINDOWS_BUILD)
+
+FileWatcher::FileWatcher() :
+	m_Port(CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1))
+{
+	if (m_Port == nullptr)
+	{
+		std::cout << "[ERROR] CreateIoCompletionPort failed, error " << GetLastError() << std::endl;
+	}
+}
+
+FileWatcher::~FileWatcher()
+{
+	for (std::unique_ptr<WATCHED_DIR>& dir : m_Dirs)
+	{
+		if (dir->Handle == INVALID_HANDLE_VALUE)
+		{
+			continue;
+		}
+
+		// The read has to be over before its buffer is freed
+		DWORD bytes = 0;
+		CancelIoEx(dir->Handle, &dir->Overlapped);
+		GetOverlappedResult(dir->Handle, &dir->Overlapped, &bytes, TRUE);
+		CloseHandle(dir->Handle);
+	}
+	m_Dirs.clear();
+
+	if (m_Port != nullptr)
+	{
+		CloseHandle(m_Port);
+	}
+}
+
+bool FileWatcher::AddDirectory(const std::filesystem::path& dir)
+{
+	if (m_Port == nullptr)
+	{
+		return false;
+	}
+
+	// A directory that stopped being watched keeps its slot, and with it
+	// its completion key, in case it's added again after being recreated
+	size_t index = m_Dirs.size();
+	for (size_t i = 0; i < m_Dirs.size(); i++)
+	{
+		if (m_Dirs[i]->Path == dir)
+		{
+			if (m_Dirs[i]->Handle != INVALID_HANDLE_VALUE)
+			{
+				return true;
+			}
+			index = i;
+			break;
+		}
+	}
+
+	HANDLE handle = CreateFileW(
+		dir.wstring().c_str(),
+		FILE_LIST_DIRECTORY,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+		nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		std::cout << "[ERROR] Failed to watch " << dir.string() << std::endl;
+		return false;
+	}
+
+	// The completion key is the directory's index in m_Dirs
+	if (CreateIoCompletionPort(handle, m_Port, (ULONG_PTR)index, 0) == nullptr)
+	{
+		std::cout << "[ERROR] Failed to watch " << dir.string() << ", error " << GetLastError() << std::endl;
+		CloseHandle(handle);
+		return false;
+	}
+
+	if (index == m_Dirs.size())
+	{
+		m_Dirs.push_back(std::make_unique<WATCHED_DIR>());
+		m_Dirs.back()->Path = dir;
+	}
+
+	WATCHED_DIR& watched = *m_Dirs[index];
+	watched.Handle = handle;
+	if (!Listen(watched))
+	{
+		std::cout << "[ERROR] Failed to watch " << dir.string() << ", error " << GetLastError() << std::endl;
+		StopWatching(watched);
+		return false;
+	}
+	return true;
+}
+
+void FileWatcher::StopWatching(WATCHED_DIR& dir)
+{
+	// Only called with no read pending, nothing can still write into the buffer
+	CloseHandle(dir.Handle);
+	dir.Handle = INVALID_HANDLE_VALUE;
+}
+
+bool FileWatcher::AnyListening() const
+{
+	for (const std::unique_ptr<WATCHED_DIR>& dir : m_Dirs)
+	{
+		if (dir->Handle != INVALID_HANDLE_VALUE)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool FileWatcher::Listen(WATCHED_DIR& dir)
+{
+	dir.Overlapped = { };
+
+	// There's no IN_CLOSE_WRITE here, a save that takes a few
+	// writes is held together by the debounce in WaitForChanges
+	return ReadDirectoryChangesW(
+		dir.Handle,
+		dir.Buffer,
+		sizeof(dir.Buffer),
+		FALSE,
+		FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE,
+		nullptr,
+		&dir.Overlapped,
+		nullptr) != FALSE;
+}
+
+bool FileWatcher::ReadEvents(DWORD timeoutMs, std::set<std::filesystem::path>& outChanged)
+{
+	DWORD bytes = 0;
+	ULONG_PTR key = 0;
+	OVERLAPPED* overlapped = nullptr;
+	const BOOL completed = GetQueuedCompletionStatus(m_Port, &bytes, &key, &overlapped, timeoutMs);
+	if (overlapped == nullptr || key >= m_Dirs.size())
+	{
+		// Timed out
+		return false;
+	}
+
+	WATCHED_DIR& dir = *m_Dirs[key];
+	if (!completed)
+	{
+		// Most likely the directory was deleted, it stays quiet from now on
+		std::cout << "[WARN] Stopped watching " << dir.Path.string() << ", error " << GetLastError() << std::endl;
+		StopWatching(dir);
+		return true;
+	}
+
+	if (bytes == 0)
+	{
+		// More changed at once than fit in the buffer
+		AddAllFiles(dir.Path, outChanged);
+	}
+	else
+	{
+		for (DWORD offset = 0;;)
+		{
+			const FILE_NOTIFY_INFORMATION* info = (const FILE_NOTIFY_INFORMATION*)(dir.Buffer + offset);
+			outChanged.insert(dir.Path / std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR)));
+
+			if (info->NextEntryOffset == 0)
+			{
+				break;
+			}
+			offset += info->NextEntryOffset;
+		}
+	}
+
+	// Changes in between are queued by the system, nothing is lost
+	if (!Listen(dir))
+	{
+		std::cout << "[WARN] Stopped watching " << dir.Path.string() << ", error " << GetLastError() << std::endl;
+		StopWatching(dir);
+	}
+	return true;
+}
+
+bool FileWatcher::WaitForChanges(std::vector<std::filesystem::path>& outChanged, uint32_t debounceMs)
+{
+	if (m_Port == nullptr)
+	{
+		return false;
+	}
+
+	std::set<std::filesystem::path> changed;
+	while (changed.empty())
+	{
+		// Nothing left that could ever complete, waiting would never return
+		if (!AnyListening())
+		{
+			std::cout << "[ERROR] None of the watched directories can be watched anymore" << std::endl;
+			return false;
+		}
+		ReadEvents(INFINITE, changed);
+	}
+
+	while (ReadEvents((DWORD)debounceMs, changed))
+	{
+	}
+
+	outChanged.assign(changed.begin(), changed.end());
+	return true;
+}
+
+#else
+
+static constexpr uint32_t PollIntervalMs = 250;
+
+FileWatcher::FileWatcher()
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+}
+
+bool FileWatcher::AddDirectory(const std::filesystem::path& dir)
+{
+	if (m_Dirs.find(dir) != m_Dirs.end())
+	{
+		return true;
+	}
+
+	std::error_code ec;
+	if (!std::filesystem::is_directory(dir, ec))
+	{
+		std::cout << "[ERROR] Failed to watch " << dir.string() << std::endl;
+		return false;
+	}
+
+	m_Dirs.insert(dir);
+	Snapshot(dir, m_Files);
+	return true;
+}
+
+void FileWatcher::Snapshot(const std::filesystem::path& dir, std::map<std::filesystem::path, WATCHED_FILE>& outFiles)
+{
+	std::error_code ec;
+	for (auto it = std::filesystem::directory_iterator(dir, ec);
+		!ec && it != std::filesystem::directory_iterator();
+		it.increment(ec))
+	{
+		if (!it->is_regular_file(ec))
+		{
+			continue;
+		}
+
+		WATCHED_FILE file = { };
+		file.Size = it->file_size(ec);
+		file.WriteTime = it->last_write_time(ec);
+		outFiles[it->path()] = file;
+	}
+}
+
+bool FileWatcher::Poll(std::set<std::filesystem::path>& outChanged)
+{
+	std::map<std::filesystem::path, WATCHED_FILE> files;
+	for (const std::filesystem::path& dir : m_Dirs)
+	{
+		Snapshot(dir, files);
+	}
+
+	bool anyChanged = false;
+	for (const auto& file : files)
+	{
+		auto prev = m_Files.find(file.first);
+		if (prev == m_Files.end() ||
+			prev->second.Size != file.second.Size ||
+			prev->second.WriteTime != file.second.WriteTime)
+		{
+			outChanged.insert(file.first);
+			anyChanged = true;
+		}
+	}
+	for (const auto& file : m_Files)
+	{
+		if (files.find(file.first) == files.end())
+		{
+			outChanged.insert(file.first);
+			anyChanged = true;
+		}
+	}
+
+	std::swap(m_Files, files);
+	return anyChanged;
+}
+
+bool FileWatcher::WaitForChanges(std::vector<std::filesystem::path>& outChanged, uint32_t debounceMs)
+{
+	std::set<std::filesystem::path> changed;
+	while (!Poll(changed))
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(PollIntervalMs));
+	}
+
+	do
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(debounceMs));
+	} while (Poll(changed));
+
+	outChanged.assign(changed.begin(), changed.end());
+	return true;
+}
+
+#endif
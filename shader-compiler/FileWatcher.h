@@ -0,0 +1,95 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <memory>
+#include <vector>
+#include <filesystem>
+#include <stdint.h>
+
+#ifdef WINDOWS_BUILD
+#include <windows.h>
+#endif
+
+
+/*
+* Watches a set of directories (not recursively) for files being written,
+* created, moved or deleted.
+* Uses inotify on LINUX_BUILD and ReadDirectoryChangesW on WINDOWS_BUILD,
+* everywhere else it falls back to polling the write times of the files
+* in the watched directories.
+*/
+class FileWatcher
+{
+public:
+
+	FileWatcher();
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	/*
+	* @brief: Adding a directory that's already watched does nothing
+	*/
+	bool AddDirectory(const std::filesystem::path& dir);
+
+	/*
+	* @brief: Blocks until at least one file changes. Editors tend to write a file
+	* in a few steps, so once something changes this keeps collecting until
+	* nothing has changed for debounceMs.
+	*/
+	bool WaitForChanges(std::vector<std::filesystem::path>& outChanged, uint32_t debounceMs);
+
+private:
+
+#ifdef LINUX_BUILD
+	/*
+	* @param outFailed: Set if inotify can't be waited on anymore, not on a timeout
+	* @returns: false if nothing was read
+	*/
+	bool ReadEvents(int timeoutMs, std::set<std::filesystem::path>& outChanged, bool& outFailed);
+
+	int m_Fd;
+	std::map<int, std::filesystem::path> m_Watches;
+#elif defined(WINDOWS_BUILD)
+	typedef struct WATCHED_DIR {
+		std::filesystem::path Path;
+		// INVALID_HANDLE_VALUE once the directory stopped being watched
+		HANDLE Handle;
+		OVERLAPPED Overlapped;
+		// FILE_NOTIFY_INFORMATION records, those have to be DWORD aligned
+		alignas(DWORD) uint8_t Buffer[16384];
+	} WATCHED_DIR;
+
+	/*
+	* @brief: Asks for the directory's next changes, they complete on m_Port
+	*/
+	bool Listen(WATCHED_DIR& dir);
+
+	/*
+	* @brief: Closes a directory that can't be listened to anymore
+	*/
+	void StopWatching(WATCHED_DIR& dir);
+
+	bool ReadEvents(DWORD timeoutMs, std::set<std::filesystem::path>& outChanged);
+
+	bool AnyListening() const;
+
+	HANDLE m_Port;
+	// The OVERLAPPED and buffer of a pending read can't move, so each is allocated on its own
+	std::vector<std::unique_ptr<WATCHED_DIR>> m_Dirs;
+#else
+	typedef struct WATCHED_FILE {
+		uint64_t Size;
+		std::filesystem::file_time_type WriteTime;
+	} WATCHED_FILE;
+
+	void Snapshot(const std::filesystem::path& dir, std::map<std::filesystem::path, WATCHED_FILE>& outFiles);
+
+	bool Poll(std::set<std::filesystem::path>& outChanged);
+
+	std::set<std::filesystem::path> m_Dirs;
+	std::map<std::filesystem::path, WATCHED_FILE> m_Files;
+#endif
+};
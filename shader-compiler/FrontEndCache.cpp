@@ -0,0 +1,300 @@
+#include "FrontEndCache.h"
+#include <string.h>
+#include <type_traits>
+
+
+// Bump whenever what's written below changes
+#define FRONTEND_CACHE_VERSION 3
+
+#define FRONTEND_CACHE_MAGIC 0x31434546 // "FEC1"
+
+class FrontEndWriter
+{
+public:
+
+	template<typename T>
+	inline void Pod(const T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Only plain data can be written as is");
+		const uint8_t* bytes = (const uint8_t*)&value;
+		Data.insert(Data.end(), bytes, bytes + sizeof(T));
+	}
+
+	inline void String(const std::string& str)
+	{
+		Pod((uint32_t)str.size());
+		Data.insert(Data.end(), str.begin(), str.end());
+	}
+
+	std::vector<uint8_t> Data;
+};
+
+/*
+* Reads back what FrontEndWriter wrote. Running off the end
+* clears Ok and every read after that is a no op.
+*/
+class FrontEndReader
+{
+public:
+
+	FrontEndReader(const std::vector<uint8_t>& data) :
+		Ptr(data.data()),
+		End(data.data() + data.size()),
+		Ok(true)
+	{
+	}
+
+	template<typename T>
+	inline void Pod(T& outValue)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Only plain data can be read as is");
+		if (!Ok || (size_t)(End - Ptr) < sizeof(T))
+		{
+			Ok = false;
+			return;
+		}
+		memcpy(&outValue, Ptr, sizeof(T));
+		Ptr += sizeof(T);
+	}
+
+	inline void String(std::string& outStr)
+	{
+		uint32_t size = 0;
+		Pod(size);
+		if (!Ok || (size_t)(End - Ptr) < size)
+		{
+			Ok = false;
+			return;
+		}
+		outStr.assign((const char*)Ptr, size);
+		Ptr += size;
+	}
+
+	const uint8_t* Ptr;
+	const uint8_t* End;
+	bool Ok;
+};
+
+SHADER_CACHE_KEY FrontEndCache::BuildKey(const std::string& type, const std::string& source)
+{
+	ShaderCacheHasher hasher;
+	hasher.Update(std::string("frontend"));
+	uint32_t layout[] = {
+		FRONTEND_CACHE_VERSION,
+		(uint32_t)sizeof(GFX_RASTER_DESC),
+		(uint32_t)sizeof(GFX_RENDER_TARGET_DESC),
+		(uint32_t)sizeof(GFX_DEPTH_STENCIL_DESC),
+		(uint32_t)sizeof(PIPELINE_RESOURCE_COUNTERS)
+	};
+	hasher.Update(layout, sizeof(layout));
+	hasher.Update(type);
+	hasher.Update(source);
+	return hasher.Finalize();
+}
+
+static void WriteResult(FrontEndWriter& writer, const FRONTEND_RESULT& result)
+{
+	writer.Pod((uint32_t)FRONTEND_CACHE_MAGIC);
+	writer.Pod(result.Counts);
+	writer.Pod(result.PipelineBlockStart);
+	writer.Pod(result.PipelineBlockEnd);
+	writer.Pod(result.PipelineBlockBeginOffset);
+	writer.Pod(result.PipelineBlockEndOffset);
+	writer.Pod(result.ResumeLine);
+	writer.Pod(result.OptionalStages);
+
+	writer.Pod((uint32_t)result.Imports.size());
+	for (const FRONTEND_IMPORT& import : result.Imports)
+	{
+		writer.String(import.Path);
+		writer.Pod(import.Hash);
+	}
+}
+
+static void ReadResult(FrontEndReader& reader, FRONTEND_RESULT& result)
+{
+	uint32_t magic = 0;
+	reader.Pod(magic);
+	if (magic != FRONTEND_CACHE_MAGIC)
+	{
+		reader.Ok = false;
+		return;
+	}
+
+	reader.Pod(result.Counts);
+	reader.Pod(result.PipelineBlockStart);
+	reader.Pod(result.PipelineBlockEnd);
+	reader.Pod(result.PipelineBlockBeginOffset);
+	reader.Pod(result.PipelineBlockEndOffset);
+	reader.Pod(result.ResumeLine);
+	reader.Pod(result.OptionalStages);
+
+	uint32_t numImports = 0;
+	reader.Pod(numImports);
+	for (uint32_t i = 0; i < numImports && reader.Ok; i++)
+	{
+		FRONTEND_IMPORT import;
+		reader.String(import.Path);
+		reader.Pod(import.Hash);
+		result.Imports.push_back(std::move(import));
+	}
+}
+
+static void WriteDesc(FrontEndWriter& writer, const FULL_PIPELINE_DESCRIPTOR& desc)
+{
+	writer.Pod(desc.Counts);
+
+	writer.Pod((uint32_t)desc.InputLayout.InputItems.size());
+	for (const GFX_INPUT_ITEM_DESC& item : desc.InputLayout.InputItems)
+	{
+		writer.String(item.Name);
+		writer.Pod(item.ItemFormat);
+	}
+
+	writer.Pod(desc.PolygonType);
+	writer.Pod(desc.RasterDesc);
+	writer.Pod(desc.bEnableAlphaToCoverage);
+	writer.Pod(desc.bIndependentBlendEnable);
+	writer.Pod(desc.RtvDescs);
+	writer.Pod(desc.DepthStencilState);
+	writer.Pod(desc.NumRenderTargets);
+}
+
+static void ReadDesc(FrontEndReader& reader, FULL_PIPELINE_DESCRIPTOR& desc)
+{
+	reader.Pod(desc.Counts);
+
+	uint32_t numItems = 0;
+	reader.Pod(numItems);
+	for (uint32_t i = 0; i < numItems && reader.Ok; i++)
+	{
+		GFX_INPUT_ITEM_DESC item;
+		reader.String(item.Name);
+		reader.Pod(item.ItemFormat);
+		desc.InputLayout.InputItems.push_back(std::move(item));
+	}
+
+	reader.Pod(desc.PolygonType);
+	reader.Pod(desc.RasterDesc);
+	reader.Pod(desc.bEnableAlphaToCoverage);
+	reader.Pod(desc.bIndependentBlendEnable);
+	reader.Pod(desc.RtvDescs);
+	reader.Pod(desc.DepthStencilState);
+	reader.Pod(desc.NumRenderTargets);
+}
+
+static void WriteDesc(FrontEndWriter& writer, const COMPUTE_PIPELINE_DESC& desc)
+{
+	writer.Pod(desc.Counts);
+}
+
+static void ReadDesc(FrontEndReader& reader, COMPUTE_PIPELINE_DESC& desc)
+{
+	reader.Pod(desc.Counts);
+}
+
+static void WriteDesc(FrontEndWriter& writer, const RAYTRACING_PIPELINE_DESC& desc)
+{
+	writer.Pod(desc.Counts);
+	writer.Pod(desc.PayloadSizeInBytes);
+	writer.Pod(desc.MaxRaytraceRecurseDepth);
+
+	writer.Pod((uint32_t)desc.HitGroups.size());
+	for (const RAYTRACING_HIT_GROUP_DESC& hitGroup : desc.HitGroups)
+	{
+		writer.String(hitGroup.ClosestHit);
+		writer.String(hitGroup.AnyHit);
+		writer.String(hitGroup.ExportName);
+	}
+}
+
+static void ReadDesc(FrontEndReader& reader, RAYTRACING_PIPELINE_DESC& desc)
+{
+	reader.Pod(desc.Counts);
+	reader.Pod(desc.PayloadSizeInBytes);
+	reader.Pod(desc.MaxRaytraceRecurseDepth);
+
+	uint32_t numHitGroups = 0;
+	reader.Pod(numHitGroups);
+	for (uint32_t i = 0; i < numHitGroups && reader.Ok; i++)
+	{
+		RAYTRACING_HIT_GROUP_DESC hitGroup;
+		reader.String(hitGroup.ClosestHit);
+		reader.String(hitGroup.AnyHit);
+		reader.String(hitGroup.ExportName);
+		desc.HitGroups.push_back(std::move(hitGroup));
+	}
+}
+
+template<typename DESC>
+static bool LoadEntry(ShaderCache* store, const SHADER_CACHE_KEY& key, FRONTEND_RESULT& outResult, DESC& outDesc)
+{
+	std::vector<uint8_t> data;
+	if (!store->Lookup(key, data))
+	{
+		return false;
+	}
+
+	// Read into temporaries so a truncated entry leaves the outputs alone
+	FrontEndReader reader(data);
+	FRONTEND_RESULT result = { };
+	DESC desc = { };
+	ReadResult(reader, result);
+	ReadDesc(reader, desc);
+	if (!reader.Ok || reader.Ptr != reader.End)
+	{
+		return false;
+	}
+
+	outResult = std::move(result);
+	outDesc = std::move(desc);
+	return true;
+}
+
+template<typename DESC>
+static void StoreEntry(ShaderCache* store, const SHADER_CACHE_KEY& key, const FRONTEND_RESULT& result, const DESC& desc)
+{
+	FrontEndWriter writer;
+	WriteResult(writer, result);
+	WriteDesc(writer, desc);
+	store->Store(key, writer.Data.data(), writer.Data.size());
+}
+
+bool FrontEndCache::Load(const SHADER_CACHE_KEY& key, FRONTEND_RESULT& outResult, FULL_PIPELINE_DESCRIPTOR& outDesc)
+{
+	return IsEnabled() && LoadEntry(m_Store, key, outResult, outDesc);
+}
+
+bool FrontEndCache::Load(const SHADER_CACHE_KEY& key, FRONTEND_RESULT& outResult, COMPUTE_PIPELINE_DESC& outDesc)
+{
+	return IsEnabled() && LoadEntry(m_Store, key, outResult, outDesc);
+}
+
+bool FrontEndCache::Load(const SHADER_CACHE_KEY& key, FRONTEND_RESULT& outResult, RAYTRACING_PIPELINE_DESC& outDesc)
+{
+	return IsEnabled() && LoadEntry(m_Store, key, outResult, outDesc);
+}
+
+void FrontEndCache::Store(const SHADER_CACHE_KEY& key, const FRONTEND_RESULT& result, const FULL_PIPELINE_DESCRIPTOR& desc)
+{
+	if (IsEnabled())
+	{
+		StoreEntry(m_Store, key, result, desc);
+	}
+}
+
+void FrontEndCache::Store(const SHADER_CACHE_KEY& key, const FRONTEND_RESULT& result, const COMPUTE_PIPELINE_DESC& desc)
+{
+	if (IsEnabled())
+	{
+		StoreEntry(m_Store, key, result, desc);
+	}
+}
+
+void FrontEndCache::Store(const SHADER_CACHE_KEY& key, const FRONTEND_RESULT& result, const RAYTRACING_PIPELINE_DESC& desc)
+{
+	if (IsEnabled())
+	{
+		StoreEntry(m_Store, key, result, desc);
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Pipeline.h"
+#include "ShaderCache.h"
+#include <string>
+#include <vector>
+
+
+// Optional graphics entry points the parser found
+#define FRONTEND_STAGE_HULL 0x1
+#define FRONTEND_STAGE_DOMAIN 0x2
+#define FRONTEND_STAGE_GEOMETRY 0x4
+
+typedef struct FRONTEND_IMPORT {
+	std::string Path;
+	SHADER_CACHE_KEY Hash;
+} FRONTEND_IMPORT;
+
+/*
+* Everything the compile stage needs from lexing, parsing and interpreting
+* a pipeline file, besides the pipeline descriptor itself.
+*/
+typedef struct FRONTEND_RESULT {
+	PIPELINE_RESOURCE_COUNTERS Counts;
+
+	// Lines and byte range of the Pipeline block, see ASTBase
+	uint32_t PipelineBlockStart;
+	uint32_t PipelineBlockEnd;
+	uint32_t PipelineBlockBeginOffset;
+	uint32_t PipelineBlockEndOffset;
+
+	// Line of the source right after the Pipeline block
+	uint32_t ResumeLine;
+
+	// FRONTEND_STAGE_*
+	uint32_t OptionalStages;
+
+	// Every header the file included, directly or not, with the content it was parsed with
+	std::vector<FRONTEND_IMPORT> Imports;
+} FRONTEND_RESULT;
+
+/*
+* Front end output kept in the compile cache so a pipeline whose source
+* hasn't changed skips the lexer, parser and interpreter entirely.
+* Entries are keyed by the source's content and live next to the compiled
+* blobs, so they're evicted by the same Trim().
+* Whether the headers an entry was built from are still the same is up to
+* the caller, the hashes are in FRONTEND_RESULT::Imports.
+*/
+class FrontEndCache
+{
+public:
+
+	FrontEndCache() = default;
+
+	/*
+	* @brief: nullptr, or a store that isn't enabled, turns the cache off
+	*/
+	inline void SetStore(ShaderCache* store)
+	{
+		m_Store = store;
+	}
+
+	inline bool IsEnabled() const
+	{
+		return m_Store != nullptr && m_Store->IsEnabled();
+	}
+
+	/*
+	* @brief: type keeps a .gfx and a .cmpt with the same text apart
+	*/
+	static SHADER_CACHE_KEY BuildKey(const std::string& type, const std::string& source);
+
+	/*
+	* @returns: true if there was a valid entry, the outputs are only written then
+	*/
+	bool Load(const SHADER_CACHE_KEY& key, FRONTEND_RESULT& outResult, FULL_PIPELINE_DESCRIPTOR& outDesc);
+	bool Load(const SHADER_CACHE_KEY& key, FRONTEND_RESULT& outResult, COMPUTE_PIPELINE_DESC& outDesc);
+	bool Load(const SHADER_CACHE_KEY& key, FRONTEND_RESULT& outResult, RAYTRACING_PIPELINE_DESC& outDesc);
+
+	/*
+	* @brief: The compiled shaders in desc aren't part of the entry
+	*/
+	void Store(const SHADER_CACHE_KEY& key, const FRONTEND_RESULT& result, const FULL_PIPELINE_DESCRIPTOR& desc);
+	void Store(const SHADER_CACHE_KEY& key, const FRONTEND_RESULT& result, const COMPUTE_PIPELINE_DESC& desc);
+	void Store(const SHADER_CACHE_KEY& key, const FRONTEND_RESULT& result, const RAYTRACING_PIPELINE_DESC& desc);
+
+private:
+
+	ShaderCache* m_Store = nullptr;
+};
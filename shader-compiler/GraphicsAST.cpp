@@ -16,7 +16,10 @@ GraphicsAST::~GraphicsAST()
 
 bool GraphicsAST::Interpret()
 {
-	return false;
+	m_Desc.Counts = GetCounts();
+
+	SchemaSetDefaults(GetGraphicsSchema(), &m_Desc);
+	return InterpretPipelineBlock(GetGraphicsSchema(), &m_Desc);
 }
 
 
@@ -6,7 +6,6 @@
 
 
 class IASTNode;
-class ASTInitializerList;
 
 class GraphicsAST : public ASTBase
 {
@@ -25,4 +24,4 @@ public:
 private:
 
 	FULL_PIPELINE_DESCRIPTOR& m_Desc;
-};
\ No newline at end of file
+};
\ No newline at end of file
@@ -0,0 +1,280 @@
+#include "HLSLKeywords.h"
+#include <stdint.h>
+#include <iterator>
+
+
+typedef struct HLSL_KEYWORD {
+	std::string_view Word;
+	EAST_TOKEN_TYPE Type;
+	// Scalar types can be spelled as a vector or matrix, float -> float3, float3x4
+	bool Scalar;
+} HLSL_KEYWORD;
+
+#define KEYWORD(word) { word, AST_TOKEN_TYPE_HLSL_KEYWORD, false }
+#define SCALAR_TYPE(word) { word, AST_TOKEN_TYPE_BUILTIN_DATATYPE, true }
+#define BUILTIN_TYPE(word) { word, AST_TOKEN_TYPE_BUILTIN_DATATYPE, false }
+#define PARAM_MODIFIER(word) { word, AST_TOKEN_TYPE_PARAM_MODIFIER, false }
+
+static constexpr HLSL_KEYWORD s_Keywords[] = {
+	{ "struct", AST_TOKEN_TYPE_STRUCT_KEYWORD, false },
+
+	PARAM_MODIFIER("in"), PARAM_MODIFIER("out"), PARAM_MODIFIER("inout"),
+
+	BUILTIN_TYPE("void"), BUILTIN_TYPE("matrix"), BUILTIN_TYPE("vector"),
+
+	SCALAR_TYPE("bool"), SCALAR_TYPE("int"), SCALAR_TYPE("uint"), SCALAR_TYPE("dword"),
+	SCALAR_TYPE("half"), SCALAR_TYPE("float"), SCALAR_TYPE("double"),
+	SCALAR_TYPE("min16float"), SCALAR_TYPE("min10float"), SCALAR_TYPE("min16int"),
+	SCALAR_TYPE("min12int"), SCALAR_TYPE("min16uint"),
+	SCALAR_TYPE("int16_t"), SCALAR_TYPE("uint16_t"), SCALAR_TYPE("int32_t"), SCALAR_TYPE("uint32_t"),
+	SCALAR_TYPE("int64_t"), SCALAR_TYPE("uint64_t"),
+	SCALAR_TYPE("float16_t"), SCALAR_TYPE("float32_t"), SCALAR_TYPE("float64_t"),
+
+	KEYWORD("AppendStructuredBuffer"), KEYWORD("asm"), KEYWORD("asm_fragment"), KEYWORD("BlendState"),
+	KEYWORD("break"), KEYWORD("Buffer"), KEYWORD("ByteAddressBuffer"), KEYWORD("case"),
+	KEYWORD("cbuffer"), KEYWORD("centroid"), KEYWORD("class"), KEYWORD("column_major"),
+	KEYWORD("compile"), KEYWORD("compile_fragment"), KEYWORD("CompileShader"), KEYWORD("const"),
+	KEYWORD("continue"), KEYWORD("ComputeShader"), KEYWORD("ConstantBuffer"),
+	KEYWORD("ConsumeStructuredBuffer"), KEYWORD("default"), KEYWORD("DepthStencilState"),
+	KEYWORD("DepthStencilView"), KEYWORD("discard"), KEYWORD("do"), KEYWORD("DomainShader"),
+	KEYWORD("else"), KEYWORD("export"), KEYWORD("extern"), KEYWORD("false"), KEYWORD("for"),
+	KEYWORD("fxgroup"), KEYWORD("GeometryShader"), KEYWORD("groupshared"), KEYWORD("HullShader"),
+	KEYWORD("if"), KEYWORD("inline"), KEYWORD("InputPatch"), KEYWORD("interface"),
+	KEYWORD("line"), KEYWORD("lineadj"), KEYWORD("linear"), KEYWORD("LineStream"),
+	KEYWORD("namespace"), KEYWORD("nointerpolation"), KEYWORD("noperspective"), KEYWORD("NULL"),
+	KEYWORD("OutputPatch"), KEYWORD("packoffset"), KEYWORD("pass"), KEYWORD("pixelfragment"),
+	KEYWORD("PixelShader"), KEYWORD("point"), KEYWORD("PointStream"), KEYWORD("precise"),
+	KEYWORD("RasterizerState"), KEYWORD("RaytracingAccelerationStructure"),
+	KEYWORD("RenderTargetView"), KEYWORD("return"), KEYWORD("register"), KEYWORD("row_major"),
+	KEYWORD("RWBuffer"), KEYWORD("RWByteAddressBuffer"), KEYWORD("RWStructuredBuffer"),
+	KEYWORD("RWTexture1D"), KEYWORD("RWTexture1DArray"), KEYWORD("RWTexture2D"),
+	KEYWORD("RWTexture2DArray"), KEYWORD("RWTexture3D"), KEYWORD("sample"), KEYWORD("sampler"),
+	KEYWORD("SamplerState"), KEYWORD("SamplerComparisonState"), KEYWORD("shared"), KEYWORD("snorm"),
+	KEYWORD("stateblock"), KEYWORD("stateblock_state"), KEYWORD("static"), KEYWORD("string"),
+	KEYWORD("switch"), KEYWORD("StructuredBuffer"), KEYWORD("tbuffer"), KEYWORD("technique"),
+	KEYWORD("technique10"), KEYWORD("technique11"), KEYWORD("texture"), KEYWORD("Texture1D"),
+	KEYWORD("Texture1DArray"), KEYWORD("Texture2D"), KEYWORD("Texture2DArray"),
+	KEYWORD("Texture2DMS"), KEYWORD("Texture2DMSArray"), KEYWORD("Texture3D"),
+	KEYWORD("TextureCube"), KEYWORD("TextureCubeArray"), KEYWORD("true"), KEYWORD("typedef"),
+	KEYWORD("triangle"), KEYWORD("triangleadj"), KEYWORD("TriangleStream"), KEYWORD("uniform"),
+	KEYWORD("unorm"), KEYWORD("unsigned"), KEYWORD("vertexfragment"), KEYWORD("VertexShader"),
+	KEYWORD("volatile"), KEYWORD("while"),
+};
+
+#undef KEYWORD
+#undef SCALAR_TYPE
+#undef BUILTIN_TYPE
+#undef PARAM_MODIFIER
+
+static constexpr uint32_t KEYWORD_COUNT = (uint32_t)std::size(s_Keywords);
+
+// Both powers of two. Keeping the table at least 3x the keyword count
+// means almost every bucket finds a free displacement on its first few tries.
+static constexpr uint32_t KEYWORD_TABLE_SIZE = 512;
+static constexpr uint32_t KEYWORD_BUCKET_COUNT = 64;
+
+static_assert(KEYWORD_COUNT * 3 <= KEYWORD_TABLE_SIZE, "Keyword table is too full, bump KEYWORD_TABLE_SIZE");
+
+static constexpr uint32_t HashWord(std::string_view word, uint32_t seed)
+{
+	uint32_t h = 2166136261u ^ (seed * 0x9E3779B9u);
+	for (char ch : word)
+	{
+		h ^= (uint8_t)ch;
+		h *= 16777619u;
+	}
+	h ^= h >> 15;
+	h *= 0x2C1B3C6Du;
+	h ^= h >> 12;
+	return h;
+}
+
+typedef struct KEYWORD_TABLE {
+	uint16_t Displacement[KEYWORD_BUCKET_COUNT];
+	int16_t Slots[KEYWORD_TABLE_SIZE];
+	uint32_t MaxLength;
+	bool Valid;
+} KEYWORD_TABLE;
+
+/*
+* Hash and displace perfect hashing, built by the compiler.
+* Every keyword is put in a bucket by HashWord(word, 0). Then, biggest
+* bucket first, each bucket searches for a seed that sends all of its
+* keywords to empty slots. A lookup is the bucket hash, then one hash
+* with that bucket's seed, then a single compare against the one
+* keyword that could be in that slot.
+*/
+static constexpr KEYWORD_TABLE BuildKeywordTable()
+{
+	KEYWORD_TABLE table = { };
+	for (uint32_t i = 0; i < KEYWORD_TABLE_SIZE; i++)
+	{
+		table.Slots[i] = -1;
+	}
+
+	uint32_t bucketOf[KEYWORD_COUNT] = { };
+	uint32_t bucketSize[KEYWORD_BUCKET_COUNT] = { };
+	for (uint32_t i = 0; i < KEYWORD_COUNT; i++)
+	{
+		if (s_Keywords[i].Word.size() > table.MaxLength)
+		{
+			table.MaxLength = (uint32_t)s_Keywords[i].Word.size();
+		}
+
+		bucketOf[i] = HashWord(s_Keywords[i].Word, 0) & (KEYWORD_BUCKET_COUNT - 1);
+		bucketSize[bucketOf[i]]++;
+	}
+
+	bool bucketDone[KEYWORD_BUCKET_COUNT] = { };
+	for (uint32_t pass = 0; pass < KEYWORD_BUCKET_COUNT; pass++)
+	{
+		uint32_t bucket = 0;
+		uint32_t largest = 0;
+		bool found = false;
+		for (uint32_t b = 0; b < KEYWORD_BUCKET_COUNT; b++)
+		{
+			if (!bucketDone[b] && (!found || bucketSize[b] > largest))
+			{
+				bucket = b;
+				largest = bucketSize[b];
+				found = true;
+			}
+		}
+		bucketDone[bucket] = true;
+
+		if (largest == 0)
+		{
+			continue;
+		}
+
+		bool placed = false;
+		for (uint32_t seed = 1; seed < 0xffff && !placed; seed++)
+		{
+			uint32_t slots[KEYWORD_COUNT] = { };
+			uint32_t members[KEYWORD_COUNT] = { };
+			uint32_t numSlots = 0;
+			bool fits = true;
+
+			for (uint32_t i = 0; i < KEYWORD_COUNT && fits; i++)
+			{
+				if (bucketOf[i] != bucket)
+				{
+					continue;
+				}
+
+				uint32_t slot = HashWord(s_Keywords[i].Word, seed) & (KEYWORD_TABLE_SIZE - 1);
+				if (table.Slots[slot] != -1)
+				{
+					fits = false;
+				}
+				for (uint32_t j = 0; j < numSlots; j++)
+				{
+					if (slots[j] == slot)
+					{
+						// Duplicates land in the same bucket and collide under every seed
+						if (s_Keywords[members[j]].Word == s_Keywords[i].Word)
+						{
+							return table;
+						}
+						fits = false;
+					}
+				}
+				members[numSlots] = i;
+				slots[numSlots++] = slot;
+			}
+
+			if (!fits)
+			{
+				continue;
+			}
+
+			for (uint32_t j = 0; j < numSlots; j++)
+			{
+				table.Slots[slots[j]] = (int16_t)members[j];
+			}
+			table.Displacement[bucket] = (uint16_t)seed;
+			placed = true;
+		}
+
+		if (!placed)
+		{
+			return table;
+		}
+	}
+
+	table.Valid = true;
+	return table;
+}
+
+static constexpr KEYWORD_TABLE s_KeywordTable = BuildKeywordTable();
+
+static_assert(s_KeywordTable.Valid, "Couldn't build the keyword perfect hash, is there a duplicate keyword?");
+
+static const HLSL_KEYWORD* FindKeyword(std::string_view word)
+{
+	if (word.size() == 0 || word.size() > s_KeywordTable.MaxLength)
+	{
+		return nullptr;
+	}
+
+	uint32_t bucket = HashWord(word, 0) & (KEYWORD_BUCKET_COUNT - 1);
+	uint32_t slot = HashWord(word, s_KeywordTable.Displacement[bucket]) & (KEYWORD_TABLE_SIZE - 1);
+
+	int16_t index = s_KeywordTable.Slots[slot];
+	if (index < 0 || s_Keywords[index].Word != word)
+	{
+		return nullptr;
+	}
+
+	return &s_Keywords[index];
+}
+
+/*
+* Reads the dimensions off the end of a vector or matrix spelling,
+* right to left:
+*   start  -[1-4]->  cols  -x->  sep  -[1-4]->  rows
+* Stopping in cols gives a vector (float3), stopping in rows a matrix (float3x4).
+* @returns: The scalar part of the spelling, or an empty view if there's no suffix
+*/
+static std::string_view StripVectorSuffix(std::string_view word)
+{
+	auto isDim = [](char ch) { return ch >= '1' && ch <= '4'; };
+
+	size_t n = word.size();
+	if (n < 2 || !isDim(word[n - 1]))
+	{
+		return std::string_view();
+	}
+
+	if (n >= 4 && word[n - 2] == 'x' && isDim(word[n - 3]))
+	{
+		return word.substr(0, n - 3);
+	}
+
+	return word.substr(0, n - 1);
+}
+
+EAST_TOKEN_TYPE ClassifyHLSLWord(std::string_view word)
+{
+	if (const HLSL_KEYWORD* keyword = FindKeyword(word))
+	{
+		return keyword->Type;
+	}
+
+	std::string_view scalar = StripVectorSuffix(word);
+	if (scalar.size() != 0)
+	{
+		const HLSL_KEYWORD* keyword = FindKeyword(scalar);
+		if (keyword != nullptr && keyword->Scalar)
+		{
+			return AST_TOKEN_TYPE_BUILTIN_DATATYPE;
+		}
+	}
+
+	return AST_TOKEN_TYPE_GENERAL_IDENTIFIER;
+}
+
+bool IsHLSLKeyword(std::string_view word)
+{
+	return FindKeyword(word) != nullptr;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Lexer.h"
+#include <string_view>
+
+
+/*
+* @brief: Sorts a word from the lexer into one of
+* AST_TOKEN_TYPE_STRUCT_KEYWORD, AST_TOKEN_TYPE_BUILTIN_DATATYPE,
+* AST_TOKEN_TYPE_PARAM_MODIFIER, AST_TOKEN_TYPE_HLSL_KEYWORD or
+* AST_TOKEN_TYPE_GENERAL_IDENTIFIER.
+* One perfect hash probe plus at most one more for vector and matrix
+* spellings like float3x4, never allocates.
+*/
+EAST_TOKEN_TYPE ClassifyHLSLWord(std::string_view word);
+
+/*
+* @returns: true if word is spelled exactly like an HLSL keyword or builtin type name.
+* Vector and matrix spellings like float4 don't count, they aren't reserved.
+*/
+bool IsHLSLKeyword(std::string_view word);
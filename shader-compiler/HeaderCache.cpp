@@ -0,0 +1,175 @@
+#include "HeaderCache.h"
+#include <string.h>
+#include <algorithm>
+
+
+// Headers have no Pipeline block, there's nothing to interpret
+class HeaderAST : public ASTBase
+{
+public:
+
+	bool Interpret() override
+	{
+		return true;
+	}
+};
+
+// Headers being parsed or revalidated on this thread right now, an
+// include cycle would otherwise recurse until the stack runs out
+thread_local static std::vector<std::string> t_Parsing;
+
+static bool IsParsing(const std::string& key)
+{
+	return std::find(t_Parsing.begin(), t_Parsing.end(), key) != t_Parsing.end();
+}
+
+static bool SameHash(const SHADER_CACHE_KEY& a, const SHADER_CACHE_KEY& b)
+{
+	return memcmp(a.Digest, b.Digest, sizeof(a.Digest)) == 0;
+}
+
+void HeaderCache::SetIncludeDir(const std::filesystem::path& dir)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	if (m_IncludeDir != dir)
+	{
+		m_IncludeDir = dir;
+		m_Entries.clear();
+		m_Files.Clear();
+	}
+}
+
+void HeaderCache::BeginBuild()
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	m_Generation++;
+	m_Files.BeginBuild();
+}
+
+bool HeaderCache::ImportsCurrent(const ASTBase& header, IPrintHandler* print)
+{
+	for (const AST_IMPORT& import : header.GetImports())
+	{
+		// Part of a cycle still being worked on, can't tell so parse again
+		if (IsParsing(import.Path.lexically_normal().string()))
+		{
+			return false;
+		}
+		if (Get(import.Path, print) != import.Header)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+std::shared_ptr<const ASTBase> HeaderCache::Get(const std::filesystem::path& path, IPrintHandler* print)
+{
+	const std::string key = path.lexically_normal().string();
+	if (IsParsing(key))
+	{
+		return nullptr;
+	}
+
+	uint32_t generation = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		generation = m_Generation;
+
+		auto findRes = m_Entries.find(key);
+		if (findRes != m_Entries.end() && findRes->second.Generation == generation)
+		{
+			m_Hits++;
+			return findRes->second.Header;
+		}
+	}
+
+	FILE_SNAPSHOT file = { };
+	bool read = false;
+	if (!m_Files.Get(path, file, read))
+	{
+		return nullptr;
+	}
+
+	std::shared_ptr<const ASTBase> cached;
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		auto findRes = m_Entries.find(key);
+		if (findRes != m_Entries.end() && SameHash(findRes->second.Hash, file.Hash))
+		{
+			cached = findRes->second.Header;
+		}
+	}
+
+	// The header itself can be the same while something it includes changed.
+	// Another thread may have cached both sides of a cycle, so this one is
+	// marked as in progress while its includes are checked too.
+	bool current = false;
+	if (cached)
+	{
+		t_Parsing.push_back(key);
+		current = ImportsCurrent(*cached, print);
+		t_Parsing.pop_back();
+	}
+
+	if (current)
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		m_Entries[key].Generation = generation;
+		m_Hits++;
+		return cached;
+	}
+
+	// Parsed without holding the lock so nested includes can come back in here.
+	// If two threads parse it at once the last one is kept, both parsed the same.
+	std::shared_ptr<HeaderAST> header = std::make_shared<HeaderAST>();
+	header->SetPrintHandler(print);
+	header->SetHeaderCache(this);
+
+	t_Parsing.push_back(key);
+	header->LoadSource(file.Contents);
+	t_Parsing.pop_back();
+
+	std::lock_guard<std::mutex> lock(m_Lock);
+	HEADER_ENTRY& entry = m_Entries[key];
+	entry.Hash = file.Hash;
+	entry.Generation = generation;
+	entry.Header = header;
+	m_Parsed++;
+
+	return header;
+}
+
+bool HeaderCache::GetContentHash(const std::filesystem::path& path, SHADER_CACHE_KEY& outHash)
+{
+	FILE_SNAPSHOT file = { };
+	bool read = false;
+	if (!m_Files.Get(path, file, read))
+	{
+		return false;
+	}
+
+	outHash = file.Hash;
+	return true;
+}
+
+void HeaderCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	m_Entries.clear();
+	m_Files.Clear();
+}
+
+void HeaderCache::GetStats(uint32_t& outHits, uint32_t& outParsed) const
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	outHits = m_Hits;
+	outParsed = m_Parsed;
+}
+
+void HeaderCache::ResetStats()
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	m_Hits = 0;
+	m_Parsed = 0;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "AST.h"
+#include "FileCache.h"
+#include <mutex>
+#include <memory>
+#include <filesystem>
+#include <unordered_map>
+
+
+/*
+* Build wide store of parsed headers, shared by every pipeline's AST.
+* A header is lexed and parsed the first time something includes it,
+* after that every AST that includes it imports the structs and
+* functions straight from the cached one.
+* Files are checked against the disk through a FileCache, a header
+* is only parsed again when its content or something it includes changed,
+* so watch mode keeps everything that's still the same across rebuilds.
+* Safe to use from any thread.
+*/
+class HeaderCache
+{
+public:
+
+	HeaderCache() = default;
+
+	HeaderCache(const HeaderCache&) = delete;
+	HeaderCache& operator=(const HeaderCache&) = delete;
+
+	/*
+	* @brief: #include paths are relative to this, same as the include handler DXC gets
+	*/
+	void SetIncludeDir(const std::filesystem::path& dir);
+
+	inline const std::filesystem::path& GetIncludeDir() const
+	{
+		return m_IncludeDir;
+	}
+
+	/*
+	* @returns: The parsed header, or nullptr if it can't be read or is
+	* already being parsed further up this thread's include chain
+	*/
+	std::shared_ptr<const ASTBase> Get(const std::filesystem::path& path, IPrintHandler* print);
+
+	/*
+	* @brief: Hash of the header's content, without parsing it.
+	* Checked against the disk at most once per build like Get.
+	* @returns: false if it can't be read
+	*/
+	bool GetContentHash(const std::filesystem::path& path, SHADER_CACHE_KEY& outHash);
+
+	/*
+	* @brief: Starts a new build, every entry gets checked against
+	* the disk once more the next time it's asked for
+	*/
+	void BeginBuild();
+
+	void Clear();
+
+	/*
+	* @brief: How many Gets were served from the cache and how many had to parse
+	*/
+	void GetStats(uint32_t& outHits, uint32_t& outParsed) const;
+
+	void ResetStats();
+
+private:
+
+	typedef struct HEADER_ENTRY {
+		// Of the content Header was parsed from
+		SHADER_CACHE_KEY Hash;
+		// Build Header was last checked against the file and its includes in
+		uint32_t Generation;
+		std::shared_ptr<const ASTBase> Header;
+	} HEADER_ENTRY;
+
+	/*
+	* @returns: false if anything header included was reparsed since header was
+	*/
+	bool ImportsCurrent(const ASTBase& header, IPrintHandler* print);
+
+	std::filesystem::path m_IncludeDir;
+
+	mutable std::mutex m_Lock;
+	std::unordered_map<std::string, HEADER_ENTRY> m_Entries;
+
+	FileCache m_Files;
+
+	uint32_t m_Generation = 1;
+	uint32_t m_Hits = 0;
+	uint32_t m_Parsed = 0;
+};
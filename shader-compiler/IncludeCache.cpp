@@ -0,0 +1,285 @@
+#include "IncludeCache.h"
+#include <vector>
+#include <string.h>
+
+#define failed(x) ((x) < 0)
+
+
+// Comments and string literals blanked out, newlines kept so lines still line up
+static std::string StripComments(const std::string& text)
+{
+	std::string out;
+	out.reserve(text.size());
+
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		if (text[i] == '/' && i + 1 < text.size() && text[i + 1] == '/')
+		{
+			while (i < text.size() && text[i] != '\n')
+			{
+				i++;
+			}
+			out += '\n';
+		}
+		else if (text[i] == '/' && i + 1 < text.size() && text[i + 1] == '*')
+		{
+			for (i += 2; i < text.size() && !(text[i] == '*' && i + 1 < text.size() && text[i + 1] == '/'); i++)
+			{
+				if (text[i] == '\n')
+				{
+					out += '\n';
+				}
+			}
+			i++;
+			out += ' ';
+		}
+		else if (text[i] == '"')
+		{
+			for (i++; i < text.size() && text[i] != '"' && text[i] != '\n'; i++)
+			{
+				if (text[i] == '\\')
+				{
+					i++;
+				}
+			}
+			out += "\"\"";
+		}
+		else
+		{
+			out += text[i];
+		}
+	}
+	return out;
+}
+
+// "#  ifndef  FOO" gives "ifndef" and "FOO"
+static void SplitDirective(const std::string& line, std::string& outName, std::string& outRest)
+{
+	size_t pos = line.find_first_not_of(" \t\r", 1);
+	size_t end = line.find_first_of(" \t\r(!", pos);
+	outName = pos == std::string::npos ? std::string() : line.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+
+	outRest.clear();
+	if (end != std::string::npos)
+	{
+		size_t restPos = line.find_first_not_of(" \t\r", end);
+		size_t restEnd = line.find_last_not_of(" \t\r");
+		if (restPos != std::string::npos)
+		{
+			outRest = line.substr(restPos, restEnd - restPos + 1);
+		}
+	}
+}
+
+/*
+* @returns: true if the text has #pragma once outside any #if.
+* An #ifndef guard doesn't count, the includer may have #undef'd the macro since.
+*/
+static bool IsIncludeOnce(const std::string& text)
+{
+	const std::string stripped = StripComments(text);
+
+	std::vector<std::string> lines;
+	size_t start = 0;
+	while (start <= stripped.size())
+	{
+		size_t end = stripped.find('\n', start);
+		if (end == std::string::npos)
+		{
+			end = stripped.size();
+		}
+
+		std::string line = stripped.substr(start, end - start);
+		const size_t first = line.find_first_not_of(" \t\r");
+		if (first != std::string::npos)
+		{
+			lines.push_back(line.substr(first));
+		}
+		start = end + 1;
+	}
+
+	std::string name;
+	std::string rest;
+
+	int32_t depth = 0;
+	for (const std::string& line : lines)
+	{
+		if (line[0] != '#')
+		{
+			continue;
+		}
+
+		SplitDirective(line, name, rest);
+		if (name == "if" || name == "ifdef" || name == "ifndef")
+		{
+			depth++;
+		}
+		else if (name == "endif")
+		{
+			depth--;
+		}
+		else if (name == "pragma" && rest == "once" && depth == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool IncludeCache::Initialize()
+{
+	if (failed(DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&m_Utils))))
+	{
+		return false;
+	}
+
+	// Not zero sized, a blob is allowed to be a null pointer then
+	return CreateBlob("\n", m_EmptyBlob);
+}
+
+void IncludeCache::BeginBuild()
+{
+	m_Files.BeginBuild();
+}
+
+bool IncludeCache::CreateBlob(const std::string& contents, ComPtr<IDxcBlobEncoding>& outBlob)
+{
+	return !failed(m_Utils->CreateBlob(contents.data(), (UINT32)contents.size(), DXC_CP_UTF8, &outBlob));
+}
+
+bool IncludeCache::SetVirtualFile(const std::filesystem::path& path, const std::string& contents)
+{
+	ComPtr<IDxcBlobEncoding> blob;
+	if (!CreateBlob(contents, blob))
+	{
+		return false;
+	}
+
+	ShaderCacheHasher hasher;
+	hasher.Update(contents.data(), contents.size());
+
+	std::lock_guard<std::mutex> lock(m_Lock);
+	INCLUDE_ENTRY& entry = m_Entries[path.lexically_normal().string()];
+	entry.Hash = hasher.Finalize();
+	entry.bVirtual = true;
+	entry.bIncludeOnce = IsIncludeOnce(contents);
+	entry.Blob = blob;
+	return true;
+}
+
+void IncludeCache::RemoveVirtualFile(const std::filesystem::path& path)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	auto findRes = m_Entries.find(path.lexically_normal().string());
+	if (findRes != m_Entries.end() && findRes->second.bVirtual)
+	{
+		m_Entries.erase(findRes);
+	}
+}
+
+void IncludeCache::SetVirtualOnly(bool virtualOnly)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	m_VirtualOnly = virtualOnly;
+}
+
+bool IncludeCache::Load(const std::filesystem::path& path, IDxcBlob** outBlob, bool& outIncludeOnce, FILE_STAMP& outStamp)
+{
+	const std::string key = path.lexically_normal().string();
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		auto findRes = m_Entries.find(key);
+		if (findRes != m_Entries.end() && findRes->second.bVirtual)
+		{
+			m_Hits++;
+			outStamp = { path.lexically_normal(), findRes->second.Blob->GetBufferSize(), 0, findRes->second.Hash };
+			outIncludeOnce = findRes->second.bIncludeOnce;
+			*outBlob = findRes->second.Blob.Ptr;
+			(*outBlob)->AddRef();
+			return true;
+		}
+
+		if (m_VirtualOnly)
+		{
+			return false;
+		}
+	}
+
+	// DXC asks for every include directory an include could be in,
+	// most of those don't exist and that's not an error
+	FILE_SNAPSHOT file = { };
+	bool read = false;
+	if (!m_Files.Get(path, file, read))
+	{
+		return false;
+	}
+	outStamp = MakeFileStamp(path, file);
+
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		if (read)
+		{
+			m_Reads++;
+		}
+		else
+		{
+			m_Hits++;
+		}
+
+		auto findRes = m_Entries.find(key);
+		if (findRes != m_Entries.end() && memcmp(findRes->second.Hash.Digest, file.Hash.Digest, sizeof(file.Hash.Digest)) == 0)
+		{
+			outIncludeOnce = findRes->second.bIncludeOnce;
+			*outBlob = findRes->second.Blob.Ptr;
+			(*outBlob)->AddRef();
+			return true;
+		}
+	}
+
+	// Made without the lock, if two workers get here for
+	// the same content either blob is as good as the other
+	ComPtr<IDxcBlobEncoding> blob;
+	if (!CreateBlob(*file.Contents, blob))
+	{
+		return false;
+	}
+	const bool includeOnce = IsIncludeOnce(*file.Contents);
+
+	std::lock_guard<std::mutex> lock(m_Lock);
+	INCLUDE_ENTRY& entry = m_Entries[key];
+	// SetVirtualFile may have run since the check above, the
+	// virtual file wins for every load after this one
+	if (!entry.bVirtual)
+	{
+		entry.Hash = file.Hash;
+		entry.bVirtual = false;
+		entry.bIncludeOnce = includeOnce;
+		entry.Blob = blob;
+	}
+
+	outIncludeOnce = includeOnce;
+	*outBlob = blob.Ptr;
+	(*outBlob)->AddRef();
+	return true;
+}
+
+void IncludeCache::GetEmptyBlob(IDxcBlob** outBlob)
+{
+	*outBlob = m_EmptyBlob.Ptr;
+	(*outBlob)->AddRef();
+}
+
+void IncludeCache::GetStats(uint32_t& outHits, uint32_t& outReads) const
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	outHits = m_Hits;
+	outReads = m_Reads;
+}
+
+void IncludeCache::ResetStats()
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	m_Hits = 0;
+	m_Reads = 0;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <filesystem>
+#include <unordered_map>
+#include <stdint.h>
+#include "ComPtr.h"
+#include "FileCache.h"
+#include <d3dcommon.h>
+#include <dxc/dxcapi.h>
+
+
+/*
+* Build wide store of the files DXC includes, as the blobs handed to it.
+* An include is read from disk the first time any compile asks for it,
+* after that every compile on every worker gets the same blob.
+* Files are checked against the disk through a FileCache, a blob
+* is only made again when the content changed.
+* Files can also be put in memory by hand, those never touch the disk.
+* Safe to use from any thread.
+*/
+class IncludeCache
+{
+public:
+
+	IncludeCache() = default;
+
+	IncludeCache(const IncludeCache&) = delete;
+	IncludeCache& operator=(const IncludeCache&) = delete;
+
+	bool Initialize();
+
+	/*
+	* @brief: Starts a new build, every file on disk gets checked
+	* once more the next time it's asked for
+	*/
+	void BeginBuild();
+
+	inline uint32_t GetGeneration() const
+	{
+		return m_Files.GetGeneration();
+	}
+
+	/*
+	* @brief: Serves path from contents until it's removed, whatever is on disk.
+	* For running as a compile server with the sources already in memory.
+	*/
+	bool SetVirtualFile(const std::filesystem::path& path, const std::string& contents);
+
+	void RemoveVirtualFile(const std::filesystem::path& path);
+
+	/*
+	* @brief: Fail every include that isn't a virtual file, the disk is never read
+	*/
+	void SetVirtualOnly(bool virtualOnly);
+
+	/*
+	* @param outIncludeOnce: The file has #pragma once,
+	* including it again in the same compile does nothing
+	* @param outStamp: The file as of outBlob, a virtual file's write time is 0
+	* @returns: false if it can't be read. outBlob is AddRef'd for the caller.
+	*/
+	bool Load(const std::filesystem::path& path, IDxcBlob** outBlob, bool& outIncludeOnce, FILE_STAMP& outStamp);
+
+	/*
+	* @brief: What a file that was already included once is included as again
+	*/
+	void GetEmptyBlob(IDxcBlob** outBlob);
+
+	/*
+	* @brief: How many loads were served from memory and how many had to read the disk
+	*/
+	void GetStats(uint32_t& outHits, uint32_t& outReads) const;
+
+	void ResetStats();
+
+private:
+
+	typedef struct INCLUDE_ENTRY {
+		// Of the content Blob was made from
+		SHADER_CACHE_KEY Hash;
+		bool bVirtual;
+		bool bIncludeOnce;
+		ComPtr<IDxcBlobEncoding> Blob;
+	} INCLUDE_ENTRY;
+
+	bool CreateBlob(const std::string& contents, ComPtr<IDxcBlobEncoding>& outBlob);
+
+	// Only creates blobs, which DXC is fine with from any thread
+	ComPtr<IDxcUtils> m_Utils;
+	ComPtr<IDxcBlobEncoding> m_EmptyBlob;
+
+	mutable std::mutex m_Lock;
+	std::unordered_map<std::string, INCLUDE_ENTRY> m_Entries;
+
+	FileCache m_Files;
+
+	bool m_VirtualOnly = false;
+	uint32_t m_Hits = 0;
+	uint32_t m_Reads = 0;
+};
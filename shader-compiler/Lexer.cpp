@@ -0,0 +1,286 @@
+#include "Lexer.h"
+#include <algorithm>
+#include <string.h>
+
+
+typedef enum ELEX_CHAR_CLASS {
+	LEX_CHAR_WORD = 0,
+	LEX_CHAR_SPACE,
+	LEX_CHAR_NEWLINE,
+	LEX_CHAR_SLASH,
+	LEX_CHAR_PUNCT
+} ELEX_CHAR_CLASS;
+
+typedef struct LEX_CHAR_INFO {
+	uint8_t Class;
+	uint8_t Kind;
+} LEX_CHAR_INFO;
+
+/*
+* One lookup per byte decides whether it ends the current word.
+* Anything that isn't whitespace or punctuation is part of a word,
+* that matches the old whitespace split, so numbers like 1.0f and
+* member access like a.b stay in one token.
+*/
+static constexpr auto BuildCharTable()
+{
+	struct {
+		LEX_CHAR_INFO Info[256];
+	} table = { };
+
+	auto set = [&](char ch, ELEX_CHAR_CLASS cls, EAST_TOKEN_TYPE kind) {
+		table.Info[(uint8_t)ch] = { (uint8_t)cls, (uint8_t)kind };
+	};
+
+	set(' ', LEX_CHAR_SPACE, AST_TOKEN_TYPE_NONE);
+	set('\t', LEX_CHAR_SPACE, AST_TOKEN_TYPE_NONE);
+	set('\r', LEX_CHAR_SPACE, AST_TOKEN_TYPE_NONE);
+	set('\v', LEX_CHAR_SPACE, AST_TOKEN_TYPE_NONE);
+	set('\f', LEX_CHAR_SPACE, AST_TOKEN_TYPE_NONE);
+	set('\n', LEX_CHAR_NEWLINE, AST_TOKEN_TYPE_NONE);
+	set('/', LEX_CHAR_SLASH, AST_TOKEN_TYPE_MATH_OPERATION);
+
+	set('(', LEX_CHAR_PUNCT, AST_TOKEN_TYPE_LEFT_PARENTHESIS);
+	set(')', LEX_CHAR_PUNCT, AST_TOKEN_TYPE_RIGHT_PARENTHESIS);
+	set('{', LEX_CHAR_PUNCT, AST_TOKEN_TYPE_LEFT_CURLY);
+	set('}', LEX_CHAR_PUNCT, AST_TOKEN_TYPE_RIGHT_CURLY);
+	set('<', LEX_CHAR_PUNCT, AST_TOKEN_TYPE_LEFT_GATOR);
+	set('>', LEX_CHAR_PUNCT, AST_TOKEN_TYPE_RIGHT_GATOR);
+	set('[', LEX_CHAR_PUNCT, AST_TOKEN_TYPE_LEFT_SQUARE);
+	set(']', LEX_CHAR_PUNCT, AST_TOKEN_TYPE_RIGHT_SQUARE);
+	set('"', LEX_CHAR_PUNCT, AST_TOKEN_TYPE_DOUBLE_QUOTE);
+	set('\'', LEX_CHAR_PUNCT, AST_TOKEN_TYPE_SINGLE_QUOTE);
+	set(':', LEX_CHAR_PUNCT, AST_TOKEN_TYPE_COLON);
+	set(';', LEX_CHAR_PUNCT, AST_TOKEN_TYPE_SEMICOLON);
+	set(',', LEX_CHAR_PUNCT, AST_TOKEN_TYPE_COMMA);
+	set('=', LEX_CHAR_PUNCT, AST_TOKEN_TYPE_EQUALS);
+	set('*', LEX_CHAR_PUNCT, AST_TOKEN_TYPE_MATH_OPERATION);
+	set('+', LEX_CHAR_PUNCT, AST_TOKEN_TYPE_MATH_OPERATION);
+	set('-', LEX_CHAR_PUNCT, AST_TOKEN_TYPE_MATH_OPERATION);
+	set('%', LEX_CHAR_PUNCT, AST_TOKEN_TYPE_MATH_OPERATION);
+	set('&', LEX_CHAR_PUNCT, AST_TOKEN_TYPE_MATH_OPERATION);
+	set('!', LEX_CHAR_PUNCT, AST_TOKEN_TYPE_MATH_OPERATION);
+
+	return table;
+}
+
+static constexpr auto s_CharTable = BuildCharTable();
+
+void Lexer::Push(EAST_TOKEN_TYPE kind, size_t offset, size_t length)
+{
+	m_Kinds.push_back((uint8_t)kind);
+	m_Offsets.push_back((uint32_t)offset);
+	m_Lengths.push_back((uint32_t)length);
+}
+
+void Lexer::Lex(std::string_view source)
+{
+	m_Source = source;
+	m_Kinds.clear();
+	m_Offsets.clear();
+	m_Lengths.clear();
+	m_LineStarts.clear();
+
+	// Even dense shaders come in under one token per 3 bytes, reserving
+	// up front means the arrays never grow while lexing
+	size_t estimate = source.size() / 3 + 16;
+	m_Kinds.reserve(estimate);
+	m_Offsets.reserve(estimate);
+	m_Lengths.reserve(estimate);
+	m_LineStarts.reserve(source.size() / 24 + 16);
+	m_LineStarts.push_back(0);
+
+	const char* data = source.data();
+	const size_t size = source.size();
+
+	size_t i = 0;
+	while (i < size)
+	{
+		const LEX_CHAR_INFO info = s_CharTable.Info[(uint8_t)data[i]];
+
+		switch (info.Class)
+		{
+		case LEX_CHAR_WORD:
+		{
+			// Words are most of the file, eat the whole thing in one go
+			const size_t start = i;
+			do
+			{
+				i++;
+			} while (i < size && s_CharTable.Info[(uint8_t)data[i]].Class == LEX_CHAR_WORD);
+			Push(AST_TOKEN_TYPE_UNKNOWN, start, i - start);
+		} break;
+		case LEX_CHAR_SPACE:
+			i++;
+			break;
+		case LEX_CHAR_NEWLINE:
+			i++;
+			m_LineStarts.push_back((uint32_t)i);
+			break;
+		case LEX_CHAR_SLASH:
+			if (i + 1 < size && data[i + 1] == '/')
+			{
+				// Leave the newline for the next iteration so it lands in the index
+				const void* nl = memchr(data + i, '\n', size - i);
+				i = nl ? (size_t)((const char*)nl - data) : size;
+			}
+			else if (i + 1 < size && data[i + 1] == '*')
+			{
+				i += 2;
+				while (i < size && !(data[i] == '*' && i + 1 < size && data[i + 1] == '/'))
+				{
+					if (data[i] == '\n')
+					{
+						m_LineStarts.push_back((uint32_t)(i + 1));
+					}
+					i++;
+				}
+				i = std::min(i + 2, size);
+			}
+			else
+			{
+				Push(AST_TOKEN_TYPE_MATH_OPERATION, i, 1);
+				i++;
+			}
+			break;
+		default:
+		{
+			EAST_TOKEN_TYPE kind = (EAST_TOKEN_TYPE)info.Kind;
+			size_t length = 1;
+			const char next = i + 1 < size ? data[i + 1] : 0;
+
+			if (kind == AST_TOKEN_TYPE_LEFT_SQUARE && next == '[')
+			{
+				kind = AST_TOKEN_TYPE_DOUBLE_LEFT_SQUARE;
+				length = 2;
+			}
+			else if (kind == AST_TOKEN_TYPE_RIGHT_SQUARE && next == ']')
+			{
+				kind = AST_TOKEN_TYPE_DOUBLE_RIGHT_SQUARE;
+				length = 2;
+			}
+			else if (kind == AST_TOKEN_TYPE_COLON && next == ':')
+			{
+				kind = AST_TOKEN_TYPE_DOUBLE_COLON;
+				length = 2;
+			}
+			else if (kind == AST_TOKEN_TYPE_EQUALS && next == '=')
+			{
+				// Comparison, not an assignment
+				kind = AST_TOKEN_TYPE_MATH_OPERATION;
+				length = 2;
+			}
+
+			Push(kind, i, length);
+			i += length;
+		} break;
+		}
+	}
+
+	BuildDelimiterIndex();
+}
+
+static inline EAST_TOKEN_TYPE GetClosingKind(EAST_TOKEN_TYPE open)
+{
+	switch (open)
+	{
+	case AST_TOKEN_TYPE_LEFT_CURLY: return AST_TOKEN_TYPE_RIGHT_CURLY;
+	case AST_TOKEN_TYPE_LEFT_PARENTHESIS: return AST_TOKEN_TYPE_RIGHT_PARENTHESIS;
+	case AST_TOKEN_TYPE_LEFT_SQUARE: return AST_TOKEN_TYPE_RIGHT_SQUARE;
+	case AST_TOKEN_TYPE_DOUBLE_LEFT_SQUARE: return AST_TOKEN_TYPE_DOUBLE_RIGHT_SQUARE;
+	default: return AST_TOKEN_TYPE_NONE;
+	}
+}
+
+void Lexer::BuildDelimiterIndex()
+{
+	const uint32_t count = (uint32_t)m_Kinds.size();
+	m_Matches.assign(count, LEXER_NO_MATCH);
+	m_NextSemicolon.resize(count);
+	m_OpenStack.clear();
+
+	uint32_t waitingForSemicolon = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const EAST_TOKEN_TYPE kind = (EAST_TOKEN_TYPE)m_Kinds[i];
+		switch (kind)
+		{
+		case AST_TOKEN_TYPE_SEMICOLON:
+			for (; waitingForSemicolon <= i; waitingForSemicolon++)
+			{
+				m_NextSemicolon[waitingForSemicolon] = i;
+			}
+			break;
+		case AST_TOKEN_TYPE_LEFT_CURLY:
+		case AST_TOKEN_TYPE_LEFT_PARENTHESIS:
+		case AST_TOKEN_TYPE_LEFT_SQUARE:
+		case AST_TOKEN_TYPE_DOUBLE_LEFT_SQUARE:
+			m_OpenStack.push_back(i);
+			break;
+		case AST_TOKEN_TYPE_RIGHT_CURLY:
+		case AST_TOKEN_TYPE_RIGHT_PARENTHESIS:
+		case AST_TOKEN_TYPE_RIGHT_SQUARE:
+		case AST_TOKEN_TYPE_DOUBLE_RIGHT_SQUARE:
+		{
+			// ']]' is lexed as one token, but closing a '[' it's two of them, Tex[Idx[0]].
+			// Both openers point at it, it points back at the outer one.
+			if (kind == AST_TOKEN_TYPE_DOUBLE_RIGHT_SQUARE && !m_OpenStack.empty() &&
+				m_Kinds[m_OpenStack.back()] == AST_TOKEN_TYPE_LEFT_SQUARE)
+			{
+				uint32_t open = m_OpenStack.back();
+				m_OpenStack.pop_back();
+				m_Matches[open] = i;
+
+				if (!m_OpenStack.empty() && m_Kinds[m_OpenStack.back()] == AST_TOKEN_TYPE_LEFT_SQUARE)
+				{
+					open = m_OpenStack.back();
+					m_OpenStack.pop_back();
+					m_Matches[open] = i;
+				}
+				m_Matches[i] = open;
+				break;
+			}
+
+			// Unwind to the closest opener of the same kind, whatever was left open
+			// inside it stays unmatched. A closer with no opener at all is a stray
+			// and doesn't disturb the openers around it.
+			size_t depth = m_OpenStack.size();
+			while (depth > 0 && GetClosingKind((EAST_TOKEN_TYPE)m_Kinds[m_OpenStack[depth - 1]]) != kind)
+			{
+				depth--;
+			}
+			if (depth == 0)
+			{
+				break;
+			}
+
+			const uint32_t open = m_OpenStack[depth - 1];
+			m_OpenStack.resize(depth - 1);
+			m_Matches[open] = i;
+			m_Matches[i] = open;
+		} break;
+		default:
+			break;
+		}
+	}
+
+	for (; waitingForSemicolon < count; waitingForSemicolon++)
+	{
+		m_NextSemicolon[waitingForSemicolon] = count;
+	}
+}
+
+uint32_t Lexer::GetLineOfOffset(uint32_t offset) const
+{
+	auto it = std::upper_bound(m_LineStarts.begin(), m_LineStarts.end(), offset);
+	return (uint32_t)(it - m_LineStarts.begin());
+}
+
+uint32_t Lexer::GetLineStart(uint32_t line) const
+{
+	if (line == 0 || line > m_LineStarts.size())
+	{
+		return (uint32_t)m_Source.size();
+	}
+	return m_LineStarts[line - 1];
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <stdint.h>
+#include <string_view>
+#include <vector>
+
+
+typedef enum EAST_TOKEN_TYPE {
+	AST_TOKEN_TYPE_NONE = 0,
+
+	// General syntax stuff
+	AST_TOKEN_TYPE_LEFT_CURLY,
+	AST_TOKEN_TYPE_RIGHT_CURLY,
+	AST_TOKEN_TYPE_LEFT_PARENTHESIS,
+	AST_TOKEN_TYPE_RIGHT_PARENTHESIS,
+	AST_TOKEN_TYPE_LEFT_GATOR,
+	AST_TOKEN_TYPE_RIGHT_GATOR,
+	AST_TOKEN_TYPE_COMMA,
+	AST_TOKEN_TYPE_COLON,
+	AST_TOKEN_TYPE_DOUBLE_COLON,
+	AST_TOKEN_TYPE_EQUALS,
+	AST_TOKEN_TYPE_SEMICOLON,
+	AST_TOKEN_TYPE_LEFT_SQUARE,
+	AST_TOKEN_TYPE_RIGHT_SQUARE,
+	AST_TOKEN_TYPE_DOUBLE_LEFT_SQUARE,
+	AST_TOKEN_TYPE_DOUBLE_RIGHT_SQUARE,
+	AST_TOKEN_TYPE_SINGLE_QUOTE,
+	AST_TOKEN_TYPE_DOUBLE_QUOTE,
+
+	// Catch all for math stuff, we don't care about this
+	AST_TOKEN_TYPE_MATH_OPERATION,
+
+	// Different keyword types
+	AST_TOKEN_TYPE_PARAM_MODIFIER,
+	AST_TOKEN_TYPE_BUILTIN_DATATYPE,
+	AST_TOKEN_TYPE_STRUCT_KEYWORD,
+	AST_TOKEN_TYPE_HLSL_KEYWORD,
+
+	// Catch all for when we think we're looking at an identifier
+	AST_TOKEN_TYPE_GENERAL_IDENTIFIER,
+
+	// Special marker that this node needs a second pass
+	AST_TOKEN_TYPE_UNKNOWN
+} EAST_TOKEN_TYPE;
+
+#define LEXER_NO_MATCH ((uint32_t)0xffffffff)
+
+/*
+* Splits a source buffer into tokens in a single pass.
+* Tokens are never copied, each one is an offset and length into the
+* source, and everything is stored as parallel arrays so the parser
+* only touches the bytes it actually looks at.
+* Comments are skipped as they're found, so there's no comment free
+* copy of the file either.
+*
+* Words come out as AST_TOKEN_TYPE_UNKNOWN, sorting out keywords
+* from identifiers is left to the parser.
+*
+* The source has to outlive the lexer.
+*/
+class Lexer
+{
+public:
+
+	/*
+	* @brief: Tokenizes source, throwing away whatever was lexed before
+	*/
+	void Lex(std::string_view source);
+
+	inline size_t Count() const
+	{
+		return m_Kinds.size();
+	}
+
+	inline EAST_TOKEN_TYPE GetKind(size_t token) const
+	{
+		return (EAST_TOKEN_TYPE)m_Kinds[token];
+	}
+
+	/*
+	* @brief: Lets the parser store what a word turned out to be
+	*/
+	inline void SetKind(size_t token, EAST_TOKEN_TYPE kind)
+	{
+		m_Kinds[token] = (uint8_t)kind;
+	}
+
+	inline uint32_t GetOffset(size_t token) const
+	{
+		return m_Offsets[token];
+	}
+
+	inline std::string_view GetText(size_t token) const
+	{
+		return m_Source.substr(m_Offsets[token], m_Lengths[token]);
+	}
+
+	/*
+	* @returns: 1 based line the token starts on
+	*/
+	inline uint32_t GetLine(size_t token) const
+	{
+		return GetLineOfOffset(m_Offsets[token]);
+	}
+
+	/*
+	* @returns: 1 based line of a byte offset into the source.
+	* Binary search over the newline index.
+	*/
+	uint32_t GetLineOfOffset(uint32_t offset) const;
+
+	/*
+	* @returns: Offset of the first byte of a 1 based line,
+	* or the size of the source if line is past the end
+	*/
+	uint32_t GetLineStart(uint32_t line) const;
+
+	inline uint32_t GetLineCount() const
+	{
+		return (uint32_t)m_LineStarts.size();
+	}
+
+	inline std::string_view GetSource() const
+	{
+		return m_Source;
+	}
+
+	/*
+	* @returns: For '{', '(', '[' and '[[' the index of their closing token and
+	* the other way around. LEXER_NO_MATCH for anything else or an unbalanced delimiter.
+	*/
+	inline uint32_t GetMatch(size_t token) const
+	{
+		return m_Matches[token];
+	}
+
+	/*
+	* @returns: Index of the first ';' at or after token, Count() if there isn't one
+	*/
+	inline uint32_t GetNextSemicolon(size_t token) const
+	{
+		return m_NextSemicolon[token];
+	}
+
+private:
+
+	void Push(EAST_TOKEN_TYPE kind, size_t offset, size_t length);
+
+	/*
+	* @brief: Fills m_Matches and m_NextSemicolon in one walk over m_Kinds
+	*/
+	void BuildDelimiterIndex();
+
+	std::string_view m_Source;
+
+	std::vector<uint8_t> m_Kinds;
+	std::vector<uint32_t> m_Offsets;
+	std::vector<uint32_t> m_Lengths;
+
+	// Offset of the first byte of every line, m_LineStarts[0] is always 0
+	std::vector<uint32_t> m_LineStarts;
+
+	// One entry per token, see GetMatch and GetNextSemicolon
+	std::vector<uint32_t> m_Matches;
+	std::vector<uint32_t> m_NextSemicolon;
+
+	// Open delimiters while building m_Matches, kept to reuse its memory
+	std::vector<uint32_t> m_OpenStack;
+};
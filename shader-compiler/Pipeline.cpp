@@ -1,35 +1,57 @@
 #include "Pipeline.h"
+#include "PipelineSchema.h"
 #include <iostream>
 #include "Utils.h"
 
 
 
-GFX_RASTER_DESC CreateDefaultGFXRasterDesc()
+FULL_PIPELINE_DESCRIPTOR CreateDefaultDescriptor()
 {
-	GFX_RASTER_DESC Result = { };
-	Result.bFillSolid = true;
-	Result.bCull = true;
-	Result.bIsCounterClockwiseForward = false;
-	Result.bDepthClipEnable = true;
-	Result.bAntialiasedLineEnabled = false;
-	Result.bMultisampleEnable = false;
-	Result.DepthBiasClamp = 0.0f;
-	Result.SlopeScaledDepthBias = 0.0f;
+	FULL_PIPELINE_DESCRIPTOR Result = { };
+	SchemaSetDefaults(GetGraphicsSchema(), &Result);
 	return Result;
 }
 
 
-FULL_PIPELINE_DESCRIPTOR CreateDefaultDescriptor()
+// Key names and value strings come from the schema, the loader parses them
+// back with the matching Parse* functions in d3d-shader-loader-types.cpp
+
+static void CountsToJson(const PIPELINE_RESOURCE_COUNTERS& counts, nlohmann::json& outJson)
 {
-	FULL_PIPELINE_DESCRIPTOR Result = { };
-	Result.PolygonType = POLYGON_TYPE_TRIANGLES;
-	Result.RasterDesc = CreateDefaultGFXRasterDesc();
-	Result.bEnableAlphaToCoverage = false;
-	Result.bIndependentBlendEnable = false;
-	Result.NumRenderTargets = 1;
-	for (uint32_t i = 0; i < 8; i++)
+	outJson["NumConstantBuffers"] = (uint32_t)counts.NumConstantBuffers;
+	outJson["NumShaderResourceViews"] = (uint32_t)counts.NumShaderResourceViews;
+	outJson["NumUnorderedAccessViews"] = (uint32_t)counts.NumUnorderedAccessViews;
+	outJson["NumSamplers"] = (uint32_t)counts.NumSamplers;
+}
+
+void GraphicsPipelineToJson(const FULL_PIPELINE_DESCRIPTOR& desc, nlohmann::json& outJson)
+{
+	outJson["Type"] = "Graphics";
+	CountsToJson(desc.Counts, outJson);
+	SchemaToJson(GetGraphicsSchema(), &desc, outJson);
+
+	// Comes from the vertex shader's signature, not the Pipeline block
+	nlohmann::json inputLayout = nlohmann::json::array();
+	for (uint32_t i = 0; i < desc.InputLayout.InputItems.size(); i++)
 	{
-		Result.RtvDescs[i] = CreateDefaultGFXRenderTargetDesc();
+		nlohmann::json item;
+		item["Name"] = desc.InputLayout.InputItems[i].Name;
+		item["Format"] = std::string(SchemaEnumToString(GetInputItemFormatEnum(), desc.InputLayout.InputItems[i].ItemFormat));
+		item["Idx"] = i;
+		inputLayout.push_back(item);
 	}
-	return Result;
+	outJson["InputLayout"] = inputLayout;
+}
+
+void RaytracingPipelineToJson(const RAYTRACING_PIPELINE_DESC& desc, nlohmann::json& outJson)
+{
+	outJson["Type"] = "Raytracing";
+	CountsToJson(desc.Counts, outJson);
+	SchemaToJson(GetRaytracingSchema(), &desc, outJson);
+}
+
+void ComputePipelineToJson(const COMPUTE_PIPELINE_DESC& desc, nlohmann::json& outJson)
+{
+	outJson["Type"] = "Compute";
+	CountsToJson(desc.Counts, outJson);
 }
@@ -190,36 +190,6 @@ typedef struct GFX_RASTER_DESC {
 
 
 
-inline GFX_DEPTH_STENCIL_DESC CreateDefaultGFXDepthStencilDesc()
-{
-	GFX_DEPTH_STENCIL_DESC Result = { };
-	Result.Format = FORMAT_D24_UNORM_S8_UINT;
-	Result.bDepthEnable = true;
-	Result.DepthWriteMask = 0xffffffff;
-	Result.DepthFunction = COMPARISON_FUNCTION_LESS;
-	Result.bStencilEnable = false;
-	GFX_DEPTH_STENCIL_OP_DESC Desc = { STENCIL_OP_KEEP, STENCIL_OP_KEEP, STENCIL_OP_KEEP, COMPARISON_FUNCTION_LESS };
-	Result.FrontFace = Desc;
-	Result.BackFace = Desc;
-	return Result;
-}
-
-inline GFX_RENDER_TARGET_DESC CreateDefaultGFXRenderTargetDesc()
-{
-	GFX_RENDER_TARGET_DESC Result = { };
-	Result.bBlendEnable = false;
-	Result.bLogicOpEnable = false;
-	Result.SrcBlend = BLEND_STYLE_ONE;
-	Result.DstBlend = BLEND_STYLE_ZERO;
-	Result.BlendOp = BLEND_OP_ADD;
-	Result.SrcBlendAlpha = BLEND_STYLE_ONE;
-	Result.DstBlendAlpha = BLEND_STYLE_ZERO;
-	Result.AlphaBlendOp = BLEND_OP_ADD;
-	Result.LogicOp = LOGIC_OP_NOOP;
-	Result.Format = FORMAT_R8G8B8A8_UNORM;
-	return Result;
-}
-
 typedef struct PIPELINE_RESOURCE_COUNTERS {
 	uint8_t NumConstantBuffers;
 	uint8_t NumShaderResourceViews;
@@ -278,8 +248,6 @@ inline bool HasDomainShader(const FULL_PIPELINE_DESCRIPTOR& Desc)
 	return Desc.DS.WasCompiled;
 }
 
-GFX_RASTER_DESC CreateDefaultGFXRasterDesc();
-
 FULL_PIPELINE_DESCRIPTOR CreateDefaultDescriptor();
 
 void GraphicsPipelineToJson(const FULL_PIPELINE_DESCRIPTOR& desc, nlohmann::json& outJson);
@@ -2,8 +2,10 @@
 #include <fstream>
 #include <iostream>
 #include <filesystem>
+#include <string.h>
+#include <algorithm>
+#include <limits>
 #include "Utils.h"
-#include "base64.hpp"
 #include "nlohmann.hpp"
 #include "ShaderCompiler.h"
 #include "PipelineCompiler.h"
@@ -13,1631 +15,845 @@
 #include "ComputeAST.h"
 
 
-/*
-void SetCompilationMode(ShaderCompilationType Mode)
-{
-	CompilationMode = Mode;
-}
-
-
-typedef struct VARIABLE_INFO {
-	std::string Name;
-	std::string Type;
-	std::string Semantic;
-} VARIABLE_INFO;
-
-
-static bool VarHasSemantic(const VARIABLE_INFO& InVar)
-{
-	return InVar.Semantic.size() > 0;
-}
-
-typedef struct STRUCT_INFO {
-	std::string Name;
-	std::vector<VARIABLE_INFO> Variables;
-} STRUCT_INFO;
-
-typedef struct FUNCTION_INFO {
-	std::string ReturnType;
-	std::string Name;
-	std::string Semantic;
-	std::vector<VARIABLE_INFO> Parameters;
-} FUNCTION_INFO;
-
-static std::string ParseToEndOfScope(const std::string& Str, size_t Loc);
-
-
-static FUNCTION_INFO GetFunctionInfo(std::string FunctionDecl)
+PipelineCompiler::PipelineCompiler(ShaderCompiler* compiler) :
+	m_WriteJson(false),
+	m_Compiler(compiler)
 {
-	FUNCTION_INFO Result;
-
-	size_t CurrentLoc = 0;
-
-	for (; FunctionDecl[CurrentLoc] == ' ' || FunctionDecl[CurrentLoc] == '\n'; CurrentLoc++) {}
-	for (; FunctionDecl[CurrentLoc] != ' ' && FunctionDecl[CurrentLoc] != '\n'; CurrentLoc++)
-	{
-		Result.ReturnType.push_back(FunctionDecl[CurrentLoc]);
-	}
-
-	size_t EndName = FunctionDecl.find('(', 0);
-
-	for (; CurrentLoc != EndName; CurrentLoc++)
-	{
-		char C = FunctionDecl[CurrentLoc];
-		if (C != ' ' && C != '\n' && C != '{')
-		{
-			Result.Name.push_back(C);
-		}
-	}
-
-	VARIABLE_INFO VarInfo;
-#define RESET_VAR() VarInfo.Name.clear(); VarInfo.Type.clear(); VarInfo.Semantic.clear();
-
-	CurrentLoc = FunctionDecl.find('(', CurrentLoc) + 1;
-	size_t EndFuncLoc = FunctionDecl.find(')', 0) + 1;
-
-	for (; CurrentLoc != EndFuncLoc; CurrentLoc++)
-	{
-		size_t EndVarDeclLoc = FunctionDecl.find(',', CurrentLoc);
-
-		if (EndVarDeclLoc == std::string::npos)
-		{
-			EndVarDeclLoc = EndFuncLoc;
-		}
-
-		bool bHasSemantic = false;
-		std::string Type;
-		for (uint32_t Tries = 0; Tries < 2; Tries++)
-		{
-			for (; FunctionDecl[CurrentLoc] != ' ' && FunctionDecl[CurrentLoc] != '\n'; CurrentLoc++)
-			{
-				Type.push_back(FunctionDecl[CurrentLoc]);
-			}
-			// If we have the various.. idk what these called, but the variable markers
-			// skip it, for what we're doing we don't need them
-			if (Type == "in" || Type == "inout" || Type == "out")
-			{
-				for (; FunctionDecl[CurrentLoc] == ' ' || FunctionDecl[CurrentLoc] == '\n'; CurrentLoc++) {}
-			}
-			else
-			{
-				VarInfo.Type = Type;
-				break;
-			}
-		}
-		for (; FunctionDecl[CurrentLoc] == ' ' || FunctionDecl[CurrentLoc] == '\n'; CurrentLoc++) {}
-		for (; FunctionDecl[CurrentLoc] != ' ' && FunctionDecl[CurrentLoc] != '\n' && FunctionDecl[CurrentLoc] != ')'; CurrentLoc++)
-		{
-			VarInfo.Name.push_back(FunctionDecl[CurrentLoc]);
-		}
-		for (size_t i = CurrentLoc; i != EndVarDeclLoc; i++)
-		{
-			char C = FunctionDecl[i];
-			if (C == ':')
-			{
-				bHasSemantic = true;
-				break;
-			}
-		}
-		if (bHasSemantic)
-		{
-			for (; CurrentLoc != EndVarDeclLoc; CurrentLoc++)
-			{
-				char C = FunctionDecl[CurrentLoc];
-				if (C != ' ' && C != ',' && C != ')')
-				{
-					VarInfo.Semantic.push_back(C);
-				}
-			}
-			if (VarInfo.Semantic.find("SV_") != std::string::npos)
-			{
-			}
-			else
-			{
-				Result.Parameters.push_back(VarInfo);
-			}
-			RESET_VAR();
-		}
-		else
-		{
-			Result.Parameters.push_back(VarInfo);
-			RESET_VAR();
-		}
-	}
-
-#undef RESET_VAR
-	return Result;
 }
 
-static STRUCT_INFO GetStructInfo(std::string StructDeclaration)
+void PipelineCompiler::SetSrcDir(const std::filesystem::path& path)
 {
-	STRUCT_INFO Result;
-
-	RemoveTabs(StructDeclaration);
-	RemoveAllNonSpaceWhiteSpace(StructDeclaration);
-
-	size_t CurrentLoc = StructDeclaration.find("struct", 0);
-	CurrentLoc += 6;
-	size_t EndName = StructDeclaration.find("{", 0);
-
-	for (; CurrentLoc != EndName; CurrentLoc++)
-	{
-		char C = StructDeclaration[CurrentLoc];
-		if (C != ' ' && C != '\n' && C != '{')
-		{
-			Result.Name.push_back(C);
-		}
-	}
-
-	std::string Members = ParseToEndOfScope(StructDeclaration, CurrentLoc);
-	std::vector<std::string> MemberList = SplitString(Members, ';');
-
-	for (std::string& Member : MemberList)
-	{
-		if (IsWhiteSpace(Member))
-		{
-			continue;
-		}
-
-		VARIABLE_INFO VarInfo;
-		uint32_t i = 0;
-		for (i = 0; Member[i] == ' ' || Member[i] == '\n'; i++) {}
-		for (; Member[i] != ' ' && Member[i] != '\n'; i++)
-		{
-			VarInfo.Type.push_back(Member[i]);
-		}
-
-		for (; Member[i] == ' ' || Member[i] == '\n' || Member[i] == '\t'; i++) {}
-
-		for (; Member[i] != ' ' && Member[i] != '\n'; i++)
-		{
-			if (Member[i] != ';' && Member[i] != ':')
-			{
-				VarInfo.Name.push_back(Member[i]);
-			}
-		}
-		size_t SemanticDeclLoc = Member.find(':', 0);
-		if (SemanticDeclLoc < Member.length())
-		{
-			for (; Member[i] != ':'; i++) {}
-			i++;
-			for (; Member[i] == ' ' || Member[i] == '\n'; i++) {}
-			for (; Member[i] != ' ' && Member[i] != '\n' && Member[i] != ';' && i < Member.length(); i++)
-			{
-				VarInfo.Semantic.push_back(Member[i]);
-			}
-		}
-		Result.Variables.push_back(VarInfo);
-
-	}
-	return Result;
+	m_SrcPath = path;
+	m_Headers.SetIncludeDir(path);
 }
 
-static EINPUT_ITEM_FORMAT TypeToItemFormat(std::string InType)
+void PipelineCompiler::SetDstDir(const std::filesystem::path& path)
 {
-	if (InType == "float")
-	{
-		return INPUT_ITEM_FORMAT_FLOAT;
-	}
-	if (InType == "float2")
-	{
-		return INPUT_ITEM_FORMAT_FLOAT2;
-	}
-	if (InType == "float3")
-	{
-		return INPUT_ITEM_FORMAT_FLOAT3;
-	}
-	if (InType == "float4")
-	{
-		return INPUT_ITEM_FORMAT_FLOAT2;
-	}
-	if (InType == "int")
-	{
-		return INPUT_ITEM_FORMAT_INT;
-	}
-	if (InType == "int2")
-	{
-		return INPUT_ITEM_FORMAT_INT2;
-	}
-	if (InType == "int3")
-	{
-		return INPUT_ITEM_FORMAT_INT3;
-	}
-	if (InType == "int4")
-	{
-		return INPUT_ITEM_FORMAT_INT4;
-	}
-	return INPUT_ITEM_FORMAT_INVALID;
+	m_DstPath = path;
 }
 
-static bool ParseBool(std::string BoolStr)
+void PipelineCompiler::SetWriteJson(bool writeJson)
 {
-	if (BoolStr == "true")
-		return true;
-	if (BoolStr == "false")
-		return false;
-	return false;
+	m_WriteJson = writeJson;
 }
 
-static EBLEND_STYLE ParseBlendStyle(const std::string& BlendStyleStr)
+void PipelineCompiler::SetBuildJobs(const PIPELINE_BUILD_JOBS& jobs)
 {
-#define CHECK_BLEND_STYLE(x)  if (BlendStyleStr == #x) { return x; }
-
-	CHECK_BLEND_STYLE(BLEND_STYLE_ZERO);
-	CHECK_BLEND_STYLE(BLEND_STYLE_ONE);
-	CHECK_BLEND_STYLE(BLEND_STYLE_SRC_COLOR);
-	CHECK_BLEND_STYLE(BLEND_STYLE_INV_SRC_COLOR);
-	CHECK_BLEND_STYLE(BLEND_STYLE_SRC_ALPHA);
-	CHECK_BLEND_STYLE(BLEND_STYLE_INV_SRC_ALPHA);
-	CHECK_BLEND_STYLE(BLEND_STYLE_DEST_ALPHA);
-	CHECK_BLEND_STYLE(BLEND_STYLE_INV_DEST_ALPHA);
-	CHECK_BLEND_STYLE(BLEND_STYLE_DEST_COLOR);
-	CHECK_BLEND_STYLE(BLEND_STYLE_INV_DEST_COLOR);
-	CHECK_BLEND_STYLE(BLEND_STYLE_SRC_ALPHA_SAT);
-	CHECK_BLEND_STYLE(BLEND_STYLE_BLEND_FACTOR);
-	CHECK_BLEND_STYLE(BLEND_STYLE_INV_BLEND_FACTOR);
-	CHECK_BLEND_STYLE(BLEND_STYLE_SRC1_COLOR);
-	CHECK_BLEND_STYLE(BLEND_STYLE_INV_SRC1_COLOR);
-	CHECK_BLEND_STYLE(BLEND_STYLE_SRC1_ALPHA);
-	CHECK_BLEND_STYLE(BLEND_STYLE_INV_SRC1_ALPHA);
-	return (EBLEND_STYLE)0;
-
-#undef CHECK_BLEND_STYLE
+	m_Jobs = jobs;
 }
 
-inline EFORMAT ParseFormat(const std::string& FormatStr)
+static bool IsPipelineExt(const std::string& ext)
 {
-#define CHECK_FORMAT(x) if (FormatStr == #x) { return x; }
-
-	CHECK_FORMAT(FORMAT_UNKNOWN);
-	CHECK_FORMAT(FORMAT_R32G32B32A32_TYPELESS);
-	CHECK_FORMAT(FORMAT_R32G32B32A32_FLOAT);
-	CHECK_FORMAT(FORMAT_R32G32B32A32_UINT);
-	CHECK_FORMAT(FORMAT_R32G32B32A32_SINT);
-	CHECK_FORMAT(FORMAT_R32G32B32_TYPELESS);
-	CHECK_FORMAT(FORMAT_R32G32B32_FLOAT);
-	CHECK_FORMAT(FORMAT_R32G32B32_UINT);
-	CHECK_FORMAT(FORMAT_R32G32B32_SINT);
-	CHECK_FORMAT(FORMAT_R16G16B16A16_TYPELESS);
-	CHECK_FORMAT(FORMAT_R16G16B16A16_FLOAT);
-	CHECK_FORMAT(FORMAT_R16G16B16A16_UNORM);
-	CHECK_FORMAT(FORMAT_R16G16B16A16_UINT);
-	CHECK_FORMAT(FORMAT_R16G16B16A16_SNORM);
-	CHECK_FORMAT(FORMAT_R16G16B16A16_SINT);
-	CHECK_FORMAT(FORMAT_R32G32_TYPELESS);
-	CHECK_FORMAT(FORMAT_R32G32_FLOAT);
-	CHECK_FORMAT(FORMAT_R32G32_UINT);
-	CHECK_FORMAT(FORMAT_R32G32_SINT);
-	CHECK_FORMAT(FORMAT_R32G8X24_TYPELESS);
-	CHECK_FORMAT(FORMAT_D32_FLOAT_S8X24_UINT);
-	CHECK_FORMAT(FORMAT_R32_FLOAT_X8X24_TYPELESS);
-	CHECK_FORMAT(FORMAT_X32_TYPELESS_G8X24_UINT);
-	CHECK_FORMAT(FORMAT_R10G10B10A2_TYPELESS);
-	CHECK_FORMAT(FORMAT_R10G10B10A2_UNORM);
-	CHECK_FORMAT(FORMAT_R10G10B10A2_UINT);
-	CHECK_FORMAT(FORMAT_R11G11B10_FLOAT);
-	CHECK_FORMAT(FORMAT_R8G8B8A8_TYPELESS);
-	CHECK_FORMAT(FORMAT_R8G8B8A8_UNORM);
-	CHECK_FORMAT(FORMAT_R8G8B8A8_UNORM_SRGB);
-	CHECK_FORMAT(FORMAT_R8G8B8A8_UINT);
-	CHECK_FORMAT(FORMAT_R8G8B8A8_SNORM);
-	CHECK_FORMAT(FORMAT_R8G8B8A8_SINT);
-	CHECK_FORMAT(FORMAT_R16G16_TYPELESS);
-	CHECK_FORMAT(FORMAT_R16G16_FLOAT);
-	CHECK_FORMAT(FORMAT_R16G16_UNORM);
-	CHECK_FORMAT(FORMAT_R16G16_UINT);
-	CHECK_FORMAT(FORMAT_R16G16_SNORM);
-	CHECK_FORMAT(FORMAT_R16G16_SINT);
-	CHECK_FORMAT(FORMAT_R32_TYPELESS);
-	CHECK_FORMAT(FORMAT_D32_FLOAT);
-	CHECK_FORMAT(FORMAT_R32_FLOAT);
-	CHECK_FORMAT(FORMAT_R32_UINT);
-	CHECK_FORMAT(FORMAT_R32_SINT);
-	CHECK_FORMAT(FORMAT_R24G8_TYPELESS);
-	CHECK_FORMAT(FORMAT_D24_UNORM_S8_UINT);
-	CHECK_FORMAT(FORMAT_R24_UNORM_X8_TYPELESS);
-	CHECK_FORMAT(FORMAT_X24_TYPELESS_G8_UINT);
-	CHECK_FORMAT(FORMAT_R8G8_TYPELESS);
-	CHECK_FORMAT(FORMAT_R8G8_UNORM);
-	CHECK_FORMAT(FORMAT_R8G8_UINT);
-	CHECK_FORMAT(FORMAT_R8G8_SNORM);
-	CHECK_FORMAT(FORMAT_R8G8_SINT);
-	CHECK_FORMAT(FORMAT_R16_TYPELESS);
-	CHECK_FORMAT(FORMAT_R16_FLOAT);
-	CHECK_FORMAT(FORMAT_D16_UNORM);
-	CHECK_FORMAT(FORMAT_R16_UNORM);
-	CHECK_FORMAT(FORMAT_R16_UINT);
-	CHECK_FORMAT(FORMAT_R16_SNORM);
-	CHECK_FORMAT(FORMAT_R16_SINT);
-	CHECK_FORMAT(FORMAT_R8_TYPELESS);
-	CHECK_FORMAT(FORMAT_R8_UNORM);
-	CHECK_FORMAT(FORMAT_R8_UINT);
-	CHECK_FORMAT(FORMAT_R8_SNORM);
-	CHECK_FORMAT(FORMAT_R8_SINT);
-	CHECK_FORMAT(FORMAT_A8_UNORM);
-	CHECK_FORMAT(FORMAT_R1_UNORM);
-	CHECK_FORMAT(FORMAT_R9G9B9E5_SHAREDEXP);
-	CHECK_FORMAT(FORMAT_R8G8_B8G8_UNORM);
-	CHECK_FORMAT(FORMAT_G8R8_G8B8_UNORM);
-	CHECK_FORMAT(FORMAT_BC1_TYPELESS);
-	CHECK_FORMAT(FORMAT_BC1_UNORM);
-	CHECK_FORMAT(FORMAT_BC1_UNORM_SRGB);
-	CHECK_FORMAT(FORMAT_BC2_TYPELESS);
-	CHECK_FORMAT(FORMAT_BC2_UNORM);
-	CHECK_FORMAT(FORMAT_BC2_UNORM_SRGB);
-	CHECK_FORMAT(FORMAT_BC3_TYPELESS);
-	CHECK_FORMAT(FORMAT_BC3_UNORM);
-	CHECK_FORMAT(FORMAT_BC3_UNORM_SRGB);
-	CHECK_FORMAT(FORMAT_BC4_TYPELESS);
-	CHECK_FORMAT(FORMAT_BC4_UNORM);
-	CHECK_FORMAT(FORMAT_BC4_SNORM);
-	CHECK_FORMAT(FORMAT_BC5_TYPELESS);
-	CHECK_FORMAT(FORMAT_BC5_UNORM);
-	CHECK_FORMAT(FORMAT_BC5_SNORM);
-	CHECK_FORMAT(FORMAT_B5G6R5_UNORM);
-	CHECK_FORMAT(FORMAT_B5G5R5A1_UNORM);
-	CHECK_FORMAT(FORMAT_B8G8R8A8_UNORM);
-	CHECK_FORMAT(FORMAT_B8G8R8X8_UNORM);
-	CHECK_FORMAT(FORMAT_R10G10B10_XR_BIAS_A2_UNORM);
-	CHECK_FORMAT(FORMAT_B8G8R8A8_TYPELESS);
-	CHECK_FORMAT(FORMAT_B8G8R8A8_UNORM_SRGB);
-	CHECK_FORMAT(FORMAT_B8G8R8X8_TYPELESS);
-	CHECK_FORMAT(FORMAT_B8G8R8X8_UNORM_SRGB);
-	CHECK_FORMAT(FORMAT_BC6H_TYPELESS);
-	CHECK_FORMAT(FORMAT_BC6H_UF16);
-	CHECK_FORMAT(FORMAT_BC6H_SF16);
-	CHECK_FORMAT(FORMAT_BC7_TYPELESS);
-	CHECK_FORMAT(FORMAT_BC7_UNORM);
-	CHECK_FORMAT(FORMAT_BC7_UNORM_SRGB);
-	CHECK_FORMAT(FORMAT_AYUV);
-	CHECK_FORMAT(FORMAT_Y410);
-	CHECK_FORMAT(FORMAT_Y416);
-	CHECK_FORMAT(FORMAT_NV12);
-	CHECK_FORMAT(FORMAT_P010);
-	CHECK_FORMAT(FORMAT_P016);
-	CHECK_FORMAT(FORMAT_420_OPAQUE);
-	CHECK_FORMAT(FORMAT_YUY2);
-	CHECK_FORMAT(FORMAT_Y210);
-	CHECK_FORMAT(FORMAT_Y216);
-	CHECK_FORMAT(FORMAT_NV11);
-	CHECK_FORMAT(FORMAT_AI44);
-	CHECK_FORMAT(FORMAT_IA44);
-	CHECK_FORMAT(FORMAT_P8);
-	CHECK_FORMAT(FORMAT_A8P8);
-	CHECK_FORMAT(FORMAT_B4G4R4A4_UNORM);
-	CHECK_FORMAT(FORMAT_P208);
-	CHECK_FORMAT(FORMAT_V208);
-	CHECK_FORMAT(FORMAT_V408);
-	CHECK_FORMAT(FORMAT_FORCE_UINT);
-	return (EFORMAT)0;
-
-#undef CHECK_FORMAT
+	return ext == "ray" || ext == "gfx" || ext == "cmpt";
 }
 
-static EPOLYGON_TYPE ParsePolygonType(const std::string& PolygonStr)
+bool PipelineCompiler::IsInput(const std::filesystem::path& path)
 {
-#define CHECK_POLYGON_MODE(x) if (PolygonStr == #x) { return x; }
-
-	CHECK_POLYGON_MODE(POLYGON_TYPE_POINTS);
-	CHECK_POLYGON_MODE(POLYGON_TYPE_LINES);
-	CHECK_POLYGON_MODE(POLYGON_TYPE_TRIANGLES);
-	CHECK_POLYGON_MODE(POLYGON_TYPE_TRIANGLE_STRIPS);
-	return POLYGON_TYPE_TRIANGLES;
+	if (path.parent_path().lexically_normal() == m_SrcPath.lexically_normal() &&
+		IsPipelineExt(GetFileSuffix(path.filename().string())))
+	{
+		return true;
+	}
 
-#undef CHECK_POLYGON_MODE
+	return m_Deps.HasDependents(path);
 }
 
-static EBLEND_OP ParseBlendOp(const std::string& BlendOpStr)
+void PipelineCompiler::GetInputDirectories(std::set<std::filesystem::path>& outDirs) const
 {
-#define CHECK_BLEND_OP(x) if (BlendOpStr == #x) { return x; }
-
-	CHECK_BLEND_OP(BLEND_OP_ADD);
-	CHECK_BLEND_OP(BLEND_OP_SUBTRACT);
-	CHECK_BLEND_OP(BLEND_OP_REV_SUBTRACT);
-	CHECK_BLEND_OP(BLEND_OP_MIN);
-	CHECK_BLEND_OP(BLEND_OP_MAX);
-	return (EBLEND_OP)0;
-
-#undef CHECK_BLEND_OP
+	outDirs.insert(m_SrcPath);
+	m_Deps.GetInputDirectories(outDirs);
 }
 
-static ELOGIC_OP ParseLogicOp(const std::string& LogicOpStr)
-{
-#define CHECK_LOGIC_OP(x) if (LogicOpStr == #x) { return x; }
-
-	CHECK_LOGIC_OP(LOGIC_OP_CLEAR);
-	CHECK_LOGIC_OP(LOGIC_OP_SET);
-	CHECK_LOGIC_OP(LOGIC_OP_COPY);
-	CHECK_LOGIC_OP(LOGIC_OP_COPY_INVERTED);
-	CHECK_LOGIC_OP(LOGIC_OP_NOOP);
-	CHECK_LOGIC_OP(LOGIC_OP_INVERT);
-	CHECK_LOGIC_OP(LOGIC_OP_AND);
-	CHECK_LOGIC_OP(LOGIC_OP_NAND);
-	CHECK_LOGIC_OP(LOGIC_OP_OR);
-	CHECK_LOGIC_OP(LOGIC_OP_NOR);
-	CHECK_LOGIC_OP(LOGIC_OP_XOR);
-	CHECK_LOGIC_OP(LOGIC_OP_EQUIV);
-	CHECK_LOGIC_OP(LOGIC_OP_AND_REVERSE);
-	CHECK_LOGIC_OP(LOGIC_OP_AND_INVERTED);
-	CHECK_LOGIC_OP(LOGIC_OP_OR_REVERSE);
-	CHECK_LOGIC_OP(LOGIC_OP_OR_INVERTED);
-	return (ELOGIC_OP)0;
-
-#undef CHECK_LOGIC_OP
-}
+// Written before the packs were split per target, removed on the next write
+static const char s_CombinedPackFileName[] = "ShaderPipelines.pack";
+static const char s_ManifestFileName[] = "ShaderPipelines.json";
+static const char s_DependencyDbFileName[] = "ShaderDependencies.json";
+static const char s_CompileHistoryFileName[] = "ShaderCompileTimes.json";
 
-static ECOMPARISON_FUNCTION ParseComparisonFunction(const std::string& ComparisonFuncStr)
+static std::string PackFileName(uint32_t type, uint32_t flags)
 {
-#define CHECK_COMPARISON_FUNC(x) if (ComparisonFuncStr == #x) { return x; }
-
-	CHECK_COMPARISON_FUNC(COMPARISON_FUNCTION_NEVER);
-	CHECK_COMPARISON_FUNC(COMPARISON_FUNCTION_LESS);
-	CHECK_COMPARISON_FUNC(COMPARISON_FUNCTION_EQUAL);
-	CHECK_COMPARISON_FUNC(COMPARISON_FUNCTION_LESS_EQUAL);
-	CHECK_COMPARISON_FUNC(COMPARISON_FUNCTION_GREATER);
-	CHECK_COMPARISON_FUNC(COMPARISON_FUNCTION_NOT_EQUAL);
-	CHECK_COMPARISON_FUNC(COMPARISON_FUNCTION_GREATER_EQUAL);
-	CHECK_COMPARISON_FUNC(COMPARISON_FUNCTION_ALWAYS);
-	return (ECOMPARISON_FUNCTION)0;
-
-#undef CHECK_COMPARISON_FUNC
+	return ShaderPackFileName(type == DXIL ? SHADER_PACK_API_DXIL : SHADER_PACK_API_SPIRV, flags);
 }
 
-// static ESTENCIL_OP ParseStencilOp(const std::string StencilOpStr)
-// {
-// #define CHECK_STENCIL_OP(x) if (StencilOpStr == #x) { return x; }
-// 
-// 	CHECK_STENCIL_OP(STENCIL_OP_KEEP);
-// 	CHECK_STENCIL_OP(STENCIL_OP_ZERO);
-// 	CHECK_STENCIL_OP(STENCIL_OP_REPLACE);
-// 	CHECK_STENCIL_OP(STENCIL_OP_INCR_SAT);
-// 	CHECK_STENCIL_OP(STENCIL_OP_DECR_SAT);
-// 	CHECK_STENCIL_OP(STENCIL_OP_INVERT);
-// 	CHECK_STENCIL_OP(STENCIL_OP_INCR);
-// 	CHECK_STENCIL_OP(STENCIL_OP_DECR);
-// 	return (ESTENCIL_OP)0;
-// 
-// #undef CHECK_STENCIL_OP
-// }
-
-
-
-// static ESTENCIL_OP ParseStencilOp(const std::string StencilOpStr)
-// {
-// #define CHECK_STENCIL_OP(x) if (StencilOpStr == #x) { return x; }
-// 
-// 	CHECK_STENCIL_OP(STENCIL_OP_KEEP);
-// 	CHECK_STENCIL_OP(STENCIL_OP_ZERO);
-// 	CHECK_STENCIL_OP(STENCIL_OP_REPLACE);
-// 	CHECK_STENCIL_OP(STENCIL_OP_INCR_SAT);
-// 	CHECK_STENCIL_OP(STENCIL_OP_DECR_SAT);
-// 	CHECK_STENCIL_OP(STENCIL_OP_INVERT);
-// 	CHECK_STENCIL_OP(STENCIL_OP_INCR);
-// 	CHECK_STENCIL_OP(STENCIL_OP_DECR);
-// 	return (ESTENCIL_OP)0;
-// 
-// #undef CHECK_STENCIL_OP
-// }
-
-static std::string ParseToEndOfScope(const std::string& InStr, size_t StartParse)
+// Every stage the pipeline has
+static std::vector<const SHADER*> GetGraphicsShaders(const FULL_PIPELINE_DESCRIPTOR& desc)
 {
-	std::string Result;
-	size_t ScopeEndLoc = 0;
-	uint32_t Depth = 1;
-	size_t BeginScopeLoc = InStr.find('{', StartParse);
-	size_t CurrentLoc = BeginScopeLoc;
-	for (int i = 0; i < 10000; i++) // Protect from infinite loop condition
+	std::vector<const SHADER*> shaders = { &desc.VS, &desc.PS };
+	if (HasHullShader(desc))
 	{
-		if (i > 9999)
-		{
-			__debugbreak(); // Something really bad happened here
-		}
-		size_t RightSideLoc = InStr.find('}', CurrentLoc);
-		size_t LeftSideLoc = InStr.find('{', CurrentLoc);
-
-		if (LeftSideLoc == BeginScopeLoc)
-		{
-			if (RightSideLoc > LeftSideLoc) // Ew redundant code
-			{
-				LeftSideLoc = InStr.find('{', LeftSideLoc + 1);
-				if (RightSideLoc > LeftSideLoc)
-				{
-					CurrentLoc = RightSideLoc;
-					Depth++;
-				}
-				else
-				{
-					CurrentLoc = RightSideLoc + 1;
-					Depth--;
-				}
-			}
-			else
-			{
-				Depth--; //???
-			}
-		}
-		else if (RightSideLoc > LeftSideLoc) // If we have a new opening brace, ie if we found another opening brace before we found a closing brace
-		{
-			CurrentLoc = RightSideLoc;
-			Depth++;
-		}
-		else if (RightSideLoc < LeftSideLoc) // if we have a new closing brace
-		{
-			CurrentLoc = RightSideLoc + 1;
-			Depth--;
-		}
-
-		if (Depth == 0)
-		{
-			ScopeEndLoc = CurrentLoc;
-			break;
-		}
+		shaders.push_back(&desc.HS);
 	}
-	Result = InStr.substr(BeginScopeLoc + 1, ((ScopeEndLoc - StartParse) - 3));
-	return Result;
-}
-
-static void ParseRenderTargetDesc(const std::string& DescStr, GFX_RENDER_TARGET_DESC& OutDesc)
-{
-	OutDesc = CreateDefaultGFXRenderTargetDesc();
+	if (HasDomainShader(desc))
 	{
-		size_t BlendEnableLoc = DescStr.find("BlendEnable");
-		if (BlendEnableLoc != std::string::npos)
-		{
-			std::string BlendEnableStr;
-			size_t AssignmentOperatorLoc = DescStr.find("=", BlendEnableLoc);
-			size_t EndAssignmentLoc = DescStr.find(";", AssignmentOperatorLoc);
-			for (size_t i = AssignmentOperatorLoc + 1; i < EndAssignmentLoc; i++)
-			{
-				if (DescStr[i] != ' ' && DescStr[i] != '\n')
-				{
-					BlendEnableStr.push_back(DescStr[i]);
-				}
-			}
-			OutDesc.bBlendEnable = ParseBool(BlendEnableStr);
-		}
+		shaders.push_back(&desc.DS);
 	}
+	if (HasGeometryShader(desc))
 	{
-		size_t LogicEnableLoc = DescStr.find("LogicEnable");
-		if (LogicEnableLoc != std::string::npos)
-		{
-			std::string LogicEnableStr;
-			size_t AssignmentOperatorLoc = DescStr.find("=", LogicEnableLoc);
-			size_t EndAssignmentLoc = DescStr.find(";", AssignmentOperatorLoc);
-			for (size_t i = AssignmentOperatorLoc + 1; i < EndAssignmentLoc; i++)
-			{
-				if (DescStr[i] != ' ' && DescStr[i] != '\n')
-				{
-					LogicEnableStr.push_back(DescStr[i]);
-				}
-			}
-			OutDesc.bLogicOpEnable = ParseBool(LogicEnableStr);
-		}
-	}
-	{
-		size_t SrcBlendLoc = DescStr.find("SrcBlend");
-		if (SrcBlendLoc != std::string::npos)
-		{
-			std::string SrcBlendStr;
-			size_t AssignmentOperatorLoc = DescStr.find("=", SrcBlendLoc);
-			size_t EndAssignmentLoc = DescStr.find(";", AssignmentOperatorLoc);
-			for (size_t i = AssignmentOperatorLoc + 1; i < EndAssignmentLoc; i++)
-			{
-				if (DescStr[i] != ' ' && DescStr[i] != '\n')
-				{
-					SrcBlendStr.push_back(DescStr[i]);
-				}
-			}
-			OutDesc.SrcBlend = ParseBlendStyle(SrcBlendStr);
-		}
-	}
-	{
-		size_t DstBlendLoc = DescStr.find("DstBlend");
-		if (DstBlendLoc != std::string::npos)
-		{
-			std::string DstBlendStr;
-			size_t AssignmentOperatorLoc = DescStr.find("=", DstBlendLoc);
-			size_t EndAssignmentLoc = DescStr.find(";", AssignmentOperatorLoc);
-			for (size_t i = AssignmentOperatorLoc + 1; i < EndAssignmentLoc; i++)
-			{
-				if (DescStr[i] != ' ' && DescStr[i] != '\n')
-				{
-					DstBlendStr.push_back(DescStr[i]);
-				}
-			}
-			OutDesc.DstBlend = ParseBlendStyle(DstBlendStr);
-		}
-	}
-	{
-		size_t BlendOpLoc = DescStr.find("BlendOp");
-		if (BlendOpLoc != std::string::npos)
-		{
-			std::string BlendOpStr;
-			size_t AssignmentOperatorLoc = DescStr.find("=", BlendOpLoc);
-			size_t EndAssignmentLoc = DescStr.find(";", AssignmentOperatorLoc);
-			for (size_t i = AssignmentOperatorLoc + 1; i < EndAssignmentLoc; i++)
-			{
-				if (DescStr[i] != ' ' && DescStr[i] != '\n')
-				{
-					BlendOpStr.push_back(DescStr[i]);
-				}
-			}
-			OutDesc.BlendOp = ParseBlendOp(BlendOpStr);
-		}
-	}
-	{
-		size_t SrcBlendAlphaLoc = DescStr.find("SrcBlendAlpha");
-		if (SrcBlendAlphaLoc != std::string::npos)
-		{
-			std::string SrcBlendAlphaStr;
-			size_t AssignmentOperatorLoc = DescStr.find("=", SrcBlendAlphaLoc);
-			size_t EndAssignmentLoc = DescStr.find(";", AssignmentOperatorLoc);
-			for (size_t i = AssignmentOperatorLoc + 1; i < EndAssignmentLoc; i++)
-			{
-				if (DescStr[i] != ' ' && DescStr[i] != '\n')
-				{
-					SrcBlendAlphaStr.push_back(DescStr[i]);
-				}
-			}
-			OutDesc.SrcBlendAlpha = ParseBlendStyle(SrcBlendAlphaStr);
-		}
-	}
-	{
-		size_t DstBlendAlphaLoc = DescStr.find("DstBlendAlpha");
-		if (DstBlendAlphaLoc != std::string::npos)
-		{
-			std::string DstBlendAlphaStr;
-			size_t AssignmentOperatorLoc = DescStr.find("=", DstBlendAlphaLoc);
-			size_t EndAssignmentLoc = DescStr.find(";", AssignmentOperatorLoc);
-			for (size_t i = AssignmentOperatorLoc + 1; i < EndAssignmentLoc; i++)
-			{
-				if (DescStr[i] != ' ' && DescStr[i] != '\n')
-				{
-					DstBlendAlphaStr.push_back(DescStr[i]);
-				}
-			}
-			OutDesc.DstBlendAlpha = ParseBlendStyle(DstBlendAlphaStr);
-		}
-	}
-	{
-		size_t AlphaBlendOpLoc = DescStr.find("AlphaBlendOp");
-		if (AlphaBlendOpLoc != std::string::npos)
-		{
-			std::string AlphaBlendOpStr;
-			size_t AssignmentOperatorLoc = DescStr.find("=", AlphaBlendOpLoc);
-			size_t EndAssignmentLoc = DescStr.find(";", AssignmentOperatorLoc);
-			for (size_t i = AssignmentOperatorLoc + 1; i < EndAssignmentLoc; i++)
-			{
-				if (DescStr[i] != ' ' && DescStr[i] != '\n')
-				{
-					AlphaBlendOpStr.push_back(DescStr[i]);
-				}
-			}
-			OutDesc.AlphaBlendOp = ParseBlendOp(AlphaBlendOpStr);
-		}
-	}
-	{
-		size_t LogicOpLoc = DescStr.find("LogicOp");
-		if (LogicOpLoc != std::string::npos)
-		{
-			std::string LogicOpStr;
-			size_t AssignmentOperatorLoc = DescStr.find("=", LogicOpLoc);
-			size_t EndAssignmentLoc = DescStr.find(";", AssignmentOperatorLoc);
-			for (size_t i = AssignmentOperatorLoc + 1; i < EndAssignmentLoc; i++)
-			{
-				if (DescStr[i] != ' ' && DescStr[i] != '\n')
-				{
-					LogicOpStr.push_back(DescStr[i]);
-				}
-			}
-			OutDesc.LogicOp = ParseLogicOp(LogicOpStr);
-		}
+		shaders.push_back(&desc.GS);
 	}
+	return shaders;
+}
+
+static bool AllCompiled(const std::vector<const SHADER*>& shaders)
+{
+	for (const SHADER* shader : shaders)
 	{
-		size_t FormatLoc = DescStr.find("Format");
-		if (FormatLoc != std::string::npos)
+		if (!shader->WasCompiled)
 		{
-			std::string FormatStr;
-			size_t AssignmentOperatorLoc = DescStr.find("=", FormatLoc);
-			size_t EndAssignmentLoc = DescStr.find(";", AssignmentOperatorLoc);
-			for (size_t i = AssignmentOperatorLoc + 1; i < EndAssignmentLoc; i++)
-			{
-				if (DescStr[i] != ' ' && DescStr[i] != '\n')
-				{
-					FormatStr.push_back(DescStr[i]);
-				}
-			}
-			OutDesc.Format = ParseFormat(FormatStr);
+			return false;
 		}
 	}
+	return true;
 }
 
-/*
-static void ParseStencilOpDesc(const std::string& DescStr, GFX_DEPTH_STENCIL_OP_DESC& OutDesc)
-{
-OutDesc = { STENCIL_OP_KEEP, STENCIL_OP_KEEP, STENCIL_OP_KEEP, COMPARISON_FUNCTION_LESS };
-
-{
-size_t StencilFailOpLoc = DescStr.find("StencilFailOp");
-if (StencilFailOpLoc != std::string::npos)
-{
-std::string StencilFailOpStr;
-size_t AssignmentOperatorLoc = DescStr.find("=", StencilFailOpLoc);
-size_t EndAssignmentLoc = DescStr.find(";", AssignmentOperatorLoc);
-for (size_t i = AssignmentOperatorLoc + 1; i < EndAssignmentLoc; i++)
-{
-if (DescStr[i] != ' ' && DescStr[i] != '\n')
-{
-StencilFailOpStr.push_back(DescStr[i]);
-}
-}
-OutDesc.StencilFailOp = ParseStencilOp(StencilFailOpStr);
-}
-}
-{
-size_t StencilDepthFailOpLoc = DescStr.find("StencilDepthFailOp");
-if (StencilDepthFailOpLoc != std::string::npos)
-{
-std::string StencilDepthFailOpStr;
-size_t AssignmentOperatorLoc = DescStr.find("=", StencilDepthFailOpLoc);
-size_t EndAssignmentLoc = DescStr.find(";", AssignmentOperatorLoc);
-for (size_t i = AssignmentOperatorLoc + 1; i < EndAssignmentLoc; i++)
-{
-if (DescStr[i] != ' ' && DescStr[i] != '\n')
-{
-StencilDepthFailOpStr.push_back(DescStr[i]);
-}
-}
-OutDesc.StencilDepthFailOp = ParseStencilOp(StencilDepthFailOpStr);
-}
-}
-{
-size_t StencilPassOpLoc = DescStr.find("StencilPassOp");
-if (StencilPassOpLoc != std::string::npos)
-{
-std::string StencilPassOpStr;
-size_t AssignmentOperatorLoc = DescStr.find("=", StencilPassOpLoc);
-size_t EndAssignmentLoc = DescStr.find(";", AssignmentOperatorLoc);
-for (size_t i = AssignmentOperatorLoc + 1; i < EndAssignmentLoc; i++)
-{
-if (DescStr[i] != ' ' && DescStr[i] != '\n')
+// By pipeline name, sources with the same name but another extension by filename
+static bool PackOrder(const std::string& a, const std::string& b)
 {
-StencilPassOpStr.push_back(DescStr[i]);
+	const std::string nameA = std::filesystem::path(a).stem().string();
+	const std::string nameB = std::filesystem::path(b).stem().string();
+	return nameA != nameB ? nameA < nameB : a < b;
 }
-}
-OutDesc.StencilPassOp = ParseStencilOp(StencilPassOpStr);
-}
-}
-{
-size_t ComparisonFuncOp = DescStr.find("ComparisonFunction");
-if (ComparisonFuncOp != std::string::npos)
-{
-std::string ComparisonFuncStr;
-size_t AssignmentOperatorLoc = DescStr.find("=", ComparisonFuncOp);
-size_t EndAssignmentLoc = DescStr.find(";", AssignmentOperatorLoc);
-for (size_t i = AssignmentOperatorLoc + 1; i < EndAssignmentLoc; i++)
-{
-if (DescStr[i] != ' ' && DescStr[i] != '\n')
-{
-ComparisonFuncStr.push_back(DescStr[i]);
-}
-}
-OutDesc.ComparisonFunction = ParseComparisonFunction(ComparisonFuncStr);
-}
-}
-}
-
 
-static void FillDescriptor(const std::string& InDescStr, FULL_PIPELINE_DESCRIPTOR& OutDesc, bool& bUsesCustomDepthStencilState)
+bool PipelineCompiler::Load()
 {
-	uint32_t NumRenderTargets = 0;
-
-	std::string DescStr = InDescStr;
-	RemoveTabs(DescStr);
-	bUsesCustomDepthStencilState = false;
+	m_Json = nlohmann::json::object();
+	m_Sources.clear();
+	m_Queued.clear();
+	for (uint32_t x = 0; x < SHADER_COMPILATION_TYPE_NUM; x++)
 	{
-		std::string SearchStr = "RenderTarget__";
-		for (size_t i = 0; i < 8; i++)
+		for (uint32_t y = 0; y < COMPILER_FLAGS_NUM; y++)
 		{
-			SearchStr[13] = std::to_string(i)[0];
-			size_t DeclPos = DescStr.find(SearchStr, 0);
-
-			if (DeclPos != std::string::npos)
-			{
-				size_t BeginScopePos = DescStr.find("{", DeclPos);
-				size_t EndScopePos = DescStr.find("}", DeclPos);
-				std::string RenderTargetDesc = DescStr.substr(BeginScopePos, EndScopePos - BeginScopePos);
-				ParseRenderTargetDesc(RenderTargetDesc, OutDesc.RtvDescs[i]);
-			}
+			m_PrevPipelines[x][y].clear();
 		}
-		OutDesc.NumRenderTargets = NumRenderTargets;
 	}
-	{
 
-		bool bDepthWrite = true;
-		size_t UseDepthStencilLoc = DescStr.find("DepthWrite", 0);
+	// Left over from the last Load when running in watch mode
+	m_GfxPipelines.clear();
+	m_CmptPipelines.clear();
+	m_RayPipelines.clear();
+	m_Compiler->ClearShaderIncludes();
+	m_Headers.BeginBuild();
+	m_Headers.ResetStats();
+	m_FrontEnd.SetStore(m_Compiler->GetCache());
+	m_FrontEndHits = 0;
+
+	m_Deps.Load(m_DstPath / s_DependencyDbFileName);
+	m_Deps.SetArgsHash(m_Compiler->GetArgsHash());
+	m_Compiler->GetHistory().Load(m_DstPath / s_CompileHistoryFileName);
 
-		if (UseDepthStencilLoc != std::string::npos)
+	const uint32_t targets = m_Compiler->GetTargets();
+	for (uint32_t x = 0; x < SHADER_COMPILATION_TYPE_NUM; x++)
+	{
+		for (uint32_t y = 0; y < COMPILER_FLAGS_NUM; y++)
 		{
-			size_t EndOfDepthStenilLoc = DescStr.find(";", UseDepthStencilLoc);
-			std::string UseDepthStencilStr;
-			for (size_t i = UseDepthStencilLoc; i < EndOfDepthStenilLoc; i++)
+			const std::filesystem::path packPath = m_DstPath / PackFileName(x, y);
+			if ((targets & ShaderTargetBit((ShaderCompilationType)x, (CompilerFlags)y)) &&
+				!m_PrevPacks[x][y].Load(packPath) && std::filesystem::exists(packPath))
 			{
-				if (DescStr[i] != ' ' && DescStr[i] != '\n')
-				{
-					UseDepthStencilStr.push_back(DescStr[i]);
-				}
+				std::cout << "[WARN] " << packPath.string() << " is corrupt or out of date, rebuilding everything" << std::endl;
 			}
-			bUsesCustomDepthStencilState = true;
-			bDepthWrite = ParseBool(UseDepthStencilStr);
-		}
-
-		if (bDepthWrite)
-		{
-			OutDesc.DepthStencilState = GEnableDepthWriteDesc;
-		}
-		else
-		{
-			OutDesc.DepthStencilState = GDisableDepthWriteDesc;
 		}
 	}
-	size_t DepthStencilDescLoc = DescStr.find("DepthStencilState");
 
-	if (DepthStencilDescLoc != std::string::npos)
+	if (m_WriteJson)
 	{
-		size_t BeginDeclLoc = DescStr.find('{', DepthStencilDescLoc);
-
-		std::string DepthStencilDesc = ParseToEndOfScope(DescStr, BeginDeclLoc);
-
-		GFX_DEPTH_STENCIL_DESC Desc = CreateDefaultGFXDepthStencilDesc();
-
+		std::ifstream prevManifest(m_DstPath / s_ManifestFileName);
+		m_PrevJson = prevManifest.is_open() ?
+			nlohmann::json::parse(prevManifest, nullptr, false) :
+			nlohmann::json::object();
+		if (!m_PrevJson.is_object())
 		{
-			size_t FormatLoc = DepthStencilDesc.find("Format");
-			if (FormatLoc != std::string::npos)
-			{
-				std::string FormatStr;
-				size_t AssignmentOperatorLoc = DepthStencilDesc.find("=", FormatLoc);
-				size_t EndAssignmentLoc = DepthStencilDesc.find(";", AssignmentOperatorLoc);
-				for (size_t i = AssignmentOperatorLoc + 1; i < EndAssignmentLoc; i++)
-				{
-					if (DepthStencilDesc[i] != ' ' && DepthStencilDesc[i] != '\n')
-					{
-						FormatStr.push_back(DepthStencilDesc[i]);
-					}
-				}
-				Desc.Format = ParseFormat(FormatStr);
-			}
-		}
-		{
-			size_t DepthEnableLoc = DepthStencilDesc.find("DepthEnable");
-			if (DepthEnableLoc != std::string::npos)
-			{
-				std::string DepthEnableStr;
-				size_t AssignmentOperatorLoc = DepthStencilDesc.find("=", DepthEnableLoc);
-				size_t EndAssignmentLoc = DepthStencilDesc.find(";", AssignmentOperatorLoc);
-				for (size_t i = AssignmentOperatorLoc + 1; i < EndAssignmentLoc; i++)
-				{
-					if (DepthStencilDesc[i] != ' ' && DepthStencilDesc[i] != '\n')
-					{
-						DepthEnableStr.push_back(DepthStencilDesc[i]);
-					}
-				}
-				bUsesCustomDepthStencilState = true;
-				Desc.bDepthEnable = ParseBool(DepthEnableStr);
-			}
-		}
-		{
-			size_t DepthFuncitionLoc = DepthStencilDesc.find("DepthFunction");
-			if (DepthFuncitionLoc != std::string::npos)
-			{
-				std::string DepthFunctionStr;
-				size_t AssignmentOperatorLoc = DepthStencilDesc.find("=", DepthFuncitionLoc);
-				size_t EndAssignmentLoc = DepthStencilDesc.find(";", AssignmentOperatorLoc);
-				for (size_t i = AssignmentOperatorLoc + 1; i < EndAssignmentLoc; i++)
-				{
-					if (DepthStencilDesc[i] != ' ' && DepthStencilDesc[i] != '\n')
-					{
-						DepthFunctionStr.push_back(DepthStencilDesc[i]);
-					}
-				}
-				bUsesCustomDepthStencilState = true;
-				Desc.DepthFunction = ParseComparisonFunction(DepthFunctionStr);
-			}
+			m_PrevJson = nlohmann::json::object();
 		}
+
+		// The write stage puts the json shader files in here as they finish
+		std::error_code ec;
+		std::filesystem::create_directories(m_DstPath, ec);
+		if (ec)
 		{
-			size_t DepthEnableLoc = DepthStencilDesc.find("StencilEnable");
-			if (DepthEnableLoc != std::string::npos)
-			{
-				std::string StencilEnableStr;
-				size_t AssignmentOperatorLoc = DepthStencilDesc.find("=", DepthEnableLoc);
-				size_t EndAssignmentLoc = DepthStencilDesc.find(";", AssignmentOperatorLoc);
-				for (size_t i = AssignmentOperatorLoc + 1; i < EndAssignmentLoc; i++)
-				{
-					if (DepthStencilDesc[i] != ' ' && DepthStencilDesc[i] != '\n')
-					{
-						StencilEnableStr.push_back(DepthStencilDesc[i]);
-					}
-				}
-				bUsesCustomDepthStencilState = true;
-				Desc.bStencilEnable = ParseBool(StencilEnableStr);
-			}
+			std::cout << "[ERROR] Failed to create output directory " << m_DstPath.string() << ": " << ec.message() << std::endl;
+			return false;
 		}
-		OutDesc.DepthStencilState = Desc;
 	}
 
-	size_t RasterizerStateLoc = DescStr.find("RasterState");
+	// DXC has the hardware threads, the other stages are
+	// mostly waiting on it or the disk and only need a few
+	const uint32_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	const uint32_t cpuStageJobs = std::clamp(hardwareThreads / 4, 1u, 4u);
+	const uint32_t numRead = m_Jobs.Read ? m_Jobs.Read : 1;
+	const uint32_t numFrontEnd = m_Jobs.FrontEnd ? m_Jobs.FrontEnd : cpuStageJobs;
+	const uint32_t numEncode = m_Jobs.Encode ? m_Jobs.Encode : cpuStageJobs;
+	const uint32_t numWrite = m_Jobs.Write ? m_Jobs.Write : 1;
+	const uint32_t queueDepth = m_Jobs.QueueDepth ? m_Jobs.QueueDepth : 16;
 
-	if (RasterizerStateLoc != std::string::npos)
-	{
-		GFX_RASTER_DESC RasterDesc = CreateDefaultGFXRasterDesc();
-		size_t BeginDeclLoc = DescStr.find('{', RasterizerStateLoc);
-
-		std::string RasterDescStr = ParseToEndOfScope(DescStr, BeginDeclLoc);
+	BoundedQueue<BUILD_ITEM> readQueue(queueDepth);
+	BoundedQueue<BUILD_ITEM> frontEndQueue(queueDepth);
+	BoundedQueue<BUILD_ITEM> encodeQueue(queueDepth);
+	BoundedQueue<ENCODED_PIPELINE> writeQueue(queueDepth);
+	std::atomic<bool> writeFailed = false;
+	// A pipeline that couldn't be read or parsed never reaches the compiler,
+	// WaitForCompiles doesn't know about it
+	std::atomic<bool> loadFailed = false;
 
+	// Started back to front so every stage has somewhere to put its output
+	BuildStage writeStage;
+	writeStage.Start(numWrite, [&]() {
+		ENCODED_PIPELINE encoded;
+		while (writeQueue.Pop(encoded))
 		{
-			size_t FillSolidLoc = RasterDescStr.find("FillSolid");
-			if (FillSolidLoc != std::string::npos)
+			if (!WritePipelineJson(encoded.Filename, encoded.Shaders, encoded.Metadata))
 			{
-				std::string FillSolidStr;
-				size_t AssignmentOperatorLoc = RasterDescStr.find("=", FillSolidLoc);
-				size_t EndAssignmentLoc = RasterDescStr.find(";", AssignmentOperatorLoc);
-				for (size_t i = AssignmentOperatorLoc + 1; i < EndAssignmentLoc; i++)
-				{
-					if (RasterDescStr[i] != ' ' && RasterDescStr[i] != '\n')
-					{
-						FillSolidStr.push_back(RasterDescStr[i]);
-					}
-				}
-				RasterDesc.bFillSolid = ParseBool(FillSolidStr);
+				writeFailed = true;
 			}
 		}
+	});
+
+	BuildStage encodeStage;
+	encodeStage.Start(numEncode, [&]() {
+		BUILD_ITEM item;
+		while (encodeQueue.Pop(item))
 		{
-			size_t CullEnableLoc = RasterDescStr.find("Cull");
-			if (CullEnableLoc != std::string::npos)
-			{
-				std::string CullEnableStr;
-				size_t AssignmentOperatorLoc = RasterDescStr.find("=", CullEnableLoc);
-				size_t EndAssignmentLoc = RasterDescStr.find(";", AssignmentOperatorLoc);
-				for (size_t i = AssignmentOperatorLoc + 1; i < EndAssignmentLoc; i++)
-				{
-					if (RasterDescStr[i] != ' ' && RasterDescStr[i] != '\n')
-					{
-						CullEnableStr.push_back(RasterDescStr[i]);
-					}
-				}
-				RasterDesc.bCull = ParseBool(CullEnableStr);
-			}
+			EncodePipeline(item, writeQueue);
 		}
+	});
+
+	BuildStage frontEndStage;
+	frontEndStage.Start(numFrontEnd, [&]() {
+		BUILD_ITEM item;
+		while (frontEndQueue.Pop(item))
 		{
-			size_t CounterClockwiseForwardLoc = RasterDescStr.find("IsCounterClockwiseForward");
-			if (CounterClockwiseForwardLoc != std::string::npos)
+			if (!LoadFile(item, encodeQueue))
 			{
-				std::string CounterClockwiseForwardStr;
-				size_t AssignmentOperatorLoc = RasterDescStr.find("=", CounterClockwiseForwardLoc);
-				size_t EndAssignmentLoc = RasterDescStr.find(";", AssignmentOperatorLoc);
-				for (size_t i = AssignmentOperatorLoc + 1; i < EndAssignmentLoc; i++)
-				{
-					if (RasterDescStr[i] != ' ' && RasterDescStr[i] != '\n')
-					{
-						CounterClockwiseForwardStr.push_back(RasterDescStr[i]);
-					}
-				}
-				RasterDesc.bIsCounterClockwiseForward = ParseBool(CounterClockwiseForwardStr);
+				std::cout << "[ERROR] Failed to compile shader " << item.Filename << std::endl;
+				loadFailed = true;
 			}
 		}
+	});
+
+	BuildStage readStage;
+	readStage.Start(numRead, [&]() {
+		BUILD_ITEM item;
+		while (readQueue.Pop(item))
 		{
-			size_t DepthClipEnableLoc = RasterDescStr.find("DepthClipEnable");
-			if (DepthClipEnableLoc != std::string::npos)
+			FILE_SNAPSHOT source = { };
+			if (!ReadFileSnapshot(item.Path, source) || source.Contents->empty())
 			{
-				std::string DepthClipEnableStr;
-				size_t AssignmentOperatorLoc = RasterDescStr.find("=", DepthClipEnableLoc);
-				size_t EndAssignmentLoc = RasterDescStr.find(";", AssignmentOperatorLoc);
-				for (size_t i = AssignmentOperatorLoc + 1; i < EndAssignmentLoc; i++)
-				{
-					if (RasterDescStr[i] != ' ' && RasterDescStr[i] != '\n')
-					{
-						DepthClipEnableStr.push_back(RasterDescStr[i]);
-					}
-				}
-				RasterDesc.bDepthClipEnable = ParseBool(DepthClipEnableStr);
+				std::cout << "[ERROR] Failed to read shader " << item.Filename << std::endl;
+				loadFailed = true;
+				continue;
 			}
+			item.Source = source.Contents;
+			item.SourceStamp = MakeFileStamp(item.Path, source);
+			frontEndQueue.Push(std::move(item));
 		}
+	});
 
-		OutDesc.RasterDesc = RasterDesc;
-	}
-
+	// The packs, the json dump and the loader know a pipeline by its name
+	// alone, foo.gfx and foo.cmpt would take each other's place in them
+	std::map<std::string, uint32_t> nameCounts;
+	for (const auto& file : std::filesystem::directory_iterator(m_SrcPath))
 	{
-		size_t TopologyTypeLoc = DescStr.find("PolygonType");
-		if (TopologyTypeLoc != std::string::npos)
+		if (std::filesystem::is_regular_file(file.status()) && IsPipelineExt(GetFileSuffix(file.path().filename().string())))
 		{
-			std::string TopologyStr;
-			size_t AssignmentOperatorLoc = DescStr.find("=", TopologyTypeLoc);
-			size_t EndAssignmentLoc = DescStr.find(";", AssignmentOperatorLoc);
-			for (size_t i = AssignmentOperatorLoc + 1; i < EndAssignmentLoc; i++)
-			{
-				if (DescStr[i] != ' ' && DescStr[i] != '\n')
-				{
-					TopologyStr.push_back(DescStr[i]);
-				}
-			}
-			OutDesc.PolygonType = ParsePolygonType(TopologyStr);
+			nameCounts[file.path().stem().string()]++;
 		}
 	}
-}
+	bool duplicateNames = false;
 
-static bool IsSystemType(const VARIABLE_INFO& InVar)
-{
-	if (InVar.Type == "float" || InVar.Type == "float2" || InVar.Type == "float3" || InVar.Type == "float4" ||
-		InVar.Type == "int" || InVar.Type == "int2" || InVar.Type == "int3" || InVar.Type == "int4" ||
-		InVar.Type == "uint32" || InVar.Type == "uint322" || InVar.Type == "uint323" || InVar.Type == "uint324" ||
-		InVar.Type == "float2x2" || InVar.Type == "float2x3" || InVar.Type == "float2x4" ||
-		InVar.Type == "float3x2" || InVar.Type == "float3x3" || InVar.Type == "float3x4" ||
-		InVar.Type == "float4x2" || InVar.Type == "float4x3" || InVar.Type == "float4x4" ||
-		InVar.Type == "bool")
+	// Discover, everything is found before anything is read so the
+	// pipelines that took longest last time can go first
+	std::vector<BUILD_ITEM> items;
+	for (const auto& file : std::filesystem::directory_iterator(m_SrcPath))
 	{
-		return true;
-	}
-	return false;
-}
+		// If its a directory or not file, skip
+		if (!std::filesystem::is_regular_file(file.status()))
+		{
+			continue;
+		}
 
-static std::string FindStructDeclaration(const std::string& InFile, const std::string& StructureName)
-{
-	std::string File = InFile;
-	std::string Result;
-	size_t CurrentLoc = 0;
+		std::string filename = file.path().filename().string();
 
-	bool bFound = false;
+		std::string ext = GetFileSuffix(filename);
+		if (!IsPipelineExt(ext))
+		{
+			continue;
+		}
 
-	for (size_t i = 0; i < 800; i++)
-	{
-		if (i == 799)
+		if (nameCounts[file.path().stem().string()] > 1)
 		{
-			__debugbreak();
+			std::cout << "[ERROR] " << filename << " has the same name as another pipeline, pipelines are looked up by name so one of them has to be renamed" << std::endl;
+			duplicateNames = true;
+			continue;
 		}
 
-		CurrentLoc = InFile.find("struct", CurrentLoc);
+		m_Sources.insert(filename);
 
-		if (CurrentLoc != std::string::npos)
 		{
-			for (; InFile[CurrentLoc] == ' ' || InFile[CurrentLoc] == '\n'; CurrentLoc++) {}
-
-			size_t BeginDefinitionLoc = InFile.find('{', CurrentLoc);
+			std::lock_guard<std::mutex> lock(m_Lock);
 
-			std::string CheckName;
-			for (i = CurrentLoc + 6; i != BeginDefinitionLoc; i++)
+			// Every target's previous pack has to have it, and when dumping json the
+			// previous dump too, otherwise the pipeline would be missing from the new one
+			std::string pipelineName = file.path().stem().string();
+			uint32_t prevIdx[SHADER_COMPILATION_TYPE_NUM][COMPILER_FLAGS_NUM] = { };
+			bool inPrevPacks = true;
+			for (uint32_t x = 0; x < SHADER_COMPILATION_TYPE_NUM && inPrevPacks; x++)
 			{
-				char C = InFile[i];
-				if (C != ' ' && C != '\n')
+				for (uint32_t y = 0; y < COMPILER_FLAGS_NUM && inPrevPacks; y++)
 				{
-					CheckName.push_back(C);
+					inPrevPacks = !(targets & ShaderTargetBit((ShaderCompilationType)x, (CompilerFlags)y)) ||
+						m_PrevPacks[x][y].GetView().FindPipeline(pipelineName, prevIdx[x][y]);
 				}
 			}
-			if (CheckName == StructureName)
+
+			if (inPrevPacks)
 			{
-				bFound = true;
-				break;
+				for (uint32_t x = 0; x < SHADER_COMPILATION_TYPE_NUM; x++)
+				{
+					for (uint32_t y = 0; y < COMPILER_FLAGS_NUM; y++)
+					{
+						if (targets & ShaderTargetBit((ShaderCompilationType)x, (CompilerFlags)y))
+						{
+							m_PrevPipelines[x][y][filename] = prevIdx[x][y];
+						}
+					}
+				}
 			}
-			else
+
+			if (m_Deps.IsUpToDate(filename) &&
+				inPrevPacks &&
+				(!m_WriteJson || m_PrevJson.contains(pipelineName)))
 			{
-				CurrentLoc++;
+				std::cout << "[INFO] Up to date: " << filename << std::endl;
+				if (m_WriteJson)
+				{
+					m_Json[pipelineName] = m_PrevJson[pipelineName];
+				}
+				continue;
 			}
+
+			// Until it's built successfully it has to be rebuilt next time
+			m_Deps.RemovePipeline(filename);
+			m_Queued.insert(filename);
 		}
-		else
-		{
-			__debugbreak();
-		}
+
+		std::cout << "[INFO] Loading shader: " << filename << std::endl;
+
+		BUILD_ITEM item;
+		item.Path = file.path();
+		item.Filename = std::move(filename);
+		item.Ext = std::move(ext);
+		items.push_back(std::move(item));
 	}
-	if (bFound)
+
+	// Before anything is compiled, units of deleted pipelines would skew the mean
+	m_Compiler->GetHistory().RetainPipelines(m_Sources);
+
+	// Longest first keeps one slow pipeline from starting last and running alone at the end.
+	// Ones never built before have no estimate, they go first since they could be anything.
+	std::vector<std::pair<double, size_t>> order;
+	order.reserve(items.size());
+	for (size_t i = 0; i < items.size(); i++)
 	{
-		for (; InFile[CurrentLoc] != '{'; CurrentLoc++)
+		double predictedMs = 0.0;
+		if (!m_Compiler->GetHistory().PredictPipeline(items[i].Filename, predictedMs))
 		{
-			char C = InFile[CurrentLoc];
-			Result.push_back(C);
+			predictedMs = std::numeric_limits<double>::infinity();
 		}
-		CurrentLoc--;
+		order.emplace_back(predictedMs, i);
 	}
+	std::stable_sort(order.begin(), order.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
 
-	Result += "{\n" + ParseToEndOfScope(InFile, CurrentLoc) + "\n};";
-	return Result;
-}
-
-static std::string FindFunctionDeclaration(const std::string& File, const std::string& FunctionName)
-{
-	std::string Result;
-	size_t FuncNameDecl = File.find(FunctionName);
-	size_t CurrentPos = FuncNameDecl;
-
-	// Here we try to find the return type
-
-	if (FuncNameDecl == std::string::npos)
+	for (const auto& entry : order)
 	{
-		__debugbreak();
-		return "";
+		readQueue.Push(std::move(items[entry.second]));
 	}
 
-	for (; File[CurrentPos] != ' ' && File[CurrentPos] != '\n'; CurrentPos--) {}
-	CurrentPos--;
-	for (; File[CurrentPos] != ' ' && File[CurrentPos] != '\n'; CurrentPos--) {}
-	CurrentPos--;
-
-	size_t EndFuncDecl = File.find(')', FuncNameDecl);
+	// Each stage drains before the one after it is told nothing more is coming
+	readQueue.Close();
+	readStage.Join();
+	frontEndQueue.Close();
+	frontEndStage.Join();
 
-	for (; CurrentPos < EndFuncDecl + 2; CurrentPos++)
+	uint32_t headerHits = 0;
+	uint32_t headersParsed = 0;
+	m_Headers.GetStats(headerHits, headersParsed);
+	if (headerHits + headersParsed > 0)
 	{
-		if (File[CurrentPos] != '{')
-		{
-			Result.push_back(File[CurrentPos]);
-		}
-		else
-		{
-			break;
-		}
+		std::cout << "[INFO] Headers: " << headersParsed << " parsed, " << headerHits << " reused" << std::endl;
+	}
+	if (m_FrontEndHits > 0)
+	{
+		std::cout << "[INFO] Front end skipped for " << m_FrontEndHits << " unchanged pipelines" << std::endl;
 	}
-	return Result;
-}
 
+	// Every compile group has been handed to the encode stage once this returns
+	const bool compiled = m_Compiler->WaitForCompiles();
+	encodeQueue.Close();
+	encodeStage.Join();
+	writeQueue.Close();
+	writeStage.Join();
 
+	if (!compiled)
+	{
+		std::cout << "[ERROR] One or more shaders failed to compile" << std::endl;
+		return false;
+	}
 
-void Init()
-{
-	GEnableDepthWriteDesc = CreateDefaultGFXDepthStencilDesc();
-	GDisableDepthWriteDesc = GEnableDepthWriteDesc;
-	GDisableDepthWriteDesc.bDepthEnable = false;
+	return !writeFailed && !loadFailed && !duplicateNames;
 }
 
-void GetResourceCounts(const std::string& InFile, PIPELINE_RESOURCE_COUNTERS& Counts)
+bool PipelineCompiler::WriteToFile()
 {
-	uint8_t& OutNumConstantBuffers = Counts.NumConstantBuffers;
-	uint8_t& OutNumSamplers = Counts.NumSamplers;
-	uint8_t& OutNumShaderResourceViews = Counts.NumShaderResourceViews;
-	uint8_t& OutNumUnorderedAccessViews = Counts.NumUnorderedAccessViews;
-	std::string ByteCodeAsString = InFile;
+	std::error_code ec;
+	std::filesystem::create_directories(m_DstPath, ec);
+	if (ec)
 	{
-		uint8_t NumConstBuffers = 0;
-
-		for (size_t i = 0; i < ByteCodeAsString.length(); i++)
-		{
-			i = ByteCodeAsString.find("register(b", i);
-			if (i == std::string::npos)
-				break;
-			NumConstBuffers++;
-		}
-		OutNumConstantBuffers = NumConstBuffers;
+		std::cout << "[ERROR] Failed to create output directory " << m_DstPath.string() << ": " << ec.message() << std::endl;
+		return false;
 	}
+
+	// The encode and write stages of Load already recorded the inputs and wrote
+	// the json shader files. The packs are put together here, carried over and
+	// freshly compiled pipelines sorted together by PackOrder, so they come out
+	// the same whichever were rebuilt and however the stages interleaved.
+	std::map<std::string, BUILD_ITEM> compiled;
+	for (auto& pipeline : m_GfxPipelines)
 	{
-		uint8_t NumSamplers = 0;
-		for (size_t i = 0; i < ByteCodeAsString.length(); i++)
+		if (AllCompiled(GetGraphicsShaders(*pipeline.second)))
 		{
-			i = ByteCodeAsString.find("register(s", i);
-			if (i == std::string::npos)
-				break;
-			NumSamplers++;
+			compiled[pipeline.first].Gfx = pipeline.second.get();
 		}
-		OutNumSamplers = NumSamplers;
 	}
+	for (auto& pipeline : m_CmptPipelines)
 	{
-		uint8_t NumShaderResources = 0;
-		for (size_t i = 0; i < ByteCodeAsString.length(); i++)
+		if (pipeline.second->CS.WasCompiled)
 		{
-			i = ByteCodeAsString.find("register(t", i);
-			if (i == std::string::npos)
-				break;
-			NumShaderResources++;
+			compiled[pipeline.first].Cmpt = pipeline.second.get();
 		}
-		OutNumShaderResourceViews = NumShaderResources;
 	}
+	for (auto& pipeline : m_RayPipelines)
 	{
-		uint8_t NumUnorderedAccessViews = 0;
-		for (size_t i = 0; i < ByteCodeAsString.length(); i++)
+		if (pipeline.second->Library.WasCompiled)
 		{
-			i = ByteCodeAsString.find("register(u", i);
-			if (i == std::string::npos)
-				break;
-			NumUnorderedAccessViews++;
+			compiled[pipeline.first].Ray = pipeline.second.get();
 		}
-		OutNumUnorderedAccessViews = NumUnorderedAccessViews;
-	}
-}
-
-FULL_PIPELINE_DESCRIPTOR ParseGraphicsShader(const std::string& InFile, const std::string& FileName)
-{
-	std::string File = InFile;
-	RemoveComments(File);
-
-	FULL_PIPELINE_DESCRIPTOR PipelineDesc = CreateDefaultDescriptor();
-
-	auto Find = File.find("CAMERA_CONSTANTS");
-	if (Find != std::string::npos)
-	{
-		File.replace(Find, 16, 1, ' ');
-		std::string CameraConstantsStr = "cbuffer CameraConstants : register(b0)\n{\n\tmatrix Model;\n\tmatrix View;\n\tmatrix Projection;\n\tfloat4 Position;\n}";
-		File.insert(Find, CameraConstantsStr.c_str(), 109);
 	}
 
-	std::string Resources;
-	std::string PipelineDescStr;
-	size_t ResourcesStartLoc;
-	bool bUsesCustomDepthStencil = false;
-
-	GetResourceCounts(InFile, PipelineDesc.Counts);
+	const uint32_t targets = m_Compiler->GetTargets();
 
-	// Find Resources
+	// A pipeline that failed to build keeps its last good build. The dependency
+	// database doesn't have it, so it's tried again the next time.
+	for (const std::string& filename : m_Queued)
 	{
-		ResourcesStartLoc = File.find("Resources", 0);
-		if (ResourcesStartLoc != std::string::npos)
+		bool inPrevPacks = false;
+		for (uint32_t x = 0; x < SHADER_COMPILATION_TYPE_NUM && !inPrevPacks; x++)
 		{
-			File.erase(ResourcesStartLoc, 9);
-			Resources = ParseToEndOfScope(File, ResourcesStartLoc);
-			size_t Range = Resources.length() + 4;
-			RemoveTabs(Resources);
-			CutStringRange(File, ResourcesStartLoc, Range);
+			for (uint32_t y = 0; y < COMPILER_FLAGS_NUM && !inPrevPacks; y++)
+			{
+				inPrevPacks = m_PrevPipelines[x][y].find(filename) != m_PrevPipelines[x][y].end();
+			}
 		}
-	}
-	{
-		size_t PipelineLoc = File.find("Pipeline");
-		if (PipelineLoc == std::string::npos)
+
+		if (!inPrevPacks || compiled.find(filename) != compiled.end())
 		{
-			// Here there is a very real possibility that they want to use the default pipeline, therefore just make a default one but find the input layout
+			continue;
 		}
-		else
-		{
-			File.erase(PipelineLoc, 8);
 
-			PipelineDescStr = ParseToEndOfScope(File, PipelineLoc);
-			size_t Range = PipelineDescStr.length() + 4;
-			CutStringRange(File, PipelineLoc + 1, Range);
-			RemoveTabs(PipelineDescStr);
-			FillDescriptor(PipelineDescStr, PipelineDesc, bUsesCustomDepthStencil);
+		std::cout << "[WARN] Keeping the last good build of " << filename << std::endl;
+		const std::string pipelineName = std::filesystem::path(filename).stem().string();
+		if (m_WriteJson && m_PrevJson.contains(pipelineName))
+		{
+			m_Json[pipelineName] = m_PrevJson[pipelineName];
 		}
 	}
-	{
-		FUNCTION_INFO VSMainInfo = GetFunctionInfo(FindFunctionDeclaration(File, "VSMain"));
 
-		std::vector<VARIABLE_INFO> VSInputs;
-		for (uint32_t i = 0; i < VSMainInfo.Parameters.size(); i++)
+	for (uint32_t x = 0; x < SHADER_COMPILATION_TYPE_NUM; x++)
+	{
+		for (uint32_t y = 0; y < COMPILER_FLAGS_NUM; y++)
 		{
-			VARIABLE_INFO& VarInfo = VSMainInfo.Parameters[i];
+			const std::filesystem::path packPath = m_DstPath / PackFileName(x, y);
+			if (!(targets & ShaderTargetBit((ShaderCompilationType)x, (CompilerFlags)y)))
+			{
+				// From a build with other targets, a loader mustn't pick it up
+				std::filesystem::remove(packPath, ec);
+				continue;
+			}
 
-			// If its a system type then we assume that the semantics are passed in here
-			if (IsSystemType(VarInfo))
+			const std::map<std::string, uint32_t>& prev = m_PrevPipelines[x][y];
+
+			std::vector<std::string> filenames;
+			for (const auto& pipeline : prev)
+			{
+				filenames.push_back(pipeline.first);
+			}
+			for (const auto& pipeline : compiled)
 			{
-				if (VarHasSemantic(VarInfo) && VarInfo.Semantic.find("SV_") == std::string::npos)
+				if (prev.find(pipeline.first) == prev.end())
 				{
-					VSInputs.push_back(VarInfo);
+					filenames.push_back(pipeline.first);
 				}
 			}
-			else
+			std::sort(filenames.begin(), filenames.end(), PackOrder);
+
+			ShaderPackWriter pack(x == DXIL ? SHADER_PACK_API_DXIL : SHADER_PACK_API_SPIRV, y);
+			for (const std::string& filename : filenames)
 			{
-				std::string StructName = VarInfo.Type;
-				std::string StructDeclaration = FindStructDeclaration(File, StructName);
-				STRUCT_INFO StructureInfo = GetStructInfo(StructDeclaration);
+				auto fresh = compiled.find(filename);
+				if (fresh == compiled.end())
+				{
+					pack.AddPipelineFromPack(m_PrevPacks[x][y].GetView(), prev.find(filename)->second);
+					continue;
+				}
 
-				for (auto& Var : StructureInfo.Variables)
+				const std::string name = std::filesystem::path(filename).stem().string();
+				if (fresh->second.Gfx)
 				{
-					if (VarHasSemantic(Var) && Var.Semantic.find("SV_") == std::string::npos)
-					{
-						VSInputs.push_back(Var);
-					}
+					pack.AddGraphicsPipeline(name, *fresh->second.Gfx);
+				}
+				else if (fresh->second.Cmpt)
+				{
+					pack.AddComputePipeline(name, *fresh->second.Cmpt);
+				}
+				else if (fresh->second.Ray)
+				{
+					pack.AddRaytracingPipeline(name, *fresh->second.Ray);
 				}
 			}
-		}
-		{
-			GFX_INPUT_LAYOUT_DESC InputLayoutDesc;
-			for (auto& Parameter : VSInputs)
+
+			if (!pack.Write(packPath))
 			{
-				GFX_INPUT_ITEM_DESC InputItem;
-				InputItem.Name = Parameter.Semantic;
-				InputItem.ItemFormat = TypeToItemFormat(Parameter.Type);
-				InputLayoutDesc.InputItems.push_back(InputItem);
+				return false;
 			}
-			PipelineDesc.InputLayout = InputLayoutDesc;
 		}
 	}
+	std::filesystem::remove(m_DstPath / s_CombinedPackFileName, ec);
 
-	size_t NumRenderTargets = 0;
-
+	if (m_WriteJson && !WriteFileAtomic(m_DstPath / s_ManifestFileName, m_Json.dump(1, '\t')))
 	{
-		std::string SearchStr = "SV_TARGET_";
-		for (size_t i = 0; i < 8; i++)
-		{
-			SearchStr[9] = std::to_string(i)[0];
-			size_t RTFoundLoc = File.find(SearchStr, 0);
+		std::cout << "[ERROR] Failed to write " << (m_DstPath / s_ManifestFileName).string() << std::endl;
+		return false;
+	}
 
-			if (RTFoundLoc != std::string::npos)
-			{
-				NumRenderTargets++;
-			}
-			else
-			{
-				break;
-			}
-		}
+	// Losing it only costs the next build its ordering
+	if (!m_Compiler->GetHistory().Save(m_DstPath / s_CompileHistoryFileName))
+	{
+		std::cout << "[WARN] Failed to write " << (m_DstPath / s_CompileHistoryFileName).string() << std::endl;
 	}
 
+	m_Deps.RetainPipelines(m_Sources);
+	return m_Deps.Save(m_DstPath / s_DependencyDbFileName);
+}
+
+void PipelineCompiler::EncodePipeline(const BUILD_ITEM& item, BoundedQueue<ENCODED_PIPELINE>& writeQueue)
+{
+	ENCODED_PIPELINE encoded;
+	encoded.Filename = item.Filename;
+
+	if (item.Gfx)
 	{
-		std::string FullShader = File;
-		if (ResourcesStartLoc != std::string::npos)
+		const FULL_PIPELINE_DESCRIPTOR& desc = *item.Gfx;
+		const std::vector<const SHADER*> compiledShaders = GetGraphicsShaders(desc);
+		if (!AllCompiled(compiledShaders))
 		{
-			FullShader.insert(ResourcesStartLoc, Resources.c_str());
+			return;
 		}
-		bool bHasHullShader = (File.find("HSMain", 0) != std::string::npos);
-		bool bHasGeometryShader = (File.find("GSMain", 0) != std::string::npos);
-		bool bHasDomainShader = (File.find("DSMain", 0) != std::string::npos);
 
-		PipelineDesc.VS = CompileVertexShader(FullShader, _placeholder_);
-		PipelineDesc.PS = CompilePixelShader(FullShader, _placeholder_);
+		RecordPipelineInputs(item, compiledShaders);
 
-		if (PipelineDesc.VS.CompiledStages[0].ByteCode.size() == 0)
-		{
-			std::cout << "[ERROR] " << FileName << " Vertex Shader Failed to compile" << std::endl;
-			std::cin.get();
-			return ParseGraphicsShader(ReadEntireFile(FileName), FileName);
-		}
-		if (PipelineDesc.PS.CompiledStages[0].ByteCode.size() == 0)
+		if (!m_WriteJson)
 		{
-			std::cout << "[ERROR] " << FileName << " Pixel Shader Failed to compile" << std::endl;
-			std::cin.get();
-			return ParseGraphicsShader(ReadEntireFile(FileName), FileName);
+			return;
 		}
 
-		if (bHasHullShader)
+		encoded.Shaders = "{\"VertexShader\":";
+		SerializeShader(&desc.VS, encoded.Shaders);
+		encoded.Shaders += ",\"PixelShader\":";
+		SerializeShader(&desc.PS, encoded.Shaders);
+		if (HasHullShader(desc))
 		{
-			PipelineDesc.HS = CompileHullShader(FullShader, _placeholder_);
-			if (PipelineDesc.HS.CompiledStages[0].ByteCode.size() == 0)
-			{
-				std::cout << "[ERROR] " << FileName << " Hull Shader Failed to compile" << std::endl;
-				std::cin.get();
-				return ParseGraphicsShader(ReadEntireFile(FileName), FileName);
-			}
+			encoded.Shaders += ",\"HullShader\":";
+			SerializeShader(&desc.HS, encoded.Shaders);
 		}
-		if (bHasDomainShader)
+		if (HasDomainShader(desc))
 		{
-			PipelineDesc.DS = CompileDomainShader(FullShader, _placeholder_);
-			if (PipelineDesc.DS.CompiledStages[0].ByteCode.size() == 0)
-			{
-				std::cout << "[ERROR] " << FileName << " Domain Shader Failed to compile" << std::endl;
-				std::cin.get();
-				return ParseGraphicsShader(ReadEntireFile(FileName), FileName);
-			}
+			encoded.Shaders += ",\"DomainShader\":";
+			SerializeShader(&desc.DS, encoded.Shaders);
 		}
-		if (bHasGeometryShader)
+		if (HasGeometryShader(desc))
 		{
-			PipelineDesc.GS = CompileGeometryShader(FullShader, _placeholder_);
-			if (PipelineDesc.GS.CompiledStages[0].ByteCode.size() == 0)
-			{
-				std::cout << "[ERROR] " << FileName << " Geometry Shader Failed to compile" << std::endl;
-				std::cin.get();
-				return ParseGraphicsShader(ReadEntireFile(FileName), FileName);
-			}
+			encoded.Shaders += ",\"GeometryShader\":";
+			SerializeShader(&desc.GS, encoded.Shaders);
 		}
+		encoded.Shaders += '}';
 
-		if (bUsesCustomDepthStencil == false)
+		GraphicsPipelineToJson(desc, encoded.Metadata);
+	}
+	else if (item.Cmpt)
+	{
+		const COMPUTE_PIPELINE_DESC& desc = *item.Cmpt;
+		if (!desc.CS.WasCompiled)
 		{
-			PipelineDesc.DepthStencilState = GEnableDepthWriteDesc;
+			return;
 		}
-	}
 
-	PipelineDesc.NumRenderTargets = static_cast<uint32_t>(NumRenderTargets);
+		RecordPipelineInputs(item, { &desc.CS });
 
-	std::cout << "[MESSAGE] Compiled " << FileName << std::endl;
-
-	return PipelineDesc;
-}
+		if (!m_WriteJson)
+		{
+			return;
+		}
 
-COMPUTE_PIPELINE_DESC ParseComputeShader(const std::string& InFile, const std::string& FileName)
-{
-	COMPUTE_PIPELINE_DESC Result = {};
+		SerializeShader(&desc.CS, encoded.Shaders);
+		ComputePipelineToJson(desc, encoded.Metadata);
+	}
+	else if (item.Ray)
+	{
+		const RAYTRACING_PIPELINE_DESC& desc = *item.Ray;
+		if (!desc.Library.WasCompiled)
+		{
+			return;
+		}
 
-	GetResourceCounts(InFile, Result.Counts);
+		RecordPipelineInputs(item, { &desc.Library });
 
-	Result.CS = CompileComputeShader(InFile, _placeholder_);
+		if (!m_WriteJson)
+		{
+			return;
+		}
 
-	if (Result.CS.CompiledStages[0].ByteCode.size() == 0)
+		SerializeShader(&desc.Library, encoded.Shaders);
+		RaytracingPipelineToJson(desc, encoded.Metadata);
+	}
+	else
 	{
-		std::cout << "[ERROR] Failed to compile compute shader: " << FileName;
-		std::cin.get();
-		return ParseComputeShader(ReadEntireFile(FileName), FileName);
+		return;
 	}
-	std::cout << "[MESSAGE] Compiled " << FileName << std::endl;
 
-	return Result;
+	writeQueue.Push(std::move(encoded));
 }
 
-RAYTRACING_PIPELINE_DESC ParseRaytracingShader(const std::string& InFile, const std::string& FileName)
-{
-	RAYTRACING_PIPELINE_DESC Result = {};
-
-	GetResourceCounts(InFile, Result.Counts);
+bool PipelineCompiler::WritePipelineJson(
+	const std::string& filename,
+	const std::string& shaders,
+	nlohmann::json& metadata
+) {
+	std::string shaderReference = filename + ".json";
 
-	Result.Library = CompileRaytracingShader(InFile, _placeholder_);
-
-	// RayIntersection
-	// RayAnyHit
-	// RayClosestHit
-
-	std::string NoComments = InFile;
-	RemoveComments(NoComments);
+	if (!WriteFileAtomic(m_DstPath / shaderReference, shaders))
+	{
+		std::cout << "[ERROR] Failed to write " << (m_DstPath / shaderReference).string() << std::endl;
+		return false;
+	}
 
-	// Now we're safe to search for function names
-	// This is a naive approach however its *probably* good enough
+	metadata["ShaderReference"] = shaderReference;
 
-	// We're also assuming that "RayGen" and "RayMiss" are present already
+	std::lock_guard<std::mutex> lock(m_Lock);
+	m_Json[std::filesystem::path(filename).stem().string()] = metadata;
+	return true;
+}
 
-	if (NoComments.find("RayIntersection") != std::string::npos)
+void PipelineCompiler::RecordPipelineInputs(const BUILD_ITEM& item, const std::vector<const SHADER*>& compiledShaders)
+{
+	std::vector<FILE_STAMP> inputs = { item.SourceStamp };
+	for (const SHADER* shader : compiledShaders)
 	{
-		Result.bHasIntersection = true;
+		m_Compiler->GetShaderIncludes(shader, inputs);
 	}
 
-	if (NoComments.find("RayAnyHit") != std::string::npos)
+	std::lock_guard<std::mutex> lock(m_Lock);
+	m_Deps.SetPipelineInputs(item.Filename, inputs);
+}
+
+bool PipelineCompiler::LoadFile(const BUILD_ITEM& item, BoundedQueue<BUILD_ITEM>& encodeQueue)
+{
+	if (item.Ext == "ray")
 	{
-		Result.bHasAnyHit = true;
+		return LoadRayFile(item, encodeQueue);
 	}
-
-	if (NoComments.find("RayClosestHit") != std::string::npos)
+	else if (item.Ext == "gfx")
 	{
-		Result.bHasClosestHit = true;
+		return LoadGfxFile(item, encodeQueue);
 	}
-
-	if (Result.Library.CompiledStages[0].ByteCode.size() == 0)
+	else if (item.Ext == "cmpt")
 	{
-		std::cout << "[ERROR] Failed to compile raytracing shader: " << FileName;
-		std::cin.get();
-		return ParseRaytracingShader(ReadEntireFile(FileName), FileName);
+		return LoadCmptFile(item, encodeQueue);
 	}
-
-	std::cout << "[MESSAGE] Compiled " << FileName << std::endl;
-
-	return Result;
-}
-
-FULL_PIPELINE_DESCRIPTOR LoadGraphicsPipeline(const std::string& ShaderFile)
-{
-	std::string File = ReadEntireFile(ShaderFile);
-	FULL_PIPELINE_DESCRIPTOR PipelineDesc = ParseGraphicsShader(File, ShaderFile);
-	return PipelineDesc;
-}
-
-COMPUTE_PIPELINE_DESC LoadComputePipeline(const std::string& ShaderFile)
-{
-	std::string File = ReadEntireFile(ShaderFile);
-	COMPUTE_PIPELINE_DESC PipelineDesc = ParseComputeShader(File, ShaderFile);
-	return PipelineDesc;
-}
-
-RAYTRACING_PIPELINE_DESC LoadRaytracingPipeline(const std::string& ShaderFile)
-{
-	std::string File = ReadEntireFile(ShaderFile);
-	RAYTRACING_PIPELINE_DESC PipelineDesc = ParseRaytracingShader(File, ShaderFile);
-	return PipelineDesc;
+	return false;
 }
-*/
 
-PipelineCompiler::PipelineCompiler(ShaderCompiler* compiler) :
-	m_Compiler(compiler)
+bool PipelineCompiler::LoadGfxFile(const BUILD_ITEM& item, BoundedQueue<BUILD_ITEM>& encodeQueue)
 {
-}
+	std::unique_ptr<FULL_PIPELINE_DESCRIPTOR> descPtr = std::make_unique<FULL_PIPELINE_DESCRIPTOR>();
+	FULL_PIPELINE_DESCRIPTOR& desc = *descPtr;
 
-void PipelineCompiler::SetSrcDir(const std::filesystem::path& path)
-{
-	m_SrcPath = path;
-}
+	const std::filesystem::path& path = item.Path;
+	const std::shared_ptr<const std::string>& source = item.Source;
 
-bool PipelineCompiler::Load()
-{
-	for (const auto& file : std::filesystem::directory_iterator(m_SrcPath))
+	const SHADER_CACHE_KEY frontEndKey = FrontEndCache::BuildKey("graphics", *source);
+	FRONTEND_RESULT frontEnd = { };
+	if (m_FrontEnd.Load(frontEndKey, frontEnd, desc) && FrontEndImportsCurrent(frontEnd))
 	{
-		// If its a directory or not file, skip
-		if (!std::filesystem::is_regular_file(file.status()))
+		m_FrontEndHits++;
+	}
+	else
+	{
+		desc = FULL_PIPELINE_DESCRIPTOR();
+		GraphicsAST ast(desc);
+
+		if (!LoadFileImpl(path, source, &ast, "graphics", frontEnd))
 		{
-			continue;
+			return false;
 		}
 
-		std::string filename = file.path().filename().string();
+		// Left empty if the parser didn't see the entry point,
+		// compiling the vertex shader below reports that properly
+		ast.GetVertexInputLayout(VertexEntry, desc.InputLayout);
 
-		std::string ext = GetFileSuffix(filename);
+		frontEnd.OptionalStages =
+			(ast.GetFuncDecl(HullEntry) ? FRONTEND_STAGE_HULL : 0) |
+			(ast.GetFuncDecl(DomainEntry) ? FRONTEND_STAGE_DOMAIN : 0) |
+			(ast.GetFuncDecl(GeometryEntry) ? FRONTEND_STAGE_GEOMETRY : 0);
 
-		std::cout << "[INFO] Loading shader: " << filename << std::endl;
-		if (ext == "ray")
-		{
-			if (!LoadRayFile(file.path()))
-			{
-				std::cout << "[ERROR] Failed to compile shader " << filename << std::endl;
-			}
-		}
-		else if (ext == "gfx")
-		{
-			if (!LoadGfxFile(file.path()))
-			{
-				std::cout << "[ERROR] Failed to compile shader " << filename << std::endl;
-			}
-		}
-		else if (ext == "cmpt")
-		{
-			if (!LoadCmptFile(file.path()))
-			{
-				std::cout << "[ERROR] Failed to compile shader " << filename << std::endl;
-			}
-		}
+		m_FrontEnd.Store(frontEndKey, frontEnd, desc);
 	}
 
-	return true;
-}
+	std::shared_ptr<const std::string> toShader = CutPipelineBlock(source, frontEnd);
 
-void PipelineCompiler::WriteToFile(const std::filesystem::path& dstFile)
-{
-	std::ofstream outFile(dstFile.native());
-	outFile << m_Json;
-}
+	BUILD_ITEM encode;
+	encode.Filename = item.Filename;
+	encode.SourceStamp = item.SourceStamp;
+	encode.Gfx = &desc;
+	std::shared_ptr<SHADER_COMPILE_GROUP> group = m_Compiler->BeginGroup(item.Filename, [&encodeQueue, encode]() { encodeQueue.Push(encode); });
 
-bool PipelineCompiler::LoadGfxFile(const std::filesystem::path& path)
-{
-	FULL_PIPELINE_DESCRIPTOR desc = { };
-	GraphicsAST ast(desc);
+	// Vertex and pixel are required, the rest are only
+	// compiled if the entry point is actually there
+	bool result = true;
+	result &= m_Compiler->CompileVertexShader(toShader, &desc.VS, group);
+	result &= m_Compiler->CompilePixelShader(toShader, &desc.PS, group);
 
-	if (!LoadFileImpl(path, &ast, "graphics"))
+	if (frontEnd.OptionalStages & FRONTEND_STAGE_HULL)
 	{
-		return false;
+		result &= m_Compiler->CompileHullShader(toShader, &desc.HS, group);
+	}
+	if (frontEnd.OptionalStages & FRONTEND_STAGE_DOMAIN)
+	{
+		result &= m_Compiler->CompileDomainShader(toShader, &desc.DS, group);
+	}
+	if (frontEnd.OptionalStages & FRONTEND_STAGE_GEOMETRY)
+	{
+		result &= m_Compiler->CompileGeometryShader(toShader, &desc.GS, group);
 	}
 
-	// I know its bad we're opening the same file
-	// multiple times... TODO: fix?
-	std::string fullFile = ReadEntireFile(path.filename().string());
-
-	std::string toShader = CutPipelineBlock(fullFile, &ast);
-
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		m_GfxPipelines[item.Filename] = std::move(descPtr);
+	}
 
-	return true;
+	m_Compiler->EndGroup(group);
+	return result;
 }
 
-bool PipelineCompiler::LoadCmptFile(const std::filesystem::path& path)
+bool PipelineCompiler::LoadCmptFile(const BUILD_ITEM& item, BoundedQueue<BUILD_ITEM>& encodeQueue)
 {
-	COMPUTE_PIPELINE_DESC desc = { };
-	ComputeAST ast(desc);
+	std::unique_ptr<COMPUTE_PIPELINE_DESC> descPtr = std::make_unique<COMPUTE_PIPELINE_DESC>();
+	COMPUTE_PIPELINE_DESC& desc = *descPtr;
+
+	const std::filesystem::path& path = item.Path;
+	const std::shared_ptr<const std::string>& source = item.Source;
 
-	if (!LoadFileImpl(path, &ast, "compute"))
+	const SHADER_CACHE_KEY frontEndKey = FrontEndCache::BuildKey("compute", *source);
+	FRONTEND_RESULT frontEnd = { };
+	if (m_FrontEnd.Load(frontEndKey, frontEnd, desc) && FrontEndImportsCurrent(frontEnd))
 	{
-		return false;
+		m_FrontEndHits++;
+	}
+	else
+	{
+		desc = COMPUTE_PIPELINE_DESC();
+		ComputeAST ast(desc);
+
+		if (!LoadFileImpl(path, source, &ast, "compute", frontEnd))
+		{
+			return false;
+		}
+
+		m_FrontEnd.Store(frontEndKey, frontEnd, desc);
 	}
 
-	// I know its bad we're opening the same file
-	// multiple times... TODO: fix?
-	std::string fullFile = ReadEntireFile(path.filename().string());
+	std::shared_ptr<const std::string> toShader = CutPipelineBlock(source, frontEnd);
+
+	BUILD_ITEM encode;
+	encode.Filename = item.Filename;
+	encode.SourceStamp = item.SourceStamp;
+	encode.Cmpt = &desc;
+	std::shared_ptr<SHADER_COMPILE_GROUP> group = m_Compiler->BeginGroup(item.Filename, [&encodeQueue, encode]() { encodeQueue.Push(encode); });
 
-	std::string toShader = CutPipelineBlock(fullFile, &ast);
+	bool result = m_Compiler->CompileComputeShader(toShader, &desc.CS, group);
 
-	if (!m_Compiler->CompileComputeShader(toShader, &desc.CS))
 	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		m_CmptPipelines[item.Filename] = std::move(descPtr);
 	}
-	return true;
+
+	m_Compiler->EndGroup(group);
+	return result;
 }
 
-bool PipelineCompiler::LoadRayFile(const std::filesystem::path& path)
+bool PipelineCompiler::LoadRayFile(const BUILD_ITEM& item, BoundedQueue<BUILD_ITEM>& encodeQueue)
 {
-	RAYTRACING_PIPELINE_DESC desc = { };
-	RaytracingAST ast(desc);
+	std::unique_ptr<RAYTRACING_PIPELINE_DESC> descPtr = std::make_unique<RAYTRACING_PIPELINE_DESC>();
+	RAYTRACING_PIPELINE_DESC& desc = *descPtr;
 
-	if (!LoadFileImpl(path, &ast, "raytracing"))
+	const std::filesystem::path& path = item.Path;
+	const std::shared_ptr<const std::string>& source = item.Source;
+
+	const SHADER_CACHE_KEY frontEndKey = FrontEndCache::BuildKey("raytracing", *source);
+	FRONTEND_RESULT frontEnd = { };
+	if (m_FrontEnd.Load(frontEndKey, frontEnd, desc) && FrontEndImportsCurrent(frontEnd))
 	{
-		return false;
+		m_FrontEndHits++;
+	}
+	else
+	{
+		desc = RAYTRACING_PIPELINE_DESC();
+		RaytracingAST ast(desc);
+
+		if (!LoadFileImpl(path, source, &ast, "raytracing", frontEnd))
+		{
+			return false;
+		}
+
+		m_FrontEnd.Store(frontEndKey, frontEnd, desc);
 	}
 
-	// I know its bad we're opening the same file
-	// multiple times... TODO: fix?
-	std::string fullFile = ReadEntireFile(path.filename().string());
+	std::shared_ptr<const std::string> toShader = CutPipelineBlock(source, frontEnd);
 
-	std::string toShader = CutPipelineBlock(fullFile, &ast);
+	BUILD_ITEM encode;
+	encode.Filename = item.Filename;
+	encode.SourceStamp = item.SourceStamp;
+	encode.Ray = &desc;
+	std::shared_ptr<SHADER_COMPILE_GROUP> group = m_Compiler->BeginGroup(item.Filename, [&encodeQueue, encode]() { encodeQueue.Push(encode); });
 
-	if (!m_Compiler->CompileRaytracingShader(toShader, &desc.Library))
-	{
+	bool result = m_Compiler->CompileRaytracingShader(toShader, &desc.Library, group);
 
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		m_RayPipelines[item.Filename] = std::move(descPtr);
 	}
 
-	return true;
+	m_Compiler->EndGroup(group);
+	return result;
 }
 
-bool PipelineCompiler::LoadFileImpl(const std::filesystem::path& path, ASTBase* ast, const std::string& type)
-{
-	if (!ast->LoadFile(path))
+bool PipelineCompiler::LoadFileImpl(
+	const std::filesystem::path& path,
+	const std::shared_ptr<const std::string>& source,
+	ASTBase* ast,
+	const std::string& type,
+	FRONTEND_RESULT& outFrontEnd
+) {
+	ast->SetHeaderCache(&m_Headers);
+	if (!ast->LoadSource(source))
 	{
 		std::cout << "[ERROR] Failed to parse " << type << " shader" << path.filename().string() << std::endl;
 		return false;
@@ -1646,36 +862,62 @@ bool PipelineCompiler::LoadFileImpl(const std::filesystem::path& path, ASTBase*
 	if (!ast->Interpret())
 	{
 		std::cout << "[ERROR] Failed to load " << type << " shader " << path.filename().string() << std::endl;
+		return false;
+	}
+
+	outFrontEnd = FRONTEND_RESULT();
+	outFrontEnd.Counts = ast->GetCounts();
+	ast->GetPipelineBlockLines(outFrontEnd.PipelineBlockStart, outFrontEnd.PipelineBlockEnd);
+	ast->GetPipelineBlockRange(outFrontEnd.PipelineBlockBeginOffset, outFrontEnd.PipelineBlockEndOffset);
+	outFrontEnd.ResumeLine = ast->GetLexer().GetLineOfOffset(outFrontEnd.PipelineBlockEndOffset);
+
+	for (const AST_IMPORT& import : ast->GetImports())
+	{
+		FRONTEND_IMPORT frontEndImport;
+		frontEndImport.Path = import.Path.string();
+		if (m_Headers.GetContentHash(import.Path, frontEndImport.Hash))
+		{
+			outFrontEnd.Imports.push_back(std::move(frontEndImport));
+		}
 	}
 
 	return true;
 }
 
-std::string PipelineCompiler::CutPipelineBlock(std::string& fileData, ASTBase* ast)
+bool PipelineCompiler::FrontEndImportsCurrent(const FRONTEND_RESULT& frontEnd)
 {
-	uint32_t i = 0;
-	uint32_t start = 0;
-	uint32_t end = 0;
-	std::stringstream str(fileData);
-	std::stringstream out;
-	std::string buf;
-	ast->GetPipelineBlockLines(start, end);
-
-	if (start == 0 && end == 0)
+	SHADER_CACHE_KEY hash;
+	for (const FRONTEND_IMPORT& import : frontEnd.Imports)
 	{
-		return fileData;
+		if (!m_Headers.GetContentHash(import.Path, hash) ||
+			memcmp(hash.Digest, import.Hash.Digest, sizeof(hash.Digest)) != 0)
+		{
+			return false;
+		}
 	}
+	return true;
+}
+
+std::shared_ptr<const std::string> PipelineCompiler::CutPipelineBlock(const std::shared_ptr<const std::string>& source, const FRONTEND_RESULT& frontEnd)
+{
+	const uint32_t begin = frontEnd.PipelineBlockBeginOffset;
+	const uint32_t end = frontEnd.PipelineBlockEndOffset;
 
-	while (std::getline(str, buf))
+	// No Pipeline block, DXC can have the file as is
+	if (end <= begin || end > source->size())
 	{
-		if (i > start && i < end)
-		{
-			i++;
-			continue;
-		}
-		out << buf << "\n";
-		i++;
+		return source;
 	}
-	
-	return out.str();
+
+	// Everything after the block would shift up, #line puts
+	// DXC's diagnostics back on the lines of the original file
+	char lineDirective[32] = { };
+	int directiveLen = snprintf(lineDirective, sizeof(lineDirective), "\n#line %u\n", frontEnd.ResumeLine);
+
+	std::shared_ptr<std::string> result = std::make_shared<std::string>();
+	result->reserve(begin + directiveLen + (source->size() - end));
+	result->append(source->data(), begin);
+	result->append(lineDirective, directiveLen);
+	result->append(source->data() + end, source->size() - end);
+	return result;
 }
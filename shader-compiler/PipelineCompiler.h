@@ -2,12 +2,34 @@
 
 #include "Pipeline.h"
 #include "AST.h"
+#include "HeaderCache.h"
+#include "FrontEndCache.h"
 #include "ShaderCompiler.h"
+#include "DependencyDatabase.h"
+#include "ShaderPack.h"
+#include "BuildQueue.h"
 #include "nlohmann.hpp"
+#include <map>
+#include <set>
 #include <memory>
+#include <mutex>
+#include <atomic>
 #include <filesystem>
 
 
+/*
+* Workers per stage of the build, 0 picks a default.
+* DXC compiles run on the ShaderCompiler's own workers, see SetNumJobs.
+*/
+typedef struct PIPELINE_BUILD_JOBS {
+	uint32_t Read;
+	uint32_t FrontEnd;
+	uint32_t Encode;
+	uint32_t Write;
+	// Pipelines each queue between two stages holds before the stage feeding it blocks
+	uint32_t QueueDepth;
+} PIPELINE_BUILD_JOBS;
+
 // This would be the place where 
 // you would setup encryption when I
 // add signing and encryption to this project
@@ -22,29 +44,172 @@ public:
 
 	void SetSrcDir(const std::filesystem::path& path);
 
+	/*
+	* @brief: Where the pipelines and the dependency database are written.
+	* Pipelines whose inputs haven't changed since the last build here are skipped.
+	*/
+	void SetDstDir(const std::filesystem::path& path);
+
+	/*
+	* @brief: Also write the old json manifest and a <source>.json per pipeline.
+	* Only meant for debugging, the loader reads the pack.
+	*/
+	void SetWriteJson(bool writeJson);
+
+	void SetBuildJobs(const PIPELINE_BUILD_JOBS& jobs);
+
+	/*
+	* @brief: Builds every out of date pipeline. Each file goes through
+	* discover, read, front end, DXC, encode and write, every stage on
+	* its own workers with a bounded queue in front of it. A file can be
+	* in the front end while the ones before it are still in DXC.
+	*/
 	bool Load();
 
-	void WriteToFile(const std::filesystem::path& dstFile);
+	/*
+	* @brief: Writes a pack per target the compiler was set up with, see ShaderPackFileName,
+	* and the updated dependency database, plus the json dump if SetWriteJson was set.
+	* Packs of targets that weren't built are deleted so they can't be loaded stale.
+	*/
+	bool WriteToFile();
+
+	/*
+	* @brief: true if path is a pipeline source or something a pipeline was built from.
+	* Used by watch mode to ignore unrelated changes.
+	*/
+	bool IsInput(const std::filesystem::path& path);
+
+	/*
+	* @brief: Every directory holding a source or include the last build depended on
+	*/
+	void GetInputDirectories(std::set<std::filesystem::path>& outDirs) const;
 
 private:
 
-	bool LoadGfxFile(const std::filesystem::path& path);
+	/*
+	* A pipeline on its way through the stages. Source is only
+	* held between read and front end, the desc from front end on.
+	*/
+	typedef struct BUILD_ITEM {
+		std::filesystem::path Path;
+		std::string Filename;
+		std::string Ext;
+		std::shared_ptr<const std::string> Source;
+		// The source file as Source was read from it
+		FILE_STAMP SourceStamp = { };
+		const FULL_PIPELINE_DESCRIPTOR* Gfx = nullptr;
+		const COMPUTE_PIPELINE_DESC* Cmpt = nullptr;
+		const RAYTRACING_PIPELINE_DESC* Ray = nullptr;
+	} BUILD_ITEM;
+
+	typedef struct ENCODED_PIPELINE {
+		std::string Filename;
+		std::string Shaders;
+		nlohmann::json Metadata;
+	} ENCODED_PIPELINE;
+
+	/*
+	* @brief: Runs the front end and queues the compiles. Once they're
+	* all done the item is handed to encodeQueue by the DXC worker that finished last.
+	*/
+	bool LoadFile(const BUILD_ITEM& item, BoundedQueue<BUILD_ITEM>& encodeQueue);
+
+	/*
+	* @brief: Records the inputs of a compiled pipeline and
+	* serializes its json for the write stage if it's wanted
+	*/
+	void EncodePipeline(const BUILD_ITEM& item, BoundedQueue<ENCODED_PIPELINE>& writeQueue);
+
+	/*
+	* @brief: Writes the json shader file for a freshly compiled pipeline and adds it to the manifest
+	*/
+	bool WritePipelineJson(
+		const std::string& filename,
+		const std::string& shaders,
+		nlohmann::json& metadata
+	);
+
+	/*
+	* @brief: Records what a freshly compiled pipeline was built from, as
+	* it was read for the build. Nothing is read from the disk here.
+	*/
+	void RecordPipelineInputs(const BUILD_ITEM& item, const std::vector<const SHADER*>& compiledShaders);
 
-	bool LoadCmptFile(const std::filesystem::path& path);
+	bool LoadGfxFile(const BUILD_ITEM& item, BoundedQueue<BUILD_ITEM>& encodeQueue);
 
-	bool LoadRayFile(const std::filesystem::path& path);
+	bool LoadCmptFile(const BUILD_ITEM& item, BoundedQueue<BUILD_ITEM>& encodeQueue);
 
-	bool LoadFileImpl(const std::filesystem::path& path, ASTBase* ast, const std::string& type);
+	bool LoadRayFile(const BUILD_ITEM& item, BoundedQueue<BUILD_ITEM>& encodeQueue);
 
-	std::string CutPipelineBlock(std::string& fileData, ASTBase* ast);
+	/*
+	* @brief: Runs the front end over source and records what the compile stage needs in outFrontEnd
+	*/
+	bool LoadFileImpl(
+		const std::filesystem::path& path,
+		const std::shared_ptr<const std::string>& source,
+		ASTBase* ast,
+		const std::string& type,
+		FRONTEND_RESULT& outFrontEnd
+	);
+
+	/*
+	* @returns: false if a header a cached front end result was built from has changed since
+	*/
+	bool FrontEndImportsCurrent(const FRONTEND_RESULT& frontEnd);
+
+	/*
+	* @brief: source with the Pipeline block taken out, ready for DXC.
+	* Shares source when there's nothing to take out.
+	*/
+	std::shared_ptr<const std::string> CutPipelineBlock(const std::shared_ptr<const std::string>& source, const FRONTEND_RESULT& frontEnd);
 
 	std::filesystem::path m_SrcPath;
+	std::filesystem::path m_DstPath;
+
+	bool m_WriteJson;
+
+	PIPELINE_BUILD_JOBS m_Jobs = { };
+
+	// Guards m_Json, m_Deps and the pipeline maps while the stages are running
+	std::mutex m_Lock;
 
 	nlohmann::json m_Json;
 
+	// The manifest from the previous build, entries are
+	// carried over for pipelines that are still up to date
+	nlohmann::json m_PrevJson;
+
+	// The packs from the previous build, one per target, and the pipelines in them
+	// by filename. Any that isn't compiled successfully this build is copied into
+	// the new packs, up to date or the last good build of one that failed.
+	ShaderPackFile m_PrevPacks[SHADER_COMPILATION_TYPE_NUM][COMPILER_FLAGS_NUM];
+	std::map<std::string, uint32_t> m_PrevPipelines[SHADER_COMPILATION_TYPE_NUM][COMPILER_FLAGS_NUM];
+
+	// Pipelines the last Load queued to be built
+	std::set<std::string> m_Queued;
+
+	DependencyDatabase m_Deps;
+
+	// Headers parsed by any pipeline this build, and the builds before it in watch mode
+	HeaderCache m_Headers;
+
+	// Front end output of earlier builds, kept in the compile cache
+	FrontEndCache m_FrontEnd;
+	std::atomic<uint32_t> m_FrontEndHits = 0;
+
+	// Every pipeline source seen by the last Load, up to date or not
+	std::set<std::string> m_Sources;
+
+	// The workers in m_Compiler write into the SHADERs
+	// inside these, so they have to outlive the AST
+	// that filled them in. Keyed by the source filename
+	std::map<std::string, std::unique_ptr<FULL_PIPELINE_DESCRIPTOR>> m_GfxPipelines;
+	std::map<std::string, std::unique_ptr<COMPUTE_PIPELINE_DESC>> m_CmptPipelines;
+	std::map<std::string, std::unique_ptr<RAYTRACING_PIPELINE_DESC>> m_RayPipelines;
+
 	// Not a shared pointer because 
 	// we don't own this, m_Compiler
 	// is on the stack in main()
 	ShaderCompiler* m_Compiler;
 
-};
\ No newline at end of file
+};
\ No newline at end of file
@@ -0,0 +1,840 @@
+#include "PipelineSchema.h"
+#include "ShaderPackFormat.h"
+#include <string.h>
+#include <charconv>
+#include <iterator>
+#include <type_traits>
+
+
+// offsetof is only guaranteed on these, and everything below is offsetof
+static_assert(std::is_standard_layout_v<FULL_PIPELINE_DESCRIPTOR>, "FULL_PIPELINE_DESCRIPTOR has to stay standard layout for the schema");
+static_assert(std::is_standard_layout_v<RAYTRACING_PIPELINE_DESC>, "RAYTRACING_PIPELINE_DESC has to stay standard layout for the schema");
+static_assert(sizeof(EFORMAT) == sizeof(uint32_t) && sizeof(ECOMPARISON_FUNCTION) == sizeof(uint32_t),
+	"Enum fields are read and written as uint32_t");
+
+/*
+* Same FNV-1a as SymbolTable, but usable at compile time.
+* Takes a running hash so a prefix and a name can be hashed as one string.
+*/
+static constexpr uint32_t SchemaHash(std::string_view str, uint32_t hash = 2166136261u)
+{
+	for (char ch : str)
+	{
+		hash = (hash ^ (uint8_t)ch) * 16777619u;
+	}
+	return hash;
+}
+
+static constexpr uint32_t SchemaSlotCount(size_t numItems)
+{
+	// Load under a half, same as SymbolTable
+	uint32_t count = 8;
+	while (count < numItems * 2)
+	{
+		count *= 2;
+	}
+	return count;
+}
+
+/*
+* Open addressed name -> index table, 0 is an empty slot and
+* everything else is the index + 1
+*/
+template<size_t N>
+struct SCHEMA_SLOTS
+{
+	static constexpr uint32_t Count = SchemaSlotCount(N);
+	uint16_t Slots[Count];
+};
+
+template<typename T, size_t N>
+static constexpr SCHEMA_SLOTS<N> BuildSchemaSlots(const T (&items)[N])
+{
+	static_assert(N < 0xffff, "Slots are 16 bit");
+
+	SCHEMA_SLOTS<N> result = { };
+	for (size_t i = 0; i < N; i++)
+	{
+		uint32_t slot = SchemaHash(items[i].Name) & (result.Count - 1);
+		while (result.Slots[slot] != 0)
+		{
+			slot = (slot + 1) & (result.Count - 1);
+		}
+		result.Slots[slot] = (uint16_t)(i + 1);
+	}
+	return result;
+}
+
+template<typename T, size_t N>
+static constexpr bool HasDuplicateNames(const T (&items)[N])
+{
+	for (size_t i = 0; i < N; i++)
+	{
+		for (size_t j = i + 1; j < N; j++)
+		{
+			if (items[i].Name == items[j].Name)
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+#define SCHEMA_VALUE(x) { #x, (uint32_t)x }
+
+#define DEFINE_SCHEMA_ENUM(name, prefix, fallback, ...) \
+	static constexpr SCHEMA_ENUM_VALUE name##Values[] = { __VA_ARGS__ }; \
+	static_assert(!HasDuplicateNames(name##Values), "Duplicate value in " #name); \
+	static constexpr auto name##Slots = BuildSchemaSlots(name##Values); \
+	static constexpr SCHEMA_ENUM name = { \
+		prefix, name##Values, (uint32_t)std::size(name##Values), \
+		fallback, name##Slots.Slots, name##Slots.Count \
+	}
+
+#define DEFINE_SCHEMA_STRUCT(name, ...) \
+	static constexpr SCHEMA_FIELD name##Fields[] = { __VA_ARGS__ }; \
+	static_assert(!HasDuplicateNames(name##Fields), "Duplicate field in " #name); \
+	static constexpr auto name##Slots = BuildSchemaSlots(name##Fields); \
+	static constexpr SCHEMA_STRUCT name = { \
+		name##Fields, (uint32_t)std::size(name##Fields), \
+		name##Slots.Slots, name##Slots.Count \
+	}
+
+// Offset and size of a member of the pack structs
+#define SCHEMA_PACK(type, member) offsetof(type, member), sizeof(type::member)
+
+static constexpr SCHEMA_FIELD SchemaField(std::string_view name, std::string_view jsonName, ESCHEMA_FIELD_TYPE type, size_t offset, double defaultValue)
+{
+	SCHEMA_FIELD field = { };
+	field.Name = name;
+	field.JsonName = jsonName;
+	field.Type = type;
+	field.Offset = (uint32_t)offset;
+	field.Default = defaultValue;
+	field.CountOffset = SCHEMA_NO_OFFSET;
+	field.PackOffset = SCHEMA_NO_OFFSET;
+	return field;
+}
+
+static constexpr SCHEMA_FIELD SchemaEnumField(std::string_view name, std::string_view jsonName, size_t offset, const SCHEMA_ENUM& schemaEnum, uint32_t defaultValue)
+{
+	SCHEMA_FIELD field = SchemaField(name, jsonName, SCHEMA_FIELD_TYPE_ENUM, offset, defaultValue);
+	field.Enum = &schemaEnum;
+	return field;
+}
+
+static constexpr SCHEMA_FIELD SchemaStructField(std::string_view name, std::string_view jsonName, size_t offset, const SCHEMA_STRUCT& schema)
+{
+	SCHEMA_FIELD field = SchemaField(name, jsonName, SCHEMA_FIELD_TYPE_STRUCT, offset, 0.0);
+	field.Struct = &schema;
+	return field;
+}
+
+static constexpr SCHEMA_FIELD SchemaArrayField(std::string_view name, std::string_view jsonName, size_t offset, const SCHEMA_STRUCT& schema,
+	uint32_t arraySize, size_t stride, size_t countOffset)
+{
+	SCHEMA_FIELD field = SchemaStructField(name, jsonName, offset, schema);
+	field.ArraySize = arraySize;
+	field.Stride = (uint32_t)stride;
+	field.CountOffset = (uint32_t)countOffset;
+	return field;
+}
+
+static constexpr SCHEMA_FIELD SchemaListField(std::string_view name, std::string_view jsonName, size_t offset, const SCHEMA_STRUCT& schema, const SCHEMA_LIST& list)
+{
+	SCHEMA_FIELD field = SchemaStructField(name, jsonName, offset, schema);
+	field.Type = SCHEMA_FIELD_TYPE_LIST;
+	field.List = &list;
+	return field;
+}
+
+static constexpr SCHEMA_FIELD SchemaPacked(SCHEMA_FIELD field, size_t packOffset, size_t packSize, size_t packStride = 0)
+{
+	field.PackOffset = (uint32_t)packOffset;
+	field.PackSize = (uint32_t)packSize;
+	field.PackStride = (uint32_t)packStride;
+	return field;
+}
+
+/*
+* Another name for a field that's listed under its real name too.
+* Only the interpreter sees it, defaults, json and the pack go by the real one.
+*/
+static constexpr SCHEMA_FIELD SchemaAlias(std::string_view name, ESCHEMA_FIELD_TYPE type, size_t offset)
+{
+	SCHEMA_FIELD field = SchemaField(name, std::string_view(), type, offset, 0.0);
+	field.bAlias = true;
+	return field;
+}
+
+template<typename T>
+static constexpr SCHEMA_LIST SchemaListOf()
+{
+	SCHEMA_LIST list = { };
+	list.Size = [](const void* vec) -> size_t {
+		return ((const std::vector<T>*)vec)->size();
+	};
+	list.Append = [](void* vec) -> void* {
+		return &((std::vector<T>*)vec)->emplace_back();
+	};
+	list.At = [](const void* vec, size_t index) -> const void* {
+		return &(*(const std::vector<T>*)vec)[index];
+	};
+	list.Clear = [](void* vec) {
+		((std::vector<T>*)vec)->clear();
+	};
+	return list;
+}
+
+
+DEFINE_SCHEMA_ENUM(s_FormatEnum, "FORMAT_", "FORMAT_UNKNOWN",
+	SCHEMA_VALUE(FORMAT_UNKNOWN),
+	SCHEMA_VALUE(FORMAT_R32G32B32A32_TYPELESS),
+	SCHEMA_VALUE(FORMAT_R32G32B32A32_FLOAT),
+	SCHEMA_VALUE(FORMAT_R32G32B32A32_UINT),
+	SCHEMA_VALUE(FORMAT_R32G32B32A32_SINT),
+	SCHEMA_VALUE(FORMAT_R32G32B32_TYPELESS),
+	SCHEMA_VALUE(FORMAT_R32G32B32_FLOAT),
+	SCHEMA_VALUE(FORMAT_R32G32B32_UINT),
+	SCHEMA_VALUE(FORMAT_R32G32B32_SINT),
+	SCHEMA_VALUE(FORMAT_R16G16B16A16_TYPELESS),
+	SCHEMA_VALUE(FORMAT_R16G16B16A16_FLOAT),
+	SCHEMA_VALUE(FORMAT_R16G16B16A16_UNORM),
+	SCHEMA_VALUE(FORMAT_R16G16B16A16_UINT),
+	SCHEMA_VALUE(FORMAT_R16G16B16A16_SNORM),
+	SCHEMA_VALUE(FORMAT_R16G16B16A16_SINT),
+	SCHEMA_VALUE(FORMAT_R32G32_TYPELESS),
+	SCHEMA_VALUE(FORMAT_R32G32_FLOAT),
+	SCHEMA_VALUE(FORMAT_R32G32_UINT),
+	SCHEMA_VALUE(FORMAT_R32G32_SINT),
+	SCHEMA_VALUE(FORMAT_R32G8X24_TYPELESS),
+	SCHEMA_VALUE(FORMAT_D32_FLOAT_S8X24_UINT),
+	SCHEMA_VALUE(FORMAT_R32_FLOAT_X8X24_TYPELESS),
+	SCHEMA_VALUE(FORMAT_X32_TYPELESS_G8X24_UINT),
+	SCHEMA_VALUE(FORMAT_R10G10B10A2_TYPELESS),
+	SCHEMA_VALUE(FORMAT_R10G10B10A2_UNORM),
+	SCHEMA_VALUE(FORMAT_R10G10B10A2_UINT),
+	SCHEMA_VALUE(FORMAT_R11G11B10_FLOAT),
+	SCHEMA_VALUE(FORMAT_R8G8B8A8_TYPELESS),
+	SCHEMA_VALUE(FORMAT_R8G8B8A8_UNORM),
+	SCHEMA_VALUE(FORMAT_R8G8B8A8_UNORM_SRGB),
+	SCHEMA_VALUE(FORMAT_R8G8B8A8_UINT),
+	SCHEMA_VALUE(FORMAT_R8G8B8A8_SNORM),
+	SCHEMA_VALUE(FORMAT_R8G8B8A8_SINT),
+	SCHEMA_VALUE(FORMAT_R16G16_TYPELESS),
+	SCHEMA_VALUE(FORMAT_R16G16_FLOAT),
+	SCHEMA_VALUE(FORMAT_R16G16_UNORM),
+	SCHEMA_VALUE(FORMAT_R16G16_UINT),
+	SCHEMA_VALUE(FORMAT_R16G16_SNORM),
+	SCHEMA_VALUE(FORMAT_R16G16_SINT),
+	SCHEMA_VALUE(FORMAT_R32_TYPELESS),
+	SCHEMA_VALUE(FORMAT_D32_FLOAT),
+	SCHEMA_VALUE(FORMAT_R32_FLOAT),
+	SCHEMA_VALUE(FORMAT_R32_UINT),
+	SCHEMA_VALUE(FORMAT_R32_SINT),
+	SCHEMA_VALUE(FORMAT_R24G8_TYPELESS),
+	SCHEMA_VALUE(FORMAT_D24_UNORM_S8_UINT),
+	SCHEMA_VALUE(FORMAT_R24_UNORM_X8_TYPELESS),
+	SCHEMA_VALUE(FORMAT_X24_TYPELESS_G8_UINT),
+	SCHEMA_VALUE(FORMAT_R8G8_TYPELESS),
+	SCHEMA_VALUE(FORMAT_R8G8_UNORM),
+	SCHEMA_VALUE(FORMAT_R8G8_UINT),
+	SCHEMA_VALUE(FORMAT_R8G8_SNORM),
+	SCHEMA_VALUE(FORMAT_R8G8_SINT),
+	SCHEMA_VALUE(FORMAT_R16_TYPELESS),
+	SCHEMA_VALUE(FORMAT_R16_FLOAT),
+	SCHEMA_VALUE(FORMAT_D16_UNORM),
+	SCHEMA_VALUE(FORMAT_R16_UNORM),
+	SCHEMA_VALUE(FORMAT_R16_UINT),
+	SCHEMA_VALUE(FORMAT_R16_SNORM),
+	SCHEMA_VALUE(FORMAT_R16_SINT),
+	SCHEMA_VALUE(FORMAT_R8_TYPELESS),
+	SCHEMA_VALUE(FORMAT_R8_UNORM),
+	SCHEMA_VALUE(FORMAT_R8_UINT),
+	SCHEMA_VALUE(FORMAT_R8_SNORM),
+	SCHEMA_VALUE(FORMAT_R8_SINT),
+	SCHEMA_VALUE(FORMAT_A8_UNORM),
+	SCHEMA_VALUE(FORMAT_R1_UNORM),
+	SCHEMA_VALUE(FORMAT_R9G9B9E5_SHAREDEXP),
+	SCHEMA_VALUE(FORMAT_R8G8_B8G8_UNORM),
+	SCHEMA_VALUE(FORMAT_G8R8_G8B8_UNORM),
+	SCHEMA_VALUE(FORMAT_BC1_TYPELESS),
+	SCHEMA_VALUE(FORMAT_BC1_UNORM),
+	SCHEMA_VALUE(FORMAT_BC1_UNORM_SRGB),
+	SCHEMA_VALUE(FORMAT_BC2_TYPELESS),
+	SCHEMA_VALUE(FORMAT_BC2_UNORM),
+	SCHEMA_VALUE(FORMAT_BC2_UNORM_SRGB),
+	SCHEMA_VALUE(FORMAT_BC3_TYPELESS),
+	SCHEMA_VALUE(FORMAT_BC3_UNORM),
+	SCHEMA_VALUE(FORMAT_BC3_UNORM_SRGB),
+	SCHEMA_VALUE(FORMAT_BC4_TYPELESS),
+	SCHEMA_VALUE(FORMAT_BC4_UNORM),
+	SCHEMA_VALUE(FORMAT_BC4_SNORM),
+	SCHEMA_VALUE(FORMAT_BC5_TYPELESS),
+	SCHEMA_VALUE(FORMAT_BC5_UNORM),
+	SCHEMA_VALUE(FORMAT_BC5_SNORM),
+	SCHEMA_VALUE(FORMAT_B5G6R5_UNORM),
+	SCHEMA_VALUE(FORMAT_B5G5R5A1_UNORM),
+	SCHEMA_VALUE(FORMAT_B8G8R8A8_UNORM),
+	SCHEMA_VALUE(FORMAT_B8G8R8X8_UNORM),
+	SCHEMA_VALUE(FORMAT_R10G10B10_XR_BIAS_A2_UNORM),
+	SCHEMA_VALUE(FORMAT_B8G8R8A8_TYPELESS),
+	SCHEMA_VALUE(FORMAT_B8G8R8A8_UNORM_SRGB),
+	SCHEMA_VALUE(FORMAT_B8G8R8X8_TYPELESS),
+	SCHEMA_VALUE(FORMAT_B8G8R8X8_UNORM_SRGB),
+	SCHEMA_VALUE(FORMAT_BC6H_TYPELESS),
+	SCHEMA_VALUE(FORMAT_BC6H_UF16),
+	SCHEMA_VALUE(FORMAT_BC6H_SF16),
+	SCHEMA_VALUE(FORMAT_BC7_TYPELESS),
+	SCHEMA_VALUE(FORMAT_BC7_UNORM),
+	SCHEMA_VALUE(FORMAT_BC7_UNORM_SRGB),
+	SCHEMA_VALUE(FORMAT_AYUV),
+	SCHEMA_VALUE(FORMAT_Y410),
+	SCHEMA_VALUE(FORMAT_Y416),
+	SCHEMA_VALUE(FORMAT_NV12),
+	SCHEMA_VALUE(FORMAT_P010),
+	SCHEMA_VALUE(FORMAT_P016),
+	SCHEMA_VALUE(FORMAT_420_OPAQUE),
+	SCHEMA_VALUE(FORMAT_YUY2),
+	SCHEMA_VALUE(FORMAT_Y210),
+	SCHEMA_VALUE(FORMAT_Y216),
+	SCHEMA_VALUE(FORMAT_NV11),
+	SCHEMA_VALUE(FORMAT_AI44),
+	SCHEMA_VALUE(FORMAT_IA44),
+	SCHEMA_VALUE(FORMAT_P8),
+	SCHEMA_VALUE(FORMAT_A8P8),
+	SCHEMA_VALUE(FORMAT_B4G4R4A4_UNORM),
+	SCHEMA_VALUE(FORMAT_P208),
+	SCHEMA_VALUE(FORMAT_V208),
+	SCHEMA_VALUE(FORMAT_V408),
+	SCHEMA_VALUE(FORMAT_FORCE_UINT)
+);
+
+DEFINE_SCHEMA_ENUM(s_InputItemFormatEnum, "INPUT_ITEM_FORMAT_", "INPUT_ITEM_FORMAT_FLOAT3",
+	SCHEMA_VALUE(INPUT_ITEM_FORMAT_FLOAT),
+	SCHEMA_VALUE(INPUT_ITEM_FORMAT_INT),
+	SCHEMA_VALUE(INPUT_ITEM_FORMAT_FLOAT2),
+	SCHEMA_VALUE(INPUT_ITEM_FORMAT_INT2),
+	SCHEMA_VALUE(INPUT_ITEM_FORMAT_FLOAT3),
+	SCHEMA_VALUE(INPUT_ITEM_FORMAT_INT3),
+	SCHEMA_VALUE(INPUT_ITEM_FORMAT_FLOAT4),
+	SCHEMA_VALUE(INPUT_ITEM_FORMAT_INT4)
+);
+
+DEFINE_SCHEMA_ENUM(s_BlendStyleEnum, "BLEND_STYLE_", "BLEND_STYLE_ZERO",
+	SCHEMA_VALUE(BLEND_STYLE_ZERO),
+	SCHEMA_VALUE(BLEND_STYLE_ONE),
+	SCHEMA_VALUE(BLEND_STYLE_SRC_COLOR),
+	SCHEMA_VALUE(BLEND_STYLE_INV_SRC_COLOR),
+	SCHEMA_VALUE(BLEND_STYLE_SRC_ALPHA),
+	SCHEMA_VALUE(BLEND_STYLE_INV_SRC_ALPHA),
+	SCHEMA_VALUE(BLEND_STYLE_DEST_ALPHA),
+	SCHEMA_VALUE(BLEND_STYLE_INV_DEST_ALPHA),
+	SCHEMA_VALUE(BLEND_STYLE_DEST_COLOR),
+	SCHEMA_VALUE(BLEND_STYLE_INV_DEST_COLOR),
+	SCHEMA_VALUE(BLEND_STYLE_SRC_ALPHA_SAT),
+	SCHEMA_VALUE(BLEND_STYLE_BLEND_FACTOR),
+	SCHEMA_VALUE(BLEND_STYLE_INV_BLEND_FACTOR),
+	SCHEMA_VALUE(BLEND_STYLE_SRC1_COLOR),
+	SCHEMA_VALUE(BLEND_STYLE_INV_SRC1_COLOR),
+	SCHEMA_VALUE(BLEND_STYLE_SRC1_ALPHA),
+	SCHEMA_VALUE(BLEND_STYLE_INV_SRC1_ALPHA)
+);
+
+DEFINE_SCHEMA_ENUM(s_BlendOpEnum, "BLEND_OP_", "BLEND_OP_ADD",
+	SCHEMA_VALUE(BLEND_OP_ADD),
+	SCHEMA_VALUE(BLEND_OP_SUBTRACT),
+	SCHEMA_VALUE(BLEND_OP_REV_SUBTRACT),
+	SCHEMA_VALUE(BLEND_OP_MIN),
+	SCHEMA_VALUE(BLEND_OP_MAX)
+);
+
+DEFINE_SCHEMA_ENUM(s_LogicOpEnum, "LOGIC_OP_", "LOGIC_OP_NOOP",
+	SCHEMA_VALUE(LOGIC_OP_CLEAR),
+	SCHEMA_VALUE(LOGIC_OP_SET),
+	SCHEMA_VALUE(LOGIC_OP_COPY),
+	SCHEMA_VALUE(LOGIC_OP_COPY_INVERTED),
+	SCHEMA_VALUE(LOGIC_OP_NOOP),
+	SCHEMA_VALUE(LOGIC_OP_INVERT),
+	SCHEMA_VALUE(LOGIC_OP_AND),
+	SCHEMA_VALUE(LOGIC_OP_NAND),
+	SCHEMA_VALUE(LOGIC_OP_OR),
+	SCHEMA_VALUE(LOGIC_OP_NOR),
+	SCHEMA_VALUE(LOGIC_OP_XOR),
+	SCHEMA_VALUE(LOGIC_OP_EQUIV),
+	SCHEMA_VALUE(LOGIC_OP_AND_REVERSE),
+	SCHEMA_VALUE(LOGIC_OP_AND_INVERTED),
+	SCHEMA_VALUE(LOGIC_OP_OR_REVERSE),
+	SCHEMA_VALUE(LOGIC_OP_OR_INVERTED)
+);
+
+DEFINE_SCHEMA_ENUM(s_ComparisonFunctionEnum, "COMPARISON_FUNCTION_", "COMPARISON_FUNCTION_LESS",
+	SCHEMA_VALUE(COMPARISON_FUNCTION_NEVER),
+	SCHEMA_VALUE(COMPARISON_FUNCTION_LESS),
+	SCHEMA_VALUE(COMPARISON_FUNCTION_EQUAL),
+	SCHEMA_VALUE(COMPARISON_FUNCTION_LESS_EQUAL),
+	SCHEMA_VALUE(COMPARISON_FUNCTION_GREATER),
+	SCHEMA_VALUE(COMPARISON_FUNCTION_NOT_EQUAL),
+	SCHEMA_VALUE(COMPARISON_FUNCTION_GREATER_EQUAL),
+	SCHEMA_VALUE(COMPARISON_FUNCTION_ALWAYS)
+);
+
+DEFINE_SCHEMA_ENUM(s_StencilOpEnum, "STENCIL_OP_", "STENCIL_OP_KEEP",
+	SCHEMA_VALUE(STENCIL_OP_KEEP),
+	SCHEMA_VALUE(STENCIL_OP_ZERO),
+	SCHEMA_VALUE(STENCIL_OP_REPLACE),
+	SCHEMA_VALUE(STENCIL_OP_INCR_SAT),
+	SCHEMA_VALUE(STENCIL_OP_DECR_SAT),
+	SCHEMA_VALUE(STENCIL_OP_INVERT),
+	SCHEMA_VALUE(STENCIL_OP_INCR),
+	SCHEMA_VALUE(STENCIL_OP_DECR)
+);
+
+DEFINE_SCHEMA_ENUM(s_MultisampleLevelEnum, "MULTISAMPLE_LEVEL_", "MULTISAMPLE_LEVEL_0",
+	SCHEMA_VALUE(MULTISAMPLE_LEVEL_0),
+	SCHEMA_VALUE(MULTISAMPLE_LEVEL_4X),
+	SCHEMA_VALUE(MULTISAMPLE_LEVEL_8X),
+	SCHEMA_VALUE(MULTISAMPLE_LEVEL_16X)
+);
+
+DEFINE_SCHEMA_ENUM(s_PolygonTypeEnum, "POLYGON_TYPE_", "POLYGON_TYPE_TRIANGLES",
+	SCHEMA_VALUE(POLYGON_TYPE_POINTS),
+	SCHEMA_VALUE(POLYGON_TYPE_LINES),
+	SCHEMA_VALUE(POLYGON_TYPE_TRIANGLES),
+	SCHEMA_VALUE(POLYGON_TYPE_TRIANGLE_STRIPS)
+);
+
+
+// Json names are what the loader reads, see d3d-shader-loader-types.cpp before renaming any
+
+DEFINE_SCHEMA_STRUCT(s_DepthStencilOpSchema,
+	SchemaPacked(SchemaEnumField("StencilFailOp", "StencilFailOp", offsetof(GFX_DEPTH_STENCIL_OP_DESC, StencilFailOp), s_StencilOpEnum, STENCIL_OP_KEEP),
+		SCHEMA_PACK(SHADER_PACK_DEPTH_STENCIL_OP, StencilFailOp)),
+	SchemaPacked(SchemaEnumField("StencilDepthFailOp", "StencilDepthFailOp", offsetof(GFX_DEPTH_STENCIL_OP_DESC, StencilDepthFailOp), s_StencilOpEnum, STENCIL_OP_KEEP),
+		SCHEMA_PACK(SHADER_PACK_DEPTH_STENCIL_OP, StencilDepthFailOp)),
+	SchemaPacked(SchemaEnumField("StencilPassOp", "StencilPassOp", offsetof(GFX_DEPTH_STENCIL_OP_DESC, StencilPassOp), s_StencilOpEnum, STENCIL_OP_KEEP),
+		SCHEMA_PACK(SHADER_PACK_DEPTH_STENCIL_OP, StencilPassOp)),
+	SchemaPacked(SchemaEnumField("ComparisonFunction", "ComparisonFunction", offsetof(GFX_DEPTH_STENCIL_OP_DESC, ComparisonFunction), s_ComparisonFunctionEnum, COMPARISON_FUNCTION_LESS),
+		SCHEMA_PACK(SHADER_PACK_DEPTH_STENCIL_OP, ComparisonFunction))
+);
+
+// Flattened into SHADER_PACK_GRAPHICS_STATE
+DEFINE_SCHEMA_STRUCT(s_DepthStencilSchema,
+	SchemaPacked(SchemaEnumField("Format", "Format", offsetof(GFX_DEPTH_STENCIL_DESC, Format), s_FormatEnum, FORMAT_D24_UNORM_S8_UINT),
+		SCHEMA_PACK(SHADER_PACK_GRAPHICS_STATE, DepthStencilFormat)),
+	SchemaPacked(SchemaField("DepthEnable", "bDepthEnable", SCHEMA_FIELD_TYPE_BOOL, offsetof(GFX_DEPTH_STENCIL_DESC, bDepthEnable), true),
+		SCHEMA_PACK(SHADER_PACK_GRAPHICS_STATE, bDepthEnable)),
+	SchemaPacked(SchemaField("DepthWriteMask", "DepthWriteMask", SCHEMA_FIELD_TYPE_UINT, offsetof(GFX_DEPTH_STENCIL_DESC, DepthWriteMask), 0xffffffff),
+		SCHEMA_PACK(SHADER_PACK_GRAPHICS_STATE, DepthWriteMask)),
+	SchemaPacked(SchemaEnumField("DepthFunction", "DepthFunction", offsetof(GFX_DEPTH_STENCIL_DESC, DepthFunction), s_ComparisonFunctionEnum, COMPARISON_FUNCTION_LESS),
+		SCHEMA_PACK(SHADER_PACK_GRAPHICS_STATE, DepthFunction)),
+	SchemaPacked(SchemaField("StencilEnable", "bStencilEnable", SCHEMA_FIELD_TYPE_BOOL, offsetof(GFX_DEPTH_STENCIL_DESC, bStencilEnable), false),
+		SCHEMA_PACK(SHADER_PACK_GRAPHICS_STATE, bStencilEnable)),
+	SchemaPacked(SchemaStructField("FrontFace", "FrontFace", offsetof(GFX_DEPTH_STENCIL_DESC, FrontFace), s_DepthStencilOpSchema),
+		SCHEMA_PACK(SHADER_PACK_GRAPHICS_STATE, FrontFace)),
+	SchemaPacked(SchemaStructField("BackFace", "BackFace", offsetof(GFX_DEPTH_STENCIL_DESC, BackFace), s_DepthStencilOpSchema),
+		SCHEMA_PACK(SHADER_PACK_GRAPHICS_STATE, BackFace))
+);
+
+// Flattened into SHADER_PACK_GRAPHICS_STATE
+DEFINE_SCHEMA_STRUCT(s_RasterSchema,
+	SchemaPacked(SchemaField("FillSolid", "bFillSolid", SCHEMA_FIELD_TYPE_BOOL, offsetof(GFX_RASTER_DESC, bFillSolid), true),
+		SCHEMA_PACK(SHADER_PACK_GRAPHICS_STATE, bFillSolid)),
+	SchemaPacked(SchemaField("Cull", "bCull", SCHEMA_FIELD_TYPE_BOOL, offsetof(GFX_RASTER_DESC, bCull), true),
+		SCHEMA_PACK(SHADER_PACK_GRAPHICS_STATE, bCull)),
+	SchemaPacked(SchemaField("IsCounterClockwiseForward", "bIsCounterClockwiseForward", SCHEMA_FIELD_TYPE_BOOL, offsetof(GFX_RASTER_DESC, bIsCounterClockwiseForward), false),
+		SCHEMA_PACK(SHADER_PACK_GRAPHICS_STATE, bIsCounterClockwiseForward)),
+	SchemaPacked(SchemaField("DepthClipEnable", "bDepthClipEnable", SCHEMA_FIELD_TYPE_BOOL, offsetof(GFX_RASTER_DESC, bDepthClipEnable), true),
+		SCHEMA_PACK(SHADER_PACK_GRAPHICS_STATE, bDepthClipEnable)),
+	SchemaPacked(SchemaField("AntialiasedLineEnable", "bAntialiasedLineEnabled", SCHEMA_FIELD_TYPE_BOOL, offsetof(GFX_RASTER_DESC, bAntialiasedLineEnabled), false),
+		SCHEMA_PACK(SHADER_PACK_GRAPHICS_STATE, bAntialiasedLineEnabled)),
+	SchemaPacked(SchemaField("MultisampleEnable", "bMultisampleEnable", SCHEMA_FIELD_TYPE_BOOL, offsetof(GFX_RASTER_DESC, bMultisampleEnable), false),
+		SCHEMA_PACK(SHADER_PACK_GRAPHICS_STATE, bMultisampleEnable)),
+	SchemaPacked(SchemaField("DepthBiasClamp", "DepthBiasClamp", SCHEMA_FIELD_TYPE_FLOAT, offsetof(GFX_RASTER_DESC, DepthBiasClamp), 0.0),
+		SCHEMA_PACK(SHADER_PACK_GRAPHICS_STATE, DepthBiasClamp)),
+	// Spelled the way the loader reads it
+	SchemaPacked(SchemaField("SlopeScaledDepthBias", "SlopedScaledDepthBias", SCHEMA_FIELD_TYPE_FLOAT, offsetof(GFX_RASTER_DESC, SlopeScaledDepthBias), 0.0),
+		SCHEMA_PACK(SHADER_PACK_GRAPHICS_STATE, SlopeScaledDepthBias)),
+	SchemaPacked(SchemaEnumField("MultisampleLevel", "MultisampleLevel", offsetof(GFX_RASTER_DESC, MultisampleLevel), s_MultisampleLevelEnum, MULTISAMPLE_LEVEL_0),
+		SCHEMA_PACK(SHADER_PACK_GRAPHICS_STATE, MultisampleLevel))
+);
+
+DEFINE_SCHEMA_STRUCT(s_RenderTargetSchema,
+	SchemaPacked(SchemaField("BlendEnable", "bBlendEnable", SCHEMA_FIELD_TYPE_BOOL, offsetof(GFX_RENDER_TARGET_DESC, bBlendEnable), false),
+		SCHEMA_PACK(SHADER_PACK_RENDER_TARGET, bBlendEnable)),
+	SchemaPacked(SchemaField("LogicEnable", "bLogicOpEnable", SCHEMA_FIELD_TYPE_BOOL, offsetof(GFX_RENDER_TARGET_DESC, bLogicOpEnable), false),
+		SCHEMA_PACK(SHADER_PACK_RENDER_TARGET, bLogicOpEnable)),
+	SchemaPacked(SchemaEnumField("SrcBlend", "SrcBlend", offsetof(GFX_RENDER_TARGET_DESC, SrcBlend), s_BlendStyleEnum, BLEND_STYLE_ONE),
+		SCHEMA_PACK(SHADER_PACK_RENDER_TARGET, SrcBlend)),
+	SchemaPacked(SchemaEnumField("DstBlend", "DstBlend", offsetof(GFX_RENDER_TARGET_DESC, DstBlend), s_BlendStyleEnum, BLEND_STYLE_ZERO),
+		SCHEMA_PACK(SHADER_PACK_RENDER_TARGET, DstBlend)),
+	SchemaPacked(SchemaEnumField("BlendOp", "BlendOp", offsetof(GFX_RENDER_TARGET_DESC, BlendOp), s_BlendOpEnum, BLEND_OP_ADD),
+		SCHEMA_PACK(SHADER_PACK_RENDER_TARGET, BlendOp)),
+	SchemaPacked(SchemaEnumField("SrcBlendAlpha", "SrcBlendAlpha", offsetof(GFX_RENDER_TARGET_DESC, SrcBlendAlpha), s_BlendStyleEnum, BLEND_STYLE_ONE),
+		SCHEMA_PACK(SHADER_PACK_RENDER_TARGET, SrcBlendAlpha)),
+	SchemaPacked(SchemaEnumField("DstBlendAlpha", "DstBlendAlpha", offsetof(GFX_RENDER_TARGET_DESC, DstBlendAlpha), s_BlendStyleEnum, BLEND_STYLE_ZERO),
+		SCHEMA_PACK(SHADER_PACK_RENDER_TARGET, DstBlendAlpha)),
+	SchemaPacked(SchemaEnumField("AlphaBlendOp", "AlphaBlendOp", offsetof(GFX_RENDER_TARGET_DESC, AlphaBlendOp), s_BlendOpEnum, BLEND_OP_ADD),
+		SCHEMA_PACK(SHADER_PACK_RENDER_TARGET, AlphaBlendOp)),
+	SchemaPacked(SchemaEnumField("LogicOp", "LogicOp", offsetof(GFX_RENDER_TARGET_DESC, LogicOp), s_LogicOpEnum, LOGIC_OP_NOOP),
+		SCHEMA_PACK(SHADER_PACK_RENDER_TARGET, LogicOp)),
+	SchemaPacked(SchemaEnumField("Format", "Format", offsetof(GFX_RENDER_TARGET_DESC, Format), s_FormatEnum, FORMAT_R8G8B8A8_UNORM),
+		SCHEMA_PACK(SHADER_PACK_RENDER_TARGET, Format))
+);
+
+DEFINE_SCHEMA_STRUCT(s_GraphicsSchema,
+	SchemaPacked(SchemaEnumField("PolygonType", "PolygonType", offsetof(FULL_PIPELINE_DESCRIPTOR, PolygonType), s_PolygonTypeEnum, POLYGON_TYPE_TRIANGLES),
+		SCHEMA_PACK(SHADER_PACK_GRAPHICS_STATE, PolygonType)),
+	SchemaPacked(SchemaField("NumRenderTargets", "NumRenderTargets", SCHEMA_FIELD_TYPE_UINT, offsetof(FULL_PIPELINE_DESCRIPTOR, NumRenderTargets), 1),
+		SCHEMA_PACK(SHADER_PACK_GRAPHICS_STATE, NumRenderTargets)),
+	SchemaPacked(SchemaField("AlphaToCoverageEnable", "bEnableAlphaToCoverage", SCHEMA_FIELD_TYPE_BOOL, offsetof(FULL_PIPELINE_DESCRIPTOR, bEnableAlphaToCoverage), false),
+		SCHEMA_PACK(SHADER_PACK_GRAPHICS_STATE, bEnableAlphaToCoverage)),
+	SchemaPacked(SchemaField("IndependentBlendEnable", "bIndependentBlendEnable", SCHEMA_FIELD_TYPE_BOOL, offsetof(FULL_PIPELINE_DESCRIPTOR, bIndependentBlendEnable), false),
+		SCHEMA_PACK(SHADER_PACK_GRAPHICS_STATE, bIndependentBlendEnable)),
+	SchemaPacked(SchemaStructField("RasterState", "RasterDesc", offsetof(FULL_PIPELINE_DESCRIPTOR, RasterDesc), s_RasterSchema),
+		0, 0),
+	SchemaPacked(SchemaStructField("DepthStencilState", "DepthStencilState", offsetof(FULL_PIPELINE_DESCRIPTOR, DepthStencilState), s_DepthStencilSchema),
+		0, 0),
+	SchemaPacked(SchemaArrayField("RenderTarget", "RtvDescs", offsetof(FULL_PIPELINE_DESCRIPTOR, RtvDescs), s_RenderTargetSchema,
+			8, sizeof(GFX_RENDER_TARGET_DESC), offsetof(FULL_PIPELINE_DESCRIPTOR, NumRenderTargets)),
+		SCHEMA_PACK(SHADER_PACK_GRAPHICS_STATE, RenderTargets), sizeof(SHADER_PACK_RENDER_TARGET)),
+	// "DepthWrite = false;" predates DepthStencilState and turns the depth test off
+	SchemaAlias("DepthWrite", SCHEMA_FIELD_TYPE_BOOL, offsetof(FULL_PIPELINE_DESCRIPTOR, DepthStencilState) + offsetof(GFX_DEPTH_STENCIL_DESC, bDepthEnable))
+);
+
+static constexpr SCHEMA_LIST s_HitGroupList = SchemaListOf<RAYTRACING_HIT_GROUP_DESC>();
+
+DEFINE_SCHEMA_STRUCT(s_HitGroupSchema,
+	SchemaField("ClosestHit", "ClosestHit", SCHEMA_FIELD_TYPE_STRING, offsetof(RAYTRACING_HIT_GROUP_DESC, ClosestHit), 0.0),
+	SchemaField("AnyHit", "AnyHit", SCHEMA_FIELD_TYPE_STRING, offsetof(RAYTRACING_HIT_GROUP_DESC, AnyHit), 0.0),
+	SchemaField("ExportName", "ExportName", SCHEMA_FIELD_TYPE_STRING, offsetof(RAYTRACING_HIT_GROUP_DESC, ExportName), 0.0)
+);
+
+// Hit groups are strings, the pack writer puts those in its string table itself
+DEFINE_SCHEMA_STRUCT(s_RaytracingSchema,
+	SchemaPacked(SchemaField("PayloadSizeInBytes", "PayloadSizeInBytes", SCHEMA_FIELD_TYPE_UINT, offsetof(RAYTRACING_PIPELINE_DESC, PayloadSizeInBytes), 0),
+		SCHEMA_PACK(SHADER_PACK_RAYTRACING_STATE, PayloadSizeInBytes)),
+	SchemaPacked(SchemaField("MaxRaytraceRecurseDepth", "MaxRaytraceRecurseDepth", SCHEMA_FIELD_TYPE_UINT, offsetof(RAYTRACING_PIPELINE_DESC, MaxRaytraceRecurseDepth), 1),
+		SCHEMA_PACK(SHADER_PACK_RAYTRACING_STATE, MaxRaytraceRecurseDepth)),
+	SchemaListField("HitGroup", "HitGroups", offsetof(RAYTRACING_PIPELINE_DESC, HitGroups), s_HitGroupSchema, s_HitGroupList)
+);
+
+
+const SCHEMA_STRUCT& GetGraphicsSchema()
+{
+	return s_GraphicsSchema;
+}
+
+const SCHEMA_STRUCT& GetRaytracingSchema()
+{
+	return s_RaytracingSchema;
+}
+
+const SCHEMA_ENUM& GetInputItemFormatEnum()
+{
+	return s_InputItemFormatEnum;
+}
+
+const SCHEMA_FIELD* FindSchemaField(const SCHEMA_STRUCT& schema, std::string_view name)
+{
+	const uint32_t mask = schema.NumSlots - 1;
+	for (uint32_t slot = SchemaHash(name) & mask; schema.Slots[slot] != 0; slot = (slot + 1) & mask)
+	{
+		const SCHEMA_FIELD& field = schema.Fields[schema.Slots[slot] - 1];
+		if (field.Name == name)
+		{
+			return &field;
+		}
+	}
+	return nullptr;
+}
+
+bool FindSchemaEnumValue(const SCHEMA_ENUM& schemaEnum, std::string_view name, uint32_t& outValue)
+{
+	const uint32_t mask = schemaEnum.NumSlots - 1;
+	for (uint32_t slot = SchemaHash(name) & mask; schemaEnum.Slots[slot] != 0; slot = (slot + 1) & mask)
+	{
+		const SCHEMA_ENUM_VALUE& value = schemaEnum.Values[schemaEnum.Slots[slot] - 1];
+		if (value.Name == name)
+		{
+			outValue = value.Value;
+			return true;
+		}
+	}
+
+	if (name.substr(0, schemaEnum.Prefix.size()) == schemaEnum.Prefix)
+	{
+		return false;
+	}
+
+	// Short form, hash it as if the prefix was there without building the string
+	const uint32_t hash = SchemaHash(name, SchemaHash(schemaEnum.Prefix));
+	for (uint32_t slot = hash & mask; schemaEnum.Slots[slot] != 0; slot = (slot + 1) & mask)
+	{
+		const SCHEMA_ENUM_VALUE& value = schemaEnum.Values[schemaEnum.Slots[slot] - 1];
+		if (value.Name.size() == schemaEnum.Prefix.size() + name.size() &&
+			value.Name.substr(schemaEnum.Prefix.size()) == name)
+		{
+			outValue = value.Value;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+std::string_view SchemaEnumToString(const SCHEMA_ENUM& schemaEnum, uint32_t value)
+{
+	// Tables are in value order, so this is almost always a direct hit
+	if (value < schemaEnum.NumValues && schemaEnum.Values[value].Value == value)
+	{
+		return schemaEnum.Values[value].Name;
+	}
+
+	for (uint32_t i = 0; i < schemaEnum.NumValues; i++)
+	{
+		if (schemaEnum.Values[i].Value == value)
+		{
+			return schemaEnum.Values[i].Name;
+		}
+	}
+	return schemaEnum.Fallback;
+}
+
+static uint32_t ReadScalar(const SCHEMA_FIELD& field, const uint8_t* src)
+{
+	if (field.Type == SCHEMA_FIELD_TYPE_BOOL)
+	{
+		return *(const bool*)src ? 1 : 0;
+	}
+
+	uint32_t value = 0;
+	memcpy(&value, src, sizeof(value));
+	return value;
+}
+
+static void WriteScalar(const SCHEMA_FIELD& field, uint8_t* dst, uint32_t value)
+{
+	if (field.Type == SCHEMA_FIELD_TYPE_BOOL)
+	{
+		*(bool*)dst = value != 0;
+		return;
+	}
+	memcpy(dst, &value, sizeof(value));
+}
+
+void SchemaSetDefaults(const SCHEMA_STRUCT& schema, void* obj)
+{
+	for (uint32_t i = 0; i < schema.NumFields; i++)
+	{
+		const SCHEMA_FIELD& field = schema.Fields[i];
+		if (field.bAlias)
+		{
+			continue;
+		}
+
+		uint8_t* dst = (uint8_t*)obj + field.Offset;
+		switch (field.Type)
+		{
+		case SCHEMA_FIELD_TYPE_BOOL:
+		case SCHEMA_FIELD_TYPE_UINT:
+		case SCHEMA_FIELD_TYPE_ENUM:
+			WriteScalar(field, dst, (uint32_t)field.Default);
+			break;
+		case SCHEMA_FIELD_TYPE_FLOAT:
+			*(float*)dst = (float)field.Default;
+			break;
+		case SCHEMA_FIELD_TYPE_STRING:
+			((std::string*)dst)->clear();
+			break;
+		case SCHEMA_FIELD_TYPE_STRUCT:
+			for (uint32_t element = 0; element < (field.ArraySize ? field.ArraySize : 1); element++)
+			{
+				SchemaSetDefaults(*field.Struct, dst + element * field.Stride);
+			}
+			break;
+		case SCHEMA_FIELD_TYPE_LIST:
+			field.List->Clear(dst);
+			break;
+		}
+	}
+}
+
+void SchemaToJson(const SCHEMA_STRUCT& schema, const void* obj, nlohmann::json& outJson)
+{
+	for (uint32_t i = 0; i < schema.NumFields; i++)
+	{
+		const SCHEMA_FIELD& field = schema.Fields[i];
+		if (field.bAlias || field.JsonName.empty())
+		{
+			continue;
+		}
+
+		const std::string jsonName(field.JsonName);
+		const uint8_t* src = (const uint8_t*)obj + field.Offset;
+		switch (field.Type)
+		{
+		case SCHEMA_FIELD_TYPE_BOOL:
+			outJson[jsonName] = *(const bool*)src;
+			break;
+		case SCHEMA_FIELD_TYPE_UINT:
+			outJson[jsonName] = ReadScalar(field, src);
+			break;
+		case SCHEMA_FIELD_TYPE_FLOAT:
+			outJson[jsonName] = *(const float*)src;
+			break;
+		case SCHEMA_FIELD_TYPE_ENUM:
+			outJson[jsonName] = std::string(SchemaEnumToString(*field.Enum, ReadScalar(field, src)));
+			break;
+		case SCHEMA_FIELD_TYPE_STRING:
+			outJson[jsonName] = *(const std::string*)src;
+			break;
+		case SCHEMA_FIELD_TYPE_STRUCT:
+			if (field.ArraySize == 0)
+			{
+				SchemaToJson(*field.Struct, src, outJson[jsonName]);
+			}
+			else
+			{
+				uint32_t count = field.ArraySize;
+				if (field.CountOffset != SCHEMA_NO_OFFSET)
+				{
+					uint32_t used = 0;
+					memcpy(&used, (const uint8_t*)obj + field.CountOffset, sizeof(used));
+					count = used < count ? used : count;
+				}
+
+				nlohmann::json elements = nlohmann::json::array();
+				for (uint32_t element = 0; element < count; element++)
+				{
+					nlohmann::json elementJson = nlohmann::json::object();
+					SchemaToJson(*field.Struct, src + element * field.Stride, elementJson);
+					elements.push_back(std::move(elementJson));
+				}
+				outJson[jsonName] = std::move(elements);
+			}
+			break;
+		case SCHEMA_FIELD_TYPE_LIST:
+		{
+			nlohmann::json elements = nlohmann::json::array();
+			const size_t count = field.List->Size(src);
+			for (size_t element = 0; element < count; element++)
+			{
+				nlohmann::json elementJson = nlohmann::json::object();
+				SchemaToJson(*field.Struct, field.List->At(src, element), elementJson);
+				elements.push_back(std::move(elementJson));
+			}
+			outJson[jsonName] = std::move(elements);
+		} break;
+		}
+	}
+}
+
+void SchemaToPack(const SCHEMA_STRUCT& schema, const void* obj, void* packed)
+{
+	for (uint32_t i = 0; i < schema.NumFields; i++)
+	{
+		const SCHEMA_FIELD& field = schema.Fields[i];
+		if (field.PackOffset == SCHEMA_NO_OFFSET)
+		{
+			continue;
+		}
+
+		const uint8_t* src = (const uint8_t*)obj + field.Offset;
+		uint8_t* dst = (uint8_t*)packed + field.PackOffset;
+		switch (field.Type)
+		{
+		case SCHEMA_FIELD_TYPE_BOOL:
+		case SCHEMA_FIELD_TYPE_UINT:
+		case SCHEMA_FIELD_TYPE_ENUM:
+		{
+			// Little endian, the low bytes are the narrowed value
+			const uint32_t value = ReadScalar(field, src);
+			memcpy(dst, &value, field.PackSize < sizeof(value) ? field.PackSize : sizeof(value));
+		} break;
+		case SCHEMA_FIELD_TYPE_FLOAT:
+			memcpy(dst, src, sizeof(float));
+			break;
+		case SCHEMA_FIELD_TYPE_STRUCT:
+			for (uint32_t element = 0; element < (field.ArraySize ? field.ArraySize : 1); element++)
+			{
+				SchemaToPack(*field.Struct, src + element * field.Stride, dst + element * field.PackStride);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+template<typename T>
+static bool ParseNumber(std::string_view text, T& outValue, int base)
+{
+	const char* end = text.data() + text.size();
+	std::from_chars_result result = std::from_chars(text.data(), end, outValue, base);
+	return result.ec == std::errc() && result.ptr == end;
+}
+
+bool SchemaParseValue(const SCHEMA_FIELD& field, std::string_view text, void* dst)
+{
+	switch (field.Type)
+	{
+	case SCHEMA_FIELD_TYPE_BOOL:
+		if (text == "true" || text == "false")
+		{
+			*(bool*)dst = text == "true";
+			return true;
+		}
+		return false;
+	case SCHEMA_FIELD_TYPE_UINT:
+	{
+		if (!text.empty() && (text.back() == 'u' || text.back() == 'U'))
+		{
+			text.remove_suffix(1);
+		}
+
+		uint32_t value = 0;
+		const bool hex = text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X');
+		if (!ParseNumber(hex ? text.substr(2) : text, value, hex ? 16 : 10))
+		{
+			return false;
+		}
+		memcpy(dst, &value, sizeof(value));
+		return true;
+	}
+	case SCHEMA_FIELD_TYPE_FLOAT:
+	{
+		if (!text.empty() && (text.back() == 'f' || text.back() == 'F'))
+		{
+			text.remove_suffix(1);
+		}
+
+		float value = 0.0f;
+		const char* end = text.data() + text.size();
+		std::from_chars_result result = std::from_chars(text.data(), end, value);
+		if (result.ec != std::errc() || result.ptr != end)
+		{
+			return false;
+		}
+		*(float*)dst = value;
+		return true;
+	}
+	case SCHEMA_FIELD_TYPE_ENUM:
+	{
+		uint32_t value = 0;
+		if (!FindSchemaEnumValue(*field.Enum, text, value))
+		{
+			return false;
+		}
+		memcpy(dst, &value, sizeof(value));
+		return true;
+	}
+	case SCHEMA_FIELD_TYPE_STRING:
+		((std::string*)dst)->assign(text.data(), text.size());
+		return true;
+	default:
+		// Blocks aren't values
+		return false;
+	}
+}
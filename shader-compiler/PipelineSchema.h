@@ -0,0 +1,145 @@
+#pragma once
+
+#include "Pipeline.h"
+#include "nlohmann.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <string_view>
+
+
+/*
+* Every piece of pipeline state the Pipeline block can set is described
+* once, in PipelineSchema.cpp: what it's called in the block, what it's called
+* in the json, where it lives in the descriptor, where it lives in the pack,
+* what its default is and, for enums, which names it accepts.
+* The interpreter, the defaults, the json and the pack are all driven
+* off those tables, adding a field is adding one line there.
+*/
+
+typedef enum ESCHEMA_FIELD_TYPE {
+	SCHEMA_FIELD_TYPE_BOOL,		// bool
+	SCHEMA_FIELD_TYPE_UINT,		// uint32_t
+	SCHEMA_FIELD_TYPE_FLOAT,	// float
+	SCHEMA_FIELD_TYPE_ENUM,		// One of the E* enums, 4 bytes
+	SCHEMA_FIELD_TYPE_STRING,	// std::string
+	SCHEMA_FIELD_TYPE_STRUCT,	// Nested block, set with Name = { ... };
+	SCHEMA_FIELD_TYPE_LIST		// std::vector of a nested block, every assignment appends one
+} ESCHEMA_FIELD_TYPE;
+
+#define SCHEMA_NO_OFFSET ((uint32_t)0xffffffff)
+
+typedef struct SCHEMA_ENUM_VALUE {
+	std::string_view Name;
+	uint32_t Value;
+} SCHEMA_ENUM_VALUE;
+
+/*
+* Values are looked up by name through a hash table built at compile time.
+* The block can spell them out in full or leave off Prefix,
+* "COMPARISON_FUNCTION_LESS" and "LESS" are the same thing.
+*/
+typedef struct SCHEMA_ENUM {
+	std::string_view Prefix;
+	const SCHEMA_ENUM_VALUE* Values;
+	uint32_t NumValues;
+	// Written for a value that isn't in the table
+	std::string_view Fallback;
+	const uint16_t* Slots;
+	uint32_t NumSlots;
+} SCHEMA_ENUM;
+
+typedef struct SCHEMA_STRUCT SCHEMA_STRUCT;
+
+/*
+* Type erased std::vector<T>, for SCHEMA_FIELD_TYPE_LIST
+*/
+typedef struct SCHEMA_LIST {
+	size_t (*Size)(const void* list);
+	void* (*Append)(void* list);
+	const void* (*At)(const void* list, size_t index);
+	void (*Clear)(void* list);
+} SCHEMA_LIST;
+
+typedef struct SCHEMA_FIELD {
+	// As written in the Pipeline block
+	std::string_view Name;
+	// Key in the json, empty to leave the field out
+	std::string_view JsonName;
+	ESCHEMA_FIELD_TYPE Type;
+	uint32_t Offset;
+
+	// Another name for a field listed under its real name too,
+	// only the interpreter sees it
+	bool bAlias;
+
+	const SCHEMA_ENUM* Enum;
+	const SCHEMA_STRUCT* Struct;
+	const SCHEMA_LIST* List;
+
+	// Numeric fields only, enums hold the value
+	double Default;
+
+	// Fixed arrays are set one element at a time as Name0 or Name_0,
+	// setting element N raises *CountOffset to at least N + 1.
+	// Only the first *CountOffset of them end up in the json.
+	uint32_t ArraySize;
+	uint32_t Stride;
+	uint32_t CountOffset;
+
+	// Where the field goes in the pack struct, SCHEMA_NO_OFFSET if it doesn't.
+	// For nested blocks it's the base their own PackOffsets are relative to.
+	uint32_t PackOffset;
+	uint32_t PackSize;
+	uint32_t PackStride;
+} SCHEMA_FIELD;
+
+struct SCHEMA_STRUCT {
+	const SCHEMA_FIELD* Fields;
+	uint32_t NumFields;
+	const uint16_t* Slots;
+	uint32_t NumSlots;
+};
+
+/*
+* @brief: The Pipeline block of a .gfx, over FULL_PIPELINE_DESCRIPTOR
+* and packed into SHADER_PACK_GRAPHICS_STATE
+*/
+const SCHEMA_STRUCT& GetGraphicsSchema();
+
+/*
+* @brief: The Pipeline block of a .ray, over RAYTRACING_PIPELINE_DESC
+* and packed into SHADER_PACK_RAYTRACING_STATE
+*/
+const SCHEMA_STRUCT& GetRaytracingSchema();
+
+const SCHEMA_ENUM& GetInputItemFormatEnum();
+
+/*
+* @returns: The field, or nullptr. O(1), one hash and usually one compare.
+*/
+const SCHEMA_FIELD* FindSchemaField(const SCHEMA_STRUCT& schema, std::string_view name);
+
+/*
+* @returns: false if name isn't one of the enum's values
+*/
+bool FindSchemaEnumValue(const SCHEMA_ENUM& schemaEnum, std::string_view name, uint32_t& outValue);
+
+std::string_view SchemaEnumToString(const SCHEMA_ENUM& schemaEnum, uint32_t value);
+
+/*
+* @brief: Writes every field's default into obj, nested blocks included
+*/
+void SchemaSetDefaults(const SCHEMA_STRUCT& schema, void* obj);
+
+void SchemaToJson(const SCHEMA_STRUCT& schema, const void* obj, nlohmann::json& outJson);
+
+/*
+* @brief: Copies every packed field of obj into packed, narrowing where the pack is smaller
+*/
+void SchemaToPack(const SCHEMA_STRUCT& schema, const void* obj, void* packed);
+
+/*
+* @brief: Parses one value as written in the Pipeline block into the field at dst
+* @returns: false if the text isn't a valid value for the field
+*/
+bool SchemaParseValue(const SCHEMA_FIELD& field, std::string_view text, void* dst);
@@ -13,5 +13,8 @@ RaytracingAST::~RaytracingAST()
 
 bool RaytracingAST::Interpret()
 {
-	return false;
+	m_Desc.Counts = GetCounts();
+
+	SchemaSetDefaults(GetRaytracingSchema(), &m_Desc);
+	return InterpretPipelineBlock(GetRaytracingSchema(), &m_Desc);
 }
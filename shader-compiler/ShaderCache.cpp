@@ -0,0 +1,372 @@
+#include "ShaderCache.h"
+#include <string.h>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+
+static constexpr uint32_t CacheEntryMagic = 0x48435353; // "SSCH"
+static constexpr uint32_t CacheEntryVersion = 1;
+
+// Written in front of every blob, lets us reject
+// entries from older versions or truncated files
+typedef struct SHADER_CACHE_ENTRY_HEADER {
+	uint32_t Magic;
+	uint32_t Version;
+	uint64_t Size;
+	uint8_t Digest[32];
+} SHADER_CACHE_ENTRY_HEADER;
+
+static const uint32_t Sha256RoundConstants[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t RotR(uint32_t x, uint32_t n)
+{
+	return (x >> n) | (x << (32 - n));
+}
+
+
+std::string SHADER_CACHE_KEY::ToString() const
+{
+	static const char hex[] = "0123456789abcdef";
+
+	std::string result;
+	result.resize(sizeof(Digest) * 2);
+	for (uint32_t i = 0; i < sizeof(Digest); i++)
+	{
+		result[i * 2 + 0] = hex[Digest[i] >> 4];
+		result[i * 2 + 1] = hex[Digest[i] & 0xf];
+	}
+	return result;
+}
+
+ShaderCacheHasher::ShaderCacheHasher() :
+	m_State{ 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 },
+	m_Block{ },
+	m_BlockLen(0),
+	m_TotalLen(0)
+{
+}
+
+void ShaderCacheHasher::Update(const void* data, size_t size)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+	m_TotalLen += size;
+
+	while (size > 0)
+	{
+		uint32_t toCopy = (uint32_t)std::min<size_t>(sizeof(m_Block) - m_BlockLen, size);
+		memcpy(m_Block + m_BlockLen, bytes, toCopy);
+		m_BlockLen += toCopy;
+		bytes += toCopy;
+		size -= toCopy;
+
+		if (m_BlockLen == sizeof(m_Block))
+		{
+			Transform(m_Block);
+			m_BlockLen = 0;
+		}
+	}
+}
+
+void ShaderCacheHasher::Update(const std::string& str)
+{
+	uint64_t len = str.size();
+	Update(&len, sizeof(len));
+	Update(str.data(), str.size());
+}
+
+void ShaderCacheHasher::Update(const std::wstring& str)
+{
+	uint64_t len = str.size();
+	Update(&len, sizeof(len));
+	Update(str.data(), str.size() * sizeof(wchar_t));
+}
+
+SHADER_CACHE_KEY ShaderCacheHasher::Finalize()
+{
+	uint64_t bitLen = m_TotalLen * 8;
+
+	uint8_t pad = 0x80;
+	Update(&pad, 1);
+	pad = 0;
+	while (m_BlockLen != 56)
+	{
+		Update(&pad, 1);
+	}
+
+	uint8_t lenBytes[8];
+	for (uint32_t i = 0; i < 8; i++)
+	{
+		lenBytes[i] = (uint8_t)(bitLen >> (56 - i * 8));
+	}
+	Update(lenBytes, sizeof(lenBytes));
+
+	SHADER_CACHE_KEY key;
+	for (uint32_t i = 0; i < 8; i++)
+	{
+		key.Digest[i * 4 + 0] = (uint8_t)(m_State[i] >> 24);
+		key.Digest[i * 4 + 1] = (uint8_t)(m_State[i] >> 16);
+		key.Digest[i * 4 + 2] = (uint8_t)(m_State[i] >> 8);
+		key.Digest[i * 4 + 3] = (uint8_t)(m_State[i]);
+	}
+	return key;
+}
+
+void ShaderCacheHasher::Transform(const uint8_t* block)
+{
+	uint32_t w[64];
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		w[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) | ((uint32_t)block[i * 4 + 2] << 8) | (uint32_t)block[i * 4 + 3];
+	}
+	for (uint32_t i = 16; i < 64; i++)
+	{
+		uint32_t s0 = RotR(w[i - 15], 7) ^ RotR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		uint32_t s1 = RotR(w[i - 2], 17) ^ RotR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+
+	uint32_t a = m_State[0], b = m_State[1], c = m_State[2], d = m_State[3];
+	uint32_t e = m_State[4], f = m_State[5], g = m_State[6], h = m_State[7];
+
+	for (uint32_t i = 0; i < 64; i++)
+	{
+		uint32_t s1 = RotR(e, 6) ^ RotR(e, 11) ^ RotR(e, 25);
+		uint32_t ch = (e & f) ^ (~e & g);
+		uint32_t temp1 = h + s1 + ch + Sha256RoundConstants[i] + w[i];
+		uint32_t s0 = RotR(a, 2) ^ RotR(a, 13) ^ RotR(a, 22);
+		uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+		uint32_t temp2 = s0 + maj;
+
+		h = g;
+		g = f;
+		f = e;
+		e = d + temp1;
+		d = c;
+		c = b;
+		b = a;
+		a = temp1 + temp2;
+	}
+
+	m_State[0] += a; m_State[1] += b; m_State[2] += c; m_State[3] += d;
+	m_State[4] += e; m_State[5] += f; m_State[6] += g; m_State[7] += h;
+}
+
+
+bool ShaderCache::Initialize(const std::filesystem::path& dir, uint64_t maxBytes)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(dir, ec);
+	if (ec)
+	{
+		std::cout << "[ERROR] Failed to create shader cache directory " << dir.string() << ": " << ec.message() << std::endl;
+		return false;
+	}
+
+	m_Dir = dir;
+	m_MaxBytes = maxBytes;
+	m_Enabled = true;
+	return true;
+}
+
+bool ShaderCache::Lookup(const SHADER_CACHE_KEY& key, std::vector<uint8_t>& outData)
+{
+	std::filesystem::path path = KeyToPath(key);
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		m_Misses++;
+		return false;
+	}
+
+	// Size of the file that's open, a store renaming a new entry into place can't change it
+	file.seekg(0, std::ios::end);
+	const std::streamoff fileSize = file.tellg();
+	file.seekg(0, std::ios::beg);
+
+	// header.Size is whatever is on disk, it's only trusted
+	// once it agrees with the file before anything is allocated
+	SHADER_CACHE_ENTRY_HEADER header = { };
+	file.read((char*)&header, sizeof(header));
+	if (!file ||
+		fileSize < (std::streamoff)sizeof(header) ||
+		header.Magic != CacheEntryMagic ||
+		header.Version != CacheEntryVersion ||
+		memcmp(header.Digest, key.Digest, sizeof(key.Digest)) != 0 ||
+		header.Size != (uint64_t)fileSize - sizeof(header))
+	{
+		m_Misses++;
+		return false;
+	}
+
+	outData.resize(header.Size);
+	file.read((char*)outData.data(), header.Size);
+	if ((uint64_t)file.gcount() != header.Size)
+	{
+		outData.clear();
+		m_Misses++;
+		return false;
+	}
+	file.close();
+
+	// Bump the write time so Trim() sees this entry as recently used
+	std::error_code ec;
+	std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+
+	m_Hits++;
+	return true;
+}
+
+bool ShaderCache::Store(const SHADER_CACHE_KEY& key, const void* data, size_t size)
+{
+	std::filesystem::path path = KeyToPath(key);
+
+	std::error_code ec;
+	std::filesystem::create_directories(path.parent_path(), ec);
+	if (ec)
+	{
+		return false;
+	}
+
+	// Unique per thread and per store, the rename below is
+	// what makes the entry visible to everyone else
+	std::filesystem::path tempPath = path;
+	tempPath += "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) +
+		"." + std::to_string(m_TempCounter++) + ".tmp";
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		SHADER_CACHE_ENTRY_HEADER header = { };
+		header.Magic = CacheEntryMagic;
+		header.Version = CacheEntryVersion;
+		header.Size = size;
+		memcpy(header.Digest, key.Digest, sizeof(key.Digest));
+
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)data, size);
+		if (!file)
+		{
+			file.close();
+			std::filesystem::remove(tempPath, ec);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(tempPath, path, ec);
+	if (ec)
+	{
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+
+	m_Stores++;
+	return true;
+}
+
+void ShaderCache::Trim()
+{
+	if (!m_Enabled)
+	{
+		return;
+	}
+
+	typedef struct CACHE_FILE {
+		std::filesystem::path Path;
+		std::filesystem::file_time_type LastUsed;
+		uint64_t Size;
+	} CACHE_FILE;
+
+	std::vector<CACHE_FILE> files;
+	uint64_t totalSize = 0;
+
+	std::error_code ec;
+	for (auto it = std::filesystem::recursive_directory_iterator(m_Dir, ec);
+		!ec && it != std::filesystem::recursive_directory_iterator();
+		it.increment(ec))
+	{
+		if (!it->is_regular_file(ec) || it->path().extension() != ".bin")
+		{
+			continue;
+		}
+
+		CACHE_FILE file;
+		file.Path = it->path();
+		file.LastUsed = it->last_write_time(ec);
+		file.Size = it->file_size(ec);
+		totalSize += file.Size;
+		files.push_back(std::move(file));
+	}
+
+	if (totalSize <= m_MaxBytes)
+	{
+		return;
+	}
+
+	std::sort(files.begin(), files.end(), [](const CACHE_FILE& a, const CACHE_FILE& b) {
+		return a.LastUsed < b.LastUsed;
+	});
+
+	// Evict a little past the budget so we don't end
+	// up trimming a handful of files every single run
+	uint64_t target = m_MaxBytes - m_MaxBytes / 8;
+	for (const CACHE_FILE& file : files)
+	{
+		if (totalSize <= target)
+		{
+			break;
+		}
+
+		if (std::filesystem::remove(file.Path, ec))
+		{
+			totalSize -= file.Size;
+			m_Evictions++;
+		}
+	}
+}
+
+void ShaderCache::PrintStats() const
+{
+	if (!m_Enabled)
+	{
+		return;
+	}
+
+	uint64_t hits = m_Hits;
+	uint64_t misses = m_Misses;
+	uint64_t total = hits + misses;
+	double hitRate = total == 0 ? 0.0 : (double)hits * 100.0 / (double)total;
+
+	std::cout << "[INFO] Shader cache: " << hits << " hits, " << misses << " misses (" << (uint32_t)hitRate << "% hit rate), "
+		<< m_Stores << " stored, " << m_Evictions << " evicted" << std::endl;
+}
+
+void ShaderCache::ResetStats()
+{
+	m_Hits = 0;
+	m_Misses = 0;
+	m_Stores = 0;
+	m_Evictions = 0;
+}
+
+std::filesystem::path ShaderCache::KeyToPath(const SHADER_CACHE_KEY& key) const
+{
+	std::string hex = key.ToString();
+	return m_Dir / hex.substr(0, 2) / (hex.substr(2) + ".bin");
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <filesystem>
+#include <stdint.h>
+
+
+/*
+* SHA-256 of everything that can change what DXC outputs for a compile unit
+*/
+typedef struct SHADER_CACHE_KEY {
+	uint8_t Digest[32];
+
+	std::string ToString() const;
+} SHADER_CACHE_KEY;
+
+/*
+* Small streaming SHA-256, just enough to build SHADER_CACHE_KEYs
+*/
+class ShaderCacheHasher
+{
+public:
+
+	ShaderCacheHasher();
+
+	void Update(const void* data, size_t size);
+
+	/*
+	* @brief: The string is hashed along with its length so
+	* neighbouring strings can't run together
+	*/
+	void Update(const std::string& str);
+	void Update(const std::wstring& str);
+
+	SHADER_CACHE_KEY Finalize();
+
+private:
+
+	void Transform(const uint8_t* block);
+
+	uint32_t m_State[8];
+	uint8_t m_Block[64];
+	uint32_t m_BlockLen;
+	uint64_t m_TotalLen;
+};
+
+/*
+* Content addressed store of compiled shader blobs on disk.
+* Every entry is its own file under <dir>/<2 hex>/<62 hex>.bin, and entries
+* are written to a temp file then renamed into place so a crashed or
+* concurrent run never sees a half written blob.
+* The last write time of an entry is bumped on every hit, Trim() uses that
+* to evict the least recently used entries once the cache is over budget.
+*/
+class ShaderCache
+{
+public:
+
+	ShaderCache() = default;
+
+	/*
+	* @brief: Creates the cache directory if needed.
+	* @param maxBytes: Trim() evicts entries once the cache grows past this
+	* @returns: false if the directory could not be created, the cache stays disabled
+	*/
+	bool Initialize(const std::filesystem::path& dir, uint64_t maxBytes);
+
+	inline bool IsEnabled() const
+	{
+		return m_Enabled;
+	}
+
+	/*
+	* @brief: Safe to call from any thread. An entry that's
+	* truncated or otherwise damaged counts as a miss.
+	* @returns: true and fills outData on a hit
+	*/
+	bool Lookup(const SHADER_CACHE_KEY& key, std::vector<uint8_t>& outData);
+
+	/*
+	* @brief: Safe to call from any thread.
+	*/
+	bool Store(const SHADER_CACHE_KEY& key, const void* data, size_t size);
+
+	/*
+	* @brief: Evicts the least recently used entries until the cache is back under budget.
+	* Shouldn't be called while other threads are still using the cache.
+	*/
+	void Trim();
+
+	/*
+	* @brief: Hits, misses, stores and evictions since the last ResetStats
+	*/
+	void PrintStats() const;
+
+	void ResetStats();
+
+private:
+
+	std::filesystem::path KeyToPath(const SHADER_CACHE_KEY& key) const;
+
+	bool m_Enabled = false;
+	std::filesystem::path m_Dir;
+	uint64_t m_MaxBytes = 0;
+
+	std::atomic<uint64_t> m_Hits = 0;
+	std::atomic<uint64_t> m_Misses = 0;
+	std::atomic<uint64_t> m_Stores = 0;
+	std::atomic<uint64_t> m_Evictions = 0;
+	std::atomic<uint32_t> m_TempCounter = 0;
+};
@@ -3,10 +3,15 @@
 #include <d3dcommon.h>
 #include <dxc/dxcapi.h>
 #include <iostream>
+#include <algorithm>
 #include <regex>
+#include <string.h>
 
 #define failed(x) ((x) < 0)
 
+// A unit that takes down or hangs its worker process this many times is failed
+static constexpr uint32_t MaxWorkerProcessAttempts = 2;
+
 
 
 
@@ -96,7 +101,105 @@ static std::wstring StageToEntry(ShaderStages stage)
 }
 
 
+// Arguments that don't change what the preprocessor outputs
+static bool IsCodegenOnlyArg(const std::wstring& arg)
+{
+	return arg == L"-Zi" ||
+		arg == L"-Od" ||
+		arg == L"-Qembed_debug" ||
+		arg == L"-Qstrip_debug" ||
+		arg.rfind(L"-O", 0) == 0 ||
+		arg.rfind(L"-Zs", 0) == 0;
+}
+
+static bool SamePreprocessorArgs(IDxcCompilerArgs* a, IDxcCompilerArgs* b)
+{
+	std::vector<std::wstring> argsA;
+	std::vector<std::wstring> argsB;
+	for (uint32_t i = 0; i < a->GetCount(); i++)
+	{
+		if (!IsCodegenOnlyArg(a->GetArguments()[i]))
+		{
+			argsA.push_back(a->GetArguments()[i]);
+		}
+	}
+	for (uint32_t i = 0; i < b->GetCount(); i++)
+	{
+		if (!IsCodegenOnlyArg(b->GetArguments()[i]))
+		{
+			argsB.push_back(b->GetArguments()[i]);
+		}
+	}
+	return argsA == argsB;
+}
+
+class ByteCodeBlob final : public IDxcBlob
+{
+public:
+
+	ByteCodeBlob(std::vector<uint8_t>&& bytes) :
+		m_Bytes(std::move(bytes)),
+		m_RefCount(1)
+	{
+	}
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+	{
+		(void)riid;
+		(void)ppvObject;
+		return E_FAIL;
+	}
+
+	ULONG STDMETHODCALLTYPE AddRef() override
+	{
+		return ++m_RefCount;
+	}
+
+	ULONG STDMETHODCALLTYPE Release() override
+	{
+		ULONG refCount = --m_RefCount;
+		if (refCount == 0)
+		{
+			delete this;
+		}
+		return refCount;
+	}
+
+	LPVOID STDMETHODCALLTYPE GetBufferPointer() override
+	{
+		return m_Bytes.data();
+	}
+
+	SIZE_T STDMETHODCALLTYPE GetBufferSize() override
+	{
+		return m_Bytes.size();
+	}
+
+private:
+
+	std::vector<uint8_t> m_Bytes;
+
+	// Released by whichever thread drops the last SHADER_BYTECODE
+	std::atomic<ULONG> m_RefCount;
+};
+
+IDxcBlob* CreateByteCodeBlob(std::vector<uint8_t>&& bytes)
+{
+	return new ByteCodeBlob(std::move(bytes));
+}
+
+// Heap order for the compile queues, longest predicted first then first queued
+static bool UnitRunsLater(const SHADER_COMPILE_UNIT& a, const SHADER_COMPILE_UNIT& b)
+{
+	if (a.PredictedMs != b.PredictedMs)
+	{
+		return a.PredictedMs < b.PredictedMs;
+	}
+	return a.Sequence > b.Sequence;
+}
+
 ShaderCompilerIncludeHandler::ShaderCompilerIncludeHandler(const std::filesystem::path& startPath) :
+	m_Cwd(startPath),
 	m_RefCount(1)
 {
 }
@@ -114,41 +217,120 @@ HRESULT __stdcall ShaderCompilerIncludeHandler::QueryInterface(REFIID riid, void
 
 ULONG __stdcall ShaderCompilerIncludeHandler::AddRef()
 {
-	m_RefCount++;
-	return m_RefCount;
+	return ++m_RefCount;
 }
 
 ULONG __stdcall ShaderCompilerIncludeHandler::Release()
 {
-	if (m_RefCount == 0)
-	{
-		return 0;
-	}
-	
-	m_RefCount--;
-	if (m_RefCount == 0)
+	ULONG refCount = --m_RefCount;
+	if (refCount == 0)
 	{
 		delete this;
-		return 0;
 	}
 
-	return m_RefCount;
+	return refCount;
 }
 
 HRESULT __stdcall ShaderCompilerIncludeHandler::LoadSource(LPCWSTR pFilename, IDxcBlob** ppIncludeSource)
 {
-	wchar_t fullPath[4096] = { 0 };
-	swprintf(fullPath, L"%s/%s", m_Cwd.c_str(), pFilename);
+	// If pFilename is absolute this just gives back pFilename
+	std::filesystem::path fullPath = (m_Cwd / std::filesystem::path(pFilename)).lexically_normal();
+
+	if (m_Cache == nullptr)
+	{
+		// Stamped before DXC reads it, a save in between shows up as a changed stat next build
+		FILE_SNAPSHOT snapshot = { };
+		const bool stamped = m_Recording && ReadFileSnapshot(fullPath, snapshot);
+
+		HRESULT res = m_DefaultHandler->LoadSource(fullPath.wstring().c_str(), ppIncludeSource);
+		if (SUCCEEDED(res) && stamped)
+		{
+			m_Recorded.push_back(MakeFileStamp(fullPath, snapshot));
+		}
+		return res;
+	}
+
+	if (std::find(m_Included.begin(), m_Included.end(), fullPath) != m_Included.end())
+	{
+		m_Cache->GetEmptyBlob(ppIncludeSource);
+		return S_OK;
+	}
 
-	return m_DefaultHandler->LoadSource((LPCWSTR)fullPath, ppIncludeSource);
+	bool includeOnce = false;
+	FILE_STAMP stamp = { };
+	if (!m_Cache->Load(fullPath, ppIncludeSource, includeOnce, stamp))
+	{
+		return E_FAIL;
+	}
+
+	if (includeOnce)
+	{
+		m_Included.push_back(fullPath);
+	}
+	if (m_Recording)
+	{
+		m_Recorded.push_back(std::move(stamp));
+	}
+
+	return S_OK;
+}
+
+void ShaderCompilerIncludeHandler::BeginRecording()
+{
+	m_Recorded.clear();
+	m_Included.clear();
+	m_Recording = true;
+}
+
+void ShaderCompilerIncludeHandler::EndRecording(std::vector<FILE_STAMP>& outIncludes)
+{
+	m_Recording = false;
+	std::swap(outIncludes, m_Recorded);
+	m_Recorded.clear();
 }
 
 
 ShaderCompiler::ShaderCompiler(std::filesystem::path shaderDir) :
+	m_ShaderDir(shaderDir),
 	m_ArgsSetup(false)
 {
-	ShaderCompilerIncludeHandler* handler = new ShaderCompilerIncludeHandler(shaderDir);
-	m_IncludeHandler.UnsafeSet(handler);
+}
+
+ShaderCompiler::~ShaderCompiler()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_QueueMutex);
+		m_ShuttingDown = true;
+	}
+	m_QueueCv.notify_all();
+
+	for (auto& worker : m_Workers)
+	{
+		if (worker->Thread.joinable())
+		{
+			worker->Thread.join();
+		}
+	}
+}
+
+void ShaderCompiler::SetNumJobs(uint32_t numJobs)
+{
+	m_NumJobs = numJobs;
+}
+
+void ShaderCompiler::SetMaxHeavyCompiles(uint32_t maxHeavy)
+{
+	m_MaxHeavyCompiles = maxHeavy;
+}
+
+void ShaderCompiler::SetWorkerProcesses(bool useProcesses)
+{
+	m_UseWorkerProcesses = useProcesses;
+}
+
+void ShaderCompiler::SetWorkerProcessTimeout(uint32_t timeoutSeconds)
+{
+	m_WorkerProcessTimeout = timeoutSeconds;
 }
 
 bool ShaderCompiler::InitializeDxcResources()
@@ -157,19 +339,107 @@ bool ShaderCompiler::InitializeDxcResources()
 	{
 		return false;
 	}
-	if (failed(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&m_Compiler))))
+
+	if (!m_Includes.Initialize())
 	{
 		return false;
 	}
 
-	ComPtr<IDxcIncludeHandler> includeHandler;
-	m_Utils->CreateDefaultIncludeHandler(&includeHandler);
+	uint32_t numJobs = m_NumJobs;
+	if (numJobs == 0)
+	{
+		numJobs = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	for (uint32_t i = 0; i < numJobs; i++)
+	{
+		std::unique_ptr<SHADER_COMPILE_WORKER> worker = std::make_unique<SHADER_COMPILE_WORKER>();
+
+		if (m_UseWorkerProcesses)
+		{
+			worker->Process = std::make_unique<CompileWorkerProcess>();
+			worker->Process->SetTimeout(m_WorkerProcessTimeout * 1000);
+			if (!worker->Process->Start(m_ShaderDir))
+			{
+				return false;
+			}
+
+			m_Workers.push_back(std::move(worker));
+			continue;
+		}
+
+		if (failed(DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&worker->Utils))))
+		{
+			return false;
+		}
+		if (failed(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&worker->Compiler))))
+		{
+			return false;
+		}
+
+		ComPtr<IDxcIncludeHandler> includeHandler;
+		worker->Utils->CreateDefaultIncludeHandler(&includeHandler);
 
-	m_IncludeHandler->SetDefaultHandler(includeHandler);
+		worker->IncludeHandler.UnsafeSet(new ShaderCompilerIncludeHandler(m_ShaderDir));
+		worker->IncludeHandler->SetDefaultHandler(includeHandler);
+		worker->IncludeHandler->SetIncludeCache(&m_Includes);
+
+		m_Workers.push_back(std::move(worker));
+	}
+
+	{
+		// The children load the same dxcompiler as this process
+		ComPtr<IDxcCompiler3> compiler;
+		if (failed(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler))))
+		{
+			return false;
+		}
+
+		ComPtr<IDxcVersionInfo> versionInfo;
+		if (!failed(compiler->QueryInterface(IID_PPV_ARGS(&versionInfo))))
+		{
+			UINT32 major = 0;
+			UINT32 minor = 0;
+			versionInfo->GetVersion(&major, &minor);
+			m_DxcVersion = std::to_string(major) + "." + std::to_string(minor);
+		}
+
+		ComPtr<IDxcVersionInfo2> versionInfo2;
+		if (!failed(compiler->QueryInterface(IID_PPV_ARGS(&versionInfo2))))
+		{
+			UINT32 commitCount = 0;
+			char* commitHash = nullptr;
+			if (!failed(versionInfo2->GetCommitInfo(&commitCount, &commitHash)) && commitHash)
+			{
+				m_DxcVersion += "." + std::to_string(commitCount) + "-" + commitHash;
+				CoTaskMemFree(commitHash);
+			}
+		}
+	}
+
+	// Enough that a worker never waits on whoever is queueing,
+	// few enough that they can't queue the whole build up front
+	m_MaxQueuedUnits = m_Workers.size() * (uint32_t)SHADER_COMPILATION_TYPE_NUM * (uint32_t)COMPILER_FLAGS_NUM * 2;
+	if (m_MaxHeavyCompiles == 0)
+	{
+		m_MaxHeavyCompiles = std::max((uint32_t)m_Workers.size() / 2, 1u);
+	}
+
+	// Only start the threads once every worker was created, if we
+	// bail out above there's nothing to join in the destructor
+	for (uint32_t i = 0; i < m_Workers.size(); i++)
+	{
+		m_Workers[i]->Thread = std::thread(&ShaderCompiler::WorkerMain, this, i);
+	}
 
 	return true;
 }
 
+bool ShaderCompiler::EnableCache(const std::filesystem::path& cacheDir, uint64_t maxBytes)
+{
+	return m_Cache.Initialize(cacheDir, maxBytes);
+}
+
 bool ShaderCompiler::SetupArgs()
 {
 	if (m_ArgsSetup)
@@ -177,7 +447,7 @@ bool ShaderCompiler::SetupArgs()
 		return true;
 	}
 
-	if (m_Utils.Ptr == nullptr || m_Compiler.Ptr == nullptr)
+	if (m_Utils.Ptr == nullptr || m_Workers.empty())
 	{
 		return false;
 	}
@@ -187,6 +457,11 @@ bool ShaderCompiler::SetupArgs()
 	{
 		for (uint32_t y = 0; y < COMPILER_FLAGS_NUM; y++)
 		{
+			if (!(m_Targets & ShaderTargetBit((ShaderCompilationType)x, (CompilerFlags)y)))
+			{
+				continue;
+			}
+
 			std::vector<std::wstring> args;
 
 			bool skipSetup = false;
@@ -260,6 +535,30 @@ bool ShaderCompiler::SetupArgs()
 		}
 	}
 
+	// The target profile defines macros per stage and -spirv defines __spirv__,
+	// so only the flags of one stage and target can share a preprocess
+	for (uint32_t x = 0; x < SHADER_COMPILATION_TYPE_NUM; x++)
+	{
+		for (uint32_t i = 0; i < STAGE_NUM; i++)
+		{
+			for (uint32_t y = 0; y < COMPILER_FLAGS_NUM; y++)
+			{
+				m_PreprocessShared[x][i][y] = y;
+				for (uint32_t prev = 0; prev < y; prev++)
+				{
+					IDxcCompilerArgs* current = x == DXIL ? m_D3DArgs[y][i].Ptr : m_VKArgs[y][i].Ptr;
+					IDxcCompilerArgs* shared = x == DXIL ? m_D3DArgs[prev][i].Ptr : m_VKArgs[prev][i].Ptr;
+					if (current != nullptr && shared != nullptr && SamePreprocessorArgs(current, shared))
+					{
+						m_PreprocessShared[x][i][y] = prev;
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	m_ArgsSetup = true;
 	return true;
 }
 
@@ -319,322 +618,631 @@ void ShaderCompiler::SetD3DOverrideFlags(CompilerFlags flags, const std::string&
 	}
 }
 
-bool ShaderCompiler::CompileVertexShader(const std::string& InByteCode, SHADER* shader)
+void ShaderCompiler::SetTargets(uint32_t targets)
+{
+	m_Targets = targets & SHADER_TARGETS_ALL;
+}
+
+bool ShaderCompiler::CompileVertexShader(const std::shared_ptr<const std::string>& InByteCode, SHADER* shader, const std::shared_ptr<SHADER_COMPILE_GROUP>& group)
+{
+	return QueueShaderCompile(InByteCode, STAGE_VERTEX, shader, group);
+}
+
+bool ShaderCompiler::CompilePixelShader(const std::shared_ptr<const std::string>& InByteCode, SHADER* shader, const std::shared_ptr<SHADER_COMPILE_GROUP>& group)
+{
+	return QueueShaderCompile(InByteCode, STAGE_PIXEL, shader, group);
+}
+
+bool ShaderCompiler::CompileHullShader(const std::shared_ptr<const std::string>& InByteCode, SHADER* shader, const std::shared_ptr<SHADER_COMPILE_GROUP>& group)
+{
+	return QueueShaderCompile(InByteCode, STAGE_HULL, shader, group);
+}
+
+bool ShaderCompiler::CompileDomainShader(const std::shared_ptr<const std::string>& InByteCode, SHADER* shader, const std::shared_ptr<SHADER_COMPILE_GROUP>& group)
+{
+	return QueueShaderCompile(InByteCode, STAGE_DOMAIN, shader, group);
+}
+
+bool ShaderCompiler::CompileGeometryShader(const std::shared_ptr<const std::string>& InByteCode, SHADER* shader, const std::shared_ptr<SHADER_COMPILE_GROUP>& group)
 {
-	if (!shader)
+	return QueueShaderCompile(InByteCode, STAGE_GEOMETRY, shader, group);
+}
+
+bool ShaderCompiler::CompileComputeShader(const std::shared_ptr<const std::string>& InByteCode, SHADER* shader, const std::shared_ptr<SHADER_COMPILE_GROUP>& group)
+{
+	return QueueShaderCompile(InByteCode, STAGE_COMPUTE, shader, group);
+}
+
+bool ShaderCompiler::CompileRaytracingShader(const std::shared_ptr<const std::string>& InByteCode, SHADER* shader, const std::shared_ptr<SHADER_COMPILE_GROUP>& group)
+{
+	return QueueShaderCompile(InByteCode, STAGE_RAYTRACING, shader, group);
+}
+
+std::shared_ptr<SHADER_COMPILE_GROUP> ShaderCompiler::BeginGroup(const std::string& name, std::function<void()> onDone)
+{
+	std::shared_ptr<SHADER_COMPILE_GROUP> group = std::make_shared<SHADER_COMPILE_GROUP>();
+	group->Name = name;
+	group->Pending = 1;
+	group->Units = 0;
+	group->FailedUnits = 0;
+	group->OnDone = std::move(onDone);
+	return group;
+}
+
+void ShaderCompiler::EndGroup(const std::shared_ptr<SHADER_COMPILE_GROUP>& group)
+{
+	ReleaseGroup(group);
+}
+
+void ShaderCompiler::ReleaseGroup(const std::shared_ptr<SHADER_COMPILE_GROUP>& group)
+{
+	if (!group || group->Pending.fetch_sub(1) != 1)
 	{
-		return false;
+		return;
 	}
-	if (failed(ShaderCompile(
-			InByteCode,
-			WithDebugInfo_NoOptimization,
-			DXIL,
-			STAGE_VERTEX,
-			&shader->DXILStages[WithDebugInfo_NoOptimization])) || 
-		failed(ShaderCompile(
-			InByteCode,
-			WithoutDebugInfo_Optimize,
-			DXIL,
-			STAGE_VERTEX,
-			&shader->DXILStages[WithDebugInfo_NoOptimization])) ||
-		failed(ShaderCompile(
-			InByteCode,
-			WithDebugInfo_NoOptimization,
-			SPIRV,
-			STAGE_VERTEX,
-			&shader->SPRVStages[WithDebugInfo_NoOptimization])) ||
-		failed(ShaderCompile(
-			InByteCode,
-			WithoutDebugInfo_Optimize,
-			SPIRV,
-			STAGE_VERTEX,
-			&shader->SPRVStages[WithDebugInfo_NoOptimization])))
-	{
-		std::cout << "[ERROR] Shader failed to compile" << std::endl;
-		return false;
+
+	// One line per pipeline, the units' own errors were printed as they failed
+	if (group->Units > 0)
+	{
+		std::lock_guard<std::mutex> lock(m_PrintMutex);
+		if (group->FailedUnits == 0)
+		{
+			std::cout << "[INFO] Compiled " << group->Name << std::endl;
+		}
+		else
+		{
+			std::cout << "[ERROR] " << group->FailedUnits << " of " << group->Units << " units of " << group->Name << " failed to compile" << std::endl;
+		}
+	}
+
+	if (group->OnDone)
+	{
+		group->OnDone();
 	}
-	return true;
 }
 
-bool ShaderCompiler::CompilePixelShader(const std::string& InByteCode, SHADER* shader)
+bool ShaderCompiler::WaitForCompiles()
 {
-	if (!shader)
+	std::unique_lock<std::mutex> lock(m_QueueMutex);
+	m_IdleCv.wait(lock, [this]() { return m_PendingUnits == 0; });
+
+	// Nothing is running on the workers now, safe to evict
+	m_Cache.Trim();
+	m_Cache.PrintStats();
+	m_Cache.ResetStats();
+
+	if (m_BuildStarted && !m_BuildPredictedMs.empty())
 	{
-		return false;
+		const double actualMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_BuildStart).count();
+		std::cout << "[INFO] Compiled " << m_BuildPredictedMs.size() << " units in " << (uint64_t)actualMs << "ms, ";
+		if (m_BuildUnpredicted == m_BuildPredictedMs.size())
+		{
+			std::cout << "no compile history to predict from yet" << std::endl;
+		}
+		else
+		{
+			std::cout << "history predicted " << (uint64_t)PredictMakespanMs() << "ms";
+			if (m_BuildUnpredicted > 0)
+			{
+				std::cout << " (" << m_BuildUnpredicted << " units had no history)";
+			}
+			std::cout << std::endl;
+		}
 	}
-	if (failed(ShaderCompile(
-			InByteCode,
-			WithDebugInfo_NoOptimization,
-			DXIL,
-			STAGE_PIXEL,
-			&shader->DXILStages[WithDebugInfo_NoOptimization])) ||
-		failed(ShaderCompile(
-			InByteCode,
-			WithoutDebugInfo_Optimize,
-			DXIL,
-			STAGE_PIXEL,
-			&shader->DXILStages[WithDebugInfo_NoOptimization])) ||
-		failed(ShaderCompile(
-			InByteCode,
-			WithDebugInfo_NoOptimization,
-			SPIRV,
-			STAGE_PIXEL,
-			&shader->SPRVStages[WithDebugInfo_NoOptimization])) ||
-		failed(ShaderCompile(
-			InByteCode,
-			WithoutDebugInfo_Optimize,
-			SPIRV,
-			STAGE_PIXEL,
-			&shader->SPRVStages[WithDebugInfo_NoOptimization])))
-	{
-		std::cout << "[ERROR] Shader failed to compile" << std::endl;
-		return false;
+	m_BuildStarted = false;
+	m_BuildPredictedMs.clear();
+	m_BuildUnpredicted = 0;
+
+	uint32_t includeHits = 0;
+	uint32_t includeReads = 0;
+	m_Includes.GetStats(includeHits, includeReads);
+	if (includeHits + includeReads > 0)
+	{
+		std::cout << "[INFO] Includes: " << includeReads << " read from disk, " << includeHits << " served from memory" << std::endl;
 	}
-	return true;
+	m_Includes.ResetStats();
+
+	if (m_WorkerCrashes > 0)
+	{
+		std::cout << "[WARN] DXC crashed or hung " << m_WorkerCrashes << " times, its worker processes were restarted" << std::endl;
+		m_WorkerCrashes = 0;
+	}
+
+	bool result = m_FailedUnits == 0;
+	m_FailedUnits = 0;
+	return result;
 }
 
-bool ShaderCompiler::CompileHullShader(const std::string& InByteCode, SHADER* shader)
+void ShaderCompiler::GetShaderIncludes(const SHADER* shader, std::vector<FILE_STAMP>& outIncludes)
 {
-	if (!shader)
+	std::lock_guard<std::mutex> lock(m_QueueMutex);
+	auto findRes = m_ShaderIncludes.find(shader);
+	if (findRes == m_ShaderIncludes.end())
 	{
-		return false;
-	}
-	if (failed(ShaderCompile(
-			InByteCode,
-			WithDebugInfo_NoOptimization,
-			DXIL,
-			STAGE_HULL,
-			&shader->DXILStages[WithDebugInfo_NoOptimization])) ||
-		failed(ShaderCompile(
-			InByteCode,
-			WithoutDebugInfo_Optimize,
-			DXIL,
-			STAGE_HULL,
-			&shader->DXILStages[WithDebugInfo_NoOptimization])) ||
-		failed(ShaderCompile(
-			InByteCode,
-			WithDebugInfo_NoOptimization,
-			SPIRV,
-			STAGE_HULL,
-			&shader->SPRVStages[WithDebugInfo_NoOptimization])) ||
-		failed(ShaderCompile(
-			InByteCode,
-			WithoutDebugInfo_Optimize,
-			SPIRV,
-			STAGE_HULL,
-			&shader->SPRVStages[WithDebugInfo_NoOptimization])))
-	{
-		std::cout << "[ERROR] Shader failed to compile" << std::endl;
-		return false;
+		return;
 	}
-	return true;
+
+	outIncludes.insert(outIncludes.end(), findRes->second.begin(), findRes->second.end());
 }
 
-bool ShaderCompiler::CompileDomainShader(const std::string& InByteCode, SHADER* shader)
+void ShaderCompiler::ClearShaderIncludes()
 {
-	if (!shader)
+	std::lock_guard<std::mutex> lock(m_QueueMutex);
+	m_ShaderIncludes.clear();
+}
+
+std::string ShaderCompiler::GetArgsHash()
+{
+	ShaderCacheHasher hasher;
+	for (uint32_t y = 0; y < COMPILER_FLAGS_NUM; y++)
 	{
-		return false;
-	}
-	if (failed(ShaderCompile(
-			InByteCode,
-			WithDebugInfo_NoOptimization,
-			DXIL,
-			STAGE_DOMAIN,
-			&shader->DXILStages[WithDebugInfo_NoOptimization])) ||
-		failed(ShaderCompile(
-			InByteCode,
-			WithoutDebugInfo_Optimize,
-			DXIL,
-			STAGE_DOMAIN,
-			&shader->DXILStages[WithDebugInfo_NoOptimization])) ||
-		failed(ShaderCompile(
-			InByteCode,
-			WithDebugInfo_NoOptimization,
-			SPIRV,
-			STAGE_DOMAIN,
-			&shader->SPRVStages[WithDebugInfo_NoOptimization])) ||
-		failed(ShaderCompile(
-			InByteCode,
-			WithoutDebugInfo_Optimize,
-			SPIRV,
-			STAGE_DOMAIN,
-			&shader->SPRVStages[WithDebugInfo_NoOptimization])))
-	{
-		std::cout << "[ERROR] Shader failed to compile" << std::endl;
-		return false;
+		for (uint32_t i = 0; i < STAGE_NUM; i++)
+		{
+			IDxcCompilerArgs* argLists[] = { m_D3DArgs[y][i].Ptr, m_VKArgs[y][i].Ptr };
+			for (IDxcCompilerArgs* args : argLists)
+			{
+				if (args == nullptr)
+				{
+					continue;
+				}
+				for (uint32_t j = 0; j < args->GetCount(); j++)
+				{
+					hasher.Update(std::wstring(args->GetArguments()[j]));
+				}
+			}
+		}
 	}
-	return true;
+	hasher.Update(std::to_string(m_Targets));
+	hasher.Update(m_Model);
+	hasher.Update(m_DxcVersion);
+	return hasher.Finalize().ToString();
 }
 
-bool ShaderCompiler::CompileGeometryShader(const std::string& InByteCode, SHADER* shader)
-{
-	if (!shader)
+bool ShaderCompiler::QueueShaderCompile(
+	const std::shared_ptr<const std::string>& InByteCode,
+	ShaderStages stage,
+	SHADER* shader,
+	const std::shared_ptr<SHADER_COMPILE_GROUP>& group
+) {
+	if (!shader || !InByteCode)
 	{
 		return false;
 	}
-	if (failed(ShaderCompile(
-			InByteCode,
-			WithDebugInfo_NoOptimization,
-			DXIL,
-			STAGE_GEOMETRY,
-			&shader->DXILStages[WithDebugInfo_NoOptimization])) ||
-		failed(ShaderCompile(
-			InByteCode,
-			WithoutDebugInfo_Optimize,
-			DXIL,
-			STAGE_GEOMETRY,
-			&shader->DXILStages[WithDebugInfo_NoOptimization])) ||
-		failed(ShaderCompile(
-			InByteCode,
-			WithDebugInfo_NoOptimization,
-			SPIRV,
-			STAGE_GEOMETRY,
-			&shader->SPRVStages[WithDebugInfo_NoOptimization])) ||
-		failed(ShaderCompile(
-			InByteCode,
-			WithoutDebugInfo_Optimize,
-			SPIRV,
-			STAGE_GEOMETRY,
-			&shader->SPRVStages[WithDebugInfo_NoOptimization])))
-	{
-		std::cout << "[ERROR] Shader failed to compile" << std::endl;
+
+	if (!m_ArgsSetup || m_Workers.empty())
+	{
+		std::cout << "[ERROR] Shader compiler was not initialized before compiling" << std::endl;
 		return false;
 	}
+
+	// Marked as failed by the workers if any of the variants fail
+	shader->WasCompiled = true;
+
+	// Sized up front, the units point into it
+	shader->Variants.clear();
+	for (uint32_t x = 0; x < SHADER_COMPILATION_TYPE_NUM; x++)
+	{
+		for (uint32_t y = 0; y < COMPILER_FLAGS_NUM; y++)
+		{
+			if (m_Targets & ShaderTargetBit((ShaderCompilationType)x, (CompilerFlags)y))
+			{
+				SHADER_VARIANT variant = { };
+				variant.Type = (ShaderCompilationType)x;
+				variant.Flags = (CompilerFlags)y;
+				shader->Variants.push_back(variant);
+			}
+		}
+	}
+
+	// Looked up before taking the queue lock, the history has its own
+	double predictedMs[SHADER_COMPILATION_TYPE_NUM][COMPILER_FLAGS_NUM] = { };
+	bool predicted[SHADER_COMPILATION_TYPE_NUM][COMPILER_FLAGS_NUM] = { };
+	std::string historyKeys[SHADER_COMPILATION_TYPE_NUM][COMPILER_FLAGS_NUM];
+	const double meanMs = m_History.GetMeanMs();
+	for (uint32_t x = 0; x < SHADER_COMPILATION_TYPE_NUM; x++)
+	{
+		for (uint32_t y = 0; y < COMPILER_FLAGS_NUM; y++)
+		{
+			if (!(m_Targets & ShaderTargetBit((ShaderCompilationType)x, (CompilerFlags)y)))
+			{
+				continue;
+			}
+			if (group)
+			{
+				historyKeys[x][y] = CompileHistory::MakeKey(group->Name, stage, x, y);
+			}
+			// Units never seen before are assumed to be average. New or just edited
+			// shaders tend to be the expensive ones, they mustn't sort behind everything
+			predicted[x][y] = !historyKeys[x][y].empty() && m_History.Lookup(historyKeys[x][y], predictedMs[x][y]);
+			if (!predicted[x][y])
+			{
+				predictedMs[x][y] = meanMs;
+			}
+		}
+	}
+
+	// Well past the typical unit, these are the ones that take DXC's memory
+	const double heavyMs = meanMs * 4.0;
+
+	{
+		std::unique_lock<std::mutex> lock(m_QueueMutex);
+		m_QueueSpaceCv.wait(lock, [this]() { return m_HeavyQueue.size() + m_LightQueue.size() < m_MaxQueuedUnits; });
+
+		if (!m_BuildStarted)
+		{
+			// Includes that changed since the last build are read again
+			m_Includes.BeginBuild();
+			m_BuildStarted = true;
+			m_BuildStart = std::chrono::steady_clock::now();
+		}
+
+		m_ShaderIncludes.erase(shader);
+		if (group)
+		{
+			group->Pending += (uint32_t)shader->Variants.size();
+			group->Units += (uint32_t)shader->Variants.size();
+		}
+
+		SHADER_VARIANT* variant = shader->Variants.data();
+		for (uint32_t x = 0; x < SHADER_COMPILATION_TYPE_NUM; x++)
+		{
+			std::shared_ptr<SHADER_PREPROCESS> preprocess[COMPILER_FLAGS_NUM];
+			for (uint32_t y = 0; y < COMPILER_FLAGS_NUM; y++)
+			{
+				if (!(m_Targets & ShaderTargetBit((ShaderCompilationType)x, (CompilerFlags)y)))
+				{
+					continue;
+				}
+
+				const uint32_t shared = m_PreprocessShared[x][stage][y];
+				preprocess[y] = shared == y ? std::make_shared<SHADER_PREPROCESS>() : preprocess[shared];
+
+				SHADER_COMPILE_UNIT unit;
+				unit.Source = InByteCode;
+				unit.Preprocess = preprocess[y];
+				unit.Flags = (CompilerFlags)y;
+				unit.Type = (ShaderCompilationType)x;
+				unit.Stage = stage;
+				unit.Owner = shader;
+				unit.OutByteCode = &(variant++)->ByteCode;
+				unit.Group = group;
+				unit.HistoryKey = std::move(historyKeys[x][y]);
+				unit.PredictedMs = predictedMs[x][y];
+				unit.bPredicted = predicted[x][y];
+				unit.bHeavy = meanMs > 0.0 && unit.PredictedMs > heavyMs;
+				unit.Sequence = m_NextSequence++;
+
+				std::vector<SHADER_COMPILE_UNIT>& queue = unit.bHeavy ? m_HeavyQueue : m_LightQueue;
+				queue.push_back(std::move(unit));
+				std::push_heap(queue.begin(), queue.end(), UnitRunsLater);
+				m_PendingUnits++;
+			}
+		}
+	}
+	m_QueueCv.notify_all();
+
 	return true;
 }
 
-bool ShaderCompiler::CompileComputeShader(const std::string& InByteCode, SHADER* shader)
+bool ShaderCompiler::PopUnit(SHADER_COMPILE_UNIT& outUnit)
 {
-	if (!shader)
+	// Once shutting down the limit doesn't matter, there's nothing else left to run
+	std::vector<SHADER_COMPILE_UNIT>* queue = nullptr;
+	if (!m_HeavyQueue.empty() && (m_RunningHeavy < m_MaxHeavyCompiles || (m_ShuttingDown && m_LightQueue.empty())))
 	{
-		return false;
+		queue = &m_HeavyQueue;
+	}
+	else if (!m_LightQueue.empty())
+	{
+		queue = &m_LightQueue;
 	}
-	if (failed(ShaderCompile(
-			InByteCode,
-			WithDebugInfo_NoOptimization,
-			DXIL,
-			STAGE_COMPUTE,
-			&shader->DXILStages[WithDebugInfo_NoOptimization])) ||
-		failed(ShaderCompile(
-			InByteCode,
-			WithoutDebugInfo_Optimize,
-			DXIL,
-			STAGE_COMPUTE,
-			&shader->DXILStages[WithDebugInfo_NoOptimization])) ||
-		failed(ShaderCompile(
-			InByteCode,
-			WithDebugInfo_NoOptimization,
-			SPIRV,
-			STAGE_COMPUTE,
-			&shader->SPRVStages[WithDebugInfo_NoOptimization])) ||
-		failed(ShaderCompile(
-			InByteCode,
-			WithoutDebugInfo_Optimize,
-			SPIRV,
-			STAGE_COMPUTE,
-			&shader->SPRVStages[WithDebugInfo_NoOptimization])))
-	{
-		std::cout << "[ERROR] Shader failed to compile" << std::endl;
+	else
+	{
 		return false;
 	}
+
+	std::pop_heap(queue->begin(), queue->end(), UnitRunsLater);
+	outUnit = std::move(queue->back());
+	queue->pop_back();
+
+	if (outUnit.bHeavy)
+	{
+		m_RunningHeavy++;
+	}
 	return true;
 }
 
-bool ShaderCompiler::CompileRaytracingShader(const std::string& InByteCode, SHADER* shader)
+double ShaderCompiler::PredictMakespanMs() const
 {
-	if (!shader)
+	std::vector<double> units = m_BuildPredictedMs;
+	std::sort(units.begin(), units.end(), std::greater<double>());
+
+	// Every unit goes to whichever worker frees up first
+	std::vector<double> workers(std::max(m_Workers.size(), (size_t)1), 0.0);
+	for (double ms : units)
 	{
-		return false;
+		std::pop_heap(workers.begin(), workers.end(), std::greater<double>());
+		workers.back() += ms;
+		std::push_heap(workers.begin(), workers.end(), std::greater<double>());
 	}
-	if (failed(ShaderCompile(
-			InByteCode,
-			WithDebugInfo_NoOptimization,
-			DXIL,
-			STAGE_RAYTRACING,
-			&shader->DXILStages[WithDebugInfo_NoOptimization])) ||
-		failed(ShaderCompile(
-			InByteCode,
-			WithoutDebugInfo_Optimize,
-			DXIL,
-			STAGE_RAYTRACING,
-			&shader->DXILStages[WithDebugInfo_NoOptimization])) ||
-		failed(ShaderCompile(
-			InByteCode,
-			WithDebugInfo_NoOptimization,
-			SPIRV,
-			STAGE_RAYTRACING,
-			&shader->SPRVStages[WithDebugInfo_NoOptimization])) ||
-		failed(ShaderCompile(
-			InByteCode,
-			WithoutDebugInfo_Optimize,
-			SPIRV,
-			STAGE_RAYTRACING,
-			&shader->SPRVStages[WithDebugInfo_NoOptimization])))
-	{
-		std::cout << "[ERROR] Shader failed to compile" << std::endl;
-		return false;
+	return *std::max_element(workers.begin(), workers.end());
+}
+
+void ShaderCompiler::WorkerMain(uint32_t workerIdx)
+{
+	SHADER_COMPILE_WORKER& worker = *m_Workers[workerIdx];
+
+	for (;;)
+	{
+		SHADER_COMPILE_UNIT unit;
+		{
+			std::unique_lock<std::mutex> lock(m_QueueMutex);
+			m_QueueCv.wait(lock, [this]() {
+				return m_ShuttingDown ||
+					!m_LightQueue.empty() ||
+					(!m_HeavyQueue.empty() && m_RunningHeavy < m_MaxHeavyCompiles);
+			});
+
+			if (!PopUnit(unit))
+			{
+				// Shutting down and nothing left to do
+				return;
+			}
+		}
+		m_QueueSpaceCv.notify_one();
+
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		bool cacheHit = false;
+		std::vector<FILE_STAMP> includes;
+		HRESULT res = ShaderCompile(worker, unit, cacheHit, includes);
+
+		// Cache hits say nothing about what DXC costs
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (!cacheHit && !failed(res) && !unit.HistoryKey.empty())
+		{
+			m_History.Record(unit.HistoryKey, ms);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_QueueMutex);
+			std::vector<FILE_STAMP>& shaderIncludes = m_ShaderIncludes[unit.Owner];
+			for (FILE_STAMP& include : includes)
+			{
+				auto findRes = std::find_if(shaderIncludes.begin(), shaderIncludes.end(), [&include](const FILE_STAMP& other) {
+					return other.Path == include.Path;
+				});
+
+				if (findRes == shaderIncludes.end())
+				{
+					shaderIncludes.push_back(std::move(include));
+				}
+				else if (memcmp(findRes->Hash.Digest, include.Hash.Digest, sizeof(include.Hash.Digest)) != 0)
+				{
+					// It was saved while the variants were compiling and they didn't
+					// all get the same content, a stamp matching no content makes the next build redo it
+					findRes->Hash = { };
+				}
+			}
+
+			if (failed(res))
+			{
+				unit.Owner->WasCompiled = false;
+				m_FailedUnits++;
+				if (unit.Group)
+				{
+					unit.Group->FailedUnits++;
+				}
+			}
+
+			if (!cacheHit)
+			{
+				m_BuildPredictedMs.push_back(unit.PredictedMs);
+				m_BuildUnpredicted += unit.bPredicted ? 0 : 1;
+			}
+
+			if (unit.bHeavy)
+			{
+				// Someone may be waiting on the limit
+				m_RunningHeavy--;
+				m_QueueCv.notify_all();
+			}
+		}
+
+		// Outside the lock, the group's OnDone can block on the next stage.
+		// Still counted as pending until it returns, so WaitForCompiles
+		// doesn't return before every group has been handed on.
+		ReleaseGroup(unit.Group);
+		unit.Group = nullptr;
+
+		{
+			std::lock_guard<std::mutex> lock(m_QueueMutex);
+			m_PendingUnits--;
+			if (m_PendingUnits == 0)
+			{
+				m_IdleCv.notify_all();
+			}
+		}
 	}
-	return true;
 }
 
-uint32_t ShaderCompiler::ShaderCompile(
-	const std::string& SourceFile,
-	CompilerFlags Flags,
-	ShaderCompilationType Type,
-	ShaderStages stage,
-	SHADER_BYTECODE* OutByteCode
+bool ShaderCompiler::RunDxc(
+	SHADER_COMPILE_WORKER& worker,
+	const SHADER_COMPILE_UNIT& unit,
+	const std::string& source,
+	const LPCWSTR* args,
+	uint32_t numArgs,
+	DXC_OUTPUT& outOutput,
+	std::vector<FILE_STAMP>& outIncludes
 ) {
-	ComPtr<IDxcResult> Result = nullptr;
-	HRESULT CompileRes = (HRESULT)0;
+	if (!worker.Process)
+	{
+		CompileWithDxc(worker.Compiler.Ptr, worker.IncludeHandler.Ptr, args, numArgs, source, outOutput);
+		outIncludes.insert(outIncludes.end(), outOutput.Includes.begin(), outOutput.Includes.end());
+		return true;
+	}
+
+	const std::string unitName =
+		(unit.Group ? unit.Group->Name : std::string("shader")) + " " +
+		std::to_string((uint32_t)unit.Stage) + " " +
+		(unit.Type == DXIL ? "DXIL " : "SPIRV ") +
+		CompilerFlagsToStr(unit.Flags);
+
+	for (uint32_t attempt = 1;; attempt++)
+	{
+		if (!worker.Process->IsRunning() && !worker.Process->Start(m_ShaderDir))
+		{
+			return false;
+		}
+
+		if (worker.Process->Run(m_Includes.GetGeneration(), args, numArgs, source, outOutput))
+		{
+			outIncludes.insert(outIncludes.end(), outOutput.Includes.begin(), outOutput.Includes.end());
+			return true;
+		}
+
+		m_WorkerCrashes++;
+
+		// Run already killed a child that timed out, it's restarted like a crashed one
+		const char* what = worker.Process->TimedOut() ? "stopped answering" : "crashed";
 
-	DxcBuffer Buf = { };
-	Buf.Encoding = DXC_CP_UTF8;
-	Buf.Ptr = SourceFile.c_str();
-	Buf.Size = SourceFile.length();
+		std::lock_guard<std::mutex> lock(m_PrintMutex);
+		if (attempt >= MaxWorkerProcessAttempts)
+		{
+			std::cout << "[ERROR] DXC " << what << " on " << unitName << ", " << attempt << " attempts failed, giving up on it" << std::endl;
+			return false;
+		}
+		std::cout << "[WARN] DXC " << what << " on " << unitName << ", restarting its worker process and trying again" << std::endl;
+	}
+}
 
-	ComPtr<IDxcCompilerArgs> Args;
-	if (Type == DXIL)
+HRESULT ShaderCompiler::ShaderCompile(
+	SHADER_COMPILE_WORKER& worker,
+	const SHADER_COMPILE_UNIT& unit,
+	bool& outCacheHit,
+	std::vector<FILE_STAMP>& outIncludes
+) {
+	// Not taking a reference, these are shared between the workers
+	// and live as long as the ShaderCompiler does
+	IDxcCompilerArgs* Args = nullptr;
+	if (unit.Type == DXIL)
+	{
+		Args = m_D3DArgs[unit.Flags][unit.Stage].Ptr;
+	}
+	else if (unit.Type == SPIRV)
 	{
-		Args = m_D3DArgs[Flags][stage];
+		Args = m_VKArgs[unit.Flags][unit.Stage].Ptr;
 	}
-	else if (Type == SPIRV)
+
+	// Done or failed once it returns, either way nothing writes to it anymore
+	Preprocess(worker, unit, Args);
+	const SHADER_PREPROCESS& Preprocessed = *unit.Preprocess;
+	outIncludes.insert(outIncludes.end(), Preprocessed.Includes.begin(), Preprocessed.Includes.end());
+
+	SHADER_CACHE_KEY cacheKey = { };
+	bool useCache = m_Cache.IsEnabled() && Preprocessed.Succeeded;
+	if (useCache)
 	{
-		Args = m_VKArgs[Flags][stage];
+		cacheKey = BuildCacheKey(unit, Args);
+		std::vector<uint8_t> cached;
+		if (m_Cache.Lookup(cacheKey, cached))
+		{
+			unit.OutByteCode->Blob = nullptr;
+			unit.OutByteCode->Blob.UnsafeSet(CreateByteCodeBlob(std::move(cached)));
+			outCacheHit = true;
+			return S_OK;
+		}
 	}
 
-	CompileRes = m_Compiler->Compile(&Buf, Args->GetArguments(), Args->GetCount(), nullptr, IID_PPV_ARGS(&Result));
-	Args->Release();
-	if (FAILED(CompileRes))
+	// Every include is already expanded in the preprocessed text, DXC
+	// doesn't go back to the disk for them
+	const std::string& Source = Preprocessed.Succeeded ? Preprocessed.Text : *unit.Source;
+
+	DXC_OUTPUT Result = { };
+	if (!RunDxc(worker, unit, Source, Args->GetArguments(), Args->GetCount(), Result, outIncludes))
 	{
-		return CompileRes;
+		return E_FAIL;
 	}
 
-	ComPtr<IDxcBlob> ResultBlob = nullptr;
-	Result->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&ResultBlob), nullptr);
-	if (ResultBlob != nullptr && ResultBlob->GetBufferSize() != 0)
+	if (!Result.Errors.empty())
 	{
+		std::lock_guard<std::mutex> lock(m_PrintMutex);
 		std::cout << "Failed to compile" << std::endl;
-		std::cout << (const char*)ResultBlob->GetBufferPointer() << std::endl;
+		std::cout << Result.Errors << std::endl;
 	}
 
-	HRESULT Status;
-	Result->GetStatus(&Status);
+	if (!SUCCEEDED(Result.Status))
+	{
+		return Result.Status;
+	}
+
+	if (Result.Object == nullptr)
+	{
+		return E_FAIL;
+	}
 
-	if (!SUCCEEDED(Status))
+	if (useCache)
 	{
-		return Status;
+		m_Cache.Store(cacheKey, Result.Object->GetBufferPointer(), Result.Object->GetBufferSize());
 	}
 
-	std::cout << "Successfully compiled" << std::endl;
+	// Each unit owns a distinct slot in its SHADER, no lock needed
+	unit.OutByteCode->Blob = Result.Object;
+
+	return Result.Status;
+}
+
+void ShaderCompiler::Preprocess(
+	SHADER_COMPILE_WORKER& worker,
+	const SHADER_COMPILE_UNIT& unit,
+	IDxcCompilerArgs* args
+) {
+	SHADER_PREPROCESS& preprocess = *unit.Preprocess;
 
-	ComPtr<IDxcBlob> ShaderCode = nullptr;
-	Result->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&ShaderCode), nullptr);
+	// The other variant waits here rather than preprocessing the same thing again
+	std::lock_guard<std::mutex> lock(preprocess.Lock);
+	if (preprocess.Done)
+	{
+		return;
+	}
+	preprocess.Done = true;
 
-	OutByteCode->ByteCode.resize(ShaderCode->GetBufferSize());
-	memcpy(OutByteCode->ByteCode.data(), ShaderCode->GetBufferPointer(), ShaderCode->GetBufferSize());
+	std::vector<LPCWSTR> preprocessArgs(args->GetArguments(), args->GetArguments() + args->GetCount());
+	preprocessArgs.push_back(L"-P");
 
-	ShaderCode->Release();
+	DXC_OUTPUT Result = { };
+	if (!RunDxc(worker, unit, *unit.Source, preprocessArgs.data(), (uint32_t)preprocessArgs.size(), Result, preprocess.Includes))
+	{
+		return;
+	}
+
+	if (failed(Result.Status) || Result.Preprocessed.empty())
+	{
+		// Let the real compile report the error
+		return;
+	}
+
+	preprocess.Text = std::move(Result.Preprocessed);
+
+	ShaderCacheHasher hasher;
+	hasher.Update(preprocess.Text.data(), preprocess.Text.size());
+	preprocess.Hash = hasher.Finalize();
+	preprocess.Succeeded = true;
+}
+
+SHADER_CACHE_KEY ShaderCompiler::BuildCacheKey(
+	const SHADER_COMPILE_UNIT& unit,
+	IDxcCompilerArgs* args
+) {
+	ShaderCacheHasher hasher;
+	hasher.Update(unit.Preprocess->Hash.Digest, sizeof(unit.Preprocess->Hash.Digest));
+	for (uint32_t i = 0; i < args->GetCount(); i++)
+	{
+		hasher.Update(std::wstring(args->GetArguments()[i]));
+	}
+	hasher.Update(m_Model);
+	hasher.Update(m_DxcVersion);
+	hasher.Update(&unit.Type, sizeof(unit.Type));
 
-	return CompileRes;
+	return hasher.Finalize();
 }
@@ -1,9 +1,21 @@
 #pragma once
 #include <string.h>
 #include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <chrono>
+#include <condition_variable>
 #include "nlohmann.hpp"
-#include "base64.hpp"
+#include "Base64Encoder.h"
 #include "ComPtr.h"
+#include "ShaderCache.h"
+#include "CompileHistory.h"
+#include "CompileWorkerProcess.h"
+#include "IncludeCache.h"
 #include <d3dcommon.h>
 #include <dxc/dxcapi.h>
 
@@ -52,6 +64,17 @@ inline std::string CompilerFlagsToStr(CompilerFlags flags)
 	return "";
 }
 
+/*
+* A target is one ShaderCompilationType compiled with one CompilerFlags,
+* a build only compiles the targets in its mask, see ShaderTargets.h
+*/
+inline constexpr uint32_t ShaderTargetBit(ShaderCompilationType type, CompilerFlags flags)
+{
+	return 1u << ((uint32_t)type * (uint32_t)COMPILER_FLAGS_NUM + (uint32_t)flags);
+}
+
+constexpr uint32_t SHADER_TARGETS_ALL = (1u << ((uint32_t)SHADER_COMPILATION_TYPE_NUM * (uint32_t)COMPILER_FLAGS_NUM)) - 1;
+
 const std::string VertexEntry = "VSMain";
 const std::string HullEntry = "HSMain";
 const std::string DomainEntry = "DSMain";
@@ -61,37 +84,100 @@ const std::string ComputeEntry = "CSMain";
 
 
 
+/*
+* Refcounted, the blob DXC compiled into is kept as is and
+* shared on its way into the pack instead of being copied.
+* Null if the variant wasn't compiled.
+*/
 typedef struct SHADER_BYTECODE {
-	std::vector<uint8_t> ByteCode;
+	ComPtr<IDxcBlob> Blob;
+
+	inline const uint8_t* Data() const
+	{
+		return Blob.Ptr ? (const uint8_t*)Blob.Ptr->GetBufferPointer() : nullptr;
+	}
+
+	inline size_t Size() const
+	{
+		return Blob.Ptr ? (size_t)Blob.Ptr->GetBufferSize() : 0;
+	}
 } SHADER_BYTECODE;
 
+/*
+* @brief: A blob owning bytes that didn't come out of DXC in this process,
+* cache hits and worker process results. Starts with one reference.
+*/
+IDxcBlob* CreateByteCodeBlob(std::vector<uint8_t>&& bytes);
+
+typedef struct SHADER_VARIANT {
+	ShaderCompilationType Type;
+	CompilerFlags Flags;
+	SHADER_BYTECODE ByteCode;
+} SHADER_VARIANT;
+
 typedef struct SHADER {
 	bool WasCompiled;
-	SHADER_BYTECODE DXILStages[COMPILER_FLAGS_NUM];
-	SHADER_BYTECODE SPRVStages[COMPILER_FLAGS_NUM];
+	// One per target the build compiled, in ShaderTargetBit order.
+	// Targets that weren't asked for have no entry at all.
+	std::vector<SHADER_VARIANT> Variants;
+
+	/*
+	* @returns: nullptr if the target wasn't compiled
+	*/
+	inline const SHADER_BYTECODE* FindVariant(ShaderCompilationType type, CompilerFlags flags) const
+	{
+		for (const SHADER_VARIANT& variant : Variants)
+		{
+			if (variant.Type == type && variant.Flags == flags)
+			{
+				return &variant.ByteCode;
+			}
+		}
+		return nullptr;
+	}
 } SHADER;
 
 
-inline nlohmann::json SerializeShader(const SHADER* Shader)
+/*
+* @brief: Appends the shader as a json object, {"DXIL":{<flags>:<base64>},"SPRV":{...}}.
+* Only the variants that were compiled are written.
+* Written by hand so the bytecode is encoded straight into Out
+* instead of through a string per variant and a json DOM.
+*/
+inline void SerializeShader(const SHADER* Shader, std::string& Out)
 {
-	nlohmann::json Result;
-	Result["SPRV"] = {
-		"WithDebugInfo_NoOptimization", base64::to_base64(
-			Shader->SPRVStages[CompilerFlags::WithDebugInfo_NoOptimization].ByteCode
-		),
-		"WithoutDebugInfo_Optimize", base64::to_base64(
-			Shader->SPRVStages[CompilerFlags::WithoutDebugInfo_Optimize].ByteCode
-		)
-	};
-	Result["DXIL"] = {
-		"WithDebugInfo_NoOptimization", base64::to_base64(
-			Shader->DXILStages[CompilerFlags::WithDebugInfo_NoOptimization].ByteCode
-		),
-		"WithoutDebugInfo_Optimize", base64::to_base64(
-			Shader->DXILStages[CompilerFlags::WithoutDebugInfo_Optimize].ByteCode
-		)
-	};
-	return Result;
+	const char* ApiNames[] = { "DXIL", "SPRV" };
+
+	size_t Reserve = 64;
+	for (const SHADER_VARIANT& Variant : Shader->Variants)
+	{
+		Reserve += Base64EncodedLength(Variant.ByteCode.Size()) + 64;
+	}
+	Out.reserve(Out.size() + Reserve);
+
+	Out += '{';
+	for (uint32_t Api = 0; Api < SHADER_COMPILATION_TYPE_NUM; Api++)
+	{
+		Out += Api == 0 ? "\"" : ",\"";
+		Out += ApiNames[Api];
+		Out += "\":{";
+		bool First = true;
+		for (const SHADER_VARIANT& Variant : Shader->Variants)
+		{
+			if (Variant.Type != (ShaderCompilationType)Api)
+			{
+				continue;
+			}
+			Out += First ? "\"" : ",\"";
+			Out += CompilerFlagsToStr(Variant.Flags);
+			Out += "\":\"";
+			AppendBase64(Out, Variant.ByteCode.Data(), Variant.ByteCode.Size());
+			Out += '"';
+			First = false;
+		}
+		Out += '}';
+	}
+	Out += '}';
 }
 
 
@@ -118,25 +204,162 @@ public:
 		m_DefaultHandler = defaultHandler;
 	}
 
+	/*
+	* @brief: Includes are loaded through the cache instead of the default handler
+	*/
+	inline void SetIncludeCache(IncludeCache* cache)
+	{
+		m_Cache = cache;
+	}
+
+	/*
+	* @brief: Every include resolved between BeginRecording and EndRecording
+	* is returned by EndRecording. Nested includes come through here too,
+	* so this is the full set of files a compile depended on.
+	* One recording is one compile, files with #pragma once
+	* are only handed to DXC once in it.
+	*/
+	void BeginRecording();
+
+	void EndRecording(std::vector<FILE_STAMP>& outIncludes);
+
 private:
 
 	std::filesystem::path m_Cwd;
 
+	bool m_Recording = false;
+	std::vector<FILE_STAMP> m_Recorded;
+	// Include once files already given to the current compile
+	std::vector<std::filesystem::path> m_Included;
+
 	ComPtr<IDxcIncludeHandler> m_DefaultHandler;
+	IncludeCache* m_Cache = nullptr;
 
-	ULONG m_RefCount;
+	// Every compile worker owns its own handler, but DXC is free
+	// to AddRef/Release from whichever thread it's running on
+	std::atomic<ULONG> m_RefCount;
 };
 
+/*
+* Ties together every unit queued for one pipeline. OnDone runs once,
+* on whichever worker finishes the last of them, after their bytecode
+* and includes are in place.
+*/
+typedef struct SHADER_COMPILE_GROUP {
+	// Pipeline file the units are recorded under in the compile history
+	std::string Name;
+	// One per unit still in flight, plus one held until EndGroup
+	std::atomic<uint32_t> Pending;
+	// Reported once per pipeline when the last unit finishes
+	std::atomic<uint32_t> Units;
+	std::atomic<uint32_t> FailedUnits;
+	std::function<void()> OnDone;
+} SHADER_COMPILE_GROUP;
+
+/*
+* Preprocessed source of one stage for one target. The debug and release
+* variants usually only differ in flags the preprocessor ignores, those share
+* one of these and whichever runs first preprocesses for both.
+*/
+typedef struct SHADER_PREPROCESS {
+	std::mutex Lock;
+	bool Done = false;
+	// false if preprocessing failed, the units compile the
+	// raw source instead so DXC reports the error properly
+	bool Succeeded = false;
+	std::string Text;
+	// Of Text, every unit's cache key is built on it
+	SHADER_CACHE_KEY Hash = { };
+	std::vector<FILE_STAMP> Includes;
+} SHADER_PREPROCESS;
+
+/*
+* A single call into DXC. Every shader stage of a pipeline expands
+* into one of these per target the build compiles
+*/
+typedef struct SHADER_COMPILE_UNIT {
+	// Shared between all the units queued for the same shader
+	std::shared_ptr<const std::string> Source;
+	// Shared with the other variants that preprocess the same
+	std::shared_ptr<SHADER_PREPROCESS> Preprocess;
+	CompilerFlags Flags;
+	ShaderCompilationType Type;
+	ShaderStages Stage;
+	SHADER* Owner;
+	SHADER_BYTECODE* OutByteCode;
+	// nullptr if the shader wasn't queued as part of a group
+	std::shared_ptr<SHADER_COMPILE_GROUP> Group;
+
+	// Empty without a group, the unit isn't recorded then
+	std::string HistoryKey;
+	// The history's mean for a unit it has never seen
+	double PredictedMs;
+	// false if PredictedMs is only the mean, for the report
+	bool bPredicted;
+	// Counted against the limit on heavy units running at once
+	bool bHeavy;
+	// Queue order, breaks ties between equal predictions
+	uint64_t Sequence;
+} SHADER_COMPILE_UNIT;
+
+/*
+* Each worker thread gets its own set of DXC objects, IDxcCompiler3
+* is not safe to call into from multiple threads at once.
+* With worker processes the thread owns a child process instead
+* and the DXC objects are left null.
+*/
+typedef struct SHADER_COMPILE_WORKER {
+	ComPtr<IDxcUtils> Utils;
+	ComPtr<IDxcCompiler3> Compiler;
+	ComPtr<ShaderCompilerIncludeHandler> IncludeHandler;
+	std::unique_ptr<CompileWorkerProcess> Process;
+	std::thread Thread;
+} SHADER_COMPILE_WORKER;
+
 class ShaderCompiler
 {
 public:
 
 	ShaderCompiler() = default;
 	ShaderCompiler(std::filesystem::path shaderDir);
-	~ShaderCompiler() = default;
+	~ShaderCompiler();
+
+	/*
+	* @brief: Sets the number of compile workers. Must be called before InitializeDxcResources.
+	* 0 uses one worker per hardware thread.
+	*/
+	void SetNumJobs(uint32_t numJobs);
+
+	/*
+	* @brief: How many of the heaviest units, by their compile history,
+	* can run at once. DXC's memory use grows with how long a compile
+	* takes, this keeps a handful of huge libraries from running the
+	* machine out of memory together. 0 allows half the workers.
+	*/
+	void SetMaxHeavyCompiles(uint32_t maxHeavy);
+
+	/*
+	* @brief: Runs DXC in a child process per worker instead of on the worker threads.
+	* A shader that crashes DXC then only fails itself, its child is restarted
+	* and the unit retried once. Must be called before InitializeDxcResources.
+	*/
+	void SetWorkerProcesses(bool useProcesses);
+
+	/*
+	* @brief: Seconds a worker process gets to answer one compile before it's
+	* treated as hung, killed and the unit retried like a crash. 0 waits forever.
+	*/
+	void SetWorkerProcessTimeout(uint32_t timeoutSeconds);
 
 	bool InitializeDxcResources();
 
+	/*
+	* @brief: Enables the on disk compile cache. Compiles that hash to an
+	* entry already in the cache skip DXC entirely.
+	* @param maxBytes: The least recently used entries are evicted past this size
+	*/
+	bool EnableCache(const std::filesystem::path& cacheDir, uint64_t maxBytes);
+
 	bool SetupArgs();
 
 	bool SetShaderModel(const std::string& ShaderModel);
@@ -149,30 +372,167 @@ public:
 
 	void SetD3DOverrideFlags(CompilerFlags flags, const std::string& compilerFlagsOverride);
 
-	bool CompileVertexShader(const std::string& InByteCode, SHADER* shader);
+	/*
+	* @brief: Only these targets are compiled, a mask of ShaderTargetBit.
+	* Every shader ends up with one variant per target. Defaults to all of them.
+	* Must be called before SetupArgs.
+	*/
+	void SetTargets(uint32_t targets);
 
-	bool CompilePixelShader(const std::string& InByteCode, SHADER* shader);
-
-	bool CompileHullShader(const std::string& InByteCode, SHADER* shader);
-
-	bool CompileDomainShader(const std::string& InByteCode, SHADER* shader);
+	inline uint32_t GetTargets() const
+	{
+		return m_Targets;
+	}
 
-	bool CompileGeometryShader(const std::string& InByteCode, SHADER* shader);
+	/*
+	* The Compile*Shader functions hold on to InByteCode until every
+	* variant is compiled, pass the same buffer for every stage of a
+	* pipeline and it's never copied.
+	* They block while the queue is full, so whoever is feeding the
+	* workers can't get more than a few units per worker ahead of them.
+	*/
+	bool CompileVertexShader(const std::shared_ptr<const std::string>& InByteCode, SHADER* shader, const std::shared_ptr<SHADER_COMPILE_GROUP>& group = nullptr);
+
+	bool CompilePixelShader(const std::shared_ptr<const std::string>& InByteCode, SHADER* shader, const std::shared_ptr<SHADER_COMPILE_GROUP>& group = nullptr);
+
+	bool CompileHullShader(const std::shared_ptr<const std::string>& InByteCode, SHADER* shader, const std::shared_ptr<SHADER_COMPILE_GROUP>& group = nullptr);
+
+	bool CompileDomainShader(const std::shared_ptr<const std::string>& InByteCode, SHADER* shader, const std::shared_ptr<SHADER_COMPILE_GROUP>& group = nullptr);
+
+	bool CompileGeometryShader(const std::shared_ptr<const std::string>& InByteCode, SHADER* shader, const std::shared_ptr<SHADER_COMPILE_GROUP>& group = nullptr);
+
+	bool CompileComputeShader(const std::shared_ptr<const std::string>& InByteCode, SHADER* shader, const std::shared_ptr<SHADER_COMPILE_GROUP>& group = nullptr);
+
+	bool CompileRaytracingShader(const std::shared_ptr<const std::string>& InByteCode, SHADER* shader, const std::shared_ptr<SHADER_COMPILE_GROUP>& group = nullptr);
+
+	/*
+	* @brief: Starts a group. Pass it to the Compile*Shader calls of one
+	* pipeline, then to EndGroup once they're all queued. onDone is
+	* free to block, the worker running it just stops taking new units.
+	*/
+	std::shared_ptr<SHADER_COMPILE_GROUP> BeginGroup(const std::string& name, std::function<void()> onDone);
+
+	/*
+	* @brief: Nothing more will be queued in group. Runs onDone right
+	* here if every unit in it already finished, or none were queued.
+	*/
+	void EndGroup(const std::shared_ptr<SHADER_COMPILE_GROUP>& group);
+
+	/*
+	* @brief: The Compile*Shader functions only queue their work. This blocks
+	* until every queued compile unit has finished, then reports how long
+	* the compiles took against what the history predicted.
+	* @returns: false if any unit queued since the last call failed to compile.
+	*/
+	bool WaitForCompiles();
+
+	/*
+	* @brief: Every file included while compiling any variant of this shader,
+	* as it was when it was handed to DXC. Only valid once WaitForCompiles returns.
+	*/
+	void GetShaderIncludes(const SHADER* shader, std::vector<FILE_STAMP>& outIncludes);
+
+	void ClearShaderIncludes();
+
+	/*
+	* @brief: Hash of everything besides the source that goes into a compile,
+	* targets, arguments, shader model and dxc version. Only valid after SetupArgs.
+	*/
+	std::string GetArgsHash();
+
+	/*
+	* @returns: The compile cache, nullptr if EnableCache wasn't called or failed
+	*/
+	inline ShaderCache* GetCache()
+	{
+		return m_Cache.IsEnabled() ? &m_Cache : nullptr;
+	}
 
-	bool CompileComputeShader(const std::string& InByteCode, SHADER* shader);
+	/*
+	* @brief: Units are queued longest first by this, loading and saving it is up to the caller
+	*/
+	inline CompileHistory& GetHistory()
+	{
+		return m_History;
+	}
 
-	bool CompileRaytracingShader(const std::string& InByteCode, SHADER* shader);
+	/*
+	* @brief: Every include DXC reads goes through this, files can be put in it by hand
+	*/
+	inline IncludeCache& GetIncludeCache()
+	{
+		return m_Includes;
+	}
 
 private:
 
-	uint32_t ShaderCompile(
-		const std::string& SourceFile,
-		CompilerFlags Flags,
-		ShaderCompilationType Type,
+	bool QueueShaderCompile(
+		const std::shared_ptr<const std::string>& InByteCode,
 		ShaderStages stage,
-		SHADER_BYTECODE* OutByteCode
+		SHADER* shader,
+		const std::shared_ptr<SHADER_COMPILE_GROUP>& group
+	);
+
+	void ReleaseGroup(const std::shared_ptr<SHADER_COMPILE_GROUP>& group);
+
+	/*
+	* @brief: Takes the longest unit that's allowed to run, heavy ones only under the limit.
+	* Caller holds m_QueueMutex.
+	* @returns: false if there's nothing to take
+	*/
+	bool PopUnit(SHADER_COMPILE_UNIT& outUnit);
+
+	/*
+	* @brief: Makespan the history predicts for the units that went through DXC,
+	* scheduled longest first on every worker. Caller holds m_QueueMutex.
+	*/
+	double PredictMakespanMs() const;
+
+	void WorkerMain(uint32_t workerIdx);
+
+	/*
+	* @brief: One call into DXC, on the worker's thread or in its child process.
+	* Includes the compile resolved are appended to outIncludes.
+	* @returns: false if DXC crashed or hung, the unit can't be compiled
+	*/
+	bool RunDxc(
+		SHADER_COMPILE_WORKER& worker,
+		const SHADER_COMPILE_UNIT& unit,
+		const std::string& source,
+		const LPCWSTR* args,
+		uint32_t numArgs,
+		DXC_OUTPUT& outOutput,
+		std::vector<FILE_STAMP>& outIncludes
 	);
 
+	HRESULT ShaderCompile(
+		SHADER_COMPILE_WORKER& worker,
+		const SHADER_COMPILE_UNIT& unit,
+		bool& outCacheHit,
+		std::vector<FILE_STAMP>& outIncludes
+	);
+
+	/*
+	* @brief: Preprocesses the unit's source, unless another variant sharing
+	* unit.Preprocess already did or is doing it right now
+	*/
+	void Preprocess(
+		SHADER_COMPILE_WORKER& worker,
+		const SHADER_COMPILE_UNIT& unit,
+		IDxcCompilerArgs* args
+	);
+
+	/*
+	* @brief: Hashes the preprocessed output together with the arguments, shader model
+	* and dxc version. Hashing the preprocessed output means edits to included files are picked up.
+	*/
+	SHADER_CACHE_KEY BuildCacheKey(
+		const SHADER_COMPILE_UNIT& unit,
+		IDxcCompilerArgs* args
+	);
+
+	std::filesystem::path m_ShaderDir;
+
 	std::wstring m_Model;
 
 	// Extra compilation flags
@@ -187,12 +547,65 @@ private:
 
 	bool m_ArgsSetup;
 
+	uint32_t m_Targets = SHADER_TARGETS_ALL;
+
+	// Only used to build the arguments, compilation happens on the workers
 	ComPtr<IDxcUtils> m_Utils;
-	ComPtr<IDxcCompiler3> m_Compiler;
-	ComPtr<ShaderCompilerIncludeHandler> m_IncludeHandler;
 
+	// Built once in SetupArgs and only read afterwards, so these
+	// are shared between all the workers. Null for targets not compiled.
 	ComPtr<IDxcCompilerArgs> m_D3DArgs[COMPILER_FLAGS_NUM][STAGE_NUM];
 	ComPtr<IDxcCompilerArgs> m_VKArgs[COMPILER_FLAGS_NUM][STAGE_NUM];
 
+	// First flags whose arguments preprocess the same as these, the
+	// units of both share a SHADER_PREPROCESS
+	uint32_t m_PreprocessShared[SHADER_COMPILATION_TYPE_NUM][STAGE_NUM][COMPILER_FLAGS_NUM];
+
+	uint32_t m_NumJobs = 0;
+	bool m_UseWorkerProcesses = false;
+	uint32_t m_WorkerProcessTimeout = 300;
+	std::vector<std::unique_ptr<SHADER_COMPILE_WORKER>> m_Workers;
+	// Worker processes lost to a crash or a timeout since the last WaitForCompiles
+	std::atomic<uint32_t> m_WorkerCrashes = 0;
+
+	std::mutex m_QueueMutex;
+	std::condition_variable m_QueueCv;
+	std::condition_variable m_IdleCv;
+	std::condition_variable m_QueueSpaceCv;
+	// Max heaps on PredictedMs, heavy units are kept apart so
+	// the longest light one can be taken while they're held back
+	std::vector<SHADER_COMPILE_UNIT> m_HeavyQueue;
+	std::vector<SHADER_COMPILE_UNIT> m_LightQueue;
+	// Set from the number of workers, queueing blocks past this
+	size_t m_MaxQueuedUnits = 0;
+	uint32_t m_MaxHeavyCompiles = 0;
+	uint32_t m_RunningHeavy = 0;
+	uint64_t m_NextSequence = 0;
+
+	// Since the first unit queued after the last WaitForCompiles
+	bool m_BuildStarted = false;
+	std::chrono::steady_clock::time_point m_BuildStart;
+	// Prediction of every unit that went through DXC this build
+	std::vector<double> m_BuildPredictedMs;
+	uint32_t m_BuildUnpredicted = 0;
+	uint32_t m_PendingUnits = 0;
+	uint32_t m_FailedUnits = 0;
+	bool m_ShuttingDown = false;
+
+	// Keeps the DXC diagnostics from different workers from interleaving
+	std::mutex m_PrintMutex;
+
+	// Guarded by m_QueueMutex
+	std::map<const SHADER*, std::vector<FILE_STAMP>> m_ShaderIncludes;
+
+	ShaderCache m_Cache;
+
+	CompileHistory m_History;
+
+	IncludeCache m_Includes;
+
+	// Part of every cache key, a new dxcompiler invalidates the whole cache
+	std::string m_DxcVersion;
+
 };
 
@@ -0,0 +1,279 @@
+#include "ShaderPack.h"
+#include "PipelineSchema.h"
+#include "Utils.h"
+#include <fstream>
+#include <iostream>
+
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+ShaderPackWriter::ShaderPackWriter(ESHADER_PACK_API api, uint32_t flags) :
+	m_Api(api),
+	m_Flags(flags)
+{
+}
+
+void ShaderPackWriter::AddGraphicsPipeline(const std::string& name, const FULL_PIPELINE_DESCRIPTOR& desc)
+{
+	SHADER_PACK_PIPELINE& pipeline = BeginPipeline(name, SHADER_PACK_PIPELINE_TYPE_GRAPHICS, desc.Counts);
+	SHADER_PACK_GRAPHICS_STATE& state = pipeline.Graphics;
+
+	// Everything the Pipeline block sets, the input layout comes from the vertex shader
+	SchemaToPack(GetGraphicsSchema(), &desc, &state);
+	state.NumRenderTargets = desc.NumRenderTargets > 8 ? 8 : desc.NumRenderTargets;
+
+	state.FirstInputItem = (uint32_t)m_InputItems.size();
+	state.NumInputItems = (uint32_t)desc.InputLayout.InputItems.size();
+	for (const GFX_INPUT_ITEM_DESC& item : desc.InputLayout.InputItems)
+	{
+		SHADER_PACK_INPUT_ITEM packItem = { };
+		packItem.Name = AddString(item.Name);
+		packItem.Format = (uint32_t)item.ItemFormat;
+		m_InputItems.push_back(packItem);
+	}
+
+	AddShader(pipeline, desc.VS, SHADER_PACK_STAGE_VERTEX);
+	AddShader(pipeline, desc.PS, SHADER_PACK_STAGE_PIXEL);
+	if (HasHullShader(desc))
+	{
+		AddShader(pipeline, desc.HS, SHADER_PACK_STAGE_HULL);
+	}
+	if (HasDomainShader(desc))
+	{
+		AddShader(pipeline, desc.DS, SHADER_PACK_STAGE_DOMAIN);
+	}
+	if (HasGeometryShader(desc))
+	{
+		AddShader(pipeline, desc.GS, SHADER_PACK_STAGE_GEOMETRY);
+	}
+}
+
+void ShaderPackWriter::AddComputePipeline(const std::string& name, const COMPUTE_PIPELINE_DESC& desc)
+{
+	SHADER_PACK_PIPELINE& pipeline = BeginPipeline(name, SHADER_PACK_PIPELINE_TYPE_COMPUTE, desc.Counts);
+	AddShader(pipeline, desc.CS, SHADER_PACK_STAGE_COMPUTE);
+}
+
+void ShaderPackWriter::AddRaytracingPipeline(const std::string& name, const RAYTRACING_PIPELINE_DESC& desc)
+{
+	SHADER_PACK_PIPELINE& pipeline = BeginPipeline(name, SHADER_PACK_PIPELINE_TYPE_RAYTRACING, desc.Counts);
+	SHADER_PACK_RAYTRACING_STATE& state = pipeline.Raytracing;
+
+	SchemaToPack(GetRaytracingSchema(), &desc, &state);
+	state.FirstHitGroup = (uint32_t)m_HitGroups.size();
+	state.NumHitGroups = (uint32_t)desc.HitGroups.size();
+	for (const RAYTRACING_HIT_GROUP_DESC& hitGroup : desc.HitGroups)
+	{
+		SHADER_PACK_HIT_GROUP packHitGroup = { };
+		packHitGroup.ClosestHit = AddString(hitGroup.ClosestHit);
+		packHitGroup.AnyHit = AddString(hitGroup.AnyHit);
+		packHitGroup.ExportName = AddString(hitGroup.ExportName);
+		m_HitGroups.push_back(packHitGroup);
+	}
+
+	AddShader(pipeline, desc.Library, SHADER_PACK_STAGE_LIBRARY);
+}
+
+void ShaderPackWriter::AddPipelineFromPack(const ShaderPackView& pack, uint32_t pipelineIdx)
+{
+	const SHADER_PACK_PIPELINE& src = pack.GetPipeline(pipelineIdx);
+
+	m_Pipelines.push_back(src);
+	SHADER_PACK_PIPELINE& pipeline = m_Pipelines.back();
+	pipeline.Name = AddString(pack.GetString(src.Name));
+	pipeline.FirstBlob = (uint32_t)m_Blobs.size();
+	pipeline.NumBlobs = 0;
+
+	for (uint32_t i = src.FirstBlob; i < src.FirstBlob + src.NumBlobs; i++)
+	{
+		const SHADER_PACK_BLOB& blob = pack.GetBlob(i);
+		if (blob.Api != m_Api || blob.Flags != m_Flags)
+		{
+			continue;
+		}
+		AddBlob(pipeline, pack.GetBlobData(blob), blob.Size, nullptr, blob.Stage, blob.Api, blob.Flags);
+	}
+
+	pipeline.Graphics.FirstInputItem = (uint32_t)m_InputItems.size();
+	for (uint32_t i = src.Graphics.FirstInputItem; i < src.Graphics.FirstInputItem + src.Graphics.NumInputItems; i++)
+	{
+		SHADER_PACK_INPUT_ITEM item = pack.GetInputItem(i);
+		item.Name = AddString(pack.GetString(item.Name));
+		m_InputItems.push_back(item);
+	}
+
+	pipeline.Raytracing.FirstHitGroup = (uint32_t)m_HitGroups.size();
+	for (uint32_t i = src.Raytracing.FirstHitGroup; i < src.Raytracing.FirstHitGroup + src.Raytracing.NumHitGroups; i++)
+	{
+		SHADER_PACK_HIT_GROUP hitGroup = pack.GetHitGroup(i);
+		hitGroup.ClosestHit = AddString(pack.GetString(hitGroup.ClosestHit));
+		hitGroup.AnyHit = AddString(pack.GetString(hitGroup.AnyHit));
+		hitGroup.ExportName = AddString(pack.GetString(hitGroup.ExportName));
+		m_HitGroups.push_back(hitGroup);
+	}
+}
+
+bool ShaderPackWriter::Write(const std::filesystem::path& path) const
+{
+	SHADER_PACK_HEADER header = { };
+	header.Magic = SHADER_PACK_MAGIC;
+	header.Version = SHADER_PACK_VERSION;
+	header.NumPipelines = (uint32_t)m_Pipelines.size();
+	header.NumBlobs = (uint32_t)m_Blobs.size();
+	header.NumInputItems = (uint32_t)m_InputItems.size();
+	header.NumHitGroups = (uint32_t)m_HitGroups.size();
+
+	uint64_t offset = AlignUp(sizeof(SHADER_PACK_HEADER), SHADER_PACK_ALIGNMENT);
+	header.PipelinesOffset = offset;
+	offset = AlignUp(offset + m_Pipelines.size() * sizeof(SHADER_PACK_PIPELINE), SHADER_PACK_ALIGNMENT);
+	header.BlobsOffset = offset;
+	offset = AlignUp(offset + m_Blobs.size() * sizeof(SHADER_PACK_BLOB), SHADER_PACK_ALIGNMENT);
+	header.InputItemsOffset = offset;
+	offset = AlignUp(offset + m_InputItems.size() * sizeof(SHADER_PACK_INPUT_ITEM), SHADER_PACK_ALIGNMENT);
+	header.HitGroupsOffset = offset;
+	offset = AlignUp(offset + m_HitGroups.size() * sizeof(SHADER_PACK_HIT_GROUP), SHADER_PACK_ALIGNMENT);
+	header.StringsOffset = offset;
+	header.StringsSize = m_Strings.size();
+	offset = AlignUp(offset + m_Strings.size(), SHADER_PACK_ALIGNMENT);
+
+	uint64_t blobDataOffset = offset;
+	header.FileSize = blobDataOffset + m_BlobDataSize;
+
+	std::vector<SHADER_PACK_BLOB> blobs = m_Blobs;
+	for (SHADER_PACK_BLOB& blob : blobs)
+	{
+		blob.Offset += blobDataOffset;
+	}
+
+	// Everything up to the bytecode, zero filled so the alignment padding is deterministic
+	std::string data((size_t)blobDataOffset, '\0');
+	memcpy(&data[0], &header, sizeof(header));
+	if (!m_Pipelines.empty())
+	{
+		memcpy(&data[header.PipelinesOffset], m_Pipelines.data(), m_Pipelines.size() * sizeof(SHADER_PACK_PIPELINE));
+	}
+	if (!blobs.empty())
+	{
+		memcpy(&data[header.BlobsOffset], blobs.data(), blobs.size() * sizeof(SHADER_PACK_BLOB));
+	}
+	if (!m_InputItems.empty())
+	{
+		memcpy(&data[header.InputItemsOffset], m_InputItems.data(), m_InputItems.size() * sizeof(SHADER_PACK_INPUT_ITEM));
+	}
+	if (!m_HitGroups.empty())
+	{
+		memcpy(&data[header.HitGroupsOffset], m_HitGroups.data(), m_HitGroups.size() * sizeof(SHADER_PACK_HIT_GROUP));
+	}
+	if (!m_Strings.empty())
+	{
+		memcpy(&data[header.StringsOffset], m_Strings.data(), m_Strings.size());
+	}
+	// The bytecode goes straight from the blobs into the file
+	auto write = [&](std::ofstream& file) {
+		static const char padding[SHADER_PACK_ALIGNMENT] = { };
+
+		file.write(data.data(), data.size());
+		uint64_t written = blobDataOffset;
+		for (size_t i = 0; i < blobs.size(); i++)
+		{
+			file.write(padding, (std::streamsize)(blobs[i].Offset - written));
+			file.write((const char*)m_BlobData[i].Data, (std::streamsize)blobs[i].Size);
+			written = blobs[i].Offset + blobs[i].Size;
+		}
+		return (bool)file;
+	};
+
+	if (!WriteFileAtomic(path, write))
+	{
+		std::cout << "[ERROR] Failed to write " << path.string() << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+SHADER_PACK_PIPELINE& ShaderPackWriter::BeginPipeline(const std::string& name, ESHADER_PACK_PIPELINE_TYPE type, const PIPELINE_RESOURCE_COUNTERS& counts)
+{
+	SHADER_PACK_PIPELINE pipeline = { };
+	pipeline.Name = AddString(name);
+	pipeline.Type = (uint32_t)type;
+	pipeline.NumConstantBuffers = counts.NumConstantBuffers;
+	pipeline.NumShaderResourceViews = counts.NumShaderResourceViews;
+	pipeline.NumUnorderedAccessViews = counts.NumUnorderedAccessViews;
+	pipeline.NumSamplers = counts.NumSamplers;
+	pipeline.FirstBlob = (uint32_t)m_Blobs.size();
+	pipeline.Graphics.FirstInputItem = (uint32_t)m_InputItems.size();
+	pipeline.Raytracing.FirstHitGroup = (uint32_t)m_HitGroups.size();
+
+	m_Pipelines.push_back(pipeline);
+	return m_Pipelines.back();
+}
+
+void ShaderPackWriter::AddShader(SHADER_PACK_PIPELINE& pipeline, const SHADER& shader, ESHADER_PACK_STAGE stage)
+{
+	const ShaderCompilationType type = m_Api == SHADER_PACK_API_DXIL ? DXIL : SPIRV;
+	const SHADER_BYTECODE* byteCode = shader.FindVariant(type, (CompilerFlags)m_Flags);
+	if (byteCode != nullptr && byteCode->Size() != 0)
+	{
+		AddBlob(pipeline, byteCode->Data(), byteCode->Size(), byteCode->Blob.Ptr, (uint8_t)stage, (uint8_t)m_Api, (uint8_t)m_Flags);
+	}
+}
+
+void ShaderPackWriter::AddBlob(SHADER_PACK_PIPELINE& pipeline, const uint8_t* data, uint64_t size, IDxcBlob* owner, uint8_t stage, uint8_t api, uint8_t flags)
+{
+	SHADER_PACK_BLOB blob = { };
+	blob.Offset = AlignUp(m_BlobDataSize, SHADER_PACK_ALIGNMENT);
+	blob.Size = size;
+	blob.Stage = stage;
+	blob.Api = api;
+	blob.Flags = flags;
+	m_BlobDataSize = blob.Offset + size;
+
+	PACK_BLOB_DATA blobData = { };
+	blobData.Data = data;
+	blobData.Owner = owner;
+	m_BlobData.push_back(blobData);
+
+	m_Blobs.push_back(blob);
+	pipeline.NumBlobs++;
+}
+
+SHADER_PACK_STRING ShaderPackWriter::AddString(std::string_view str)
+{
+	SHADER_PACK_STRING result = { };
+	result.Offset = (uint32_t)m_Strings.size();
+	result.Length = (uint32_t)str.size();
+	m_Strings.append(str);
+	return result;
+}
+
+bool ShaderPackFile::Load(const std::filesystem::path& path)
+{
+	m_Data.clear();
+	m_View = ShaderPackView();
+
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	std::streamoff size = file.tellg();
+	if (size <= 0)
+	{
+		return false;
+	}
+
+	m_Data.resize((size_t)size);
+	file.seekg(0);
+	if (!file.read((char*)m_Data.data(), size))
+	{
+		m_Data.clear();
+		return false;
+	}
+
+	return m_View.Open(m_Data.data(), m_Data.size());
+}
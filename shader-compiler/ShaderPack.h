@@ -0,0 +1,98 @@
+#pragma once
+
+#include "ShaderPackFormat.h"
+#include "Pipeline.h"
+#include <string>
+#include <vector>
+#include <filesystem>
+
+
+/*
+* Builds a shader pack's tables in memory then writes it out in one go.
+* A pack holds a single api and CompilerFlags, the variants of the other
+* targets are left out. Pipelines are either added from freshly compiled
+* descriptors or copied verbatim out of the previous build's pack.
+* Bytecode isn't copied in, the writer keeps a reference to each blob
+* and streams them into the file on Write.
+*/
+class ShaderPackWriter
+{
+public:
+
+	ShaderPackWriter(ESHADER_PACK_API api, uint32_t flags);
+
+	void AddGraphicsPipeline(const std::string& name, const FULL_PIPELINE_DESCRIPTOR& desc);
+
+	void AddComputePipeline(const std::string& name, const COMPUTE_PIPELINE_DESC& desc);
+
+	void AddRaytracingPipeline(const std::string& name, const RAYTRACING_PIPELINE_DESC& desc);
+
+	/*
+	* @brief: Copies a pipeline with its state, strings and bytecode out of another pack.
+	* The bytecode is only referenced, pack has to stay loaded until Write.
+	*/
+	void AddPipelineFromPack(const ShaderPackView& pack, uint32_t pipelineIdx);
+
+	bool Write(const std::filesystem::path& path) const;
+
+private:
+
+	SHADER_PACK_PIPELINE& BeginPipeline(const std::string& name, ESHADER_PACK_PIPELINE_TYPE type, const PIPELINE_RESOURCE_COUNTERS& counts);
+
+	/*
+	* @brief: Adds the pack's variant of shader if it has bytecode
+	*/
+	void AddShader(SHADER_PACK_PIPELINE& pipeline, const SHADER& shader, ESHADER_PACK_STAGE stage);
+
+	/*
+	* @param owner: Kept alive until the writer is destroyed, null if the caller keeps data alive
+	*/
+	void AddBlob(SHADER_PACK_PIPELINE& pipeline, const uint8_t* data, uint64_t size, IDxcBlob* owner, uint8_t stage, uint8_t api, uint8_t flags);
+
+	SHADER_PACK_STRING AddString(std::string_view str);
+
+	ESHADER_PACK_API m_Api;
+	uint32_t m_Flags;
+
+	std::vector<SHADER_PACK_PIPELINE> m_Pipelines;
+
+	typedef struct PACK_BLOB_DATA {
+		const uint8_t* Data;
+		ComPtr<IDxcBlob> Owner;
+	} PACK_BLOB_DATA;
+
+	// Blob offsets are relative to the start of the blob data until Write
+	std::vector<SHADER_PACK_BLOB> m_Blobs;
+	// One per m_Blobs
+	std::vector<PACK_BLOB_DATA> m_BlobData;
+	uint64_t m_BlobDataSize = 0;
+
+	std::vector<SHADER_PACK_INPUT_ITEM> m_InputItems;
+	std::vector<SHADER_PACK_HIT_GROUP> m_HitGroups;
+	std::string m_Strings;
+};
+
+/*
+* A pack read into memory
+*/
+class ShaderPackFile
+{
+public:
+
+	ShaderPackFile() = default;
+
+	/*
+	* @returns: false if the file is missing or isn't a valid pack
+	*/
+	bool Load(const std::filesystem::path& path);
+
+	const ShaderPackView& GetView() const
+	{
+		return m_View;
+	}
+
+private:
+
+	std::vector<uint8_t> m_Data;
+	ShaderPackView m_View;
+};
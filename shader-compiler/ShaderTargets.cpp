@@ -0,0 +1,133 @@
+#include "ShaderTargets.h"
+#include "ShaderCompiler.h"
+#include "nlohmann.hpp"
+#include <fstream>
+#include <iostream>
+
+
+typedef struct SHADER_TARGET_NAME {
+	const char* Name;
+	uint32_t Targets;
+} SHADER_TARGET_NAME;
+
+// Single targets first, ShaderTargetsToStr only uses those
+static const SHADER_TARGET_NAME TargetNames[] = {
+	{ "dxil-debug", ShaderTargetBit(DXIL, WithDebugInfo_NoOptimization) },
+	{ "dxil-release", ShaderTargetBit(DXIL, WithoutDebugInfo_Optimize) },
+	{ "spirv-debug", ShaderTargetBit(SPIRV, WithDebugInfo_NoOptimization) },
+	{ "spirv-release", ShaderTargetBit(SPIRV, WithoutDebugInfo_Optimize) },
+	{ "dxil", ShaderTargetBit(DXIL, WithDebugInfo_NoOptimization) | ShaderTargetBit(DXIL, WithoutDebugInfo_Optimize) },
+	{ "spirv", ShaderTargetBit(SPIRV, WithDebugInfo_NoOptimization) | ShaderTargetBit(SPIRV, WithoutDebugInfo_Optimize) },
+	{ "all", SHADER_TARGETS_ALL },
+};
+
+static constexpr uint32_t NumSingleTargets = (uint32_t)SHADER_COMPILATION_TYPE_NUM * (uint32_t)COMPILER_FLAGS_NUM;
+
+
+bool ParseShaderTargets(const std::string& list, uint32_t& outTargets)
+{
+	outTargets = 0;
+
+	size_t start = 0;
+	while (start <= list.size())
+	{
+		size_t end = list.find(',', start);
+		if (end == std::string::npos)
+		{
+			end = list.size();
+		}
+
+		std::string name = list.substr(start, end - start);
+		name.erase(0, name.find_first_not_of(" \t"));
+		name.erase(name.find_last_not_of(" \t") + 1);
+		start = end + 1;
+
+		if (name.empty())
+		{
+			continue;
+		}
+
+		bool found = false;
+		for (const SHADER_TARGET_NAME& target : TargetNames)
+		{
+			if (name == target.Name)
+			{
+				outTargets |= target.Targets;
+				found = true;
+				break;
+			}
+		}
+
+		if (!found)
+		{
+			std::cout << "[ERROR] Unknown shader target \"" << name << "\"" << std::endl;
+			return false;
+		}
+	}
+
+	return outTargets != 0;
+}
+
+std::string ShaderTargetsToStr(uint32_t targets)
+{
+	std::string out;
+	for (uint32_t i = 0; i < NumSingleTargets; i++)
+	{
+		if (targets & TargetNames[i].Targets)
+		{
+			out += out.empty() ? "" : ",";
+			out += TargetNames[i].Name;
+		}
+	}
+	return out;
+}
+
+bool LoadShaderTargetConfigs(const std::filesystem::path& file, std::map<std::string, uint32_t>& outConfigs)
+{
+	std::ifstream stream(file);
+	if (!stream.is_open())
+	{
+		std::cout << "[ERROR] Failed to open " << file.string() << std::endl;
+		return false;
+	}
+
+	// Exceptions are off, a malformed file is reported instead
+	nlohmann::json json = nlohmann::json::parse(stream, nullptr, false);
+	if (json.is_discarded() || !json.is_object())
+	{
+		std::cout << "[ERROR] " << file.string() << " isn't a json object" << std::endl;
+		return false;
+	}
+
+	for (auto config = json.begin(); config != json.end(); config++)
+	{
+		// Either ["dxil-debug", "spirv-debug"] or "dxil-debug,spirv-debug"
+		std::string list;
+		if (config.value().is_string())
+		{
+			list = config.value().get<std::string>();
+		}
+		else if (config.value().is_array())
+		{
+			for (const nlohmann::json& target : config.value())
+			{
+				if (!target.is_string())
+				{
+					list.clear();
+					break;
+				}
+				list += target.get<std::string>() + ",";
+			}
+		}
+
+		uint32_t targets = 0;
+		if (!ParseShaderTargets(list, targets))
+		{
+			std::cout << "[ERROR] Configuration \"" << config.key() << "\" in " << file.string() << " has no valid targets" << std::endl;
+			return false;
+		}
+		outConfigs[config.key()] = targets;
+	}
+
+	return true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <filesystem>
+#include <stdint.h>
+
+
+/*
+* Which variants a build compiles and ships, as a mask of ShaderTargetBit.
+* Written on the command line as a comma separated list of
+* dxil-debug, dxil-release, spirv-debug and spirv-release.
+* dxil or spirv alone means both of its flags, all means everything.
+*/
+
+/*
+* @returns: false on an unknown target or if the list names none
+*/
+bool ParseShaderTargets(const std::string& list, uint32_t& outTargets);
+
+/*
+* @brief: The mask written back as a list ParseShaderTargets accepts
+*/
+std::string ShaderTargetsToStr(uint32_t targets);
+
+/*
+* @brief: Reads named target lists so a build can just ask for "shipping".
+* {"shipping": ["dxil-release"], "dev": ["dxil-debug", "spirv-debug"]}
+* @returns: false if the file can't be read or an entry doesn't parse
+*/
+bool LoadShaderTargetConfigs(const std::filesystem::path& file, std::map<std::string, uint32_t>& outConfigs);
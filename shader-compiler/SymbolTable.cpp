@@ -0,0 +1,129 @@
+#include "SymbolTable.h"
+#include <string.h>
+
+
+#define SYMBOL_TABLE_INITIAL_SLOTS 256
+#define SYMBOL_TABLE_BLOCK_SIZE 4096
+
+SymbolTable::SymbolTable() :
+	m_BlockUsed(0),
+	m_BlockSize(0)
+{
+	m_Slots.assign(SYMBOL_TABLE_INITIAL_SLOTS, AST_INVALID_SYMBOL);
+}
+
+uint32_t SymbolTable::Hash(std::string_view str)
+{
+	// FNV-1a, identifiers are short enough that anything fancier doesn't pay
+	uint32_t hash = 2166136261u;
+	for (char ch : str)
+	{
+		hash = (hash ^ (uint8_t)ch) * 16777619u;
+	}
+	return hash;
+}
+
+AST_SYMBOL SymbolTable::Find(std::string_view str) const
+{
+	const uint32_t hash = Hash(str);
+	const size_t mask = m_Slots.size() - 1;
+
+	for (size_t slot = hash & mask;; slot = (slot + 1) & mask)
+	{
+		const AST_SYMBOL symbol = m_Slots[slot];
+		if (symbol == AST_INVALID_SYMBOL)
+		{
+			return AST_INVALID_SYMBOL;
+		}
+
+		if (m_Hashes[symbol] == hash && m_Strings[symbol] == str)
+		{
+			return symbol;
+		}
+	}
+}
+
+AST_SYMBOL SymbolTable::Intern(std::string_view str)
+{
+	const uint32_t hash = Hash(str);
+	size_t mask = m_Slots.size() - 1;
+
+	size_t slot = hash & mask;
+	for (;; slot = (slot + 1) & mask)
+	{
+		const AST_SYMBOL symbol = m_Slots[slot];
+		if (symbol == AST_INVALID_SYMBOL)
+		{
+			break;
+		}
+
+		if (m_Hashes[symbol] == hash && m_Strings[symbol] == str)
+		{
+			return symbol;
+		}
+	}
+
+	const AST_SYMBOL symbol = (AST_SYMBOL)m_Strings.size();
+	m_Strings.push_back(Store(str));
+	m_Hashes.push_back(hash);
+
+	// Keep the load under a half so probe chains stay short
+	if (m_Strings.size() * 2 > m_Slots.size())
+	{
+		Grow();
+	}
+	else
+	{
+		m_Slots[slot] = symbol;
+	}
+
+	return symbol;
+}
+
+void SymbolTable::Grow()
+{
+	m_Slots.assign(m_Slots.size() * 2, AST_INVALID_SYMBOL);
+	const size_t mask = m_Slots.size() - 1;
+
+	for (AST_SYMBOL symbol = 0; symbol < (AST_SYMBOL)m_Strings.size(); symbol++)
+	{
+		size_t slot = m_Hashes[symbol] & mask;
+		while (m_Slots[slot] != AST_INVALID_SYMBOL)
+		{
+			slot = (slot + 1) & mask;
+		}
+		m_Slots[slot] = symbol;
+	}
+}
+
+std::string_view SymbolTable::Store(std::string_view str)
+{
+	if (str.empty())
+	{
+		return std::string_view();
+	}
+
+	if (m_Blocks.empty() || m_BlockUsed + str.size() > m_BlockSize)
+	{
+		// Oversized strings get a block of their own
+		m_BlockSize = str.size() > SYMBOL_TABLE_BLOCK_SIZE ? str.size() : SYMBOL_TABLE_BLOCK_SIZE;
+		m_Blocks.push_back(std::make_unique<char[]>(m_BlockSize));
+		m_BlockUsed = 0;
+	}
+
+	char* dst = m_Blocks.back().get() + m_BlockUsed;
+	memcpy(dst, str.data(), str.size());
+	m_BlockUsed += str.size();
+
+	return std::string_view(dst, str.size());
+}
+
+void SymbolTable::Clear()
+{
+	m_Slots.assign(SYMBOL_TABLE_INITIAL_SLOTS, AST_INVALID_SYMBOL);
+	m_Hashes.clear();
+	m_Strings.clear();
+	m_Blocks.clear();
+	m_BlockUsed = 0;
+	m_BlockSize = 0;
+}
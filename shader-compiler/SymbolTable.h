@@ -0,0 +1,137 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+
+typedef uint32_t AST_SYMBOL;
+
+#define AST_INVALID_SYMBOL ((AST_SYMBOL)0xffffffff)
+
+/*
+* Interns identifiers. Every distinct spelling gets one AST_SYMBOL and one
+* copy of its characters, so two symbols are equal exactly when their
+* spelling is, and the views GetString hands out stay valid for as long
+* as the table does.
+* Open addressing over a power of two slot array, Find never allocates.
+*/
+class SymbolTable
+{
+public:
+
+	SymbolTable();
+
+	SymbolTable(const SymbolTable&) = delete;
+	SymbolTable& operator=(const SymbolTable&) = delete;
+
+	/*
+	* @returns: The symbol for str, adding it if it's new
+	*/
+	AST_SYMBOL Intern(std::string_view str);
+
+	/*
+	* @returns: The symbol for str or AST_INVALID_SYMBOL if it was never interned
+	*/
+	AST_SYMBOL Find(std::string_view str) const;
+
+	inline std::string_view GetString(AST_SYMBOL symbol) const
+	{
+		return m_Strings[symbol];
+	}
+
+	inline size_t Count() const
+	{
+		return m_Strings.size();
+	}
+
+	void Clear();
+
+private:
+
+	static uint32_t Hash(std::string_view str);
+
+	void Grow();
+
+	std::string_view Store(std::string_view str);
+
+	// Symbol in each slot, AST_INVALID_SYMBOL if the slot is free
+	std::vector<AST_SYMBOL> m_Slots;
+	std::vector<uint32_t> m_Hashes;
+	std::vector<std::string_view> m_Strings;
+
+	// Characters live in blocks that never move once allocated
+	std::vector<std::unique_ptr<char[]>> m_Blocks;
+	size_t m_BlockUsed;
+	size_t m_BlockSize;
+};
+
+/*
+* Items of type T keyed by symbol. Items are kept in the order they were
+* added, and every symbol maps straight to its item through a flat index,
+* so a lookup is one array read.
+* Pointers returned by Find are valid until the next Insert.
+*/
+template<typename T>
+class SymbolMap
+{
+public:
+
+	/*
+	* @returns: false if symbol already has an item, item is left untouched then
+	*/
+	inline bool Insert(AST_SYMBOL symbol, T&& item)
+	{
+		if (symbol >= m_IndexOfSymbol.size())
+		{
+			m_IndexOfSymbol.resize((size_t)symbol + 1, AST_INVALID_SYMBOL);
+		}
+		else if (m_IndexOfSymbol[symbol] != AST_INVALID_SYMBOL)
+		{
+			return false;
+		}
+
+		m_IndexOfSymbol[symbol] = (uint32_t)m_Items.size();
+		m_Items.push_back(std::move(item));
+		return true;
+	}
+
+	inline const T* Find(AST_SYMBOL symbol) const
+	{
+		if (symbol >= m_IndexOfSymbol.size() || m_IndexOfSymbol[symbol] == AST_INVALID_SYMBOL)
+		{
+			return nullptr;
+		}
+		return &m_Items[m_IndexOfSymbol[symbol]];
+	}
+
+	inline bool Contains(AST_SYMBOL symbol) const
+	{
+		return Find(symbol) != nullptr;
+	}
+
+	inline size_t Count() const
+	{
+		return m_Items.size();
+	}
+
+	/*
+	* @returns: Every item in the order it was added
+	*/
+	inline const std::vector<T>& GetItems() const
+	{
+		return m_Items;
+	}
+
+	inline void Clear()
+	{
+		m_IndexOfSymbol.clear();
+		m_Items.clear();
+	}
+
+private:
+
+	std::vector<uint32_t> m_IndexOfSymbol;
+	std::vector<T> m_Items;
+};
@@ -40,57 +40,61 @@ std::string GetFileSuffix(const std::string& filename) {
 
 std::string ReadEntireFile(const std::string& filename)
 {
-	std::ifstream file(filename);
+	// Binary so the size we ask for is the size we get, the lexer
+	// treats '\r' as whitespace so CRLF files don't need translating
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
 	if (!file.is_open())
 	{
-		std::cout << "fkfkfkf" << std::endl;
+		std::cout << "[ERROR] Failed to open " << filename << std::endl;
+		return std::string();
 	}
-	std::ostringstream ss;
-	ss << file.rdbuf();  // Read the whole file into the stream buffer
-	return ss.str();     // Convert to std::string
+
+	std::string result;
+	result.resize((size_t)file.tellg());
+	file.seekg(0);
+	file.read(result.data(), result.size());
+	result.resize((size_t)file.gcount());
+	return result;
 }
 
+bool WriteFileAtomic(const std::filesystem::path& path, const std::string& data)
+{
+	return WriteFileAtomic(path, [&data](std::ofstream& file) {
+		file.write(data.data(), data.size());
+		return (bool)file;
+	});
+}
 
-std::string RemoveHLSLComments(const std::string& source)
+bool WriteFileAtomic(const std::filesystem::path& path, const std::function<bool(std::ofstream&)>& write)
 {
-	std::string result;
-	bool inSingleLineComment = false;
-	bool inMultiLineComment = false;
-
-	for (size_t i = 0; i < source.length(); ++i) {
-		if (!inSingleLineComment && !inMultiLineComment) {
-			if (source[i] == '/' && i + 1 < source.length()) {
-				if (source[i + 1] == '/') {
-					inSingleLineComment = true;
-					++i; // skip the next '/'
-					continue;
-				}
-				else if (source[i + 1] == '*') {
-					inMultiLineComment = true;
-					++i; // skip the next '*'
-					continue;
-				}
-			}
-			result += source[i];
-		}
-		else if (inSingleLineComment) {
-			if (source[i] == '\n') {
-				inSingleLineComment = false;
-				result += '\n'; // preserve newline
-			}
+	std::filesystem::path tempPath = path;
+	tempPath += ".tmp";
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			return false;
 		}
-		else if (inMultiLineComment) {
-			if (source[i] == '*' && i + 1 < source.length() && source[i + 1] == '/') {
-				inMultiLineComment = false;
-				++i; // skip the '/'
-			}
-			else if (source[i] == '\n') {
-				result += '\n'; // preserve newline
-			}
+
+		if (!write(file) || !file)
+		{
+			file.close();
+			std::error_code ec;
+			std::filesystem::remove(tempPath, ec);
+			return false;
 		}
 	}
 
-	return result;
+	std::error_code ec;
+	std::filesystem::rename(tempPath, path, ec);
+	if (ec)
+	{
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+
+	return true;
 }
 
 void IPrintHandler::Error(const char* fmt, ...)
@@ -124,4 +128,4 @@ void IPrintHandler::Message(const char* fmt, ...)
 	va_end(args);
 
 	this->MessageImpl(buffer);
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <sstream>
 #include <filesystem>
 #include <iostream>
+#include <functional>
 
 bool IsWhiteSpace(const std::string& TestStr);
 
@@ -15,7 +16,17 @@ std::string GetFileSuffix(const std::string& filename);
 
 std::string ReadEntireFile(const std::string& filename);
 
-std::string RemoveHLSLComments(const std::string& source);
+/*
+* @brief: Writes to a temp file next to path then renames it over path,
+* readers never see a partially written file.
+*/
+bool WriteFileAtomic(const std::filesystem::path& path, const std::string& data);
+
+/*
+* @brief: Same, but write streams the contents into the temp file
+* so they never have to be in memory all at once
+*/
+bool WriteFileAtomic(const std::filesystem::path& path, const std::function<bool(std::ofstream&)>& write);
 
 class IPrintHandler
 {
@@ -48,4 +59,4 @@ public:
 	{
 		std::cout << "[MSG] " << message << std::endl;
 	}
-};
\ No newline at end of file
+};
\ No newline at end of file
@@ -5,12 +5,16 @@
 #include "RaytracingAST.h"
 #include "ShaderCompiler.h"
 #include "PipelineCompiler.h"
+#include "FileWatcher.h"
+#include "CompileWorkerProcess.h"
+#include "ShaderTargets.h"
 
 
 struct ShaderCompilerArgs : public argparse::Args
 {
 	std::string& ShaderFolder = kwarg("s,shaders", "The folder containing the shaders you wish to compile");
 	std::string& ShaderModel = kwarg("m,model", "The shader model you want to compile your shaders to. Uses direct3d shaders models. Eg. 6_5");
+	std::string& OutputFolder = kwarg("o,output", "The folder the compiled pipelines and dependency database are written to");
 
 	std::string& D3DExtraFlags = kwarg("d3d,d3d-extra", "Extra flags to compile your DirectX shaders with").set_default("");
 	std::string& VKExtraFlags = kwarg("vk,vk-extra", "Extra flags to compile your Vulkan shaders with").set_default("");
@@ -20,10 +24,37 @@ struct ShaderCompilerArgs : public argparse::Args
 
 	std::string& D3DReleaseOverride = kwarg("d3dro,d3d-release-override", "Completely override flags that DirectX shaders compile with in release mode. Default flags: \"-O3\"").set_default("");
 	std::string& VKReleaseOverride = kwarg("vkro,vk-release-override", "Completely override flags that Vulkan shaders compile with in release mode. Default flags: \"-O3 -spirv\"").set_default("");
+
+	std::string& Targets = kwarg("t,targets", "Only compile and write these variants. A comma separated list of dxil-debug, dxil-release, spirv-debug and spirv-release, dxil or spirv for both of theirs, or the name of a configuration in --target-config. Defaults to all").set_default("");
+	std::string& TargetConfig = kwarg("target-config", "Json file naming lists of targets, {\"shipping\": [\"dxil-release\"]}. Defaults to <shaders>/ShaderTargets.json if there is one").set_default("");
+
+	int& Jobs = kwarg("j,jobs", "Number of shaders to compile in parallel. 0 uses one per hardware thread").set_default(0);
+	bool& WorkerProcesses = flag("worker-processes", "Run DXC in a child process per job, a shader that crashes DXC only fails itself instead of the whole build");
+	int& WorkerTimeout = kwarg("worker-timeout", "Seconds a --worker-processes child gets to compile one shader before it's killed as hung and the shader retried. 0 waits forever").set_default(300);
+	int& MaxHeavyCompiles = kwarg("max-heavy-compiles", "Shaders that took far longer than average last build allowed to compile at once. 0 uses half of --jobs").set_default(0);
+	int& ReadJobs = kwarg("read-jobs", "Threads reading pipeline sources. 0 picks a default").set_default(0);
+	int& FrontEndJobs = kwarg("frontend-jobs", "Threads parsing pipelines while DXC compiles. 0 picks a default").set_default(0);
+	int& EncodeJobs = kwarg("encode-jobs", "Threads serializing compiled pipelines. 0 picks a default").set_default(0);
+	int& WriteJobs = kwarg("write-jobs", "Threads writing pipelines out. 0 picks a default").set_default(0);
+	int& QueueDepth = kwarg("queue-depth", "Pipelines queued between two build stages before the earlier one waits. 0 picks a default").set_default(0);
+
+	std::string& CacheDir = kwarg("c,cache", "Directory of the compile cache. Defaults to <shaders>/.shadercache").set_default("");
+	int& CacheSize = kwarg("cache-size", "Maximum size of the compile cache in megabytes").set_default(1024);
+	bool& NoCache = flag("no-cache", "Always invoke dxc, don't read or write the compile cache");
+
+	bool& Watch = flag("w,watch", "Keep running and recompile the affected pipelines whenever a shader or include changes");
+
+	bool& Json = flag("json", "Also write the pipelines as json next to the packs, for debugging");
 };
 
 int main(int argc, char** argv)
 {
+	// Started by ourselves with --worker-processes, see CompileWorkerProcess
+	if (argc == 3 && strcmp(argv[1], "--compile-worker") == 0)
+	{
+		return RunCompileWorker(argv[2]);
+	}
+
 	auto args = argparse::parse<ShaderCompilerArgs>(argc, argv);
 
 	{
@@ -38,6 +69,11 @@ int main(int argc, char** argv)
 			std::cout << "[ERROR] -m,--model MUST be set" << std::endl;
 			hasError = true;
 		}
+		if (args.OutputFolder == "")
+		{
+			std::cout << "[ERROR] -o,--output MUST be set" << std::endl;
+			hasError = true;
+		}
 
 		if (hasError)
 		{
@@ -47,6 +83,40 @@ int main(int argc, char** argv)
 
 	ShaderCompiler compiler(std::filesystem::path(args.ShaderFolder));
 
+	if (args.Jobs < 0)
+	{
+		std::cout << "[ERROR] -j,--jobs can't be negative" << std::endl;
+		exit(1);
+	}
+	compiler.SetNumJobs((uint32_t)args.Jobs);
+
+	if (args.MaxHeavyCompiles < 0)
+	{
+		std::cout << "[ERROR] --max-heavy-compiles can't be negative" << std::endl;
+		exit(1);
+	}
+	compiler.SetMaxHeavyCompiles((uint32_t)args.MaxHeavyCompiles);
+	compiler.SetWorkerProcesses(args.WorkerProcesses);
+
+	if (args.WorkerTimeout < 0)
+	{
+		std::cout << "[ERROR] --worker-timeout can't be negative" << std::endl;
+		exit(1);
+	}
+	compiler.SetWorkerProcessTimeout((uint32_t)args.WorkerTimeout);
+
+	if (!args.NoCache)
+	{
+		std::filesystem::path cacheDir = args.CacheDir.empty() ?
+			std::filesystem::path(args.ShaderFolder) / ".shadercache" :
+			std::filesystem::path(args.CacheDir);
+
+		if (!compiler.EnableCache(cacheDir, (uint64_t)std::max(args.CacheSize, 0) * 1024 * 1024))
+		{
+			std::cout << "[WARN] Continuing without the compile cache" << std::endl;
+		}
+	}
+
 	if (!compiler.InitializeDxcResources())
 	{
 		std::cout << "[ERROR] Failed to initalize dxc resources" << std::endl;
@@ -86,14 +156,116 @@ int main(int argc, char** argv)
 		compiler.SetVulkanOverrideFlags(WithoutDebugInfo_Optimize, args.VKReleaseOverride);
 	}
 
+	if (!args.Targets.empty())
+	{
+		std::filesystem::path configFile = args.TargetConfig.empty() ?
+			std::filesystem::path(args.ShaderFolder) / "ShaderTargets.json" :
+			std::filesystem::path(args.TargetConfig);
+
+		std::map<std::string, uint32_t> configs;
+		if ((!args.TargetConfig.empty() || std::filesystem::exists(configFile)) && !LoadShaderTargetConfigs(configFile, configs))
+		{
+			exit(1);
+		}
+
+		uint32_t targets = 0;
+		auto findRes = configs.find(args.Targets);
+		if (findRes != configs.end())
+		{
+			targets = findRes->second;
+		}
+		else if (!ParseShaderTargets(args.Targets, targets))
+		{
+			std::cout << "[ERROR] -t,--targets is neither a configuration nor a list of targets" << std::endl;
+			exit(1);
+		}
+
+		compiler.SetTargets(targets);
+		std::cout << "[INFO] Compiling targets: " << ShaderTargetsToStr(targets) << std::endl;
+	}
+
 	if (!compiler.SetupArgs())
 	{
 		std::cout << "[ERROR] Failed to setup arguments for the compiler" << std::endl;
 		exit(1);
 	}
 
+	if (args.ReadJobs < 0 || args.FrontEndJobs < 0 || args.EncodeJobs < 0 || args.WriteJobs < 0 || args.QueueDepth < 0)
+	{
+		std::cout << "[ERROR] --read-jobs, --frontend-jobs, --encode-jobs, --write-jobs and --queue-depth can't be negative" << std::endl;
+		exit(1);
+	}
+
+	PIPELINE_BUILD_JOBS buildJobs = { };
+	buildJobs.Read = (uint32_t)args.ReadJobs;
+	buildJobs.FrontEnd = (uint32_t)args.FrontEndJobs;
+	buildJobs.Encode = (uint32_t)args.EncodeJobs;
+	buildJobs.Write = (uint32_t)args.WriteJobs;
+	buildJobs.QueueDepth = (uint32_t)args.QueueDepth;
+
 	PipelineCompiler pipelineCompiler(&compiler);
+	pipelineCompiler.SetBuildJobs(buildJobs);
 
 	pipelineCompiler.SetSrcDir(args.ShaderFolder);
-	pipelineCompiler.Load();
+	pipelineCompiler.SetDstDir(args.OutputFolder);
+	pipelineCompiler.SetWriteJson(args.Json);
+
+	// Still write out whatever did compile, the failed pipelines keep their
+	// last good build and are left out of the dependency database
+	bool succeeded = pipelineCompiler.Load();
+	succeeded &= pipelineCompiler.WriteToFile();
+
+	if (!args.Watch)
+	{
+		return succeeded ? 0 : 1;
+	}
+
+	FileWatcher watcher;
+	for (;;)
+	{
+		// Includes can come and go between builds
+		std::set<std::filesystem::path> dirs;
+		pipelineCompiler.GetInputDirectories(dirs);
+		for (const std::filesystem::path& dir : dirs)
+		{
+			watcher.AddDirectory(dir);
+		}
+
+		std::cout << "[INFO] Watching for changes..." << std::endl;
+
+		std::vector<std::filesystem::path> changed;
+		if (!watcher.WaitForChanges(changed, 100))
+		{
+			return 1;
+		}
+
+		bool anyInputs = false;
+		for (const std::filesystem::path& path : changed)
+		{
+			if (pipelineCompiler.IsInput(path))
+			{
+				std::cout << "[INFO] Changed: " << path.string() << std::endl;
+				anyInputs = true;
+			}
+		}
+
+		if (!anyInputs)
+		{
+			continue;
+		}
+
+		// Only the pipelines depending on what changed are out
+		// of date, everything else is skipped by the dependency database
+		bool rebuilt = pipelineCompiler.Load();
+		rebuilt &= pipelineCompiler.WriteToFile();
+
+		if (rebuilt)
+		{
+			std::cout << "[INFO] Rebuild succeeded" << std::endl;
+		}
+		else
+		{
+			std::cout << "[ERROR] Rebuild failed, keeping the last good output of the failed pipelines" << std::endl;
+		}
+	}
 }
\ No newline at end of file